@@ -1,4 +1,4 @@
-QT  += core gui widgets network charts
+QT  += core gui widgets network charts concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -10,19 +10,65 @@ CONFIG += c++17
 
 SOURCES += \
     #apiManager.cpp \
+    apicache.cpp \
+    connectivitymonitor.cpp \
+    fetchscheduler.cpp \
+    filehistorystorage.cpp \
+    geocodecache.cpp \
+    historybenchmark.cpp \
+    historylock.cpp \
     historymanager.cpp \
+    historystorage.cpp \
+    historywriter.cpp \
+    jsonstreamparser.cpp \
     main.cpp \
     mainwindow.cpp \
+    ratelimiter.cpp \
+    requestbroker.cpp \
+    sensorcatalog.cpp \
+    seriesstore.cpp \
+    sessioncodec.cpp \
+    sessiondocument.cpp \
+    sessionfilter.cpp \
+    sessionindex.cpp \
+    sessionmanifest.cpp \
     window_2_data_vis.cpp
 
 
 HEADERS += \
     #apiManager.h \
+    apicache.h \
+    connectivitymonitor.h \
+    fetchscheduler.h \
+    filehistorystorage.h \
+    geocodecache.h \
+    historybenchmark.h \
+    historylock.h \
     historymanager.h \
+    historystorage.h \
+    historywriter.h \
+    jsonstreamparser.h \
     mainwindow.h \
+    ratelimiter.h \
+    requestbroker.h \
+    sensorcatalog.h \
+    seriesstore.h \
+    sessioncodec.h \
+    sessiondocument.h \
+    sessionfilter.h \
+    sessionindex.h \
+    sessionmanifest.h \
     window_2_data_vis.h
 
 
+# Optional SQLite history storage (selected with storage/backend=sqlite in history.ini)
+qtHaveModule(sql) {
+    QT += sql
+    DEFINES += HISTORY_SQLITE_BACKEND
+    SOURCES += sqlitehistorystorage.cpp
+    HEADERS += sqlitehistorystorage.h
+}
+
 FORMS += \
     mainwindow.ui \
     window_2_data_vis.ui
@@ -0,0 +1,201 @@
+#include "apicache.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QLocale>
+#include <QNetworkDiskCache>
+#include <QStandardPaths>
+#include <QDebug>
+#include <memory>
+
+namespace {
+
+/**
+ * @brief Czas ważności odpowiedzi punktu końcowego API GIOŚ.
+ */
+struct EndpointTtl {
+    const char *path; ///< Fragment ścieżki adresu punktu końcowego.
+    int seconds;      ///< Czas ważności odpowiedzi w sekundach.
+};
+
+// The station catalog and station sensors change very rarely; measurements and the index hourly
+const EndpointTtl ENDPOINT_TTLS[] = {
+    {"/pjp-api/rest/station/findAll", 24 * 3600},
+    {"/pjp-api/rest/station/sensors/", 24 * 3600},
+    {"/pjp-api/rest/data/getData/", 10 * 60},
+    {"/pjp-api/rest/aqindex/getIndex/", 10 * 60},
+};
+
+ApiCache::Stats cacheStats;
+
+} // namespace
+
+/**
+ * @brief Konstruktor klasy ApiCache.
+ *
+ * @param manager Menedżer sieciowy, którego odpowiedzi są zliczane (staje się rodzicem).
+ */
+ApiCache::ApiCache(QNetworkAccessManager *manager)
+    : QAbstractNetworkCache(manager) {
+    connect(manager, &QNetworkAccessManager::finished, this, &ApiCache::recordReply);
+}
+
+/**
+ * @brief Instaluje pamięć podręczną w menedżerze sieciowym.
+ *
+ * Menedżer przejmuje obiekt ApiCache na własność.
+ *
+ * @param manager Menedżer sieciowy.
+ */
+void ApiCache::install(QNetworkAccessManager *manager) {
+    manager->setCache(new ApiCache(manager));
+}
+
+/**
+ * @brief Zwraca statystyki wszystkich menedżerów.
+ *
+ * @return Statystyki od uruchomienia aplikacji.
+ */
+ApiCache::Stats ApiCache::stats() {
+    return cacheStats;
+}
+
+/**
+ * @brief Zwraca czas ważności odpowiedzi punktu końcowego.
+ *
+ * @param url Adres żądania.
+ * @return Czas ważności w sekundach lub 0 dla adresów bez ustalonego czasu.
+ */
+int ApiCache::ttlSeconds(const QUrl &url) {
+    if (url.host() != "api.gios.gov.pl") {
+        return 0;
+    }
+    const QString path = url.path();
+    for (const EndpointTtl &endpoint : ENDPOINT_TTLS) {
+        if (path.startsWith(QLatin1String(endpoint.path))) {
+            return endpoint.seconds;
+        }
+    }
+    return 0;
+}
+
+QNetworkCacheMetaData ApiCache::metaData(const QUrl &url) {
+    return diskCache()->metaData(url);
+}
+
+/**
+ * @brief Aktualizuje metadane po odpowiedzi 304, odnawiając czas ważności.
+ *
+ * @param metaData Metadane odpowiedzi.
+ */
+void ApiCache::updateMetaData(const QNetworkCacheMetaData &metaData) {
+    diskCache()->updateMetaData(withTtl(metaData));
+}
+
+QIODevice *ApiCache::data(const QUrl &url) {
+    return diskCache()->data(url);
+}
+
+bool ApiCache::remove(const QUrl &url) {
+    return diskCache()->remove(url);
+}
+
+qint64 ApiCache::cacheSize() const {
+    return diskCache()->cacheSize();
+}
+
+/**
+ * @brief Przygotowuje zapis odpowiedzi z czasem ważności punktu końcowego.
+ *
+ * @param metaData Metadane odpowiedzi.
+ * @return Urządzenie, do którego zapisywana jest treść odpowiedzi, lub nullptr.
+ */
+QIODevice *ApiCache::prepare(const QNetworkCacheMetaData &metaData) {
+    return diskCache()->prepare(withTtl(metaData));
+}
+
+void ApiCache::insert(QIODevice *device) {
+    diskCache()->insert(device);
+}
+
+void ApiCache::clear() {
+    diskCache()->clear();
+}
+
+/**
+ * @brief Zlicza zakończoną odpowiedź w statystykach.
+ *
+ * Liczone są tylko udane odpowiedzi punktów końcowych z ustalonym czasem ważności.
+ *
+ * @param reply Odpowiedź sieciowa.
+ */
+void ApiCache::recordReply(QNetworkReply *reply) {
+    if (reply->error() != QNetworkReply::NoError || reply->operation() != QNetworkAccessManager::GetOperation
+        || ttlSeconds(reply->url()) == 0) {
+        return;
+    }
+    if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool()) {
+        cacheStats.hits++;
+        std::unique_ptr<QIODevice> cached(diskCache()->data(reply->url()));
+        if (cached) {
+            cacheStats.bytesSaved += cached->size();
+        }
+    } else {
+        cacheStats.misses++;
+    }
+    qDebug() << "HTTP cache hit ratio:" << QString::number(cacheStats.hitRatio() * 100.0, 'f', 1) << "% of"
+             << (cacheStats.hits + cacheStats.misses) << "replies, saved" << cacheStats.bytesSaved << "bytes";
+}
+
+/**
+ * @brief Nadaje metadanym czas ważności punktu końcowego.
+ *
+ * Nagłówki Cache-Control, Pragma i Expires serwera są pomijane, a nagłówek Date jest
+ * ustawiany na chwilę zapisu, więc odpowiedź jest świeża przez czas ważności liczony
+ * od pobrania lub ostatniej odpowiedzi 304. Nagłówki ETag i Last-Modified pozostają
+ * i służą do ponownej weryfikacji. Zapisywane są tylko odpowiedzi 200.
+ *
+ * @param metaData Metadane odpowiedzi.
+ * @return Metadane z czasem ważności.
+ */
+QNetworkCacheMetaData ApiCache::withTtl(const QNetworkCacheMetaData &metaData) {
+    int ttl = ttlSeconds(metaData.url());
+    if (ttl == 0 || metaData.attributes().value(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        return metaData;
+    }
+
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    QNetworkCacheMetaData::RawHeaderList headers;
+    const QNetworkCacheMetaData::RawHeaderList rawHeaders = metaData.rawHeaders();
+    for (const QNetworkCacheMetaData::RawHeader &header : rawHeaders) {
+        QByteArray name = header.first.toLower();
+        if (name != "cache-control" && name != "pragma" && name != "expires" && name != "date") {
+            headers.append(header);
+        }
+    }
+    headers.append({"Date", QLocale::c().toString(now, "ddd, dd MMM yyyy hh:mm:ss 'GMT'").toLatin1()});
+
+    QNetworkCacheMetaData result = metaData;
+    result.setRawHeaders(headers);
+    result.setExpirationDate(now.addSecs(ttl));
+    result.setSaveToDisk(true);
+    return result;
+}
+
+/**
+ * @brief Zwraca wspólną pamięć podręczną na dysku.
+ *
+ * Pamięć jest tworzona przy pierwszym użyciu w katalogu <CacheLocation>/http i należy
+ * do obiektu aplikacji. Wszystkie menedżery sieciowe działają w wątku interfejsu,
+ * więc dostęp nie wymaga synchronizacji.
+ *
+ * @return Pamięć podręczna współdzielona przez wszystkie obiekty ApiCache.
+ */
+QNetworkDiskCache *ApiCache::diskCache() {
+    static QNetworkDiskCache *cache = [] {
+        QNetworkDiskCache *diskCache = new QNetworkDiskCache(QCoreApplication::instance());
+        diskCache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/http");
+        diskCache->setMaximumCacheSize(MAX_CACHE_SIZE);
+        return diskCache;
+    }();
+    return cache;
+}
@@ -0,0 +1,107 @@
+#ifndef APICACHE_H
+#define APICACHE_H
+
+#include <QAbstractNetworkCache>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+class QNetworkDiskCache;
+
+/**
+ * @class ApiCache
+ * @brief Pamięć podręczna odpowiedzi HTTP z czasami ważności dla punktów końcowych API GIOŚ.
+ *
+ * Każdy QNetworkAccessManager dostaje własny obiekt ApiCache, a wszystkie przekazują
+ * zapis i odczyt do jednej, wspólnej pamięci QNetworkDiskCache w katalogu pamięci
+ * podręcznej aplikacji. Odpowiedzi punktów końcowych z tabeli czasów ważności są
+ * zapisywane niezależnie od nagłówków Cache-Control serwera: do upływu czasu ważności
+ * są zwracane bez połączenia z siecią, a potem QNetworkAccessManager ponawia żądanie
+ * z nagłówkami If-None-Match/If-Modified-Since i przy odpowiedzi 304 korzysta z kopii.
+ * Pozostałe odpowiedzi są zapisywane zgodnie z nagłówkami serwera.
+ *
+ * Klasa zlicza trafienia (odpowiedzi z kopii, także po odpowiedzi 304), pobrania
+ * i zaoszczędzone bajty dla wszystkich menedżerów razem (stats()).
+ */
+class ApiCache : public QAbstractNetworkCache
+{
+    Q_OBJECT
+public:
+    /**
+     * @struct Stats
+     * @brief Statystyki pamięci podręcznej od uruchomienia aplikacji.
+     */
+    struct Stats {
+        qint64 hits = 0;       ///< Odpowiedzi zwrócone z pamięci podręcznej.
+        qint64 misses = 0;     ///< Odpowiedzi pobrane w całości z sieci.
+        qint64 bytesSaved = 0; ///< Bajty odpowiedzi zwróconych z pamięci podręcznej.
+
+        /**
+         * @brief Zwraca odsetek trafień.
+         * @return Trafienia jako ułamek wszystkich odpowiedzi (0, jeśli nie było odpowiedzi).
+         */
+        double hitRatio() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0; }
+    };
+
+    /**
+     * @brief Konstruktor klasy ApiCache.
+     * @param manager Menedżer sieciowy, którego odpowiedzi są zliczane (staje się rodzicem).
+     */
+    explicit ApiCache(QNetworkAccessManager *manager);
+
+    /**
+     * @brief Instaluje pamięć podręczną w menedżerze sieciowym.
+     * @param manager Menedżer sieciowy.
+     */
+    static void install(QNetworkAccessManager *manager);
+
+    /**
+     * @brief Zwraca statystyki wszystkich menedżerów.
+     * @return Statystyki od uruchomienia aplikacji.
+     */
+    static Stats stats();
+
+    /**
+     * @brief Zwraca czas ważności odpowiedzi punktu końcowego.
+     * @param url Adres żądania.
+     * @return Czas ważności w sekundach lub 0 dla adresów bez ustalonego czasu.
+     */
+    static int ttlSeconds(const QUrl &url);
+
+    QNetworkCacheMetaData metaData(const QUrl &url) override;
+    void updateMetaData(const QNetworkCacheMetaData &metaData) override;
+    QIODevice *data(const QUrl &url) override;
+    bool remove(const QUrl &url) override;
+    qint64 cacheSize() const override;
+    QIODevice *prepare(const QNetworkCacheMetaData &metaData) override;
+    void insert(QIODevice *device) override;
+
+public slots:
+    void clear() override;
+
+private:
+    /**
+     * @brief Zlicza zakończoną odpowiedź w statystykach.
+     * @param reply Odpowiedź sieciowa.
+     */
+    void recordReply(QNetworkReply *reply);
+
+    /**
+     * @brief Nadaje metadanym czas ważności punktu końcowego.
+     * @param metaData Metadane odpowiedzi.
+     * @return Metadane z czasem ważności (bez zmian dla adresów bez ustalonego czasu).
+     */
+    static QNetworkCacheMetaData withTtl(const QNetworkCacheMetaData &metaData);
+
+    /**
+     * @brief Zwraca wspólną pamięć podręczną na dysku.
+     * @return Pamięć podręczna współdzielona przez wszystkie obiekty ApiCache.
+     */
+    static QNetworkDiskCache *diskCache();
+
+    /**
+     * @brief Maksymalny rozmiar pamięci podręcznej na dysku (w bajtach).
+     */
+    static const qint64 MAX_CACHE_SIZE = 64 * 1024 * 1024;
+};
+
+#endif // APICACHE_H
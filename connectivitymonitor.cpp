@@ -0,0 +1,169 @@
+#include "connectivitymonitor.h"
+#include <QCoreApplication>
+#include <QNetworkRequest>
+#include <QDebug>
+
+/**
+ * @brief Zwraca wspólny monitor, tworząc go przy pierwszym użyciu.
+ *
+ * @return Monitor należący do obiektu aplikacji.
+ */
+ConnectivityMonitor *ConnectivityMonitor::instance() {
+    static ConnectivityMonitor *monitor = new ConnectivityMonitor(QCoreApplication::instance());
+    return monitor;
+}
+
+/**
+ * @brief Konstruktor klasy ConnectivityMonitor.
+ *
+ * Ładuje domyślny moduł QNetworkInformation. Jeśli system nie zgłasza osiągalności,
+ * stan początkowy (połączenie dostępne) jest od razu weryfikowany asynchronicznie.
+ *
+ * @param parent Wskaźnik na obiekt nadrzędny.
+ */
+ConnectivityMonitor::ConnectivityMonitor(QObject *parent)
+    : QObject(parent), m_probeManager(new QNetworkAccessManager(this)), m_pendingProbes(0), m_probeSucceeded(false), m_online(true) {
+    m_probeTimer.setSingleShot(true);
+    connect(&m_probeTimer, &QTimer::timeout, this, &ConnectivityMonitor::probe);
+
+    if (QNetworkInformation::loadDefaultBackend()
+        && QNetworkInformation::instance()->supports(QNetworkInformation::Feature::Reachability)) {
+        QNetworkInformation *information = QNetworkInformation::instance();
+        qDebug() << "Using network information backend:" << information->backendName();
+        connect(information, &QNetworkInformation::reachabilityChanged, this, &ConnectivityMonitor::onReachabilityChanged);
+        onReachabilityChanged(information->reachability());
+    } else {
+        qDebug() << "No network information backend, checking connectivity with HEAD requests";
+        probe();
+    }
+}
+
+/**
+ * @brief Obserwuje odpowiedzi menedżera sieciowego.
+ *
+ * @param manager Menedżer sieciowy.
+ */
+void ConnectivityMonitor::watch(QNetworkAccessManager *manager) {
+    connect(manager, &QNetworkAccessManager::finished, this, &ConnectivityMonitor::reportReply);
+}
+
+/**
+ * @brief Zgłasza wynik żądania sieciowego.
+ *
+ * Odpowiedź z kodem HTTP (także błędu serwera) oznacza połączenie, a błąd na poziomie
+ * sieci jego brak. Odpowiedzi z pamięci podręcznej nie zmieniają stanu.
+ *
+ * @param reply Zakończona odpowiedź.
+ */
+void ConnectivityMonitor::reportReply(QNetworkReply *reply) {
+    if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool()) {
+        return;
+    }
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+        setOnline(true);
+    } else if (isConnectivityError(reply->error())) {
+        qDebug() << "Request to" << reply->url().host() << "failed without a response:" << reply->errorString();
+        setOnline(false);
+    }
+}
+
+/**
+ * @brief Ustawia stan połączenia i planuje sprawdzenie, gdy połączenia nie ma.
+ *
+ * @param online Nowy stan połączenia.
+ */
+void ConnectivityMonitor::setOnline(bool online) {
+    if (online) {
+        m_probeTimer.stop();
+    } else if (!m_probeTimer.isActive() && m_pendingProbes == 0) {
+        m_probeTimer.start(PROBE_INTERVAL_MS);
+    }
+    if (m_online == online) {
+        return;
+    }
+    m_online = online;
+    qDebug() << (online ? "Internet connection is available" : "Internet connection is unavailable");
+    emit onlineChanged(online);
+}
+
+/**
+ * @brief Wysyła asynchroniczne żądania sprawdzające połączenie.
+ *
+ * Żądania HEAD trafiają równolegle do znanych adresów; połączenie jest dostępne,
+ * jeśli odpowie którykolwiek z nich. Kolejne sprawdzenie nie jest wysyłane,
+ * dopóki poprzednie trwa.
+ */
+void ConnectivityMonitor::probe() {
+    if (m_pendingProbes > 0) {
+        return;
+    }
+    m_probeSucceeded = false;
+    const QStringList endpoints = {"https://www.google.com", "https://cloudflare.com"};
+    for (const QString &endpoint : endpoints) {
+        QNetworkRequest request{QUrl(endpoint)};
+        request.setHeader(QNetworkRequest::UserAgentHeader, "AirQualityApp/1.0");
+        request.setTransferTimeout(PROBE_TIMEOUT_MS);
+        QNetworkReply *reply = m_probeManager->head(request);
+        m_pendingProbes++;
+        qDebug() << "Checking connectivity with HEAD request to:" << endpoint;
+
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            reply->deleteLater();
+            m_pendingProbes--;
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+                if (!m_probeSucceeded) {
+                    qDebug() << "HEAD request to" << reply->url().toString() << "succeeded. Internet is connected.";
+                    m_probeSucceeded = true;
+                    setOnline(true);
+                }
+            } else {
+                qDebug() << "HEAD request to" << reply->url().toString() << "failed:" << reply->errorString();
+            }
+            if (m_pendingProbes == 0 && !m_probeSucceeded) {
+                setOnline(false);
+            }
+        });
+    }
+}
+
+/**
+ * @brief Obsługuje zmianę osiągalności zgłoszoną przez system.
+ *
+ * Sieć lokalna bez dostępu do internetu oznacza brak połączenia. Osiągalność
+ * nieznana lub ograniczona do części sieci jest sprawdzana żądaniami HEAD.
+ *
+ * @param reachability Osiągalność sieci.
+ */
+void ConnectivityMonitor::onReachabilityChanged(QNetworkInformation::Reachability reachability) {
+    switch (reachability) {
+    case QNetworkInformation::Reachability::Online:
+        setOnline(true);
+        break;
+    case QNetworkInformation::Reachability::Disconnected:
+    case QNetworkInformation::Reachability::Local:
+        setOnline(false);
+        break;
+    default:
+        probe();
+        break;
+    }
+}
+
+/**
+ * @brief Sprawdza, czy błąd odpowiedzi oznacza brak połączenia.
+ *
+ * @param error Błąd odpowiedzi.
+ * @return true dla błędów na poziomie sieci.
+ */
+bool ConnectivityMonitor::isConnectivityError(QNetworkReply::NetworkError error) {
+    switch (error) {
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
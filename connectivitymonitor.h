@@ -0,0 +1,126 @@
+#ifndef CONNECTIVITYMONITOR_H
+#define CONNECTIVITYMONITOR_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkInformation>
+#include <QNetworkReply>
+#include <QTimer>
+
+/**
+ * @class ConnectivityMonitor
+ * @brief Wspólny, asynchroniczny stan połączenia z internetem.
+ *
+ * Stan jest przechowywany w pamięci i odczytywany przez isOnline() bez blokowania.
+ * Aktualizują go trzy źródła:
+ * - QNetworkInformation (zmiany osiągalności zgłaszane przez system),
+ * - odpowiedzi obserwowanych menedżerów sieciowych (watch()): każda odpowiedź HTTP
+ *   oznacza połączenie, a błąd na poziomie sieci (np. nieznany host, przekroczony czas)
+ *   jego brak,
+ * - asynchroniczne żądania HEAD do znanych adresów, wysyłane, gdy stan jest niepewny,
+ *   i ponawiane co PROBE_INTERVAL_MS, dopóki połączenie nie wróci.
+ * Zmiana stanu jest sygnalizowana przez onlineChanged().
+ */
+class ConnectivityMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Zwraca wspólny monitor, tworząc go przy pierwszym użyciu.
+     * @return Monitor należący do obiektu aplikacji.
+     */
+    static ConnectivityMonitor *instance();
+
+    /**
+     * @brief Zwraca ostatnio znany stan połączenia.
+     * @return true, jeśli połączenie z internetem jest dostępne.
+     */
+    bool isOnline() const { return m_online; }
+
+    /**
+     * @brief Obserwuje odpowiedzi menedżera sieciowego.
+     * @param manager Menedżer sieciowy.
+     */
+    void watch(QNetworkAccessManager *manager);
+
+    /**
+     * @brief Zgłasza wynik żądania sieciowego.
+     * @param reply Zakończona odpowiedź.
+     */
+    void reportReply(QNetworkReply *reply);
+
+    /**
+     * @brief Maksymalny czas oczekiwania na odpowiedź sprawdzającą (ms).
+     */
+    static const int PROBE_TIMEOUT_MS = 3000;
+
+    /**
+     * @brief Odstęp między sprawdzeniami, gdy połączenie jest niedostępne (ms).
+     */
+    static const int PROBE_INTERVAL_MS = 30000;
+
+signals:
+    /**
+     * @brief Sygnał emitowany przy zmianie stanu połączenia.
+     * @param online Nowy stan połączenia.
+     */
+    void onlineChanged(bool online);
+
+private:
+    /**
+     * @brief Konstruktor klasy ConnectivityMonitor.
+     * @param parent Wskaźnik na obiekt nadrzędny.
+     */
+    explicit ConnectivityMonitor(QObject *parent);
+
+    /**
+     * @brief Ustawia stan połączenia i planuje sprawdzenie, gdy połączenia nie ma.
+     * @param online Nowy stan połączenia.
+     */
+    void setOnline(bool online);
+
+    /**
+     * @brief Wysyła asynchroniczne żądania sprawdzające połączenie.
+     */
+    void probe();
+
+    /**
+     * @brief Obsługuje zmianę osiągalności zgłoszoną przez system.
+     * @param reachability Osiągalność sieci.
+     */
+    void onReachabilityChanged(QNetworkInformation::Reachability reachability);
+
+    /**
+     * @brief Sprawdza, czy błąd odpowiedzi oznacza brak połączenia.
+     * @param error Błąd odpowiedzi.
+     * @return true dla błędów na poziomie sieci.
+     */
+    static bool isConnectivityError(QNetworkReply::NetworkError error);
+
+    /**
+     * @brief Menedżer sieciowy żądań sprawdzających.
+     */
+    QNetworkAccessManager *m_probeManager;
+
+    /**
+     * @brief Zegar kolejnego sprawdzenia, gdy połączenia nie ma.
+     */
+    QTimer m_probeTimer;
+
+    /**
+     * @brief Liczba trwających żądań sprawdzających.
+     */
+    int m_pendingProbes;
+
+    /**
+     * @brief Czy któreś z trwających żądań sprawdzających się powiodło.
+     */
+    bool m_probeSucceeded;
+
+    /**
+     * @brief Ostatnio znany stan połączenia.
+     */
+    bool m_online;
+};
+
+#endif // CONNECTIVITYMONITOR_H
@@ -0,0 +1,128 @@
+#include "fetchscheduler.h"
+#include "ratelimiter.h"
+#include <QDebug>
+
+/**
+ * @brief Konstruktor klasy FetchScheduler.
+ *
+ * @param maxConcurrent Maksymalna liczba równoczesnych pobrań.
+ * @param parent Wskaźnik na obiekt nadrzędny.
+ */
+FetchScheduler::FetchScheduler(int maxConcurrent, QObject *parent)
+    : QObject(parent), m_maxConcurrent(qMax(1, maxConcurrent)) {
+}
+
+/**
+ * @brief Ustawia maksymalną liczbę równoczesnych pobrań.
+ *
+ * Zwiększenie limitu od razu wysyła kolejne oczekujące żądania; zmniejszenie
+ * nie przerywa pobrań, które już trwają.
+ *
+ * @param maxConcurrent Maksymalna liczba równoczesnych pobrań (co najmniej 1).
+ */
+void FetchScheduler::setMaxConcurrent(int maxConcurrent) {
+    m_maxConcurrent = qMax(1, maxConcurrent);
+    dispatch();
+}
+
+/**
+ * @brief Dodaje żądanie do kolejki lub podnosi priorytet oczekującego żądania.
+ *
+ * Żądanie, którego adres jest już pobierany, nie jest wysyłane ponownie; jeśli czeka
+ * jeszcze w kolejce RateLimiter, dostaje tam wyższy z priorytetów.
+ *
+ * @param request Żądanie GET.
+ * @param priority Priorytet (większy jest wysyłany wcześniej).
+ */
+void FetchScheduler::enqueue(const QNetworkRequest &request, int priority) {
+    if (m_inFlight.contains(request.url())) {
+        RateLimiter::instance()->boost(request.url(), priority);
+        return;
+    }
+    for (Entry &entry : m_queue) {
+        if (entry.request.url() == request.url()) {
+            entry.priority = qMax(entry.priority, priority);
+            dispatch();
+            return;
+        }
+    }
+    m_queue.append(Entry{request, priority});
+    dispatch();
+}
+
+/**
+ * @brief Podnosi priorytet oczekującego żądania.
+ *
+ * Żądanie wysłane, ale czekające jeszcze na swoją kolej w RateLimiter, dostaje
+ * wyższy priorytet w jego kolejce.
+ *
+ * @param url Adres żądania.
+ * @param priority Nowy priorytet (niższy od obecnego jest pomijany).
+ */
+void FetchScheduler::boost(const QUrl &url, int priority) {
+    if (m_inFlight.contains(url)) {
+        RateLimiter::instance()->boost(url, priority);
+        return;
+    }
+    for (Entry &entry : m_queue) {
+        if (entry.request.url() == url) {
+            entry.priority = qMax(entry.priority, priority);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Sprawdza, czy żądanie czeka w kolejce lub jest w trakcie pobierania.
+ *
+ * @param url Adres żądania.
+ * @return true, jeśli żądanie nie zostało jeszcze zakończone.
+ */
+bool FetchScheduler::isPending(const QUrl &url) const {
+    if (m_inFlight.contains(url)) {
+        return true;
+    }
+    for (const Entry &entry : m_queue) {
+        if (entry.request.url() == url) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Zwraca liczbę żądań oczekujących i w trakcie pobierania.
+ *
+ * @return Liczba niezakończonych żądań.
+ */
+int FetchScheduler::pendingCount() const {
+    return m_queue.size() + m_inFlight.size();
+}
+
+/**
+ * @brief Wysyła oczekujące żądania, dopóki jest wolne miejsce.
+ *
+ * Kolejka ma najwyżej kilkanaście żądań (sensory jednej stacji), więc żądanie
+ * o najwyższym priorytecie jest wyszukiwane liniowo.
+ */
+void FetchScheduler::dispatch() {
+    while (!m_queue.isEmpty() && m_inFlight.size() < m_maxConcurrent) {
+        qsizetype next = 0;
+        for (qsizetype i = 1; i < m_queue.size(); ++i) {
+            if (m_queue[i].priority > m_queue[next].priority) {
+                next = i;
+            }
+        }
+        Entry entry = m_queue.takeAt(next);
+        QUrl url = entry.request.url();
+        m_inFlight.insert(url);
+        qDebug() << "Fetching" << url.toString() << "with priority" << entry.priority
+                 << "(" << m_inFlight.size() << "in flight," << m_queue.size() << "queued)";
+
+        RequestBroker::instance()->get(entry.request, entry.priority, this, [this, url](const RequestBroker::Response &response) {
+            m_inFlight.remove(url);
+            emit replyReady(response);
+            dispatch();
+        });
+    }
+}
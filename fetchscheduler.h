@@ -0,0 +1,103 @@
+#ifndef FETCHSCHEDULER_H
+#define FETCHSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QNetworkRequest>
+#include <QSet>
+#include "requestbroker.h"
+
+/**
+ * @class FetchScheduler
+ * @brief Kolejka żądań GET z priorytetami i ograniczoną liczbą równoczesnych pobrań.
+ *
+ * Żądania czekają w kolejce i są wysyłane przez RequestBroker od najwyższego
+ * priorytetu (przy równych priorytetach w kolejności dodania), najwyżej
+ * maxConcurrent naraz. Ten sam adres nie jest dodawany drugi raz: żądanie
+ * oczekujące dostaje wyższy z priorytetów, a wysłane nie jest powtarzane.
+ * Wynik każdego żądania jest przekazywany sygnałem replyReady(), a kolejka wysyła
+ * następne żądanie po zakończeniu poprzedniego.
+ */
+class FetchScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Konstruktor klasy FetchScheduler.
+     * @param maxConcurrent Maksymalna liczba równoczesnych pobrań.
+     * @param parent Wskaźnik na obiekt nadrzędny (domyślnie nullptr).
+     */
+    explicit FetchScheduler(int maxConcurrent, QObject *parent = nullptr);
+
+    /**
+     * @brief Ustawia maksymalną liczbę równoczesnych pobrań.
+     * @param maxConcurrent Maksymalna liczba równoczesnych pobrań (co najmniej 1).
+     */
+    void setMaxConcurrent(int maxConcurrent);
+
+    /**
+     * @brief Dodaje żądanie do kolejki lub podnosi priorytet oczekującego żądania.
+     * @param request Żądanie GET.
+     * @param priority Priorytet (większy jest wysyłany wcześniej).
+     */
+    void enqueue(const QNetworkRequest &request, int priority);
+
+    /**
+     * @brief Podnosi priorytet oczekującego żądania.
+     * @param url Adres żądania.
+     * @param priority Nowy priorytet (niższy od obecnego jest pomijany).
+     */
+    void boost(const QUrl &url, int priority);
+
+    /**
+     * @brief Sprawdza, czy żądanie czeka w kolejce lub jest w trakcie pobierania.
+     * @param url Adres żądania.
+     * @return true, jeśli żądanie nie zostało jeszcze zakończone.
+     */
+    bool isPending(const QUrl &url) const;
+
+    /**
+     * @brief Zwraca liczbę żądań oczekujących i w trakcie pobierania.
+     * @return Liczba niezakończonych żądań.
+     */
+    int pendingCount() const;
+
+signals:
+    /**
+     * @brief Sygnał emitowany po zakończeniu żądania.
+     * @param response Wynik żądania.
+     */
+    void replyReady(const RequestBroker::Response &response);
+
+private:
+    /**
+     * @struct Entry
+     * @brief Żądanie oczekujące w kolejce.
+     */
+    struct Entry {
+        QNetworkRequest request; ///< Żądanie GET.
+        int priority;            ///< Priorytet żądania.
+    };
+
+    /**
+     * @brief Wysyła oczekujące żądania, dopóki jest wolne miejsce.
+     */
+    void dispatch();
+
+    /**
+     * @brief Maksymalna liczba równoczesnych pobrań.
+     */
+    int m_maxConcurrent;
+
+    /**
+     * @brief Żądania oczekujące w kolejności dodania.
+     */
+    QList<Entry> m_queue;
+
+    /**
+     * @brief Adresy żądań w trakcie pobierania.
+     */
+    QSet<QUrl> m_inFlight;
+};
+
+#endif // FETCHSCHEDULER_H
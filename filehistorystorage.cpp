@@ -0,0 +1,1367 @@
+#include "filehistorystorage.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QMutexLocker>
+#include <QDebug>
+
+/**
+ * @brief Konstruktor klasy FileHistoryStorage.
+ *
+ * Zapewnia istnienie katalogu historii, jednorazowo importuje indeks zapisany
+ * przez starsze wersje w pliku history_index.json i przenosi pliki sesji leżące
+ * bezpośrednio w katalogu historii do katalogów partycji.
+ *
+ * @param directory Katalog przechowywania danych historii.
+ * @param maxSessions Maksymalna liczba przechowywanych sesji.
+ * @param format Format zapisu plików bazowych sesji.
+ */
+FileHistoryStorage::FileHistoryStorage(const QString &directory, int maxSessions, SessionCodec::Format format)
+    : m_historyDir(directory), m_sessionIndex(directory), m_manifest(directory), m_seriesStore(m_historyDir.filePath("series")),
+      m_maxSessions(maxSessions), m_format(format), m_cacheEpoch(0), m_externalChanges(0), m_writerLock(directory, "history") {
+    ensureHistoryDir();
+    m_compactionPool.setMaxThreadCount(1);
+    m_indexCompactionPending = false;
+    m_documentCache.setMaxCost(DOCUMENT_CACHE_BUDGET);
+
+    // Import the JSON index and move the flat session files written by older versions once
+    QString legacyIndexPath = m_historyDir.filePath("history_index.json");
+    if (QFile::exists(legacyIndexPath) || !m_historyDir.entryList({"session_*"}, QDir::Files).isEmpty()) {
+        HistoryLock::Locker writer(m_writerLock);
+        if (writer.isLocked()) {
+            if (QFile::exists(legacyIndexPath) && m_sessionIndex.importLegacy(legacyIndexPath)) {
+                m_historyDir.remove("history_index.json");
+            }
+            migrateFlatLayout();
+        }
+    }
+}
+
+/**
+ * @brief Destruktor klasy FileHistoryStorage.
+ *
+ * Czeka na zakończenie zaplanowanych scaleń dzienników i indeksu.
+ */
+FileHistoryStorage::~FileHistoryStorage() {
+    m_compactionPool.waitForDone();
+}
+
+/**
+ * @brief Przenosi pliki sesji z katalogu historii do katalogów partycji.
+ *
+ * Partycja sesji jest wyznaczana z daty wpisu indeksu (lub daty modyfikacji pliku
+ * dla sesji spoza indeksu). Sesja trafia do manifestu dopiero po przeniesieniu
+ * wszystkich jej plików; jeśli któregoś pliku nie da się przenieść, przeniesione
+ * pliki wracają na miejsce, a sesja jest czytana z katalogu historii.
+ * Wywołujący musi trzymać blokadę zapisu.
+ *
+ * @return Liczba przeniesionych sesji.
+ */
+int FileHistoryStorage::migrateFlatLayout() {
+    const QStringList fileNames = m_historyDir.entryList({"session_*"}, QDir::Files);
+    if (fileNames.isEmpty()) {
+        return 0;
+    }
+
+    QHash<QString, QStringList> sessionFiles;
+    for (const QString &fileName : fileNames) {
+        qsizetype dot = fileName.lastIndexOf('.');
+        if (dot > 8) {
+            sessionFiles[fileName.mid(8, dot - 8)].append(fileName); // "session_" + id + extension
+        }
+    }
+
+    QHash<QString, QDate> created;
+    const QVariantList sessions = m_sessionIndex.readAll();
+    for (const QVariant &sessionVariant : sessions) {
+        QVariantMap entry = sessionVariant.toMap();
+        created.insert(entry["session_id"].toString(), QDateTime::fromString(entry["timestamp"].toString(), Qt::ISODate).date());
+    }
+
+    int migrated = 0;
+    for (auto it = sessionFiles.constBegin(); it != sessionFiles.constEnd(); ++it) {
+        const QString &sessionId = it.key();
+        QDate date = created.value(sessionId);
+        if (!date.isValid()) {
+            date = QFileInfo(m_historyDir.filePath(it.value().first())).lastModified().date();
+        }
+        QString directory = m_manifest.directoryOf(sessionId);
+        if (directory.isEmpty()) {
+            directory = QString(SessionManifest::SESSIONS_DIR) + '/' + SessionManifest::partitionFor(sessionId, date);
+        }
+        if (!m_historyDir.mkpath(directory)) {
+            qDebug() << "Failed to create session directory:" << m_historyDir.filePath(directory);
+            continue;
+        }
+
+        QStringList moved;
+        for (const QString &fileName : it.value()) {
+            if (!m_historyDir.rename(fileName, directory + '/' + fileName)) {
+                qDebug() << "Failed to move session file:" << fileName << "to" << directory;
+                break;
+            }
+            moved.append(fileName);
+        }
+        if (moved.size() < it.value().size()) {
+            for (const QString &fileName : std::as_const(moved)) {
+                m_historyDir.rename(directory + '/' + fileName, fileName);
+            }
+            continue;
+        }
+        if (!m_manifest.assign(sessionId, date).isEmpty()) {
+            migrated++;
+        }
+    }
+    qDebug() << "Moved" << migrated << "sessions into partitioned session directories";
+    return migrated;
+}
+
+/**
+ * @brief Zwraca ścieżkę pliku sesji względem katalogu historii.
+ *
+ * Katalog partycji pochodzi z manifestu, więc wyznaczenie ścieżki nie dotyka dysku.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param fileName Nazwa pliku sesji.
+ * @return Ścieżka w katalogu partycji sesji (w katalogu historii dla sesji spoza manifestu).
+ */
+QString FileHistoryStorage::sessionPath(const QString &sessionId, const QString &fileName) const {
+    QString directory = m_manifest.directoryOf(sessionId);
+    return directory.isEmpty() ? fileName : directory + '/' + fileName;
+}
+
+/**
+ * @brief Zapisuje plik bazowy nowej sesji i dopisuje ją do indeksu.
+ *
+ * Nowa sesja dostaje w manifeście partycję wyznaczoną z daty wpisu indeksu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param sessionData Dane sesji.
+ * @param indexEntry Wpis indeksu sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool FileHistoryStorage::writeSession(const QString &sessionId, const QVariantMap &sessionData, const QVariantMap &indexEntry) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    syncWithOtherInstances();
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_documentCache.remove(sessionId);
+        m_cacheEpoch++;
+    }
+    QDate created = QDateTime::fromString(indexEntry["timestamp"].toString(), Qt::ISODate).date();
+    if (m_manifest.assign(sessionId, created).isEmpty()) {
+        return false;
+    }
+    m_historyDir.remove(journalFileName(sessionId));
+    if (!writeSessionFile(sessionId, sessionData)) {
+        return false;
+    }
+    qDebug() << "Wrote session file:" << sessionFileName(sessionId, m_format);
+
+    SessionFilter filter;
+    filter.addSession(sessionData);
+    writeFilterFile(sessionId, filter);
+
+    // Update index
+    updateIndexFile(indexEntry);
+    return true;
+}
+
+/**
+ * @brief Zapisuje połączone zmiany istniejącej sesji.
+ *
+ * Pomiary trafiają do współdzielonych szeregów sensorów. Sensory, zakresy pomiarów
+ * i dane o jakości powietrza są dopisywane do dziennika sesji jednym rekordem "update".
+ * Cały zapis odbywa się pod blokadą zapisu, więc inne instancje nie przeplatają
+ * z nim zmian szeregów ani dziennika.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param update Połączone zmiany sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool FileHistoryStorage::writeUpdate(const QString &sessionId, const SessionUpdate &update) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    syncWithOtherInstances();
+
+    QVariantMap record;
+    record["type"] = "update";
+    if (!update.sensors.isEmpty()) {
+        QVariantList sensorEntries;
+        for (const QVariantMap &sensor : update.sensors) {
+            sensorEntries.append(sensor);
+        }
+        record["sensors"] = sensorEntries;
+    }
+    if (!update.measurements.isEmpty()) {
+        QVariantList ranges = storeMeasurements(sessionId, update.measurements);
+        if (!ranges.isEmpty()) {
+            record["ranges"] = ranges;
+        }
+    }
+    if (update.hasAirQuality) {
+        record["airQuality"] = update.airQuality;
+    }
+
+    if (record.size() == 1) {
+        return true;
+    }
+    if (!appendJournalRecord(sessionId, record)) {
+        return false;
+    }
+    qDebug() << "Journaled" << update.operations << "updates for session:" << sessionId;
+
+    // The filter only grows, so the journaled sensors and ranges are added to it
+    if (record.contains("sensors") || record.contains("ranges")) {
+        SessionFilter filter = sessionFilter(sessionId);
+        for (const QVariantMap &sensor : update.sensors) {
+            filter.addSensor(sensor["id"].toInt(), sensor["stationId"].toInt());
+        }
+        for (const QVariant &rangeVariant : record["ranges"].toList()) {
+            QVariantMap range = rangeVariant.toMap();
+            filter.addSensor(range["sensorId"].toInt());
+            filter.extendRange(range["from"].toLongLong(), range["to"].toLongLong());
+        }
+        writeFilterFile(sessionId, filter);
+    }
+    return true;
+}
+
+/**
+ * @brief Zapisuje pomiary do współdzielonych szeregów sensorów.
+ *
+ * Szeregi przechowują jeden pomiar na godzinę (nowszy zastępuje wcześniejszy).
+ * Sesja odwołuje się do zwróconych zakresów czasu. Wywołujący musi trzymać blokadę zapisu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param measurements Lista pomiarów jako QList<QVariantMap>.
+ * @return QVariantList z zakresami {sensorId, from, to} zapisanych szeregów.
+ */
+QVariantList FileHistoryStorage::storeMeasurements(const QString &sessionId, const QList<QVariantMap> &measurements) {
+    QMap<int, QVector<MeasurementPoint>> pointsBySensor = groupMeasurements(measurements);
+
+    QVariantList ranges;
+    int stored = 0;
+    QString sessionFile = sessionFileName(sessionId);
+    if (!QFile::exists(m_historyDir.filePath(sessionFile))) {
+        qDebug() << "Failed to read session file:" << sessionFile << "Error: file does not exist";
+        return ranges;
+    }
+
+    for (auto it = pointsBySensor.constBegin(); it != pointsBySensor.constEnd(); ++it) {
+        int written = m_seriesStore.append(it.key(), it.value());
+        if (written < 0) {
+            continue;
+        }
+        stored += written;
+
+        qint64 from = it.value().first().timestamp;
+        qint64 to = from;
+        for (const MeasurementPoint &point : it.value()) {
+            from = qMin(from, point.timestamp);
+            to = qMax(to, point.timestamp);
+        }
+        ranges.append(QVariantMap{{"sensorId", it.key()}, {"from", from}, {"to", to}});
+    }
+    qDebug() << "Stored" << stored << "new measurements for" << ranges.size() << "sensors in session:" << sessionId;
+    return ranges;
+}
+
+/**
+ * @brief Dopisuje rekord do dziennika sesji.
+ *
+ * Rekord jest zapisywany jako jedna linia JSON w trybie Compact. Gdy dziennik przekroczy
+ * próg JOURNAL_COMPACT_THRESHOLD, planowane jest jego scalenie z plikiem bazowym.
+ * Wywołujący musi trzymać blokadę zapisu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param record Rekord dziennika jako QVariantMap.
+ * @return true, jeśli rekord został zapisany; false w przeciwnym razie.
+ */
+bool FileHistoryStorage::appendJournalRecord(const QString &sessionId, const QVariantMap &record) {
+    QString sessionFile = sessionFileName(sessionId);
+    QString journalFile = journalFileName(sessionId);
+    qint64 journalSize = 0;
+
+    if (!QFile::exists(m_historyDir.filePath(sessionFile))) {
+        qDebug() << "Failed to read session file:" << sessionFile << "Error: file does not exist";
+        return false;
+    }
+
+    QFile file(m_historyDir.filePath(journalFile));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open journal file for writing:" << journalFile << "Error:" << file.errorString();
+        return false;
+    }
+
+    QByteArray line = QJsonDocument(QJsonObject::fromVariantMap(record)).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    qint64 bytesWritten = file.write(line);
+    file.flush();
+    journalSize = file.size();
+    file.close();
+
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_cacheEpoch++;
+        if (bytesWritten != line.size()) {
+            qDebug() << "Failed to append to journal file:" << journalFile << "Error:" << file.errorString();
+            m_documentCache.remove(sessionId);
+            return false;
+        }
+
+        // Keep an indexed copy of the session current instead of re-reading the journal;
+        // readers may still hold the cached copy, so it is replaced rather than modified
+        if (QSharedPointer<IndexedSession> *cached = m_documentCache.object(sessionId)) {
+            QSharedPointer<IndexedSession> updated(new IndexedSession(**cached));
+            updated->journal.append(record);
+            *cached = updated;
+        }
+    }
+
+    if (journalSize > JOURNAL_COMPACT_THRESHOLD) {
+        scheduleCompaction(sessionId);
+    }
+    return true;
+}
+
+/**
+ * @brief Wczytuje plik bazowy sesji bez uwzględniania dziennika.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return QVariantMap z danymi sesji lub pusta mapa w przypadku błędu.
+ */
+QVariantMap FileHistoryStorage::readSessionFile(const QString &sessionId) const {
+    QString sessionFile = sessionFileName(sessionId);
+    QFile file(m_historyDir.filePath(sessionFile));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to read session file:" << sessionFile << "Error:" << file.errorString();
+        return QVariantMap();
+    }
+    bool ok = false;
+    QVariantMap sessionData = SessionCodec::decode(file.readAll(), &ok);
+    file.close();
+    if (!ok) {
+        qDebug() << "Failed to parse session file:" << sessionFile;
+        return QVariantMap();
+    }
+    return sessionData;
+}
+
+/**
+ * @brief Wczytuje plik bazowy sesji i rekordy jej dziennika jako spójną parę.
+ *
+ * Odczyt nie zakłada blokady. Scalanie dziennika najpierw podmienia plik bazowy,
+ * a dopiero potem usuwa dziennik, dlatego jeśli plik bazowy zmienił się w trakcie
+ * odczytu, dziennik mógł już zostać w nim uwzględniony i odczyt jest powtarzany.
+ * Dziennik odczytany tuż przed usunięciem i nałożony na nowy plik bazowy daje ten
+ * sam wynik, bo rekordy "update" można nakładać wielokrotnie. Sesja spoza manifestu
+ * mogła zostać zapisana przez inną instancję, więc wtedy manifest jest odświeżany.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param data Ustawiane na zawartość pliku bazowego.
+ * @param journal Ustawiane na rekordy dziennika w kolejności zapisu.
+ * @return true, jeśli odczyt się powiódł; false w przeciwnym razie.
+ */
+bool FileHistoryStorage::readSessionSnapshot(const QString &sessionId, QByteArray &data, QList<QVariantMap> &journal) const {
+    if (!m_manifest.contains(sessionId)) {
+        syncWithOtherInstances();
+    }
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+        QString sessionFile = sessionFileName(sessionId);
+        QFileInfo info(m_historyDir.filePath(sessionFile));
+        qint64 size = info.size();
+        QDateTime modified = info.lastModified();
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug() << "Failed to read session file:" << sessionFile << "Error:" << file.errorString();
+            return false;
+        }
+        data = file.readAll();
+        file.close();
+        journal = readJournalRecords(sessionId);
+
+        info.refresh();
+        if (info.exists() && info.size() == size && info.lastModified() == modified) {
+            return true;
+        }
+    }
+    qDebug() << "Session file kept changing while reading:" << sessionFileName(sessionId);
+    return false;
+}
+
+/**
+ * @brief Czyści pamięci podręczne, jeśli inna instancja zapisała zmiany w historii.
+ *
+ * Sprawdzenie to odczyt licznika zapisów blokady, więc jest wykonywane na początku
+ * operacji, które korzystają z pamięci podręcznych.
+ */
+void FileHistoryStorage::syncWithOtherInstances() const {
+    if (!m_writerLock.hasExternalChanges()) {
+        return;
+    }
+    m_manifest.reload();
+    QMutexLocker locker(&m_storageMutex);
+    m_documentCache.clear();
+    m_filters.clear();
+    m_cacheEpoch++;
+    m_externalChanges++;
+    qDebug() << "History was changed by another instance, dropping cached sessions";
+}
+
+/**
+ * @brief Zwraca liczbę wykrytych zapisów innych instancji aplikacji.
+ *
+ * Najpierw sprawdza licznik zapisów blokady, więc wynik obejmuje zmiany zapisane
+ * do tej chwili.
+ *
+ * @return Licznik zwiększany przy każdym wykryciu zmian zapisanych przez inną instancję.
+ */
+quint64 FileHistoryStorage::externalChangeCount() const {
+    syncWithOtherInstances();
+    QMutexLocker locker(&m_storageMutex);
+    return m_externalChanges;
+}
+
+/**
+ * @brief Zwraca blokadę zapisu historii.
+ *
+ * @return Blokada zapisu współdzielona przez instancje aplikacji.
+ */
+HistoryLock &FileHistoryStorage::writerLock() {
+    return m_writerLock;
+}
+
+/**
+ * @brief Atomowo zapisuje plik bazowy sesji w formacie m_format.
+ *
+ * Plik w drugim formacie (np. JSON zapisany przez starszą wersję) jest usuwany
+ * dopiero po zatwierdzeniu nowego pliku. Wywołujący musi trzymać blokadę zapisu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param sessionData Dane sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool FileHistoryStorage::writeSessionFile(const QString &sessionId, const QVariantMap &sessionData) {
+    QString sessionFile = sessionFileName(sessionId, m_format);
+    QSaveFile file(m_historyDir.filePath(sessionFile));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open session file for writing:" << sessionFile << "Error:" << file.errorString();
+        return false;
+    }
+    file.write(SessionCodec::encode(sessionData, m_format));
+    if (!file.commit()) {
+        qDebug() << "Failed to write session file:" << sessionFile << "Error:" << file.errorString();
+        return false;
+    }
+
+    QString otherFile = sessionFileName(sessionId, m_format == SessionCodec::Json ? SessionCodec::Cbor : SessionCodec::Json);
+    if (m_historyDir.exists(otherFile)) {
+        m_historyDir.remove(otherFile);
+    }
+    return true;
+}
+
+/**
+ * @brief Wczytuje rekordy dziennika sesji.
+ *
+ * Uszkodzone linie (np. przerwany zapis) są pomijane.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Rekordy w kolejności zapisu.
+ */
+QList<QVariantMap> FileHistoryStorage::readJournalRecords(const QString &sessionId) const {
+    QList<QVariantMap> records;
+    QString journalFile = journalFileName(sessionId);
+    QFile file(m_historyDir.filePath(journalFile));
+    if (!file.exists()) {
+        return records;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to read journal file:" << journalFile << "Error:" << file.errorString();
+        return records;
+    }
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (doc.isNull() || !doc.isObject()) {
+            qDebug() << "Skipping malformed journal record in:" << journalFile;
+            continue;
+        }
+        records.append(doc.object().toVariantMap());
+    }
+    file.close();
+    return records;
+}
+
+/**
+ * @brief Nakłada rekordy dziennika na dane sesji.
+ *
+ * Rekordy są stosowane w kolejności zapisu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param sessionData Dane sesji wczytane z pliku bazowego.
+ */
+void FileHistoryStorage::replayJournal(const QString &sessionId, QVariantMap &sessionData) const {
+    const QList<QVariantMap> records = readJournalRecords(sessionId);
+    for (const QVariantMap &record : records) {
+        applyJournalRecord(sessionData, record);
+    }
+    if (!records.isEmpty()) {
+        qDebug() << "Replayed" << records.size() << "journal records for session:" << sessionId;
+    }
+}
+
+/**
+ * @brief Nakłada pojedynczy rekord dziennika na dane sesji.
+ *
+ * Rekord "update" łączy sensory, zakresy szeregów i dane o jakości powietrza z kilku
+ * wywołań. Sensory są dodawane z pominięciem duplikatów, zakresy szeregów są sumowane
+ * w polach seriesFrom i seriesTo sensora, a dane o jakości powietrza zastępują
+ * poprzednie. Rekordy z pomiarami pochodzą ze starszych dzienników, sprzed zapisu
+ * pomiarów do SeriesStore, i są dopisywane do odpowiednich sensorów.
+ *
+ * @param sessionData Dane sesji do zaktualizowania.
+ * @param record Rekord dziennika.
+ */
+void FileHistoryStorage::applyJournalRecord(QVariantMap &sessionData, const QVariantMap &record) {
+    QString type = record["type"].toString();
+
+    if (type == "update") {
+        // Combined record written by the history writer for coalesced updates
+        if (record.contains("sensors")) {
+            applyJournalRecord(sessionData, QVariantMap{{"type", "sensors"}, {"sensors", record["sensors"]}});
+        }
+        if (record.contains("ranges")) {
+            applyJournalRecord(sessionData, QVariantMap{{"type", "seriesRanges"}, {"ranges", record["ranges"]}});
+        }
+        if (record.contains("airQuality")) {
+            applyJournalRecord(sessionData, QVariantMap{{"type", "airQuality"}, {"airQuality", record["airQuality"]}});
+        }
+    } else if (type == "sensors") {
+        QVariantList sensors = sessionData["sensors"].toList();
+
+        // Create a set of existing sensor IDs to avoid duplicates
+        QSet<int> existingSensorIds;
+        for (const QVariant &sensorVariant : sensors) {
+            existingSensorIds.insert(sensorVariant.toMap()["id"].toInt());
+        }
+
+        for (const QVariant &sensorVariant : record["sensors"].toList()) {
+            int sensorId = sensorVariant.toMap()["id"].toInt();
+            if (!existingSensorIds.contains(sensorId)) {
+                sensors.append(sensorVariant);
+                existingSensorIds.insert(sensorId);
+            }
+        }
+        sessionData["sensors"] = sensors;
+    } else if (type == "measurements") {
+        // Organize measurements by sensorId
+        QMap<int, QVariantList> measurementsBySensor;
+        for (const QVariant &measurementVariant : record["measurements"].toList()) {
+            QVariantMap measurement = measurementVariant.toMap();
+            QVariantMap measurementEntry;
+            measurementEntry["date"] = measurement["date"];
+            measurementEntry["value"] = measurement["value"];
+            measurementsBySensor[measurement["sensorId"].toInt()].append(measurementEntry);
+        }
+
+        QVariantList sensors = sessionData["sensors"].toList();
+        for (QVariant &sensorVariant : sensors) {
+            QVariantMap sensor = sensorVariant.toMap();
+            int sensorId = sensor["id"].toInt();
+            if (measurementsBySensor.contains(sensorId)) {
+                QVariantList existingMeasurements = sensor["measurements"].toList();
+                existingMeasurements.append(measurementsBySensor[sensorId]);
+                sensor["measurements"] = existingMeasurements;
+                sensorVariant = sensor;
+            }
+        }
+        sessionData["sensors"] = sensors;
+    } else if (type == "seriesRanges") {
+        QMap<int, QVariantMap> rangesBySensor;
+        for (const QVariant &rangeVariant : record["ranges"].toList()) {
+            QVariantMap range = rangeVariant.toMap();
+            rangesBySensor[range["sensorId"].toInt()] = range;
+        }
+
+        QVariantList sensors = sessionData["sensors"].toList();
+        for (QVariant &sensorVariant : sensors) {
+            QVariantMap sensor = sensorVariant.toMap();
+            int sensorId = sensor["id"].toInt();
+            if (rangesBySensor.contains(sensorId)) {
+                qint64 from = rangesBySensor[sensorId]["from"].toLongLong();
+                qint64 to = rangesBySensor[sensorId]["to"].toLongLong();
+                if (sensor.contains("seriesFrom")) {
+                    from = qMin(from, sensor["seriesFrom"].toLongLong());
+                    to = qMax(to, sensor["seriesTo"].toLongLong());
+                }
+                sensor["seriesFrom"] = from;
+                sensor["seriesTo"] = to;
+                sensorVariant = sensor;
+            }
+        }
+        sessionData["sensors"] = sensors;
+    } else if (type == "airQuality") {
+        sessionData["airQuality"] = record["airQuality"];
+    } else {
+        qDebug() << "Unknown journal record type:" << type;
+    }
+}
+
+/**
+ * @brief Scala dziennik sesji z plikiem bazowym.
+ *
+ * Zapisuje plik bazowy z nałożonymi rekordami dziennika (atomowo, przez QSaveFile)
+ * w formacie m_format, a następnie usuwa dziennik. Czytelnicy, którzy w tym czasie
+ * czytają sesję, wykrywają podmianę pliku bazowego (readSessionSnapshot()).
+ *
+ * @param sessionId Identyfikator sesji.
+ */
+void FileHistoryStorage::compactSession(const QString &sessionId) {
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_pendingCompactions.remove(sessionId);
+    }
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return;
+    }
+    syncWithOtherInstances();
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_documentCache.remove(sessionId);
+        m_cacheEpoch++;
+    }
+
+    QString journalFile = journalFileName(sessionId);
+    if (!QFile::exists(m_historyDir.filePath(journalFile))) {
+        return;
+    }
+
+    QVariantMap sessionData = readSessionFile(sessionId);
+    if (sessionData.isEmpty()) {
+        return;
+    }
+    replayJournal(sessionId, sessionData);
+
+    QString sessionFile = sessionFileName(sessionId, m_format);
+    if (!writeSessionFile(sessionId, sessionData)) {
+        return;
+    }
+
+    if (m_historyDir.remove(journalFile)) {
+        qDebug() << "Compacted journal into session file:" << sessionFile;
+    } else {
+        qDebug() << "Failed to remove journal file:" << journalFile;
+    }
+}
+
+/**
+ * @brief Planuje scalenie dziennika sesji w tle.
+ *
+ * Zadanie trafia do jednowątkowej puli m_compactionPool. Sesja już oczekująca
+ * na scalenie nie jest dodawana ponownie.
+ *
+ * @param sessionId Identyfikator sesji.
+ */
+void FileHistoryStorage::scheduleCompaction(const QString &sessionId) {
+    {
+        QMutexLocker locker(&m_storageMutex);
+        if (m_pendingCompactions.contains(sessionId)) {
+            return;
+        }
+        m_pendingCompactions.insert(sessionId);
+    }
+    qDebug() << "Scheduling journal compaction for session:" << sessionId;
+    m_compactionPool.start([this, sessionId]() {
+        compactSession(sessionId);
+    });
+}
+
+/**
+ * @brief Aktualizuje plik indeksu sesji.
+ *
+ * Dopisuje nową sesję na końcu dziennika indeksu. Co INDEX_COMPACT_INTERVAL wpisów
+ * w tle uruchamiane jest scalanie indeksu, które usuwa sesje ponad limit m_maxSessions.
+ *
+ * @param session Dane sesji jako QVariantMap.
+ */
+void FileHistoryStorage::updateIndexFile(const QVariantMap &session) {
+    if (!m_sessionIndex.append(session)) {
+        return;
+    }
+    qDebug() << "Appended session to index log:" << session["session_id"].toString();
+
+    if (m_sessionIndex.logRecordCount() >= INDEX_COMPACT_INTERVAL) {
+        scheduleIndexCompaction();
+    }
+}
+
+/**
+ * @brief Uruchamia w tle scalanie indeksu, jeśli nie jest już zaplanowane.
+ */
+void FileHistoryStorage::scheduleIndexCompaction() {
+    {
+        QMutexLocker locker(&m_storageMutex);
+        if (m_indexCompactionPending) {
+            return;
+        }
+        m_indexCompactionPending = true;
+    }
+    m_compactionPool.start([this]() {
+        compactIndex();
+    });
+}
+
+/**
+ * @brief Zapisuje podsumowanie sesji w indeksie.
+ *
+ * Podsumowanie jest dopisywane do dziennika podsumowań indeksu. Gdy dziennik
+ * przekroczy JOURNAL_COMPACT_THRESHOLD, w tle uruchamiane jest scalanie indeksu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param summary Podsumowanie sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool FileHistoryStorage::writeSummary(const QString &sessionId, const QVariantMap &summary) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked() || !m_sessionIndex.appendSummary(sessionId, summary)) {
+        return false;
+    }
+    if (m_sessionIndex.summaryLogSize() > JOURNAL_COMPACT_THRESHOLD) {
+        scheduleIndexCompaction();
+    }
+    return true;
+}
+
+/**
+ * @brief Scala indeks sesji i usuwa sesje ponad limit.
+ *
+ * Dla każdej usuniętej z indeksu sesji kasowany jest jej plik bazowy i dziennik.
+ * Współdzielone szeregi pomiarów pozostają, bo mogą do nich odwoływać się inne sesje.
+ * Indeks obejmuje sesje wszystkich instancji, więc scalanie wykonuje się pod blokadą zapisu.
+ */
+void FileHistoryStorage::compactIndex() {
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_indexCompactionPending = false;
+    }
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return;
+    }
+    syncWithOtherInstances();
+
+    QVariantList evicted = m_sessionIndex.compact(m_maxSessions);
+    for (const QVariant &sessionVariant : evicted) {
+        removeSessionFiles(sessionVariant.toMap()["session_id"].toString());
+    }
+    m_manifest.compact();
+}
+
+/**
+ * @brief Usuwa wszystkie pliki sesji.
+ *
+ * Sesja jest usuwana z manifestu, a opustoszałe katalogi partycji są kasowane.
+ * Wywołujący musi trzymać blokadę zapisu.
+ *
+ * @param sessionId Identyfikator sesji.
+ */
+void FileHistoryStorage::removeSessionFiles(const QString &sessionId) {
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_documentCache.remove(sessionId);
+        m_filters.remove(sessionId);
+        m_cacheEpoch++;
+    }
+    QString oldFile = sessionFileName(sessionId);
+    if (m_historyDir.remove(oldFile)) {
+        qDebug() << "Removed old session file:" << oldFile;
+    } else {
+        qDebug() << "Failed to remove old session file:" << oldFile;
+    }
+    // A file in the other format remains only if a rewrite was interrupted
+    QString otherFile = sessionFileName(sessionId, oldFile.endsWith(".json") ? SessionCodec::Cbor : SessionCodec::Json);
+    m_historyDir.remove(otherFile);
+    m_historyDir.remove(journalFileName(sessionId));
+    m_historyDir.remove(filterFileName(sessionId));
+
+    QString directory = m_manifest.directoryOf(sessionId);
+    m_manifest.remove(sessionId);
+    if (!directory.isEmpty()) {
+        m_historyDir.rmpath(directory);
+    }
+}
+
+/**
+ * @brief Wczytuje listę sesji z pliku indeksu.
+ *
+ * Indeks jest czytany jednym sekwencyjnym przejściem, bez blokad. Zwracanych jest co najwyżej
+ * m_maxSessions najnowszych sesji, także jeśli scalanie indeksu jeszcze nie usunęło starszych.
+ *
+ * @return QVariantList zawierający listę sesji.
+ */
+QVariantList FileHistoryStorage::loadSessions() const {
+    try {
+        QVariantList sessions = m_sessionIndex.readAll();
+        if (sessions.size() > m_maxSessions) {
+            sessions.erase(sessions.begin() + m_maxSessions, sessions.end());
+        }
+        return sessions;
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in loadSessions:" << e.what();
+        return QVariantList();
+    } catch (...) {
+        qDebug() << "Unknown exception in loadSessions";
+        return QVariantList();
+    }
+}
+
+/**
+ * @brief Wczytuje szczegóły sesji z pliku sesji.
+ *
+ * Wczytuje plik bazowy sesji i nakłada na niego rekordy z dziennika sesji. Odczyt
+ * nie zakłada blokad, więc nie czeka na zapisy tej ani innych instancji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param cost Ustawiane na łączny rozmiar pliku bazowego i dziennika.
+ * @return QVariantMap zawierający szczegóły sesji.
+ */
+QVariantMap FileHistoryStorage::loadSessionDetails(const QString &sessionId, qint64 *cost) const {
+    QByteArray data;
+    QList<QVariantMap> journal;
+    if (!readSessionSnapshot(sessionId, data, journal)) {
+        return QVariantMap();
+    }
+    bool ok = false;
+    QVariantMap sessionData = SessionCodec::decode(data, &ok);
+    if (!ok) {
+        qDebug() << "Failed to parse session file:" << sessionFileName(sessionId);
+        return QVariantMap();
+    }
+    for (const QVariantMap &record : std::as_const(journal)) {
+        applyJournalRecord(sessionData, record);
+    }
+
+    if (cost) {
+        *cost = data.size() + QFileInfo(m_historyDir.filePath(journalFileName(sessionId))).size();
+    }
+    return sessionData;
+}
+
+/**
+ * @brief Wczytuje wybrane pola sesji bez dekodowania pozostałych.
+ *
+ * Pola są dekodowane z indeksu pliku bazowego, a następnie nakładane są na nie
+ * rekordy dziennika sesji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param keys Nazwy pól.
+ * @return QVariantMap z istniejącymi polami spośród keys.
+ */
+QVariantMap FileHistoryStorage::loadSessionFields(const QString &sessionId, const QStringList &keys) const {
+    syncWithOtherInstances();
+    QSharedPointer<const IndexedSession> session = indexedSession(sessionId);
+    if (!session) {
+        return QVariantMap();
+    }
+
+    QVariantMap fields;
+    for (const QString &key : keys) {
+        QVariant value = session->document.value(key);
+        if (value.isValid()) {
+            fields[key] = value;
+        }
+    }
+    for (const QVariantMap &record : session->journal) {
+        applyJournalRecord(fields, record);
+    }
+
+    // Journal records may add fields that were not requested
+    for (auto it = fields.begin(); it != fields.end();) {
+        if (keys.contains(it.key())) {
+            ++it;
+        } else {
+            it = fields.erase(it);
+        }
+    }
+    return fields;
+}
+
+/**
+ * @brief Wczytuje sensory jednej stacji zapisane w sesji.
+ *
+ * Dekodowane są tylko sensory tej stacji z pliku bazowego; rekordy dziennika
+ * dodają nowe sensory i zakresy szeregów.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param stationId Identyfikator stacji.
+ * @return Lista sensorów stacji.
+ */
+QList<QVariantMap> FileHistoryStorage::loadStationSensors(const QString &sessionId, int stationId) const {
+    syncWithOtherInstances();
+    QSharedPointer<const IndexedSession> session = indexedSession(sessionId);
+    if (!session) {
+        return QList<QVariantMap>();
+    }
+
+    QVariantMap partial;
+    partial["sensors"] = session->document.stationSensors(stationId);
+    for (const QVariantMap &record : session->journal) {
+        applyJournalRecord(partial, record);
+    }
+
+    QList<QVariantMap> sensors;
+    for (const QVariant &sensorVariant : partial["sensors"].toList()) {
+        QVariantMap sensor = sensorVariant.toMap();
+        if (sensor["stationId"].toInt() == stationId) {
+            sensors.append(sensor);
+        }
+    }
+    return sensors;
+}
+
+/**
+ * @brief Zwraca zindeksowaną sesję z pamięci podręcznej, indeksując ją w razie potrzeby.
+ *
+ * Plik bazowy jest czytany jednym odczytem i indeksowany bez dekodowania wartości.
+ * Odczyt i indeksowanie odbywają się bez muteksu; zindeksowana sesja trafia do pamięci
+ * podręcznej tylko wtedy, gdy w tym czasie żaden zapisujący jej nie zmienił.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Zindeksowana sesja lub pusty wskaźnik, jeśli sesji nie udało się wczytać.
+ */
+QSharedPointer<const FileHistoryStorage::IndexedSession> FileHistoryStorage::indexedSession(const QString &sessionId) const {
+    quint64 epoch = 0;
+    {
+        QMutexLocker locker(&m_storageMutex);
+        if (QSharedPointer<IndexedSession> *cached = m_documentCache.object(sessionId)) {
+            return *cached;
+        }
+        epoch = m_cacheEpoch;
+    }
+
+    QByteArray data;
+    QList<QVariantMap> journal;
+    if (!readSessionSnapshot(sessionId, data, journal)) {
+        return QSharedPointer<const IndexedSession>();
+    }
+    QSharedPointer<IndexedSession> session(new IndexedSession{SessionDocument::index(data), journal});
+    if (!session->document.isValid()) {
+        qDebug() << "Failed to parse session file:" << sessionFileName(sessionId);
+        return QSharedPointer<const IndexedSession>();
+    }
+
+    // A session larger than the whole budget is not cached (QCache rejects it) but is still returned
+    QMutexLocker locker(&m_storageMutex);
+    if (m_cacheEpoch == epoch) {
+        m_documentCache.insert(sessionId, new QSharedPointer<IndexedSession>(session), qMax<qint64>(session->document.size(), 1));
+    }
+    return session;
+}
+
+/**
+ * @brief Wczytuje pomiary sensora z podanego przedziału czasu.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @return Pomiary w kolejności czasu.
+ */
+QVector<MeasurementPoint> FileHistoryStorage::loadMeasurements(int sensorId, qint64 from, qint64 to) const {
+    return m_seriesStore.range(sensorId, from, to);
+}
+
+/**
+ * @brief Wczytuje zagregowane pomiary sensora nakładające się na podany przedział czasu.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @return Przedziały dobowe i sześciogodzinne w kolejności czasu.
+ */
+QVector<RollupPoint> FileHistoryStorage::loadRollups(int sensorId, qint64 from, qint64 to) const {
+    return m_seriesStore.rollups(sensorId, from, to);
+}
+
+/**
+ * @brief Zwraca identyfikatory sensorów, które mają zapisane pomiary.
+ *
+ * @return Lista identyfikatorów sensorów.
+ */
+QList<int> FileHistoryStorage::seriesSensorIds() const {
+    return m_seriesStore.sensorIds();
+}
+
+/**
+ * @brief Przenosi starsze pomiary sensora do poziomów zagregowanych.
+ *
+ * Plik poziomu jest zapisywany przed przełączeniem szeregu na nowe pokolenie bez
+ * przeniesionych pomiarów, więc pojedynczy odczyt nigdy nie traci pomiarów.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param rawBefore Pomiary sprzed tej chwili trafiają do przedziałów sześciogodzinnych.
+ * @param rollupBefore Przedziały sześciogodzinne sprzed tej chwili trafiają do przedziałów dobowych.
+ * @return Liczba przeniesionych pomiarów i przedziałów lub -1 w przypadku błędu.
+ */
+int FileHistoryStorage::rollUpSensor(int sensorId, qint64 rawBefore, qint64 rollupBefore) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return -1;
+    }
+    return m_seriesStore.rollUp(sensorId, rawBefore, rollupBefore);
+}
+
+/**
+ * @brief Zwraca czas najstarszych zapisanych danych pomiarowych.
+ *
+ * @return Sekundy od epoki lub -1, jeśli magazyn nie ma pomiarów.
+ */
+qint64 FileHistoryStorage::oldestMeasurement() const {
+    qint64 oldest = -1;
+    const QList<int> sensorIds = m_seriesStore.sensorIds();
+    for (int sensorId : sensorIds) {
+        qint64 timestamp = m_seriesStore.oldestTimestamp(sensorId);
+        if (timestamp >= 0 && (oldest < 0 || timestamp < oldest)) {
+            oldest = timestamp;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief Usuwa dane pomiarowe wszystkich sensorów sprzed podanej chwili.
+ *
+ * @param cutoff Dane kończące się przed tą chwilą są usuwane.
+ * @return Szacowana liczba zwolnionych bajtów lub -1, jeśli zapis któregoś szeregu się nie powiódł.
+ */
+qint64 FileHistoryStorage::trimBefore(qint64 cutoff) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return -1;
+    }
+    qint64 freed = 0;
+    bool ok = true;
+    const QList<int> sensorIds = m_seriesStore.sensorIds();
+    for (int sensorId : sensorIds) {
+        qint64 sensorFreed = m_seriesStore.trimBefore(sensorId, cutoff);
+        if (sensorFreed < 0) {
+            ok = false;
+        } else {
+            freed += sensorFreed;
+        }
+    }
+    return ok ? freed : -1;
+}
+
+/**
+ * @brief Oddaje systemowi zwolnione miejsce.
+ *
+ * trimBefore() przepisuje lub usuwa pliki, więc miejsce jest zwalniane od razu.
+ *
+ * @return Zawsze true.
+ */
+bool FileHistoryStorage::reclaimSpace() {
+    return true;
+}
+
+/**
+ * @brief Zwraca miejsce zajmowane przez pliki historii.
+ *
+ * @return Łączny rozmiar plików w katalogu historii i jego podkatalogach (w bajtach).
+ */
+qint64 FileHistoryStorage::diskUsage() const {
+    qint64 total = 0;
+    QDirIterator it(m_historyDir.path(), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        total += it.fileInfo().size();
+    }
+    return total;
+}
+
+/**
+ * @brief Sprawdza, czy plik sesji istnieje.
+ *
+ * Ścieżka pliku pochodzi z manifestu; manifest jest wczytywany ponownie tylko wtedy,
+ * gdy sesji w nim nie ma, a inna instancja zapisała w tym czasie zmiany.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return true, jeśli sesja istnieje; false w przeciwnym razie.
+ */
+bool FileHistoryStorage::sessionExists(const QString &sessionId) const {
+    if (!m_manifest.contains(sessionId)) {
+        syncWithOtherInstances();
+    }
+    return QFile::exists(m_historyDir.filePath(sessionFileName(sessionId)));
+}
+
+/**
+ * @brief Wyszukuje sesje, które mają sensor spełniający zapytanie.
+ *
+ * Najpierw sprawdzany jest filtr sesji; sesje, których filtr wyklucza, są pomijane
+ * bez otwierania pliku sesji. Pozostałe są sprawdzane na podstawie zapisanych
+ * sensorów (przy podanej stacji dekodowane są tylko sensory tej stacji).
+ *
+ * @param query Zapytanie (stacja, sensor, przedział czasu).
+ * @param stats Ustawiane na statystyki wykonania zapytania (opcjonalnie).
+ * @return Identyfikatory pasujących sesji od najnowszej do najstarszej.
+ */
+QStringList FileHistoryStorage::findSessions(const SessionQuery &query, SessionQueryStats *stats) const {
+    SessionQueryStats queryStats;
+    QStringList matches;
+    syncWithOtherInstances();
+    const QVariantList sessions = loadSessions();
+    for (const QVariant &sessionVariant : sessions) {
+        QString sessionId = sessionVariant.toMap()["session_id"].toString();
+        queryStats.sessions++;
+        if (!sessionFilter(sessionId).mayMatch(query)) {
+            queryStats.pruned++;
+            continue;
+        }
+
+        queryStats.opened++;
+        QList<QVariantMap> sensors;
+        if (query.stationId != 0) {
+            sensors = loadStationSensors(sessionId, query.stationId);
+        } else {
+            for (const QVariant &sensorVariant : loadSessionFields(sessionId, {"sensors"})["sensors"].toList()) {
+                sensors.append(sensorVariant.toMap());
+            }
+        }
+        for (const QVariantMap &sensor : std::as_const(sensors)) {
+            if (query.matchesSensor(sensor)) {
+                matches.append(sessionId);
+                break;
+            }
+        }
+    }
+
+    queryStats.matched = matches.size();
+    if (stats) {
+        *stats = queryStats;
+    }
+    return matches;
+}
+
+/**
+ * @brief Zwraca nazwę istniejącego pliku bazowego sesji.
+ *
+ * Najpierw sprawdzany jest plik w formacie m_format, potem w drugim formacie.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Ścieżka pliku względem katalogu historii.
+ */
+QString FileHistoryStorage::sessionFileName(const QString &sessionId) const {
+    QString preferred = sessionFileName(sessionId, m_format);
+    if (m_historyDir.exists(preferred)) {
+        return preferred;
+    }
+    QString other = sessionFileName(sessionId, m_format == SessionCodec::Json ? SessionCodec::Cbor : SessionCodec::Json);
+    return m_historyDir.exists(other) ? other : preferred;
+}
+
+/**
+ * @brief Zwraca nazwę pliku bazowego sesji zapisanego w podanym formacie.
+ *
+ * Obie odmiany CBOR (zwykła i skompresowana) używają rozszerzenia .cbor.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param format Format zapisu.
+ * @return Ścieżka pliku względem katalogu historii.
+ */
+QString FileHistoryStorage::sessionFileName(const QString &sessionId, SessionCodec::Format format) const {
+    return sessionPath(sessionId, QString(format == SessionCodec::Json ? "session_%1.json" : "session_%1.cbor").arg(sessionId));
+}
+
+/**
+ * @brief Przepisuje pliki bazowe sesji do formatu m_format.
+ *
+ * Pliki zapisane w innym formacie (np. JSON ze starszych wersji) są dekodowane
+ * i zapisywane ponownie. Dzienniki sesji pozostają bez zmian. Lista sesji pochodzi
+ * z manifestu, więc katalogi partycji nie są listowane.
+ *
+ * @return Liczba przepisanych plików.
+ */
+int FileHistoryStorage::convertFormat() {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return 0;
+    }
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_documentCache.clear();
+        m_cacheEpoch++;
+    }
+    migrateFlatLayout();
+    int converted = 0;
+    const QStringList sessionIds = m_manifest.sessionIds();
+    for (const QString &sessionId : sessionIds) {
+        QString fileName = sessionFileName(sessionId);
+        QFile file(m_historyDir.filePath(fileName));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug() << "Failed to read session file:" << fileName << "Error:" << file.errorString();
+            continue;
+        }
+        QByteArray encoded = file.readAll();
+        file.close();
+        if (SessionCodec::detect(encoded) == m_format && fileName == sessionFileName(sessionId, m_format)) {
+            continue;
+        }
+
+        bool ok = false;
+        QVariantMap sessionData = SessionCodec::decode(encoded, &ok);
+        if (!ok) {
+            qDebug() << "Skipping unreadable session file:" << fileName;
+            continue;
+        }
+        if (writeSessionFile(sessionId, sessionData)) {
+            converted++;
+        }
+    }
+    qDebug() << "Converted" << converted << "session files to" << SessionCodec::formatName(m_format);
+    return converted;
+}
+
+/**
+ * @brief Zwraca nazwę pliku filtra sesji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Ścieżka pliku względem katalogu historii.
+ */
+QString FileHistoryStorage::filterFileName(const QString &sessionId) const {
+    return sessionPath(sessionId, QString("session_%1.filter").arg(sessionId));
+}
+
+/**
+ * @brief Zwraca filtr sesji, budując go z pliku sesji, jeśli plik filtra nie istnieje.
+ *
+ * Filtry sesji zapisanych przez starsze wersje są budowane przy pierwszym użyciu
+ * z pliku bazowego i dziennika sesji. Zbudowany filtr jest zapisywany tylko wtedy,
+ * gdy blokada zapisu jest wolna i nikt w międzyczasie nie zapisał pliku filtra,
+ * więc odczyt nie czeka na zapisujących ani nie nadpisuje nowszego filtra.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Filtr sesji.
+ */
+SessionFilter FileHistoryStorage::sessionFilter(const QString &sessionId) const {
+    quint64 epoch = 0;
+    {
+        QMutexLocker locker(&m_storageMutex);
+        auto cached = m_filters.constFind(sessionId);
+        if (cached != m_filters.constEnd()) {
+            return cached.value();
+        }
+        epoch = m_cacheEpoch;
+    }
+
+    QString filterPath = m_historyDir.filePath(filterFileName(sessionId));
+    QFile file(filterPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        bool ok = false;
+        SessionFilter filter = SessionFilter::fromBytes(file.readAll(), &ok);
+        file.close();
+        if (ok) {
+            QMutexLocker locker(&m_storageMutex);
+            if (m_cacheEpoch == epoch) {
+                m_filters.insert(sessionId, filter);
+            }
+            return filter;
+        }
+        qDebug() << "Rebuilding malformed session filter:" << filterFileName(sessionId);
+    }
+
+    SessionFilter filter;
+    QByteArray data;
+    QList<QVariantMap> journal;
+    if (!readSessionSnapshot(sessionId, data, journal)) {
+        return filter;
+    }
+    QVariantMap sessionData = SessionCodec::decode(data);
+    for (const QVariantMap &record : std::as_const(journal)) {
+        applyJournalRecord(sessionData, record);
+    }
+    filter.addSession(sessionData);
+    if (!sessionData.isEmpty() && m_writerLock.tryLock()) {
+        // Writers always store the filter, so a valid file written meanwhile is at least as recent
+        QFile current(filterPath);
+        bool valid = current.open(QIODevice::ReadOnly);
+        if (valid) {
+            SessionFilter::fromBytes(current.readAll(), &valid);
+            current.close();
+        }
+        if (!valid) {
+            writeFilterFile(sessionId, filter);
+        }
+        m_writerLock.unlock();
+    }
+    return filter;
+}
+
+/**
+ * @brief Zapisuje filtr sesji do pliku i pamięci podręcznej.
+ *
+ * Plik jest zapisywany atomowo, przez QSaveFile. Wywołujący musi trzymać blokadę zapisu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param filter Filtr sesji.
+ * @return true, jeśli zapis się powiódł.
+ */
+bool FileHistoryStorage::writeFilterFile(const QString &sessionId, const SessionFilter &filter) const {
+    {
+        QMutexLocker locker(&m_storageMutex);
+        m_filters.insert(sessionId, filter);
+        m_cacheEpoch++;
+    }
+    QString filterFile = filterFileName(sessionId);
+    QSaveFile file(m_historyDir.filePath(filterFile));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open session filter for writing:" << filterFile << "Error:" << file.errorString();
+        return false;
+    }
+    file.write(filter.toBytes());
+    if (!file.commit()) {
+        qDebug() << "Failed to write session filter:" << filterFile << "Error:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Zwraca nazwę pliku dziennika sesji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Ścieżka pliku względem katalogu historii.
+ */
+QString FileHistoryStorage::journalFileName(const QString &sessionId) const {
+    return sessionPath(sessionId, QString("session_%1.journal").arg(sessionId));
+}
+
+/**
+ * @brief Zapewnia istnienie katalogu historii.
+ *
+ * Tworzy katalog, jeśli nie istnieje, i loguje wynik operacji.
+ */
+void FileHistoryStorage::ensureHistoryDir() {
+    if (!m_historyDir.exists()) {
+        if (!m_historyDir.mkpath(".")) {
+            qDebug() << "Failed to create history directory:" << m_historyDir.path();
+        } else {
+            qDebug() << "Created history directory:" << m_historyDir.path();
+        }
+    }
+}
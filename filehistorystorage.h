@@ -0,0 +1,360 @@
+#ifndef FILEHISTORYSTORAGE_H
+#define FILEHISTORYSTORAGE_H
+
+#include <QCache>
+#include <QHash>
+#include <QDir>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include "historylock.h"
+#include "historystorage.h"
+#include "seriesstore.h"
+#include "sessioncodec.h"
+#include "sessiondocument.h"
+#include "sessionindex.h"
+#include "sessionmanifest.h"
+
+/**
+ * @class FileHistoryStorage
+ * @brief Magazyn historii sesji oparty na plikach.
+ *
+ * Każda sesja ma plik bazowy zapisany jako CBOR (session_<id>.cbor) albo JSON
+ * (session_<id>.json); format jest rozpoznawany przy odczycie. Zmiany w istniejących sesjach
+ * są dopisywane do dziennika sesji (session_<id>.journal), który jest okresowo scalany
+ * z plikiem bazowym w tle. Pomiary sensorów są przechowywane w kolumnowym magazynie
+ * SeriesStore, a lista sesji w indeksie SessionIndex. Odczyt sensorów jednej stacji
+ * i pojedynczych pól korzysta z indeksu SessionDocument i nie dekoduje całej sesji.
+ * Obok pliku sesji przechowywany jest filtr SessionFilter (session_<id>.filter),
+ * dzięki któremu wyszukiwanie sesji pomija pliki niepasujące do zapytania.
+ *
+ * Pliki sesji leżą w katalogach partycji sessions/<rok>/<miesiąc>/<xx> przypisanych
+ * w manifeście SessionManifest, więc ścieżka pliku sesji jest wyznaczana bez listowania
+ * katalogów. Pliki sesji zapisane przez starsze wersje bezpośrednio w katalogu historii
+ * są przenoszone do partycji przy pierwszym uruchomieniu.
+ *
+ * Katalog historii może być współdzielony przez kilka instancji aplikacji. Zapisy
+ * są wykonywane pod blokadą HistoryLock (plik history.lock), a pliki są podmieniane
+ * atomowo lub zapisywane jako nowe pokolenie, więc odczyty nie zakładają blokad
+ * i nie czekają na zapisujących. Muteks m_storageMutex chroni tylko pamięci podręczne.
+ */
+class FileHistoryStorage : public HistoryStorage
+{
+public:
+    /**
+     * @brief Konstruktor klasy FileHistoryStorage.
+     * @param directory Katalog przechowywania danych historii.
+     * @param maxSessions Maksymalna liczba przechowywanych sesji.
+     * @param format Format zapisu plików bazowych sesji.
+     */
+    FileHistoryStorage(const QString &directory, int maxSessions, SessionCodec::Format format = SessionCodec::Cbor);
+
+    /**
+     * @brief Destruktor klasy FileHistoryStorage.
+     */
+    ~FileHistoryStorage() override;
+
+    bool writeSession(const QString &sessionId, const QVariantMap &sessionData, const QVariantMap &indexEntry) override;
+    bool writeUpdate(const QString &sessionId, const SessionUpdate &update) override;
+    bool writeSummary(const QString &sessionId, const QVariantMap &summary) override;
+    QVariantList loadSessions() const override;
+    QVariantMap loadSessionDetails(const QString &sessionId, qint64 *cost = nullptr) const override;
+    QVariantMap loadSessionFields(const QString &sessionId, const QStringList &keys) const override;
+    QList<QVariantMap> loadStationSensors(const QString &sessionId, int stationId) const override;
+    QVector<MeasurementPoint> loadMeasurements(int sensorId, qint64 from, qint64 to) const override;
+    QVector<RollupPoint> loadRollups(int sensorId, qint64 from, qint64 to) const override;
+    QList<int> seriesSensorIds() const override;
+    int rollUpSensor(int sensorId, qint64 rawBefore, qint64 rollupBefore) override;
+    qint64 oldestMeasurement() const override;
+    qint64 trimBefore(qint64 cutoff) override;
+    bool reclaimSpace() override;
+    qint64 diskUsage() const override;
+    bool sessionExists(const QString &sessionId) const override;
+    QStringList findSessions(const SessionQuery &query, SessionQueryStats *stats = nullptr) const override;
+    quint64 externalChangeCount() const override;
+    HistoryLock &writerLock() override;
+    int convertFormat() override;
+
+    /**
+     * @brief Scala dziennik sesji z plikiem bazowym.
+     * @param sessionId Identyfikator sesji.
+     */
+    void compactSession(const QString &sessionId);
+
+private:
+    /**
+     * @brief Zapewnia istnienie katalogu historii.
+     *
+     * Tworzy katalog, jeśli nie istnieje.
+     */
+    void ensureHistoryDir();
+
+    /**
+     * @brief Przenosi pliki sesji z katalogu historii do katalogów partycji.
+     * @return Liczba przeniesionych sesji.
+     */
+    int migrateFlatLayout();
+
+    /**
+     * @brief Zwraca ścieżkę pliku sesji względem katalogu historii.
+     * @param sessionId Identyfikator sesji.
+     * @param fileName Nazwa pliku sesji.
+     * @return Ścieżka w katalogu partycji sesji.
+     */
+    QString sessionPath(const QString &sessionId, const QString &fileName) const;
+
+    /**
+     * @brief Zapisuje pomiary do współdzielonych szeregów sensorów.
+     * @param sessionId Identyfikator sesji.
+     * @param measurements Lista pomiarów jako QList<QVariantMap>.
+     * @return QVariantList z zakresami zapisanych szeregów.
+     */
+    QVariantList storeMeasurements(const QString &sessionId, const QList<QVariantMap> &measurements);
+
+    /**
+     * @brief Uruchamia w tle scalanie indeksu, jeśli nie jest już zaplanowane.
+     */
+    void scheduleIndexCompaction();
+
+    /**
+     * @brief Aktualizuje plik indeksu sesji.
+     * @param session Dane sesji do dodania do indeksu jako QVariantMap.
+     */
+    void updateIndexFile(const QVariantMap &session);
+
+    /**
+     * @brief Scala indeks sesji i usuwa sesje ponad limit.
+     */
+    void compactIndex();
+
+    /**
+     * @brief Usuwa wszystkie pliki sesji.
+     * @param sessionId Identyfikator sesji.
+     */
+    void removeSessionFiles(const QString &sessionId);
+
+    /**
+     * @brief Zwraca nazwę istniejącego pliku bazowego sesji.
+     * @param sessionId Identyfikator sesji.
+     * @return Ścieżka pliku względem katalogu historii (dla nowej sesji w formacie m_format).
+     */
+    QString sessionFileName(const QString &sessionId) const;
+
+    /**
+     * @brief Zwraca nazwę pliku bazowego sesji zapisanego w podanym formacie.
+     * @param sessionId Identyfikator sesji.
+     * @param format Format zapisu.
+     * @return Ścieżka pliku względem katalogu historii.
+     */
+    QString sessionFileName(const QString &sessionId, SessionCodec::Format format) const;
+
+    /**
+     * @brief Atomowo zapisuje plik bazowy sesji w formacie m_format.
+     * @param sessionId Identyfikator sesji.
+     * @param sessionData Dane sesji.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    bool writeSessionFile(const QString &sessionId, const QVariantMap &sessionData);
+
+    /**
+     * @brief Zwraca nazwę pliku filtra sesji.
+     * @param sessionId Identyfikator sesji.
+     * @return Ścieżka pliku względem katalogu historii.
+     */
+    QString filterFileName(const QString &sessionId) const;
+
+    /**
+     * @brief Zwraca filtr sesji, budując go z pliku sesji, jeśli plik filtra nie istnieje.
+     * @param sessionId Identyfikator sesji.
+     * @return Filtr sesji.
+     */
+    SessionFilter sessionFilter(const QString &sessionId) const;
+
+    /**
+     * @brief Zapisuje filtr sesji do pliku i pamięci podręcznej.
+     * @param sessionId Identyfikator sesji.
+     * @param filter Filtr sesji.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool writeFilterFile(const QString &sessionId, const SessionFilter &filter) const;
+
+    /**
+     * @brief Zwraca nazwę pliku dziennika sesji.
+     * @param sessionId Identyfikator sesji.
+     * @return Ścieżka pliku względem katalogu historii.
+     */
+    QString journalFileName(const QString &sessionId) const;
+
+    /**
+     * @brief Wczytuje plik bazowy sesji bez uwzględniania dziennika.
+     * @param sessionId Identyfikator sesji.
+     * @return QVariantMap z danymi sesji.
+     */
+    QVariantMap readSessionFile(const QString &sessionId) const;
+
+    /**
+     * @brief Wczytuje plik bazowy sesji i rekordy jej dziennika jako spójną parę.
+     * @param sessionId Identyfikator sesji.
+     * @param data Ustawiane na zawartość pliku bazowego.
+     * @param journal Ustawiane na rekordy dziennika w kolejności zapisu.
+     * @return true, jeśli odczyt się powiódł; false w przeciwnym razie.
+     */
+    bool readSessionSnapshot(const QString &sessionId, QByteArray &data, QList<QVariantMap> &journal) const;
+
+    /**
+     * @brief Czyści pamięci podręczne, jeśli inna instancja zapisała zmiany w historii.
+     */
+    void syncWithOtherInstances() const;
+
+    /**
+     * @brief Dopisuje rekord do dziennika sesji.
+     * @param sessionId Identyfikator sesji.
+     * @param record Rekord dziennika jako QVariantMap.
+     * @return true, jeśli rekord został zapisany; false w przeciwnym razie.
+     */
+    bool appendJournalRecord(const QString &sessionId, const QVariantMap &record);
+
+    /**
+     * @struct IndexedSession
+     * @brief Zindeksowany plik bazowy sesji wraz z rekordami jej dziennika.
+     */
+    struct IndexedSession {
+        SessionDocument document;    ///< Indeks pliku bazowego.
+        QList<QVariantMap> journal;  ///< Rekordy dziennika w kolejności zapisu.
+    };
+
+    /**
+     * @brief Zwraca zindeksowaną sesję z pamięci podręcznej, indeksując ją w razie potrzeby.
+     * @param sessionId Identyfikator sesji.
+     * @return Zindeksowana sesja lub pusty wskaźnik.
+     */
+    QSharedPointer<const IndexedSession> indexedSession(const QString &sessionId) const;
+
+    /**
+     * @brief Wczytuje rekordy dziennika sesji.
+     * @param sessionId Identyfikator sesji.
+     * @return Rekordy w kolejności zapisu.
+     */
+    QList<QVariantMap> readJournalRecords(const QString &sessionId) const;
+
+    /**
+     * @brief Nakłada rekordy dziennika na dane sesji.
+     * @param sessionId Identyfikator sesji.
+     * @param sessionData Dane sesji do zaktualizowania.
+     */
+    void replayJournal(const QString &sessionId, QVariantMap &sessionData) const;
+
+    /**
+     * @brief Nakłada pojedynczy rekord dziennika na dane sesji.
+     * @param sessionData Dane sesji do zaktualizowania.
+     * @param record Rekord dziennika.
+     */
+    static void applyJournalRecord(QVariantMap &sessionData, const QVariantMap &record);
+
+    /**
+     * @brief Planuje scalenie dziennika sesji w tle.
+     * @param sessionId Identyfikator sesji.
+     */
+    void scheduleCompaction(const QString &sessionId);
+
+    /**
+     * @brief Katalog przechowujący pliki historii.
+     */
+    QDir m_historyDir;
+
+    /**
+     * @brief Indeks sesji (dziennik rekordów i migawka).
+     */
+    SessionIndex m_sessionIndex;
+
+    /**
+     * @brief Manifest katalogów partycji plików sesji.
+     */
+    mutable SessionManifest m_manifest;
+
+    /**
+     * @brief Kolumnowy magazyn pomiarów sensorów.
+     */
+    SeriesStore m_seriesStore;
+
+    /**
+     * @brief Maksymalna liczba przechowywanych sesji.
+     */
+    const int m_maxSessions;
+
+    /**
+     * @brief Format zapisu plików bazowych sesji.
+     */
+    const SessionCodec::Format m_format;
+
+    /**
+     * @brief Liczba wpisów w dzienniku indeksu, po której indeks jest scalany.
+     */
+    static const int INDEX_COMPACT_INTERVAL = 16;
+
+    /**
+     * @brief Rozmiar dziennika (w bajtach), po którego przekroczeniu dziennik jest scalany.
+     */
+    static const qint64 JOURNAL_COMPACT_THRESHOLD = 256 * 1024;
+
+    /**
+     * @brief Budżet pamięci podręcznej zindeksowanych sesji (w bajtach).
+     */
+    static const qint64 DOCUMENT_CACHE_BUDGET = 8 * 1024 * 1024;
+
+    /**
+     * @brief Pamięć podręczna zindeksowanych sesji, z kosztem równym rozmiarowi pliku.
+     */
+    mutable QCache<QString, QSharedPointer<IndexedSession>> m_documentCache;
+
+    /**
+     * @brief Filtry sesji wczytane z plików session_<id>.filter.
+     */
+    mutable QHash<QString, SessionFilter> m_filters;
+
+    /**
+     * @brief Licznik zmian pamięci podręcznych przez zapisujących.
+     *
+     * Czytelnik wstawia wczytane dane do pamięci podręcznej tylko wtedy, gdy licznik
+     * nie zmienił się od rozpoczęcia odczytu.
+     */
+    mutable quint64 m_cacheEpoch;
+
+    /**
+     * @brief Liczba wykrytych zapisów innych instancji (chroniona przez m_storageMutex).
+     */
+    mutable quint64 m_externalChanges;
+
+    /**
+     * @brief Muteks chroniący pamięci podręczne i zbiory zaplanowanych scaleń.
+     */
+    mutable QMutex m_storageMutex;
+
+    /**
+     * @brief Blokada zapisu współdzielona z innymi instancjami aplikacji.
+     */
+    mutable HistoryLock m_writerLock;
+
+    /**
+     * @brief Liczba prób spójnego odczytu sesji zmienianej przez innego zapisującego.
+     */
+    static const int MAX_READ_ATTEMPTS = 3;
+
+    /**
+     * @brief Sesje oczekujące na scalenie dziennika.
+     */
+    QSet<QString> m_pendingCompactions;
+
+    /**
+     * @brief Czy scalanie indeksu sesji jest już zaplanowane.
+     */
+    bool m_indexCompactionPending;
+
+    /**
+     * @brief Pula wątków wykonująca scalanie dzienników i indeksu w tle.
+     */
+    QThreadPool m_compactionPool;
+};
+
+#endif // FILEHISTORYSTORAGE_H
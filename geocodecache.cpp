@@ -0,0 +1,306 @@
+#include "geocodecache.h"
+#include "historymanager.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+
+/**
+ * @brief Konstruktor klasy GeocodeCache. Wczytuje zapisane wpisy.
+ *
+ * @param filePath Ścieżka pliku pamięci (domyślnie <CacheLocation>/geocode.json).
+ */
+GeocodeCache::GeocodeCache(const QString &filePath)
+    : m_filePath(filePath), m_dirty(false) {
+    load();
+}
+
+/**
+ * @brief Destruktor klasy GeocodeCache. Czeka na odczyt historii i zapisuje zmiany kolejności LRU.
+ */
+GeocodeCache::~GeocodeCache() {
+    waitForWarmup();
+    if (m_dirty) {
+        save();
+    }
+}
+
+/**
+ * @brief Zwraca domyślną ścieżkę pliku pamięci.
+ *
+ * @return Ścieżka <CacheLocation>/geocode.json.
+ */
+QString GeocodeCache::defaultFilePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/geocode.json";
+}
+
+/**
+ * @brief Normalizuje zapytanie do postaci klucza.
+ *
+ * Usuwa skrajne odstępy i zastępuje ciągi odstępów jedną spacją, ujednolica wielkość
+ * liter, a po rozkładzie NFKD usuwa znaki diakrytyczne (np. "Łódź" daje "lodz").
+ *
+ * @param query Zapytanie wpisane przez użytkownika.
+ * @return Klucz (pusty dla pustego zapytania).
+ */
+QString GeocodeCache::normalize(const QString &query) {
+    const QString decomposed = query.simplified().toCaseFolded().normalized(QString::NormalizationForm_KD);
+    QString key;
+    key.reserve(decomposed.size());
+    for (QChar c : decomposed) {
+        if (c.category() == QChar::Mark_NonSpacing) {
+            continue;
+        }
+        // The Polish stroked l has no canonical decomposition
+        if (c == QChar(0x0142)) {
+            c = QLatin1Char('l');
+        }
+        key.append(c);
+    }
+    return key;
+}
+
+/**
+ * @brief Wyszukuje współrzędne zapytania.
+ *
+ * Trafienie odświeża chwilę użycia wpisu (kolejność LRU), a przeterminowany wpis
+ * jest usuwany. Obie zmiany są tylko w pamięci; plik jest zapisywany przy następnym
+ * insert() lub w destruktorze.
+ *
+ * @param query Zapytanie wpisane przez użytkownika.
+ * @param latitude Ustawiane na szerokość geograficzną, jeśli wpis istnieje.
+ * @param longitude Ustawiane na długość geograficzną, jeśli wpis istnieje.
+ * @return true, jeśli istnieje ważny wpis.
+ */
+bool GeocodeCache::lookup(const QString &query, double *latitude, double *longitude) {
+    auto it = m_entries.find(normalize(query));
+    if (it == m_entries.end()) {
+        return false;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    m_dirty = true;
+    if (isExpired(it.value(), now)) {
+        m_entries.erase(it);
+        return false;
+    }
+    it->usedAt = now;
+    *latitude = it->latitude;
+    *longitude = it->longitude;
+    return true;
+}
+
+/**
+ * @brief Zapisuje współrzędne zapytania.
+ *
+ * @param query Zapytanie wpisane przez użytkownika.
+ * @param latitude Szerokość geograficzna.
+ * @param longitude Długość geograficzna.
+ */
+void GeocodeCache::insert(const QString &query, double latitude, double longitude) {
+    const QString key = normalize(query);
+    if (key.isEmpty()) {
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    store(key, Entry{latitude, longitude, now, now});
+    save();
+}
+
+/**
+ * @brief Uzupełnia pamięć w tle współrzędnymi lokalizacji z sesji historii.
+ *
+ * Indeks i pola sesji są odczytywane w puli wątków (QtConcurrent), a wyniki są
+ * dołączane do pamięci w wątku obiektu context, więc wątek interfejsu nie czeka
+ * na dysk. Jeśli context zostanie usunięty wcześniej, wyniki są pomijane.
+ *
+ * @param historyManager Menedżer historii sesji (musi istnieć do zakończenia waitForWarmup()).
+ * @param context Obiekt w wątku interfejsu, w którym wyniki są dołączane do pamięci.
+ */
+void GeocodeCache::warmFrom(const HistoryManager *historyManager, QObject *context) {
+    waitForWarmup();
+    const QList<QString> keys = m_entries.keys();
+    const QSet<QString> known(keys.cbegin(), keys.cend());
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    m_warmup = QtConcurrent::run([historyManager, known, now]() {
+        return readHistory(historyManager, known, now);
+    });
+    m_warmup.then(context, [this](const QHash<QString, Entry> &entries) {
+        merge(entries);
+    });
+}
+
+/**
+ * @brief Czeka na zakończenie odczytu historii rozpoczętego przez warmFrom().
+ *
+ * Czeka tylko na odczyt w puli wątków, nie na dołączenie wyników, więc może być
+ * wywołana w wątku interfejsu (np. przed usunięciem menedżera historii).
+ */
+void GeocodeCache::waitForWarmup() {
+    m_warmup.waitForFinished();
+}
+
+/**
+ * @brief Odczytuje współrzędne lokalizacji z sesji historii.
+ *
+ * Indeks sesji zawiera tylko wpisaną lokalizację, więc współrzędne są odczytywane
+ * (samo pole "location") tylko dla lokalizacji, których nie ma jeszcze w pamięci.
+ * Sesje bez współrzędnych (wyszukiwanie offline lub nieudane geokodowanie) oraz
+ * sesje starsze niż TTL_DAYS są pomijane. Wpis jest ważny od chwili utworzenia sesji.
+ * Wywoływana w puli wątków, więc nie korzysta z m_entries.
+ *
+ * @param historyManager Menedżer historii sesji.
+ * @param known Klucze, które są już w pamięci.
+ * @param now Bieżąca chwila.
+ * @return Wpisy według znormalizowanego klucza.
+ */
+QHash<QString, GeocodeCache::Entry> GeocodeCache::readHistory(const HistoryManager *historyManager, const QSet<QString> &known, const QDateTime &now) {
+    QHash<QString, Entry> entries;
+    for (const QVariant &sessionVariant : historyManager->loadSessions()) {
+        const QVariantMap session = sessionVariant.toMap();
+        const QString key = normalize(session["location"].toString());
+        if (key.isEmpty() || known.contains(key) || entries.contains(key)) {
+            continue;
+        }
+        const QDateTime timestamp = QDateTime::fromString(session["timestamp"].toString(), Qt::ISODate);
+        if (!timestamp.isValid() || isExpired(Entry{0.0, 0.0, timestamp, timestamp}, now)) {
+            continue;
+        }
+
+        const QVariantMap location = historyManager->loadSessionFields(session["session_id"].toString(), {"location"})["location"].toMap();
+        const double latitude = location["latitude"].toDouble();
+        const double longitude = location["longitude"].toDouble();
+        if (latitude == 0.0 || longitude == 0.0) {
+            continue;
+        }
+        entries.insert(key, Entry{latitude, longitude, timestamp, timestamp});
+    }
+    return entries;
+}
+
+/**
+ * @brief Dołącza wpisy odczytane z historii.
+ *
+ * Klucze dodane w trakcie odczytu (np. przez insert() po geokodowaniu) są pomijane,
+ * bo mają świeższe współrzędne.
+ *
+ * @param entries Wpisy według znormalizowanego klucza.
+ * @return Liczba dodanych wpisów.
+ */
+int GeocodeCache::merge(const QHash<QString, Entry> &entries) {
+    int added = 0;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (m_entries.contains(it.key())) {
+            continue;
+        }
+        store(it.key(), it.value());
+        added++;
+    }
+
+    if (added > 0) {
+        qDebug() << "Geocode cache warmed with" << added << "locations from history (" << m_entries.size() << "entries)";
+        save();
+    }
+    return added;
+}
+
+/**
+ * @brief Zwraca liczbę wpisów.
+ *
+ * @return Liczba wpisów (także przeterminowanych, jeszcze nieusuniętych).
+ */
+int GeocodeCache::size() const {
+    return int(m_entries.size());
+}
+
+/**
+ * @brief Sprawdza, czy wpis jest przeterminowany.
+ *
+ * @param entry Wpis.
+ * @param now Bieżąca chwila.
+ * @return true, jeśli wpis jest starszy niż TTL_DAYS.
+ */
+bool GeocodeCache::isExpired(const Entry &entry, const QDateTime &now) {
+    return entry.storedAt.addDays(TTL_DAYS) < now;
+}
+
+/**
+ * @brief Dodaje wpis i usuwa najdawniej używane wpisy ponad MAX_ENTRIES.
+ *
+ * @param key Znormalizowany klucz.
+ * @param entry Wpis.
+ */
+void GeocodeCache::store(const QString &key, const Entry &entry) {
+    m_entries.insert(key, entry);
+    while (m_entries.size() > MAX_ENTRIES) {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->usedAt < oldest->usedAt) {
+                oldest = it;
+            }
+        }
+        m_entries.erase(oldest);
+    }
+}
+
+/**
+ * @brief Wczytuje wpisy z pliku, pomijając przeterminowane.
+ *
+ * Brak pliku lub uszkodzony plik daje pustą pamięć.
+ */
+void GeocodeCache::load() {
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        qDebug() << "Ignoring malformed geocode cache:" << m_filePath;
+        return;
+    }
+
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const QJsonObject entries = doc.object();
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const QJsonObject value = it.value().toObject();
+        Entry entry{value["lat"].toDouble(), value["lon"].toDouble(),
+                    QDateTime::fromString(value["storedAt"].toString(), Qt::ISODate),
+                    QDateTime::fromString(value["usedAt"].toString(), Qt::ISODate)};
+        if (!entry.storedAt.isValid() || entry.latitude == 0.0 || entry.longitude == 0.0 || isExpired(entry, now)) {
+            continue;
+        }
+        store(it.key(), entry);
+    }
+    qDebug() << "Loaded geocode cache with" << m_entries.size() << "entries";
+}
+
+/**
+ * @brief Zapisuje wpisy do pliku (atomowo).
+ */
+void GeocodeCache::save() {
+    m_dirty = false;
+    QJsonObject entries;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        entries.insert(it.key(), QJsonObject{
+            {"lat", it->latitude},
+            {"lon", it->longitude},
+            {"storedAt", it->storedAt.toString(Qt::ISODate)},
+            {"usedAt", it->usedAt.toString(Qt::ISODate)}
+        });
+    }
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open geocode cache for writing:" << m_filePath;
+        return;
+    }
+    file.write(QJsonDocument(entries).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qDebug() << "Failed to save geocode cache:" << m_filePath;
+    }
+}
@@ -0,0 +1,170 @@
+#ifndef GEOCODECACHE_H
+#define GEOCODECACHE_H
+
+#include <QDateTime>
+#include <QFuture>
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+class HistoryManager;
+class QObject;
+
+/**
+ * @class GeocodeCache
+ * @brief Trwała pamięć podręczna współrzędnych lokalizacji z Nominatim.
+ *
+ * Wpisy są kluczowane znormalizowanym zapytaniem (bez skrajnych i powtórzonych
+ * odstępów, bez rozróżniania wielkości liter i znaków diakrytycznych), więc
+ * "Łódź", " lodz" i "ŁÓDŹ" trafiają w ten sam wpis. Wpis jest ważny przez TTL_DAYS
+ * od geokodowania, a po przekroczeniu MAX_ENTRIES usuwane są najdawniej używane wpisy.
+ * Pamięć jest zapisywana jako JSON w <CacheLocation>/geocode.json i może być
+ * uzupełniona w tle współrzędnymi zapisanymi w sesjach historii (warmFrom()).
+ */
+class GeocodeCache
+{
+public:
+    /**
+     * @brief Konstruktor klasy GeocodeCache. Wczytuje zapisane wpisy.
+     * @param filePath Ścieżka pliku pamięci (domyślnie <CacheLocation>/geocode.json).
+     */
+    explicit GeocodeCache(const QString &filePath = defaultFilePath());
+
+    /**
+     * @brief Destruktor klasy GeocodeCache. Czeka na odczyt historii i zapisuje zmiany kolejności LRU.
+     */
+    ~GeocodeCache();
+
+    /**
+     * @brief Zwraca domyślną ścieżkę pliku pamięci.
+     * @return Ścieżka <CacheLocation>/geocode.json.
+     */
+    static QString defaultFilePath();
+
+    /**
+     * @brief Normalizuje zapytanie do postaci klucza.
+     * @param query Zapytanie wpisane przez użytkownika.
+     * @return Klucz (pusty dla pustego zapytania).
+     */
+    static QString normalize(const QString &query);
+
+    /**
+     * @brief Wyszukuje współrzędne zapytania.
+     * @param query Zapytanie wpisane przez użytkownika.
+     * @param latitude Ustawiane na szerokość geograficzną, jeśli wpis istnieje.
+     * @param longitude Ustawiane na długość geograficzną, jeśli wpis istnieje.
+     * @return true, jeśli istnieje ważny wpis.
+     */
+    bool lookup(const QString &query, double *latitude, double *longitude);
+
+    /**
+     * @brief Zapisuje współrzędne zapytania.
+     * @param query Zapytanie wpisane przez użytkownika.
+     * @param latitude Szerokość geograficzna.
+     * @param longitude Długość geograficzna.
+     */
+    void insert(const QString &query, double latitude, double longitude);
+
+    /**
+     * @brief Uzupełnia pamięć w tle współrzędnymi lokalizacji z sesji historii.
+     * @param historyManager Menedżer historii sesji (musi istnieć do zakończenia waitForWarmup()).
+     * @param context Obiekt w wątku interfejsu, w którym wyniki są dołączane do pamięci.
+     */
+    void warmFrom(const HistoryManager *historyManager, QObject *context);
+
+    /**
+     * @brief Czeka na zakończenie odczytu historii rozpoczętego przez warmFrom().
+     */
+    void waitForWarmup();
+
+    /**
+     * @brief Zwraca liczbę wpisów.
+     * @return Liczba wpisów (także przeterminowanych, jeszcze nieusuniętych).
+     */
+    int size() const;
+
+    /**
+     * @brief Czas ważności wpisu w dniach.
+     */
+    static const int TTL_DAYS = 90;
+
+    /**
+     * @brief Największa liczba wpisów.
+     */
+    static const int MAX_ENTRIES = 500;
+
+private:
+    /**
+     * @struct Entry
+     * @brief Wpis pamięci.
+     */
+    struct Entry {
+        double latitude;   ///< Szerokość geograficzna.
+        double longitude;  ///< Długość geograficzna.
+        QDateTime storedAt; ///< Chwila geokodowania (od niej liczony jest TTL).
+        QDateTime usedAt;   ///< Chwila ostatniego użycia (kolejność LRU).
+    };
+
+    /**
+     * @brief Sprawdza, czy wpis jest przeterminowany.
+     * @param entry Wpis.
+     * @param now Bieżąca chwila.
+     * @return true, jeśli wpis jest starszy niż TTL_DAYS.
+     */
+    static bool isExpired(const Entry &entry, const QDateTime &now);
+
+    /**
+     * @brief Odczytuje współrzędne lokalizacji z sesji historii (w puli wątków).
+     * @param historyManager Menedżer historii sesji.
+     * @param known Klucze, które są już w pamięci.
+     * @param now Bieżąca chwila.
+     * @return Wpisy według znormalizowanego klucza.
+     */
+    static QHash<QString, Entry> readHistory(const HistoryManager *historyManager, const QSet<QString> &known, const QDateTime &now);
+
+    /**
+     * @brief Dołącza wpisy odczytane z historii, pomijając klucze dodane w międzyczasie.
+     * @param entries Wpisy według znormalizowanego klucza.
+     * @return Liczba dodanych wpisów.
+     */
+    int merge(const QHash<QString, Entry> &entries);
+
+    /**
+     * @brief Dodaje wpis i usuwa najdawniej używane wpisy ponad MAX_ENTRIES.
+     * @param key Znormalizowany klucz.
+     * @param entry Wpis.
+     */
+    void store(const QString &key, const Entry &entry);
+
+    /**
+     * @brief Wczytuje wpisy z pliku, pomijając przeterminowane.
+     */
+    void load();
+
+    /**
+     * @brief Zapisuje wpisy do pliku (atomowo).
+     */
+    void save();
+
+    /**
+     * @brief Ścieżka pliku pamięci.
+     */
+    QString m_filePath;
+
+    /**
+     * @brief Wpisy według znormalizowanego klucza.
+     */
+    QHash<QString, Entry> m_entries;
+
+    /**
+     * @brief Czy wpisy w pamięci różnią się od zapisanych (np. po trafieniu).
+     */
+    bool m_dirty;
+
+    /**
+     * @brief Trwający odczyt historii (warmFrom()).
+     */
+    QFuture<QHash<QString, Entry>> m_warmup;
+};
+
+#endif // GEOCODECACHE_H
@@ -0,0 +1,169 @@
+#include "historybenchmark.h"
+#include "filehistorystorage.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTimeZone>
+
+namespace {
+
+/**
+ * @brief Parametry syntetycznej historii.
+ */
+const int STATION_COUNT = 300;
+const int SENSORS_PER_STATION = 4;
+const int STATIONS_PER_SESSION = 6;
+const qint64 HISTORY_SPAN_SECONDS = 2 * 365 * 24 * 3600;
+const qint64 SESSION_SPAN_SECONDS = 3 * 24 * 3600;
+const char *const PARAM_CODES[SENSORS_PER_STATION] = {"PM10", "PM2.5", "NO2", "O3"};
+
+/**
+ * @brief Sprawdza sesję pełnym odczytem, tak jak przed wprowadzeniem filtrów.
+ */
+bool fullScanMatches(const FileHistoryStorage &storage, const QString &sessionId, const SessionQuery &query) {
+    QVariantMap sessionData = storage.loadSessionDetails(sessionId);
+    for (const QVariant &sensorVariant : sessionData["sensors"].toList()) {
+        if (query.matchesSensor(sensorVariant.toMap())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * @brief Mierzy skuteczność filtrów sesji przy wyszukiwaniu sesji.
+ *
+ * Tworzy sessionCount sesji z losowymi stacjami (po STATIONS_PER_SESSION stacji
+ * z SENSORS_PER_STATION sensorami) i trzydniowymi szeregami pomiarów rozłożonymi
+ * na dwa lata, a następnie wykonuje zapytania typu "sesje z danymi sensora stacji
+ * z danego dnia", "sesje z danymi sensora" i "sesje stacji z danego dnia". Dla każdego
+ * zapytania wynik findSessions() jest porównywany z pełnym przeglądem wszystkich
+ * plików sesji. Generator ma stałe ziarno, więc wyniki są powtarzalne.
+ *
+ * @param sessionCount Liczba syntetycznych sesji.
+ * @param queryCount Liczba wykonywanych zapytań.
+ * @param out Strumień, do którego wypisywane są wyniki.
+ * @return 0, jeśli wyniki z filtrami zgadzają się z pełnym przeglądem; 1 w przeciwnym razie.
+ */
+int HistoryBenchmark::runSessionFilter(int sessionCount, int queryCount, QTextStream &out) {
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        out << "Failed to create a temporary directory\n";
+        return 1;
+    }
+
+    QRandomGenerator random(530);
+    qint64 historyStart = QDateTime(QDate(2024, 1, 1), QTime(0, 0), QTimeZone::utc()).toSecsSinceEpoch();
+    QElapsedTimer timer;
+    timer.start();
+    {
+        FileHistoryStorage storage(directory.path(), sessionCount);
+        for (int i = 0; i < sessionCount; ++i) {
+            QString sessionId = QString("benchmark-%1").arg(i, 8, 10, QChar('0'));
+            qint64 seriesTo = historyStart + HISTORY_SPAN_SECONDS * i / sessionCount;
+            qint64 seriesFrom = seriesTo - SESSION_SPAN_SECONDS;
+
+            QVariantList stations;
+            QVariantList sensors;
+            for (int s = 0; s < STATIONS_PER_SESSION; ++s) {
+                int stationId = 1 + int(random.bounded(STATION_COUNT));
+                stations.append(QVariantMap{
+                    {"stationId", stationId},
+                    {"stationName", QString("Stacja %1").arg(stationId)},
+                    {"cityName", QString("Miasto %1").arg(stationId % 50)},
+                    {"sessionId", sessionId}
+                });
+                for (int p = 0; p < SENSORS_PER_STATION; ++p) {
+                    sensors.append(QVariantMap{
+                        {"id", stationId * 10 + p},
+                        {"stationId", stationId},
+                        {"param", QVariantMap{{"paramCode", PARAM_CODES[p]}}},
+                        {"seriesFrom", seriesFrom},
+                        {"seriesTo", seriesTo}
+                    });
+                }
+            }
+
+            QString timestamp = QDateTime::fromSecsSinceEpoch(seriesTo, QTimeZone::utc()).toString(Qt::ISODate);
+            QVariantMap sessionData{{"session_id", sessionId}, {"timestamp", timestamp}, {"radius", 10.0},
+                                    {"stations", stations}, {"sensors", sensors}};
+            QVariantMap indexEntry{{"session_id", sessionId}, {"timestamp", timestamp},
+                                   {"location", "Benchmark"}, {"radius", 10.0}};
+            storage.writeSession(sessionId, sessionData, indexEntry);
+        }
+    }
+    out << "Wrote " << sessionCount << " synthetic sessions in " << timer.elapsed() << " ms\n";
+
+    // A fresh storage reads the filters from their files, as after a restart
+    FileHistoryStorage storage(directory.path(), sessionCount);
+    const QVariantList sessions = storage.loadSessions();
+
+    qint64 filteredNs = 0;
+    qint64 fullScanNs = 0;
+    qint64 checked = 0;
+    qint64 pruned = 0;
+    qint64 opened = 0;
+    qint64 matched = 0;
+    int mismatches = 0;
+    for (int q = 0; q < queryCount; ++q) {
+        SessionQuery query;
+        int stationId = 1 + int(random.bounded(STATION_COUNT));
+        qint64 day = historyStart + qint64(random.bounded(int(HISTORY_SPAN_SECONDS / 86400))) * 86400;
+        switch (q % 3) {
+        case 0:
+            query.stationId = stationId;
+            query.sensorId = stationId * 10;
+            query.from = day;
+            query.to = day + 86399;
+            break;
+        case 1:
+            query.sensorId = stationId * 10 + int(random.bounded(SENSORS_PER_STATION));
+            break;
+        default:
+            query.stationId = stationId;
+            query.from = day;
+            query.to = day + 86399;
+            break;
+        }
+
+        SessionQueryStats stats;
+        timer.restart();
+        QStringList filtered = storage.findSessions(query, &stats);
+        filteredNs += timer.nsecsElapsed();
+
+        timer.restart();
+        QStringList scanned;
+        for (const QVariant &sessionVariant : sessions) {
+            QString sessionId = sessionVariant.toMap()["session_id"].toString();
+            if (fullScanMatches(storage, sessionId, query)) {
+                scanned.append(sessionId);
+            }
+        }
+        fullScanNs += timer.nsecsElapsed();
+
+        if (filtered != scanned) {
+            mismatches++;
+        }
+        checked += stats.sessions;
+        pruned += stats.pruned;
+        opened += stats.opened;
+        matched += stats.matched;
+    }
+
+    double prunedPercent = checked > 0 ? 100.0 * pruned / checked : 0.0;
+    double falsePositivePercent = checked > 0 ? 100.0 * (opened - matched) / checked : 0.0;
+    out << "Queries: " << queryCount << ", sessions per query: " << sessions.size() << "\n";
+    out << "Pruned without opening: " << QString::number(prunedPercent, 'f', 2) << "% of session files\n";
+    out << "Opened without a match (filter false positives): " << QString::number(falsePositivePercent, 'f', 2) << "%\n";
+    out << "Average matches per query: " << QString::number(double(matched) / qMax(queryCount, 1), 'f', 2) << "\n";
+    out << "Average query time: " << QString::number(filteredNs / 1e6 / qMax(queryCount, 1), 'f', 2) << " ms with filters, "
+        << QString::number(fullScanNs / 1e6 / qMax(queryCount, 1), 'f', 2) << " ms with a full scan\n";
+    if (mismatches > 0) {
+        out << mismatches << " queries returned different sessions than the full scan\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef HISTORYBENCHMARK_H
+#define HISTORYBENCHMARK_H
+
+#include <QTextStream>
+
+/**
+ * @class HistoryBenchmark
+ * @brief Pomiary wydajności magazynu historii na syntetycznych danych.
+ *
+ * Benchmarki są uruchamiane z wiersza poleceń (opcja --benchmark-session-filter)
+ * i działają w katalogu tymczasowym, bez wpływu na historię użytkownika.
+ */
+class HistoryBenchmark
+{
+public:
+    /**
+     * @brief Mierzy skuteczność filtrów sesji przy wyszukiwaniu sesji.
+     * @param sessionCount Liczba syntetycznych sesji.
+     * @param queryCount Liczba wykonywanych zapytań.
+     * @param out Strumień, do którego wypisywane są wyniki.
+     * @return 0, jeśli wyniki z filtrami zgadzają się z pełnym przeglądem; 1 w przeciwnym razie.
+     */
+    static int runSessionFilter(int sessionCount, int queryCount, QTextStream &out);
+};
+
+#endif // HISTORYBENCHMARK_H
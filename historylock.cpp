@@ -0,0 +1,222 @@
+#include "historylock.h"
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QDebug>
+
+/**
+ * @brief Konstruktor klasy HistoryLock.
+ *
+ * @param directory Katalog współdzielony przez instancje.
+ * @param name Nazwa blokady (przedrostek plików blokady).
+ */
+HistoryLock::HistoryLock(const QString &directory, const QString &name)
+    : m_lockFile(QDir(directory).filePath(name + ".lock")),
+      m_writeCountPath(QDir(directory).filePath(name + ".writes")),
+      m_depth(0), m_owner(nullptr),
+      m_knownWrites(readGeneration(m_writeCountPath)) {
+    m_lockFile.setStaleLockTime(STALE_LOCK_MS);
+}
+
+/**
+ * @brief Zakłada blokadę, czekając najwyżej LOCK_TIMEOUT_MS.
+ *
+ * @param lock Blokada.
+ */
+HistoryLock::Locker::Locker(HistoryLock &lock)
+    : m_lock(lock), m_locked(lock.lock()) {
+}
+
+/**
+ * @brief Zwalnia blokadę, jeśli została założona.
+ */
+HistoryLock::Locker::~Locker() {
+    if (m_locked) {
+        m_lock.unlock();
+    }
+}
+
+/**
+ * @brief Zakłada blokadę, czekając najwyżej LOCK_TIMEOUT_MS.
+ *
+ * Plik blokady jest zakładany tylko przez najbardziej zewnętrzne wywołanie.
+ *
+ * @return true, jeśli blokada została założona; false po przekroczeniu czasu oczekiwania.
+ */
+bool HistoryLock::lock() {
+    m_mutex.lock();
+    if (m_depth == 0 && !m_lockFile.tryLock(LOCK_TIMEOUT_MS)) {
+        qDebug() << "Failed to acquire history lock:" << m_lockFile.fileName() << "Error:" << int(m_lockFile.error());
+        m_mutex.unlock();
+        return false;
+    }
+    if (m_depth++ == 0) {
+        m_owner.storeRelease(QThread::currentThreadId());
+    }
+    return true;
+}
+
+/**
+ * @brief Zakłada blokadę, jeśli jest wolna.
+ *
+ * @return true, jeśli blokada została założona; false, jeśli trzyma ją inny wątek lub proces.
+ */
+bool HistoryLock::tryLock() {
+    if (!m_mutex.try_lock()) {
+        return false;
+    }
+    if (m_depth == 0 && !m_lockFile.tryLock(0)) {
+        m_mutex.unlock();
+        return false;
+    }
+    if (m_depth++ == 0) {
+        m_owner.storeRelease(QThread::currentThreadId());
+    }
+    return true;
+}
+
+/**
+ * @brief Zwalnia blokadę założoną przez lock() lub tryLock().
+ *
+ * Najbardziej zewnętrzne zwolnienie zwiększa licznik zapisów i zwalnia plik blokady.
+ */
+void HistoryLock::unlock() {
+    if (--m_depth == 0) {
+        bumpWriteCount();
+        m_owner.storeRelease(nullptr);
+        m_lockFile.unlock();
+    }
+    m_mutex.unlock();
+}
+
+/**
+ * @brief Sprawdza, czy inna instancja zapisała dane od ostatniego sprawdzenia.
+ *
+ * Zapisy tej instancji aktualizują znaną wartość licznika, więc nie są zgłaszane.
+ * Wątek trzymający blokadę (zapis) zawsze odczytuje licznik, bo przed zapisem musi
+ * widzieć wszystkie zmiany innych instancji. Odczyty bez blokady sprawdzają licznik
+ * najwyżej raz na EXTERNAL_CHECK_INTERVAL_MS; zmiana zapisana w międzyczasie zostanie
+ * zgłoszona przy kolejnym sprawdzeniu.
+ *
+ * @return true, jeśli licznik zapisów zmienił się bez udziału tej instancji.
+ */
+bool HistoryLock::hasExternalChanges() {
+    if (m_owner.loadAcquire() != QThread::currentThreadId()) {
+        QMutexLocker locker(&m_checkMutex);
+        if (m_lastCheck.isValid() && !m_lastCheck.hasExpired(EXTERNAL_CHECK_INTERVAL_MS)) {
+            return false;
+        }
+        m_lastCheck.start();
+    }
+    quint64 current = readGeneration(m_writeCountPath);
+    return m_knownWrites.fetchAndStoreRelaxed(current) != current;
+}
+
+/**
+ * @brief Odczytuje numer pokolenia z pliku wskaźnika.
+ *
+ * Plik jest podmieniany atomowo, więc odczyt zawsze widzi całą wartość.
+ *
+ * @param pointerPath Ścieżka pliku wskaźnika.
+ * @return Numer pokolenia lub 0, jeśli plik nie istnieje lub jest uszkodzony.
+ */
+quint64 HistoryLock::readGeneration(const QString &pointerPath) {
+    QFile file(pointerPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    return file.readAll().trimmed().toULongLong();
+}
+
+/**
+ * @brief Atomowo zapisuje numer pokolenia do pliku wskaźnika.
+ *
+ * @param pointerPath Ścieżka pliku wskaźnika.
+ * @param generation Numer pokolenia.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool HistoryLock::writeGeneration(const QString &pointerPath, quint64 generation) {
+    QSaveFile file(pointerPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open generation file for writing:" << pointerPath << "Error:" << file.errorString();
+        return false;
+    }
+    file.write(QByteArray::number(generation));
+    if (!file.commit()) {
+        qDebug() << "Failed to write generation file:" << pointerPath << "Error:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Zwraca przedrostek plików danego pokolenia.
+ *
+ * Pokolenie 0 używa nazw plików sprzed wprowadzenia pokoleń, dzięki czemu
+ * istniejąca historia jest czytana bez konwersji.
+ *
+ * @param prefix Przedrostek plików pokolenia 0.
+ * @param generation Numer pokolenia.
+ * @return prefix dla pokolenia 0, w przeciwnym razie prefix.g<generation>.
+ */
+QString HistoryLock::generationPrefix(const QString &prefix, quint64 generation) {
+    return generation == 0 ? prefix : prefix + ".g" + QString::number(generation);
+}
+
+/**
+ * @brief Usuwa pliki pokoleń starszych niż podane.
+ *
+ * Usuwane są tylko pliki o podanych rozszerzeniach. Plik, którego nie da się
+ * usunąć (np. wciąż otwarty przez czytelnika w systemie Windows), zostanie
+ * usunięty przy kolejnym wywołaniu.
+ *
+ * @param dir Katalog plików.
+ * @param name Nazwa pliku bez rozszerzeń (przedrostek pokolenia 0).
+ * @param suffixes Rozszerzenia plików należących do pokolenia.
+ * @param generation Najstarsze zachowywane pokolenie.
+ */
+void HistoryLock::removeGenerationsBefore(const QDir &dir, const QString &name, const QStringList &suffixes, quint64 generation) {
+    const QStringList files = dir.entryList({name + ".*"}, QDir::Files);
+    for (const QString &file : files) {
+        QString suffix = file.mid(name.size() + 1);
+        quint64 fileGeneration = 0;
+        int dot = suffix.indexOf('.');
+        if (suffix.startsWith('g') && dot > 1) {
+            bool ok = false;
+            quint64 parsed = suffix.mid(1, dot - 1).toULongLong(&ok);
+            if (ok) {
+                fileGeneration = parsed;
+                suffix = suffix.mid(dot + 1);
+            }
+        }
+        if (fileGeneration < generation && suffixes.contains(suffix) && !QFile::remove(dir.filePath(file))) {
+            qDebug() << "Failed to remove old generation file:" << dir.filePath(file);
+        }
+    }
+}
+
+/**
+ * @brief Zwiększa licznik zapisów.
+ *
+ * Wywoływane z założonym plikiem blokady, więc odczyt i zapis licznika nie przeplatają
+ * się z innymi instancjami. Licznik ma stałą szerokość i jest nadpisywany w miejscu,
+ * bez podmiany pliku i bez synchronizacji z dyskiem: czytelnik, który trafi na częściowy
+ * zapis, najwyżej niepotrzebnie odświeży pamięci podręczne. Jeśli inna instancja zapisała
+ * coś od ostatniego sprawdzenia, znana wartość licznika nie jest aktualizowana, żeby
+ * hasExternalChanges() to zgłosiło.
+ */
+void HistoryLock::bumpWriteCount() {
+    QFile file(m_writeCountPath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open write counter:" << m_writeCountPath << "Error:" << file.errorString();
+        return;
+    }
+    quint64 previous = file.readAll().trimmed().toULongLong();
+    QByteArray value = QByteArray::number(previous + 1).rightJustified(WRITE_COUNT_WIDTH, '0');
+    if (!file.seek(0) || file.write(value) != value.size()) {
+        qDebug() << "Failed to update write counter:" << m_writeCountPath << "Error:" << file.errorString();
+        return;
+    }
+    m_knownWrites.testAndSetRelaxed(previous, previous + 1);
+}
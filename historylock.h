@@ -0,0 +1,164 @@
+#ifndef HISTORYLOCK_H
+#define HISTORYLOCK_H
+
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QLockFile>
+#include <QMutex>
+#include <QRecursiveMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @class HistoryLock
+ * @brief Blokada zapisu współdzielona przez wszystkie instancje aplikacji.
+ *
+ * Blokada łączy plik blokady <name>.lock (QLockFile), który wyklucza zapis z innych
+ * procesów, z muteksem rekurencyjnym, który porządkuje wątki tego procesu. Może być
+ * zakładana wielokrotnie przez ten sam wątek. Przy zwolnieniu najbardziej zewnętrznej
+ * blokady licznik zapisów w pliku <name>.writes jest zwiększany, dzięki czemu instancja
+ * może sprawdzić (hasExternalChanges()), czy inna instancja coś zapisała. Kilka zapisów
+ * wykonanych pod jedną zewnętrzną blokadą zwiększa licznik raz.
+ *
+ * Czytelnicy nie zakładają blokady: zapisujący podmieniają pliki atomowo (QSaveFile)
+ * albo zapisują nowe pokolenie plików i przełączają na nie plik wskaźnika
+ * (readGeneration(), writeGeneration(), generationPrefix()).
+ */
+class HistoryLock
+{
+public:
+    /**
+     * @class Locker
+     * @brief Zakłada blokadę w konstruktorze i zwalnia ją w destruktorze.
+     */
+    class Locker
+    {
+    public:
+        /**
+         * @brief Zakłada blokadę, czekając najwyżej LOCK_TIMEOUT_MS.
+         * @param lock Blokada.
+         */
+        explicit Locker(HistoryLock &lock);
+
+        /**
+         * @brief Zwalnia blokadę, jeśli została założona.
+         */
+        ~Locker();
+
+        /**
+         * @brief Sprawdza, czy blokada została założona.
+         * @return true, jeśli blokada jest założona.
+         */
+        bool isLocked() const { return m_locked; }
+
+    private:
+        Q_DISABLE_COPY(Locker)
+
+        HistoryLock &m_lock; ///< Blokada.
+        bool m_locked;       ///< Czy blokada została założona.
+    };
+
+    /**
+     * @brief Konstruktor klasy HistoryLock.
+     * @param directory Katalog współdzielony przez instancje.
+     * @param name Nazwa blokady (przedrostek plików blokady).
+     */
+    HistoryLock(const QString &directory, const QString &name);
+
+    /**
+     * @brief Zakłada blokadę, czekając najwyżej LOCK_TIMEOUT_MS.
+     * @return true, jeśli blokada została założona.
+     */
+    bool lock();
+
+    /**
+     * @brief Zakłada blokadę, jeśli jest wolna.
+     * @return true, jeśli blokada została założona.
+     */
+    bool tryLock();
+
+    /**
+     * @brief Zwalnia blokadę założoną przez lock() lub tryLock().
+     */
+    void unlock();
+
+    /**
+     * @brief Sprawdza, czy inna instancja zapisała dane od ostatniego sprawdzenia.
+     *
+     * Poza blokadą licznik jest odczytywany najwyżej raz na EXTERNAL_CHECK_INTERVAL_MS.
+     *
+     * @return true, jeśli licznik zapisów zmienił się bez udziału tej instancji.
+     */
+    bool hasExternalChanges();
+
+    /**
+     * @brief Odczytuje numer pokolenia z pliku wskaźnika.
+     * @param pointerPath Ścieżka pliku wskaźnika.
+     * @return Numer pokolenia lub 0, jeśli plik nie istnieje.
+     */
+    static quint64 readGeneration(const QString &pointerPath);
+
+    /**
+     * @brief Atomowo zapisuje numer pokolenia do pliku wskaźnika.
+     * @param pointerPath Ścieżka pliku wskaźnika.
+     * @param generation Numer pokolenia.
+     * @return true, jeśli zapis się powiódł.
+     */
+    static bool writeGeneration(const QString &pointerPath, quint64 generation);
+
+    /**
+     * @brief Zwraca przedrostek plików danego pokolenia.
+     * @param prefix Przedrostek plików pokolenia 0.
+     * @param generation Numer pokolenia.
+     * @return prefix dla pokolenia 0, w przeciwnym razie prefix.g<generation>.
+     */
+    static QString generationPrefix(const QString &prefix, quint64 generation);
+
+    /**
+     * @brief Usuwa pliki pokoleń starszych niż podane.
+     * @param dir Katalog plików.
+     * @param name Nazwa pliku bez rozszerzeń (przedrostek pokolenia 0).
+     * @param suffixes Rozszerzenia plików należących do pokolenia.
+     * @param generation Najstarsze zachowywane pokolenie.
+     */
+    static void removeGenerationsBefore(const QDir &dir, const QString &name, const QStringList &suffixes, quint64 generation);
+
+    /**
+     * @brief Maksymalny czas oczekiwania na blokadę (ms).
+     */
+    static const int LOCK_TIMEOUT_MS = 30000;
+
+    /**
+     * @brief Czas, po którym blokada porzucona przez zakończony proces jest przejmowana (ms).
+     */
+    static const int STALE_LOCK_MS = 60000;
+
+    /**
+     * @brief Najkrótszy odstęp między odczytami licznika zapisów poza blokadą (ms).
+     */
+    static const int EXTERNAL_CHECK_INTERVAL_MS = 250;
+
+private:
+    /**
+     * @brief Zwiększa licznik zapisów (wywoływane przy zwolnieniu blokady).
+     */
+    void bumpWriteCount();
+
+    /**
+     * @brief Szerokość zapisu licznika zapisów (cyfry uzupełniane zerami z lewej).
+     */
+    static const int WRITE_COUNT_WIDTH = 20;
+
+    QLockFile m_lockFile;                 ///< Plik blokady współdzielony z innymi procesami.
+    QString m_writeCountPath;             ///< Ścieżka pliku licznika zapisów.
+    QRecursiveMutex m_mutex;              ///< Muteks porządkujący wątki tego procesu.
+    int m_depth;                          ///< Liczba zagnieżdżonych blokad (chroniona przez m_mutex).
+    QAtomicPointer<void> m_owner;         ///< Wątek trzymający blokadę (nullptr, jeśli wolna).
+    QAtomicInteger<quint64> m_knownWrites; ///< Ostatnio znana wartość licznika zapisów.
+    QMutex m_checkMutex;                  ///< Muteks chroniący m_lastCheck.
+    QElapsedTimer m_lastCheck;            ///< Czas od ostatniego odczytu licznika poza blokadą.
+};
+
+#endif // HISTORYLOCK_H
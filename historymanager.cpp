@@ -1,30 +1,228 @@
 #include "historymanager.h"
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QFile>
+#include "filehistorystorage.h"
+#include "historylock.h"
+#ifdef HISTORY_SQLITE_BACKEND
+#include "sqlitehistorystorage.h"
+#endif
 #include <QDateTime>
 #include <QDebug>
 #include <QUuid>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QStandardPaths>
+
+namespace {
+
+/**
+ * @brief Łączy agregaty pomiarów sensora w statystyki podsumowania sesji.
+ * @return Mapa z polami id, from, to, count, min, max i mean (bez min/max/mean, gdy brak pomiarów).
+ */
+QVariantMap foldRollups(int sensorId, qint64 from, qint64 to, const QVector<RollupPoint> &rollups) {
+    QVariantMap statistics{{"id", sensorId}, {"from", from}, {"to", to}};
+    quint64 count = 0;
+    double sum = 0.0;
+    float minValue = 0.0f;
+    float maxValue = 0.0f;
+    for (const RollupPoint &rollup : rollups) {
+        if (rollup.count == 0) {
+            continue;
+        }
+        minValue = count == 0 ? rollup.min : qMin(minValue, rollup.min);
+        maxValue = count == 0 ? rollup.max : qMax(maxValue, rollup.max);
+        count += rollup.count;
+        sum += double(rollup.mean) * rollup.count;
+    }
+    statistics["count"] = count;
+    if (count > 0) {
+        statistics["min"] = minValue;
+        statistics["max"] = maxValue;
+        statistics["mean"] = sum / count;
+    }
+    return statistics;
+}
+
+/**
+ * @brief Sprawdza, czy zmiana zawiera pomiary sensora.
+ * @return true, jeśli któryś z pomiarów zmiany należy do sensora.
+ */
+bool hasMeasurementsOf(const SessionUpdate &update, int sensorId) {
+    for (const QVariantMap &measurement : update.measurements) {
+        if (measurement["sensorId"].toInt() == sensorId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Sprawdza, czy zmiana może zmienić wynik zapytania o sesje.
+ *
+ * Zapytanie dotyczy sensorów sesji, więc znaczenie mają tylko dodane sensory i pomiary.
+ * Pomiary nie niosą identyfikatora stacji, dlatego zapytanie bez sensora uwzględnia
+ * każdą taką zmianę.
+ *
+ * @return true, jeśli zapis zmiany może zmienić wynik zapytania.
+ */
+bool mayAffectQuery(const SessionUpdate &update, const SessionQuery &query) {
+    if (update.sensors.isEmpty() && update.measurements.isEmpty()) {
+        return false;
+    }
+    if (query.sensorId == 0) {
+        return true;
+    }
+    for (const QVariantMap &sensor : update.sensors) {
+        if (sensor["id"].toInt() == query.sensorId) {
+            return true;
+        }
+    }
+    return hasMeasurementsOf(update, query.sensorId);
+}
+
+} // namespace
 
 /**
  * @brief Konstruktor klasy HistoryManager.
  *
  * Inicjalizuje obiekt HistoryManager, ustawia ścieżkę katalogu historii i zapewnia jego istnienie.
+ * Magazyn danych jest wybierany na podstawie klucza storage/backend w pliku history.ini
+ * w katalogu historii ("files" lub "sqlite"), a format zapisu danych sesji klucz
+ * storage/format ("cbor" - domyślnie, "cbor-compressed" lub "json").
  *
  * @param storagePath Ścieżka do katalogu przechowywania danych historii.
  * @param parent Wskaźnik na obiekt nadrzędny.
  */
 HistoryManager::HistoryManager(const QString &storagePath, QObject *parent)
-    : QObject(parent), m_historyDir(storagePath) {
+    : QObject(parent), m_historyDir(storagePath),
+      m_writer([this](const QString &sessionId, const SessionUpdate &update) { writeSessionUpdate(sessionId, update); }) {
     ensureHistoryDir();
-    m_indexFilePath = m_historyDir.filePath("history_index.json");
+    m_sessionCache.setMaxCost(DEFAULT_SESSION_CACHE_BUDGET);
+    m_cacheHits = 0;
+    m_cacheMisses = 0;
+    m_knownExternalChanges = 0;
+
+    QSettings settings(m_historyDir.filePath("history.ini"), QSettings::IniFormat);
+    m_format = SessionCodec::formatFromName(settings.value("storage/format", "cbor").toString());
+    createStorage(settings.value("storage/backend", "files").toString(), m_format);
+
+    m_rawRetentionDays = qMax(7, settings.value("retention/rawDays", DEFAULT_RAW_RETENTION_DAYS).toInt());
+    m_rollupRetentionDays = qMax(m_rawRetentionDays, settings.value("retention/rollupDays", DEFAULT_ROLLUP_RETENTION_DAYS).toInt());
+    m_diskQuotaBytes = qMax<qint64>(0, settings.value("retention/quotaMB", 0).toLongLong()) * 1024 * 1024;
+    m_rawCutoff = 0;
+    m_rollupCutoff = 0;
+    m_quotaUsage = -1;
+    m_quotaTrimmed = false;
+    m_summariesLoaded = false;
+
+    m_catalog.reset(new SensorCatalog(m_historyDir.path(), m_format));
+    if (!m_catalog->load()) {
+        rebuildCatalog();
+    }
+
+    m_writer.setIdleTask([this]() { return runRetentionStep(); }, RETENTION_INTERVAL_MS);
+    m_writer.start(QThread::LowPriority);
+}
+
+/**
+ * @brief Destruktor klasy HistoryManager.
+ *
+ * Zapisuje zmiany oczekujące w kolejce, a następnie zamyka magazyn danych.
+ */
+HistoryManager::~HistoryManager() {
+    m_writer.stop();
+    m_storage.reset();
+}
+
+/**
+ * @brief Zwraca domyślny katalog historii aplikacji.
+ *
+ * @return Ścieżka do podkatalogu history w katalogu danych aplikacji.
+ */
+QString HistoryManager::defaultStoragePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/history";
+}
+
+/**
+ * @brief Tworzy magazyn danych wybranego typu.
+ *
+ * Przy pierwszym uruchomieniu z magazynem SQLite dane z plików JSON są jednorazowo
+ * importowane do bazy. Jeśli baza nie jest dostępna (brak modułu QtSql lub błąd
+ * otwarcia), używany jest magazyn plikowy.
+ *
+ * @param backend Nazwa magazynu ("files" lub "sqlite").
+ * @param format Format zapisu danych sesji.
+ */
+void HistoryManager::createStorage(const QString &backend, SessionCodec::Format format) {
+    if (backend == "sqlite") {
+#ifdef HISTORY_SQLITE_BACKEND
+        QScopedPointer<SqliteHistoryStorage> sqlite(new SqliteHistoryStorage(m_historyDir.filePath("history.sqlite"), MAX_SESSIONS, format));
+        if (sqlite->isOpen()) {
+            if (!sqlite->isMigrated()) {
+                FileHistoryStorage files(m_historyDir.path(), MAX_SESSIONS, format);
+                sqlite->importFrom(files);
+            }
+            m_storage.reset(sqlite.take());
+            m_backend = "sqlite";
+            qDebug() << "Using SQLite history storage:" << m_historyDir.filePath("history.sqlite");
+            return;
+        }
+        qDebug() << "Failed to open SQLite history storage, falling back to files";
+#else
+        qDebug() << "SQLite history storage is not available in this build, falling back to files";
+#endif
+    } else if (backend != "files") {
+        qDebug() << "Unknown history storage backend:" << backend << "- using files";
+    }
+    m_storage.reset(new FileHistoryStorage(m_historyDir.path(), MAX_SESSIONS, format));
+    m_backend = "files";
+}
+
+/**
+ * @brief Zwraca nazwę używanego magazynu danych.
+ *
+ * @return "files" lub "sqlite".
+ */
+QString HistoryManager::storageBackend() const {
+    return m_backend;
+}
+
+/**
+ * @brief Zwraca format zapisu danych sesji.
+ *
+ * @return Format wybrany kluczem storage/format.
+ */
+SessionCodec::Format HistoryManager::sessionFormat() const {
+    return m_format;
+}
+
+/**
+ * @brief Przepisuje zapisane sesje do bieżącego formatu zapisu.
+ *
+ * Najpierw zapisywane są zmiany oczekujące w kolejce. Odczyt rozpoznaje format
+ * automatycznie, więc konwersja nie jest wymagana, ale przyspiesza wczytywanie
+ * sesji zapisanych przez starsze wersje jako JSON. Migawka katalogu sensorów jest
+ * zapisywana ponownie w tym samym formacie.
+ *
+ * @return Liczba przepisanych plików lub wartości; -1 w przypadku błędu.
+ */
+int HistoryManager::convertSessionFormat() {
+    m_writer.flush();
+    m_catalog->compact();
+    try {
+        return m_storage->convertFormat();
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in convertSessionFormat:" << e.what();
+        return -1;
+    } catch (...) {
+        qDebug() << "Unknown exception in convertSessionFormat";
+        return -1;
+    }
 }
 
 /**
  * @brief Dodaje nową sesję do historii.
  *
- * Tworzy plik JSON dla sesji i aktualizuje plik indeksu. Sesja zawiera dane takie jak identyfikator,
- * lokalizacja, współrzędne, promień i lista stacji.
+ * Przygotowuje dane sesji (identyfikator, lokalizacja, współrzędne, promień i lista stacji)
+ * oraz wpis indeksu i przekazuje je do zapisu w tle.
  *
  * @param sessionId Unikalny identyfikator sesji.
  * @param location Nazwa lokalizacji.
@@ -35,318 +233,577 @@ HistoryManager::HistoryManager(const QString &storagePath, QObject *parent)
  */
 void HistoryManager::addSession(const QString &sessionId, const QString &location, double radius, double latitude, double longitude, const QVariantList &stations) {
     QString timestamp = QDateTime::currentDateTime().toString(Qt::ISODate);
-    QString sessionFile = QString("session_%1.json").arg(sessionId);
 
     // Create session data
-    QVariantMap sessionData;
-    sessionData["session_id"] = sessionId;
-    sessionData["timestamp"] = timestamp;
-    sessionData["location"] = QVariantMap{
+    SessionUpdate update;
+    update.session["session_id"] = sessionId;
+    update.session["timestamp"] = timestamp;
+    update.session["location"] = QVariantMap{
         {"input", location},
         {"latitude", latitude},
         {"longitude", longitude}
     };
-    sessionData["radius"] = radius;
-    sessionData["stations"] = stations;
-    sessionData["sensors"] = QVariantList(); // Initialize empty sensors list
-
-    // Write session file
-    QJsonDocument doc(QJsonObject::fromVariantMap(sessionData));
-    QFile file(m_historyDir.filePath(sessionFile));
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
-        qDebug() << "Wrote session file:" << sessionFile;
-    } else {
-        qDebug() << "Failed to write session file:" << sessionFile << "Error:" << file.errorString();
-    }
+    update.session["radius"] = radius;
+    update.session["stations"] = stations;
+    update.session["sensors"] = QVariantList(); // Initialize empty sensors list
 
-    // Update index
-    QVariantMap indexEntry;
-    indexEntry["session_id"] = sessionId;
-    indexEntry["timestamp"] = timestamp;
-    indexEntry["location"] = location;
-    indexEntry["radius"] = radius;
-    indexEntry["file"] = sessionFile;
-    updateIndexFile(indexEntry);
+    update.indexEntry["session_id"] = sessionId;
+    update.indexEntry["timestamp"] = timestamp;
+    update.indexEntry["location"] = location;
+    update.indexEntry["radius"] = radius;
+    m_writer.enqueue(sessionId, update);
 }
 
 /**
  * @brief Dodaje sensory do istniejącej sesji.
  *
- * Wczytuje istniejące dane sesji, dodaje nowe sensory (unikając duplikatów) i zapisuje zaktualizowane dane.
+ * Sensory są zapisywane w tle. Duplikaty są pomijane podczas scalania dziennika
+ * z plikiem bazowym.
  *
  * @param sessionId Identyfikator sesji.
  * @param sensors Lista sensorów jako QList<QVariantMap>.
  */
 void HistoryManager::addSessionSensors(const QString &sessionId, const QList<QVariantMap> &sensors) {
-    QString sessionFile = QString("session_%1.json").arg(sessionId);
-    QFile file(m_historyDir.filePath(sessionFile));
+    SessionUpdate update;
+    for (const QVariantMap &sensor : sensors) {
+        QVariantMap sensorEntry = sensor;
+        sensorEntry["measurements"] = QVariantList();
+        update.sensors.append(sensorEntry);
+    }
+    m_writer.enqueue(sessionId, update);
+}
 
-    try {
-        // Read existing session data
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug() << "Failed to read session file:" << sessionFile << "Error:" << file.errorString();
-            return;
-        }
+/**
+ * @brief Dodaje pomiary do sensorów w sesji.
+ *
+ * Pomiary są zapisywane w tle do współdzielonych szeregów sensorów (SeriesStore).
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param measurements Lista pomiarów jako QList<QVariantMap>.
+ */
+void HistoryManager::addSessionMeasurements(const QString &sessionId, const QList<QVariantMap> &measurements) {
+    SessionUpdate update;
+    update.measurements = measurements;
+    m_writer.enqueue(sessionId, update);
+}
 
-        QByteArray data = file.readAll();
-        file.close();
+/**
+ * @brief Wczytuje pomiary sensora z podanego przedziału czasu.
+ *
+ * Najpierw czeka na zapisanie oczekujących pomiarów tego sensora (zmiany innych
+ * sensorów nie wstrzymują odczytu). Zapytanie korzysta z indeksu czasu magazynu
+ * (posortowany szereg lub klucz (sensor_id, ts) w SQLite), więc nie wymaga
+ * wczytywania sesji, a jego koszt
+ * zależy od liczby zwróconych pomiarów. Zakres czasu sesji
+ * można odczytać z pól seriesFrom i seriesTo sensora w loadSessionDetails().
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @return Pomiary w kolejności czasu.
+ */
+QVector<MeasurementPoint> HistoryManager::loadMeasurements(int sensorId, qint64 from, qint64 to) const {
+    m_writer.waitFor([sensorId](const SessionUpdate &update) { return hasMeasurementsOf(update, sensorId); });
+    return m_storage->loadMeasurements(sensorId, from, to);
+}
 
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (doc.isNull() || !doc.isObject()) {
-            qDebug() << "Failed to parse session file JSON:" << sessionFile;
-            return;
+/**
+ * @brief Wczytuje pomiary sensora zagregowane w przedziały.
+ *
+ * Starsza część przedziału czasu jest odczytywana z poziomów zagregowanych
+ * (przedziały dobowe i sześciogodzinne), a pomiary godzinowe tylko z okresu, którego
+ * nie obejmują przedziały. Zapytania o wiele miesięcy odczytują więc głównie
+ * niewielkie pliki lub tabele przedziałów.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @param bucketSeconds Długość przedziału w sekundach.
+ * @return Przedziały w kolejności czasu.
+ */
+QVector<RollupPoint> HistoryManager::loadRollups(int sensorId, qint64 from, qint64 to, qint64 bucketSeconds) const {
+    m_writer.waitFor([sensorId](const SessionUpdate &update) { return hasMeasurementsOf(update, sensorId); });
+    try {
+        QVector<RollupPoint> rollups = m_storage->loadRollups(sensorId, from, to);
+        qint64 rawFrom = from;
+        if (!rollups.isEmpty()) {
+            rawFrom = qMax(from, rollups.last().timestamp + rollups.last().duration);
         }
+        rollups += SeriesStore::rollUpPoints(m_storage->loadMeasurements(sensorId, rawFrom, to), bucketSeconds);
+        return SeriesStore::combineRollups(rollups, bucketSeconds);
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in loadRollups:" << e.what();
+        return QVector<RollupPoint>();
+    } catch (...) {
+        qDebug() << "Unknown exception in loadRollups";
+        return QVector<RollupPoint>();
+    }
+}
 
-        QVariantMap sessionData = doc.object().toVariantMap();
-        QVariantList existingSensors = sessionData["sensors"].toList();
+/**
+ * @brief Dodaje dane o jakości powietrza do sesji.
+ *
+ * Dane są zapisywane w tle. Ostatnie dane zastępują poprzednie.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param airQualityData Dane o jakości powietrza jako QVariantMap.
+ */
+void HistoryManager::addSessionAirQuality(const QString &sessionId, const QVariantMap &airQualityData) {
+    SessionUpdate update;
+    update.airQuality = airQualityData;
+    update.hasAirQuality = true;
+    m_writer.enqueue(sessionId, update);
+}
 
-        // Create a set of existing sensor IDs to avoid duplicates
-        QSet<int> existingSensorIds;
-        for (const QVariant &sensorVariant : existingSensors) {
-            QVariantMap sensor = sensorVariant.toMap();
-            existingSensorIds.insert(sensor["id"].toInt());
-        }
+/**
+ * @brief Czeka na zapisanie wszystkich zmian zgłoszonych do tej pory.
+ */
+void HistoryManager::flush() const {
+    m_writer.flush();
+}
 
-        // Convert input sensors to the desired structure and append non-duplicates
-        QVariantList newSensors = existingSensors;
-        for (const QVariantMap &sensor : sensors) {
-            int sensorId = sensor["id"].toInt();
-            if (!existingSensorIds.contains(sensorId)) {
-                QVariantMap sensorEntry = sensor;
-                sensorEntry["measurements"] = QVariantList();
-                newSensors.append(sensorEntry);
-                existingSensorIds.insert(sensorId);
-            }
-        }
+/**
+ * @brief Sprawdza, czy sesja istnieje lub czeka na zapis.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return true, jeśli sesja istnieje; false w przeciwnym razie.
+ */
+bool HistoryManager::sessionExists(const QString &sessionId) const {
+    return m_writer.hasPending(sessionId) || m_storage->sessionExists(sessionId);
+}
 
-        // Update session data with the merged sensors list
-        sessionData["sensors"] = newSensors;
+/**
+ * @brief Zwraca liczbę zmian oczekujących na zapis.
+ *
+ * @return Długość kolejki zapisu.
+ */
+int HistoryManager::pendingWriteCount() const {
+    return m_writer.queueDepth();
+}
 
-        // Write updated session data
-        QJsonDocument updatedDoc(QJsonObject::fromVariantMap(sessionData));
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            qDebug() << "Failed to open session file for writing:" << sessionFile << "Error:" << file.errorString();
-            return;
-        }
+/**
+ * @brief Zwraca średni czas zapisu zmian jednej sesji.
+ *
+ * @return Czas w milisekundach.
+ */
+double HistoryManager::averageWriteLatencyMs() const {
+    return m_writer.averageWriteLatencyMs();
+}
 
-        qint64 bytesWritten = file.write(updatedDoc.toJson());
-        file.close();
+/**
+ * @brief Zwraca najdłuższy czas zapisu zmian jednej sesji.
+ *
+ * @return Czas w milisekundach.
+ */
+double HistoryManager::maxWriteLatencyMs() const {
+    return m_writer.maxWriteLatencyMs();
+}
 
-        if (bytesWritten == -1) {
-            qDebug() << "Failed to write updated session file:" << sessionFile << "Error:" << file.errorString();
+/**
+ * @brief Zapisuje połączone zmiany jednej sesji (w wątku zapisu).
+ *
+ * Nowa sesja jest zapisywana w całości, a pozostałe zmiany jedną operacją magazynu.
+ * Zmiany i podsumowanie sesji są zapisywane pod jedną blokadą zapisu, więc plik
+ * blokady i licznik zapisów są aktualizowane raz na porcję. Wpis sesji w pamięci
+ * podręcznej jest unieważniany.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param update Połączone zmiany sesji.
+ */
+void HistoryManager::writeSessionUpdate(const QString &sessionId, const SessionUpdate &update) {
+    try {
+        HistoryLock::Locker writer(m_storage->writerLock());
+        if (writer.isLocked()) {
+            if (!update.session.isEmpty()) {
+                m_storage->writeSession(sessionId, update.session, update.indexEntry);
+            }
+            if (!update.sensors.isEmpty() || !update.measurements.isEmpty() || update.hasAirQuality) {
+                m_storage->writeUpdate(sessionId, update);
+            }
+            updateCatalog(update);
+            updateSummary(sessionId, update);
         } else {
-            qDebug() << "Successfully updated session file:" << sessionFile << "with" << newSensors.size() << "sensors";
+            qDebug() << "Failed to lock history for session" << sessionId << ", update dropped";
         }
     } catch (const std::exception &e) {
-        qDebug() << "Exception in addSessionSensors for session" << sessionId << ":" << e.what();
-        // Continue without crashing; session file remains unchanged
+        qDebug() << "Exception in writeSessionUpdate for session" << sessionId << ":" << e.what();
+        // Continue without crashing; stored session remains unchanged
     } catch (...) {
-        qDebug() << "Unknown exception in addSessionSensors for session" << sessionId;
+        qDebug() << "Unknown exception in writeSessionUpdate for session" << sessionId;
         // Continue without crashing
     }
+
+    QMutexLocker locker(&m_cacheMutex);
+    m_sessionCache.remove(sessionId);
 }
 
 /**
- * @brief Dodaje pomiary do sensorów w sesji.
+ * @brief Aktualizuje podsumowanie sesji po zapisaniu zmiany.
  *
- * Wczytuje dane sesji, organizuje pomiary według identyfikatorów sensorów i aktualizuje dane sesji.
+ * Podsumowanie zawiera liczbę stacji, zakres dat pomiarów (from, to) oraz listę
+ * sensorów sesji z zakresem dat i statystykami pomiarów (count, min, max, mean).
+ * Statystyki sensorów, których dotyczy zmiana, są liczone od nowa z magazynu dla
+ * całego zakresu sesji, więc powtórnie pobrane godziny nie są liczone podwójnie.
+ * Metoda jest wywoływana tylko w wątku zapisu.
  *
  * @param sessionId Identyfikator sesji.
- * @param measurements Lista pomiarów jako QList<QVariantMap>.
+ * @param update Zapisana zmiana sesji.
  */
-void HistoryManager::addSessionMeasurements(const QString &sessionId, const QList<QVariantMap> &measurements) {
-    QString sessionFile = QString("session_%1.json").arg(sessionId);
-    QFile file(m_historyDir.filePath(sessionFile));
-
-    try {
-        // Read existing session data
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug() << "Failed to read session file:" << sessionFile << "Error:" << file.errorString();
-            return;
-        }
+void HistoryManager::updateSummary(const QString &sessionId, const SessionUpdate &update) {
+    if (!m_summariesLoaded) {
+        loadSummaries();
+    }
 
-        QByteArray data = file.readAll();
-        file.close();
+    QVariantMap summary;
+    if (!update.session.isEmpty()) {
+        summary["stations"] = update.session["stations"].toList().size();
+    } else if (m_summaries.contains(sessionId)) {
+        summary = m_summaries.value(sessionId);
+    } else {
+        // Session written by an older version; its summary is built from the stored data
+        m_summaryBackfill.removeAll(sessionId);
+        summary = summarizeSession(sessionId);
+    }
 
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (doc.isNull() || !doc.isObject()) {
-            qDebug() << "Failed to parse session file JSON:" << sessionFile;
-            return;
+    QMap<int, QVariantMap> sensors;
+    for (const QVariant &sensorVariant : summary["sensors"].toList()) {
+        QVariantMap sensor = sensorVariant.toMap();
+        sensors.insert(sensor["id"].toInt(), sensor);
+    }
+    QList<QVariantMap> newSensors = update.sensors;
+    for (const QVariant &sensorVariant : update.session["sensors"].toList()) {
+        newSensors.append(sensorVariant.toMap());
+    }
+    for (const QVariantMap &sensor : std::as_const(newSensors)) {
+        int sensorId = sensor["id"].toInt();
+        if (sensorId != 0 && !sensors.contains(sensorId)) {
+            sensors.insert(sensorId, QVariantMap{{"id", sensorId}});
         }
-
-        QVariantMap sessionData = doc.object().toVariantMap();
-        QVariantList sensors = sessionData["sensors"].toList();
-
-        // Organize measurements by sensorId
-        QMap<int, QVariantList> measurementsBySensor;
-        for (const QVariantMap &measurement : measurements) {
-            int sensorId = measurement["sensorId"].toInt();
-            QVariantMap measurementEntry;
-            measurementEntry["date"] = measurement["date"];
-            measurementEntry["value"] = measurement["value"];
-            measurementsBySensor[sensorId].append(measurementEntry);
+    }
+    const QMap<int, QVector<MeasurementPoint>> grouped = HistoryStorage::groupMeasurements(update.measurements);
+    for (auto it = grouped.constBegin(); it != grouped.constEnd(); ++it) {
+        if (it.value().isEmpty()) {
+            continue;
+        }
+        qint64 from = it.value().first().timestamp;
+        qint64 to = from;
+        for (const MeasurementPoint &point : it.value()) {
+            from = qMin(from, point.timestamp);
+            to = qMax(to, point.timestamp);
         }
+        const QVariantMap previous = sensors.value(it.key());
+        if (previous.contains("from")) {
+            from = qMin(from, previous["from"].toLongLong());
+            to = qMax(to, previous["to"].toLongLong());
+        }
+        sensors.insert(it.key(), sensorStatistics(it.key(), from, to));
+    }
 
-        // Update measurements for each sensor
-        bool updated = false;
-        for (QVariant &sensorVariant : sensors) {
-            QVariantMap sensor = sensorVariant.toMap();
-            int sensorId = sensor["id"].toInt();
-            if (measurementsBySensor.contains(sensorId)) {
-                QVariantList existingMeasurements = sensor["measurements"].toList();
-                existingMeasurements.append(measurementsBySensor[sensorId]);
-                sensor["measurements"] = existingMeasurements;
-                sensorVariant = sensor;
-                updated = true;
-            }
+    QVariantList sensorList;
+    qint64 from = -1;
+    qint64 to = -1;
+    for (const QVariantMap &sensor : std::as_const(sensors)) {
+        sensorList.append(sensor);
+        if (sensor.contains("from")) {
+            from = from < 0 ? sensor["from"].toLongLong() : qMin(from, sensor["from"].toLongLong());
+            to = qMax(to, sensor["to"].toLongLong());
         }
+    }
+    summary["sensors"] = sensorList;
+    if (from >= 0) {
+        summary["from"] = from;
+        summary["to"] = to;
+    }
 
-        if (updated) {
-            sessionData["sensors"] = sensors;
+    if (m_summaries.value(sessionId) == summary) {
+        return;
+    }
+    m_summaries.insert(sessionId, summary);
+    if (!m_storage->writeSummary(sessionId, summary)) {
+        qDebug() << "Failed to write summary of session" << sessionId;
+    }
+}
 
-            // Write updated session data
-            QJsonDocument updatedDoc(QJsonObject::fromVariantMap(sessionData));
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-                qDebug() << "Failed to open session file for writing:" << sessionFile << "Error:" << file.errorString();
-                return;
+/**
+ * @brief Buduje podsumowanie sesji od nowa na podstawie zapisanych danych.
+ *
+ * Odczytywane są tylko pola stations i sensors sesji. Pomiary zapisane w pliku
+ * sesji przez starsze wersje są uwzględniane bezpośrednio.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Podsumowanie sesji.
+ */
+QVariantMap HistoryManager::summarizeSession(const QString &sessionId) const {
+    QVariantMap fields = m_storage->loadSessionFields(sessionId, {"stations", "sensors"});
+    QVariantMap summary;
+    summary["stations"] = fields["stations"].toList().size();
+
+    QVariantList sensors;
+    qint64 from = -1;
+    qint64 to = -1;
+    for (const QVariant &sensorVariant : fields["sensors"].toList()) {
+        QVariantMap sensor = sensorVariant.toMap();
+        int sensorId = sensor["id"].toInt();
+        QVariantMap entry{{"id", sensorId}};
+        if (sensor.contains("seriesFrom")) {
+            entry = sensorStatistics(sensorId, sensor["seriesFrom"].toLongLong(), sensor["seriesTo"].toLongLong());
+        } else if (!sensor["measurements"].toList().isEmpty()) {
+            QList<QVariantMap> measurements;
+            for (const QVariant &measurementVariant : sensor["measurements"].toList()) {
+                QVariantMap measurement = measurementVariant.toMap();
+                measurement["sensorId"] = sensorId;
+                measurements.append(measurement);
             }
+            QVector<MeasurementPoint> points = SeriesStore::sortedUnique(HistoryStorage::groupMeasurements(measurements).value(sensorId));
+            if (!points.isEmpty()) {
+                entry = foldRollups(sensorId, points.first().timestamp, points.last().timestamp,
+                                    SeriesStore::rollUpPoints(points, SeriesStore::DAILY_BUCKET_SECONDS));
+            }
+        }
+        if (entry.contains("from")) {
+            from = from < 0 ? entry["from"].toLongLong() : qMin(from, entry["from"].toLongLong());
+            to = qMax(to, entry["to"].toLongLong());
+        }
+        sensors.append(entry);
+    }
+    summary["sensors"] = sensors;
+    if (from >= 0) {
+        summary["from"] = from;
+        summary["to"] = to;
+    }
+    return summary;
+}
 
-            qint64 bytesWritten = file.write(updatedDoc.toJson());
-            file.close();
+/**
+ * @brief Oblicza statystyki pomiarów sensora z podanego przedziału czasu.
+ *
+ * Starsze pomiary są brane z agregatów retencji, a nowsze z surowego szeregu.
+ * Metoda nie czeka na kolejkę zapisu, bo jest wywoływana w wątku zapisu.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki).
+ * @param to Koniec przedziału (sekundy od epoki).
+ * @return Mapa z polami id, from, to, count, min, max i mean.
+ */
+QVariantMap HistoryManager::sensorStatistics(int sensorId, qint64 from, qint64 to) const {
+    QVector<RollupPoint> rollups = m_storage->loadRollups(sensorId, from, to);
+    qint64 rawFrom = from;
+    if (!rollups.isEmpty()) {
+        rawFrom = qMax(from, rollups.last().timestamp + rollups.last().duration);
+    }
+    rollups += SeriesStore::rollUpPoints(m_storage->loadMeasurements(sensorId, rawFrom, to), SeriesStore::DAILY_BUCKET_SECONDS);
+    return foldRollups(sensorId, from, to, rollups);
+}
 
-            if (bytesWritten == -1) {
-                qDebug() << "Failed to write updated session file:" << sessionFile << "Error:" << file.errorString();
-            } else {
-                qDebug() << "Successfully updated session file:" << sessionFile << "with measurements for" << measurementsBySensor.size() << "sensors";
-            }
+/**
+ * @brief Wczytuje podsumowania zapisane w indeksie do m_summaries.
+ *
+ * @return Identyfikatory sesji, które nie mają jeszcze podsumowania (od najstarszej).
+ */
+QStringList HistoryManager::loadSummaries() {
+    QStringList missing;
+    m_summaries.clear();
+    const QVariantList sessions = m_storage->loadSessions();
+    for (auto it = sessions.crbegin(); it != sessions.crend(); ++it) {
+        QVariantMap entry = it->toMap();
+        QString sessionId = entry["session_id"].toString();
+        if (entry.contains("summary")) {
+            m_summaries.insert(sessionId, entry["summary"].toMap());
         } else {
-            qDebug() << "No sensors matched the provided measurements for session:" << sessionId;
+            missing.append(sessionId);
         }
-    } catch (const std::exception &e) {
-        qDebug() << "Exception in addSessionMeasurements for session" << sessionId << ":" << e.what();
-        // Continue without crashing; session file remains unchanged
-    } catch (...) {
-        qDebug() << "Unknown exception in addSessionMeasurements for session" << sessionId;
-        // Continue without crashing
     }
+    m_summariesLoaded = true;
+    return missing;
 }
 
 /**
- * @brief Dodaje dane o jakości powietrza do sesji.
+ * @brief Wykonuje porcję przebiegu retencji.
  *
- * Wczytuje dane sesji, dodaje informacje o jakości powietrza i zapisuje zaktualizowane dane.
+ * Najpierw budowane są brakujące podsumowania sesji zapisanych przez starsze wersje.
+ * Przebieg obejmuje wszystkie sensory z zapisanymi pomiarami: pomiary godzinowe
+ * starsze niż m_rawRetentionDays są agregowane w przedziały sześciogodzinne,
+ * a przedziały starsze niż m_rollupRetentionDays w przedziały dobowe. W jednej
+ * porcji przetwarzanych jest RETENTION_BATCH_SIZE sensorów, więc zapisy zgłoszone
+ * w trakcie przebiegu nie czekają długo. Na końcu przebiegu egzekwowany jest limit
+ * miejsca, również porcjami (jeden krok usuwania danych na wywołanie). Metoda jest
+ * wywoływana tylko w wątku zapisu.
  *
- * @param sessionId Identyfikator sesji.
- * @param airQualityData Dane o jakości powietrza jako QVariantMap.
+ * @return true, jeśli przebieg nie został jeszcze ukończony.
  */
-void HistoryManager::addSessionAirQuality(const QString &sessionId, const QVariantMap &airQualityData) {
-    QString sessionFile = QString("session_%1.json").arg(sessionId);
-    QFile file(m_historyDir.filePath(sessionFile));
-
+bool HistoryManager::runRetentionStep() {
     try {
-        // Read existing session data
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug() << "Failed to read session file:" << sessionFile << "Error:" << file.errorString();
-            return;
+        if (m_quotaUsage >= 0) {
+            return enforceDiskQuota();
+        }
+        if (m_retentionQueue.isEmpty() && m_summaryBackfill.isEmpty()) {
+            m_retentionQueue = m_storage->seriesSensorIds();
+            m_summaryBackfill = loadSummaries();
+            qint64 now = QDateTime::currentSecsSinceEpoch();
+            m_rawCutoff = now - qint64(m_rawRetentionDays) * 24 * 3600;
+            m_rollupCutoff = now - qint64(m_rollupRetentionDays) * 24 * 3600;
         }
 
-        QByteArray data = file.readAll();
-        file.close();
+        // Sessions written by older versions get their index summary first
+        if (!m_summaryBackfill.isEmpty()) {
+            for (int i = 0; i < SUMMARY_BACKFILL_BATCH_SIZE && !m_summaryBackfill.isEmpty(); ++i) {
+                QString sessionId = m_summaryBackfill.takeFirst();
+                QVariantMap summary = summarizeSession(sessionId);
+                m_summaries.insert(sessionId, summary);
+                m_storage->writeSummary(sessionId, summary);
+            }
+            return true;
+        }
 
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (doc.isNull() || !doc.isObject()) {
-            qDebug() << "Failed to parse session file JSON:" << sessionFile;
-            return;
+        int moved = 0;
+        for (int i = 0; i < RETENTION_BATCH_SIZE && !m_retentionQueue.isEmpty(); ++i) {
+            int sensorId = m_retentionQueue.takeFirst();
+            int result = m_storage->rollUpSensor(sensorId, m_rawCutoff, m_rollupCutoff);
+            if (result < 0) {
+                qDebug() << "Failed to roll up measurements of sensor" << sensorId;
+            } else {
+                moved += result;
+            }
+        }
+        if (moved > 0) {
+            qDebug() << "Retention moved" << moved << "measurements and rollups to coarser tiers";
+        }
+        if (!m_retentionQueue.isEmpty()) {
+            return true;
         }
 
-        QVariantMap sessionData = doc.object().toVariantMap();
-        sessionData["airQuality"] = airQualityData;
+        return enforceDiskQuota();
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in runRetentionStep:" << e.what();
+        m_retentionQueue.clear();
+        m_quotaUsage = -1;
+    } catch (...) {
+        qDebug() << "Unknown exception in runRetentionStep";
+        m_retentionQueue.clear();
+        m_quotaUsage = -1;
+    }
+    return false;
+}
 
-        // Write updated session data
-        QJsonDocument updatedDoc(QJsonObject::fromVariantMap(sessionData));
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            qDebug() << "Failed to open session file for writing:" << sessionFile << "Error:" << file.errorString();
-            return;
+/**
+ * @brief Wykonuje jeden krok egzekwowania limitu miejsca.
+ *
+ * Miejsce zajmowane przez historię jest mierzone raz, na początku egzekwowania,
+ * a potem pomniejszane o bajty zwolnione w kolejnych krokach. Każdy krok usuwa
+ * QUOTA_TRIM_STEP_SECONDS najstarszych danych, więc najpierw znikają przedziały
+ * dobowe, a zapisy zgłoszone między krokami nie czekają. Pomiary godzinowe z okresu
+ * m_rawRetentionDays nie są usuwane; jeśli mimo to limit jest przekroczony, zapisywany
+ * jest komunikat. Po ostatnim kroku magazyn oddaje zwolnione miejsce (reclaimSpace()).
+ *
+ * @return true, jeśli historia wciąż przekracza limit i potrzebny jest kolejny krok.
+ */
+bool HistoryManager::enforceDiskQuota() {
+    if (m_diskQuotaBytes <= 0) {
+        return false;
+    }
+    if (m_quotaUsage < 0) {
+        m_quotaUsage = m_storage->diskUsage();
+        m_quotaTrimmed = false;
+    }
+
+    bool more = false;
+    if (m_quotaUsage > m_diskQuotaBytes) {
+        qint64 oldest = m_storage->oldestMeasurement();
+        qint64 cutoff = qMin(oldest + QUOTA_TRIM_STEP_SECONDS, m_rawCutoff);
+        qint64 freed = -1;
+        if (oldest < 0 || oldest >= m_rawCutoff) {
+            qDebug() << "History uses about" << m_quotaUsage << "bytes, above the quota of" << m_diskQuotaBytes
+                     << "bytes, but only recent hourly measurements remain";
+        } else if ((freed = m_storage->trimBefore(cutoff)) < 0) {
+            qDebug() << "Failed to trim history before" << SeriesStore::fromEpochSeconds(cutoff);
+        } else {
+            qDebug() << "Trimmed history before" << SeriesStore::fromEpochSeconds(cutoff) << "to meet the disk quota:"
+                     << m_quotaUsage << "->" << m_quotaUsage - freed << "bytes (estimated)";
+            m_quotaUsage -= freed;
+            m_quotaTrimmed = true;
+            more = m_quotaUsage > m_diskQuotaBytes;
         }
+    }
+    if (more) {
+        return true;
+    }
 
-        qint64 bytesWritten = file.write(updatedDoc.toJson());
-        file.close();
+    if (m_quotaTrimmed && !m_storage->reclaimSpace()) {
+        qDebug() << "Failed to reclaim space freed by the disk quota";
+    }
+    m_quotaUsage = -1;
+    m_quotaTrimmed = false;
+    return false;
+}
 
-        if (bytesWritten == -1) {
-            qDebug() << "Failed to write updated session file:" << sessionFile << "Error:" << file.errorString();
-        } else {
-            qDebug() << "Successfully updated session file:" << sessionFile << "with air quality data";
+/**
+ * @brief Buduje katalog stacji i sensorów ze wszystkich zapisanych sesji.
+ *
+ * Wywoływane jednorazowo, gdy katalog nie istnieje jeszcze na dysku. Sesje są
+ * przeglądane od najstarszej, więc w katalogu zostają najnowsze dane stacji i sensorów.
+ */
+void HistoryManager::rebuildCatalog() {
+    try {
+        QVariantList sessions = m_storage->loadSessions();
+        for (auto it = sessions.crbegin(); it != sessions.crend(); ++it) {
+            QVariantMap details = m_storage->loadSessionDetails(it->toMap()["session_id"].toString());
+            m_catalog->addStations(details["stations"].toList());
+            QList<QVariantMap> sensors;
+            for (const QVariant &sensorVariant : details["sensors"].toList()) {
+                sensors.append(sensorVariant.toMap());
+            }
+            m_catalog->addSensors(sensors);
         }
+        m_catalog->compact();
+        qDebug() << "Rebuilt sensor catalog from" << sessions.size() << "sessions";
     } catch (const std::exception &e) {
-        qDebug() << "Exception in addSessionAirQuality for session" << sessionId << ":" << e.what();
-        // Continue without crashing; session file remains unchanged
+        qDebug() << "Exception in rebuildCatalog:" << e.what();
     } catch (...) {
-        qDebug() << "Unknown exception in addSessionAirQuality for session" << sessionId;
-        // Continue without crashing
+        qDebug() << "Unknown exception in rebuildCatalog";
     }
 }
 
 /**
- * @brief Aktualizuje plik indeksu sesji.
+ * @brief Dopisuje do katalogu stacje, sensory i zakresy pomiarów z zapisanej zmiany.
  *
- * Dodaje nową sesję do indeksu i usuwa najstarszą, jeśli limit sesji został przekroczony.
+ * Wywoływane w wątku zapisu, po zapisaniu zmiany w magazynie.
  *
- * @param session Dane sesji jako QVariantMap.
+ * @param update Połączone zmiany sesji.
  */
-void HistoryManager::updateIndexFile(const QVariantMap &session) {
-    QVariantList sessions;
-    QFile file(m_indexFilePath);
-    if (file.open(QIODevice::ReadOnly)) {
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        if (!doc.isNull() && doc.isObject()) {
-            sessions = doc.object()["sessions"].toVariant().toList();
-        }
-        file.close();
+void HistoryManager::updateCatalog(const SessionUpdate &update) {
+    if (!update.session.isEmpty()) {
+        m_catalog->addStations(update.session["stations"].toList());
     }
+    m_catalog->addSensors(update.sensors);
 
-    sessions.prepend(session);
-    if (sessions.size() > MAX_SESSIONS) {
-        QVariantMap oldSession = sessions.takeLast().toMap();
-        QString oldFile = oldSession["file"].toString();
-        if (m_historyDir.remove(oldFile)) {
-            qDebug() << "Removed old session file:" << oldFile;
-        } else {
-            qDebug() << "Failed to remove old session file:" << oldFile;
+    const QMap<int, QVector<MeasurementPoint>> grouped = HistoryStorage::groupMeasurements(update.measurements);
+    for (auto it = grouped.constBegin(); it != grouped.constEnd(); ++it) {
+        if (it.value().isEmpty()) {
+            continue;
         }
+        qint64 from = it.value().first().timestamp;
+        qint64 to = from;
+        for (const MeasurementPoint &point : it.value()) {
+            from = qMin(from, point.timestamp);
+            to = qMax(to, point.timestamp);
+        }
+        m_catalog->extendSeries(it.key(), from, to);
     }
-
-    QJsonObject indexObj;
-    indexObj["sessions"] = QJsonValue::fromVariant(sessions);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(indexObj).toJson());
-        file.close();
-        qDebug() << "Updated index file:" << m_indexFilePath;
-    } else {
-        qDebug() << "Failed to write index file:" << m_indexFilePath << "Error:" << file.errorString();
-    }
+    m_catalog->commit();
 }
 
 /**
- * @brief Wczytuje listę sesji z pliku indeksu.
+ * @brief Wczytuje listę sesji z magazynu.
+ *
+ * Najpierw czeka na zapisanie oczekujących nowych sesji (tylko one zmieniają indeks).
+ * Zwracanych jest co najwyżej MAX_SESSIONS najnowszych sesji.
  *
  * @return QVariantList zawierający listę sesji.
  */
 QVariantList HistoryManager::loadSessions() const {
-    QFile file(m_indexFilePath);
+    m_writer.waitFor([](const SessionUpdate &update) { return !update.indexEntry.isEmpty(); });
     try {
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug() << "Failed to read index file:" << m_indexFilePath << "Error:" << file.errorString();
-            return QVariantList();
-        }
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        file.close();
-        if (doc.isNull() || !doc.isObject()) {
-            qDebug() << "Failed to parse index file JSON:" << m_indexFilePath;
-            return QVariantList();
-        }
-        return doc.object()["sessions"].toVariant().toList();
+        return m_storage->loadSessions();
     } catch (const std::exception &e) {
         qDebug() << "Exception in loadSessions:" << e.what();
         return QVariantList();
@@ -357,21 +814,223 @@ QVariantList HistoryManager::loadSessions() const {
 }
 
 /**
- * @brief Wczytuje szczegóły sesji z pliku sesji.
+ * @brief Wyszukuje sesje zawierające dane sensora, stacji lub przedziału czasu.
+ *
+ * Najpierw czeka na zapisanie oczekujących zmian, które mogą zmienić wynik zapytania.
+ * Magazyn pomija sesje, które na pewno nie pasują do zapytania, bez otwierania ich plików.
+ *
+ * @param query Zapytanie (stacja, sensor, przedział czasu).
+ * @param stats Ustawiane na statystyki wykonania zapytania (opcjonalnie).
+ * @return Identyfikatory pasujących sesji od najnowszej do najstarszej.
+ */
+QStringList HistoryManager::findSessions(const SessionQuery &query, SessionQueryStats *stats) const {
+    m_writer.waitFor([&query](const SessionUpdate &update) { return mayAffectQuery(update, query); });
+    try {
+        return m_storage->findSessions(query, stats);
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in findSessions:" << e.what();
+        return QStringList();
+    } catch (...) {
+        qDebug() << "Unknown exception in findSessions";
+        return QStringList();
+    }
+}
+
+/**
+ * @brief Czyści pamięć podręczną sesji, jeśli inna instancja zapisała zmiany w historii.
+ *
+ * Sesja zapisana w pamięci podręcznej mogła zostać zmieniona przez inną instancję,
+ * więc po wykryciu takiego zapisu (licznik magazynu) cała pamięć jest czyszczona.
+ */
+void HistoryManager::syncWithOtherInstances() const {
+    const quint64 changes = m_storage->externalChangeCount();
+    QMutexLocker locker(&m_cacheMutex);
+    if (changes != m_knownExternalChanges) {
+        m_knownExternalChanges = changes;
+        m_sessionCache.clear();
+        qDebug() << "History was changed by another instance, dropping cached sessions";
+    }
+}
+
+/**
+ * @brief Wczytuje szczegóły sesji.
+ *
+ * Czeka na zapisanie oczekujących zmian sesji, a następnie zwraca sesję z pamięci
+ * podręcznej lub wczytuje ją z magazynu. Pomiary ze współdzielonych szeregów nie są
+ * dołączane; zwraca je loadMeasurements() dla zakresu seriesFrom..seriesTo sensora.
  *
  * @param sessionId Identyfikator sesji.
  * @return QVariantMap zawierający szczegóły sesji.
  */
 QVariantMap HistoryManager::loadSessionDetails(const QString &sessionId) const {
-    QString sessionFile = QString("session_%1.json").arg(sessionId);
-    QFile file(m_historyDir.filePath(sessionFile));
-    if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "Failed to read session file:" << sessionFile << "Error:" << file.errorString();
+    m_writer.waitForSession(sessionId);
+    syncWithOtherInstances();
+    QMutexLocker locker(&m_cacheMutex);
+    if (const QVariantMap *cached = m_sessionCache.object(sessionId)) {
+        m_cacheHits++;
+        return *cached;
+    }
+    m_cacheMisses++;
+
+    // The stored size of the session approximates the memory cost
+    qint64 cost = 0;
+    try {
+        QVariantMap sessionData = m_storage->loadSessionDetails(sessionId, &cost);
+        if (sessionData.isEmpty()) {
+            return QVariantMap();
+        }
+        m_sessionCache.insert(sessionId, new QVariantMap(sessionData), qMax<qint64>(cost, 1));
+        return sessionData;
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in loadSessionDetails:" << e.what();
         return QVariantMap();
+    } catch (...) {
+        qDebug() << "Unknown exception in loadSessionDetails";
+        return QVariantMap();
+    }
+}
+
+/**
+ * @brief Wczytuje wybrane pola sesji bez dekodowania całej sesji.
+ *
+ * Jeśli sesja jest już w pamięci podręcznej, pola są z niej kopiowane. W przeciwnym
+ * razie magazyn dekoduje tylko wskazane pola, a wynik nie trafia do pamięci podręcznej.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param keys Nazwy pól.
+ * @return QVariantMap z istniejącymi polami spośród keys.
+ */
+QVariantMap HistoryManager::loadSessionFields(const QString &sessionId, const QStringList &keys) const {
+    m_writer.waitForSession(sessionId);
+    syncWithOtherInstances();
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const QVariantMap *cached = m_sessionCache.object(sessionId)) {
+            m_cacheHits++;
+            QVariantMap fields;
+            for (const QString &key : keys) {
+                if (cached->contains(key)) {
+                    fields[key] = cached->value(key);
+                }
+            }
+            return fields;
+        }
+    }
+
+    try {
+        return m_storage->loadSessionFields(sessionId, keys);
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in loadSessionFields:" << e.what();
+        return QVariantMap();
+    } catch (...) {
+        qDebug() << "Unknown exception in loadSessionFields";
+        return QVariantMap();
+    }
+}
+
+/**
+ * @brief Wczytuje sensory jednej stacji zapisane w sesji.
+ *
+ * Jeśli sesja jest już w pamięci podręcznej, sensory są z niej filtrowane. W przeciwnym
+ * razie magazyn dekoduje tylko sensory tej stacji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param stationId Identyfikator stacji.
+ * @return Lista sensorów stacji.
+ */
+QList<QVariantMap> HistoryManager::loadStationSensors(const QString &sessionId, int stationId) const {
+    m_writer.waitForSession(sessionId);
+    syncWithOtherInstances();
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const QVariantMap *cached = m_sessionCache.object(sessionId)) {
+            m_cacheHits++;
+            QList<QVariantMap> sensors;
+            for (const QVariant &sensorVariant : cached->value("sensors").toList()) {
+                QVariantMap sensor = sensorVariant.toMap();
+                if (sensor["stationId"].toInt() == stationId) {
+                    sensors.append(sensor);
+                }
+            }
+            return sensors;
+        }
     }
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    file.close();
-    return doc.object().toVariantMap();
+
+    try {
+        return m_storage->loadStationSensors(sessionId, stationId);
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in loadStationSensors:" << e.what();
+        return QList<QVariantMap>();
+    } catch (...) {
+        qDebug() << "Unknown exception in loadStationSensors";
+        return QList<QVariantMap>();
+    }
+}
+
+/**
+ * @brief Zwraca dane sensora z katalogu wszystkich sesji.
+ *
+ * Katalog obejmuje zmiany już zapisane przez wątek zapisu oraz przez inne instancje.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @return Dane sensora (z łącznym zakresem seriesFrom..seriesTo) lub pusta mapa.
+ */
+QVariantMap HistoryManager::catalogSensor(int sensorId) const {
+    m_catalog->sync();
+    return m_catalog->sensor(sensorId);
+}
+
+/**
+ * @brief Zwraca sensory stacji z katalogu wszystkich sesji.
+ *
+ * @param stationId Identyfikator stacji.
+ * @return Lista sensorów stacji.
+ */
+QList<QVariantMap> HistoryManager::catalogStationSensors(int stationId) const {
+    m_catalog->sync();
+    return m_catalog->stationSensors(stationId);
+}
+
+/**
+ * @brief Ustawia budżet pamięci pamięci podręcznej sesji.
+ *
+ * Sesje najdawniej używane są usuwane, gdy suma ich kosztów przekroczy budżet.
+ *
+ * @param bytes Budżet w bajtach (0 wyłącza pamięć podręczną).
+ */
+void HistoryManager::setSessionCacheBudget(qint64 bytes) {
+    QMutexLocker locker(&m_cacheMutex);
+    m_sessionCache.setMaxCost(qMax<qint64>(bytes, 0));
+}
+
+/**
+ * @brief Zwraca budżet pamięci pamięci podręcznej sesji.
+ *
+ * @return Budżet w bajtach.
+ */
+qint64 HistoryManager::sessionCacheBudget() const {
+    QMutexLocker locker(&m_cacheMutex);
+    return m_sessionCache.maxCost();
+}
+
+/**
+ * @brief Zwraca liczbę odczytów sesji obsłużonych z pamięci podręcznej.
+ *
+ * @return Liczba trafień.
+ */
+quint64 HistoryManager::sessionCacheHits() const {
+    QMutexLocker locker(&m_cacheMutex);
+    return m_cacheHits;
+}
+
+/**
+ * @brief Zwraca liczbę odczytów sesji, które wymagały wczytania pliku.
+ *
+ * @return Liczba chybień.
+ */
+quint64 HistoryManager::sessionCacheMisses() const {
+    QMutexLocker locker(&m_cacheMutex);
+    return m_cacheMisses;
 }
 
 /**
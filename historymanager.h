@@ -5,6 +5,14 @@
 #include <QDir>
 #include <QVariantList>
 #include <QVariantMap>
+#include <QMutex>
+#include <QCache>
+#include <QHash>
+#include <QScopedPointer>
+#include "historystorage.h"
+#include "historywriter.h"
+#include "sessioncodec.h"
+#include "sensorcatalog.h"
 
 /**
  * @class HistoryManager
@@ -12,7 +20,17 @@
  *
  * Klasa HistoryManager odpowiada za zapisywanie, wczytywanie i aktualizowanie danych sesji,
  * takich jak informacje o stacjach pomiarowych, sensorach, pomiarach i jakości powietrza.
- * Dane są przechowywane w plikach JSON w określonym katalogu.
+ * Dane są zapisywane przez wymienny magazyn HistoryStorage: pliki JSON z dziennikami
+ * sesji i kolumnowymi szeregami pomiarów (FileHistoryStorage) albo bazę SQLite
+ * (SqliteHistoryStorage). Magazyn wybiera klucz storage/backend w pliku history.ini,
+ * a format zapisu danych sesji (JSON lub CBOR) klucz storage/format. Starsze pomiary
+ * są w tle przenoszone do przedziałów sześciogodzinnych, a potem dobowych (sekcja retention).
+ * Wpis indeksu każdej sesji zawiera podsumowanie (liczba stacji, sensory, zakres dat
+ * i statystyki pomiarów), aktualizowane przy każdym zapisie, dzięki czemu lista sesji
+ * nie wymaga otwierania plików sesji.
+ * Wczytane sesje są przechowywane w ograniczonej pamięci podręcznej LRU, a stacje
+ * i sensory ze wszystkich sesji w trwałym katalogu SensorCatalog. Metody
+ * addSession* nie wykonują operacji na dysku: zmiany zapisuje w tle wątek HistoryWriter.
  */
 class HistoryManager : public QObject
 {
@@ -25,6 +43,17 @@ public:
      */
     explicit HistoryManager(const QString &storagePath, QObject *parent = nullptr);
 
+    /**
+     * @brief Destruktor klasy HistoryManager.
+     */
+    ~HistoryManager();
+
+    /**
+     * @brief Zwraca domyślny katalog historii aplikacji.
+     * @return Ścieżka do podkatalogu history w katalogu danych aplikacji.
+     */
+    static QString defaultStoragePath();
+
     /**
      * @brief Generuje unikalny identyfikator sesji.
      * @return QString zawierający UUID sesji bez nawiasów.
@@ -56,6 +85,25 @@ public:
      */
     void addSessionMeasurements(const QString &sessionId, const QList<QVariantMap> &measurements);
 
+    /**
+     * @brief Wczytuje pomiary sensora z podanego przedziału czasu.
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek przedziału (sekundy od epoki, włącznie).
+     * @param to Koniec przedziału (sekundy od epoki, włącznie).
+     * @return Pomiary w kolejności czasu.
+     */
+    QVector<MeasurementPoint> loadMeasurements(int sensorId, qint64 from, qint64 to) const;
+
+    /**
+     * @brief Wczytuje pomiary sensora zagregowane w przedziały (min/max/średnia).
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek przedziału (sekundy od epoki, włącznie).
+     * @param to Koniec przedziału (sekundy od epoki, włącznie).
+     * @param bucketSeconds Długość przedziału w sekundach (dłuższe przedziały zapisane w historii nie są dzielone).
+     * @return Przedziały w kolejności czasu.
+     */
+    QVector<RollupPoint> loadRollups(int sensorId, qint64 from, qint64 to, qint64 bucketSeconds) const;
+
     /**
      * @brief Dodaje dane o jakości powietrza do sesji.
      * @param sessionId Identyfikator sesji.
@@ -63,19 +111,133 @@ public:
      */
     void addSessionAirQuality(const QString &sessionId, const QVariantMap &airQualityData);
 
+    /**
+     * @brief Czeka na zapisanie wszystkich zmian zgłoszonych do tej pory.
+     */
+    void flush() const;
+
+    /**
+     * @brief Sprawdza, czy sesja istnieje lub czeka na zapis.
+     * @param sessionId Identyfikator sesji.
+     * @return true, jeśli sesja istnieje; false w przeciwnym razie.
+     */
+    bool sessionExists(const QString &sessionId) const;
+
+    /**
+     * @brief Zwraca liczbę zmian oczekujących na zapis.
+     * @return Długość kolejki zapisu.
+     */
+    int pendingWriteCount() const;
+
+    /**
+     * @brief Zwraca średni czas zapisu zmian jednej sesji.
+     * @return Czas w milisekundach.
+     */
+    double averageWriteLatencyMs() const;
+
+    /**
+     * @brief Zwraca najdłuższy czas zapisu zmian jednej sesji.
+     * @return Czas w milisekundach.
+     */
+    double maxWriteLatencyMs() const;
+
     /**
      * @brief Wczytuje listę zapisanych sesji.
      * @return QVariantList zawierający dane sesji.
      */
     QVariantList loadSessions() const;
 
+    /**
+     * @brief Wyszukuje sesje zawierające dane sensora, stacji lub przedziału czasu.
+     * @param query Zapytanie (stacja, sensor, przedział czasu).
+     * @param stats Ustawiane na statystyki wykonania zapytania (opcjonalnie).
+     * @return Identyfikatory pasujących sesji od najnowszej do najstarszej.
+     */
+    QStringList findSessions(const SessionQuery &query, SessionQueryStats *stats = nullptr) const;
+
     /**
      * @brief Wczytuje szczegóły konkretnej sesji.
+     *
+     * Pomiary ze współdzielonych szeregów nie są dołączane; należy je odczytać przez
+     * loadMeasurements() w zakresie seriesFrom..seriesTo sensora.
+     *
      * @param sessionId Identyfikator sesji.
      * @return QVariantMap zawierający szczegóły sesji.
      */
     QVariantMap loadSessionDetails(const QString &sessionId) const;
 
+    /**
+     * @brief Wczytuje wybrane pola sesji bez dekodowania całej sesji.
+     * @param sessionId Identyfikator sesji.
+     * @param keys Nazwy pól (np. "stations", "location", "radius", "airQuality").
+     * @return QVariantMap z istniejącymi polami spośród keys.
+     */
+    QVariantMap loadSessionFields(const QString &sessionId, const QStringList &keys) const;
+
+    /**
+     * @brief Wczytuje sensory jednej stacji zapisane w sesji.
+     * @param sessionId Identyfikator sesji.
+     * @param stationId Identyfikator stacji.
+     * @return Lista sensorów stacji (z polami seriesFrom i seriesTo, jeśli mają pomiary).
+     */
+    QList<QVariantMap> loadStationSensors(const QString &sessionId, int stationId) const;
+
+    /**
+     * @brief Zwraca dane sensora z katalogu wszystkich sesji.
+     * @param sensorId Identyfikator sensora.
+     * @return Dane sensora (z łącznym zakresem seriesFrom..seriesTo) lub pusta mapa.
+     */
+    QVariantMap catalogSensor(int sensorId) const;
+
+    /**
+     * @brief Zwraca sensory stacji z katalogu wszystkich sesji.
+     * @param stationId Identyfikator stacji.
+     * @return Lista sensorów stacji.
+     */
+    QList<QVariantMap> catalogStationSensors(int stationId) const;
+
+    /**
+     * @brief Ustawia budżet pamięci pamięci podręcznej sesji.
+     * @param bytes Budżet w bajtach (0 wyłącza pamięć podręczną).
+     */
+    void setSessionCacheBudget(qint64 bytes);
+
+    /**
+     * @brief Zwraca budżet pamięci pamięci podręcznej sesji.
+     * @return Budżet w bajtach.
+     */
+    qint64 sessionCacheBudget() const;
+
+    /**
+     * @brief Zwraca liczbę odczytów sesji obsłużonych z pamięci podręcznej.
+     * @return Liczba trafień.
+     */
+    quint64 sessionCacheHits() const;
+
+    /**
+     * @brief Zwraca liczbę odczytów sesji, które wymagały wczytania pliku.
+     * @return Liczba chybień.
+     */
+    quint64 sessionCacheMisses() const;
+
+    /**
+     * @brief Zwraca nazwę używanego magazynu danych.
+     * @return "files" lub "sqlite".
+     */
+    QString storageBackend() const;
+
+    /**
+     * @brief Zwraca format zapisu danych sesji.
+     * @return Format wybrany kluczem storage/format.
+     */
+    SessionCodec::Format sessionFormat() const;
+
+    /**
+     * @brief Przepisuje zapisane sesje do bieżącego formatu zapisu.
+     * @return Liczba przepisanych plików lub wartości; -1 w przypadku błędu.
+     */
+    int convertSessionFormat();
+
     /**
      * @brief Katalog przechowujący pliki historii.
      */
@@ -90,20 +252,220 @@ private:
     void ensureHistoryDir();
 
     /**
-     * @brief Aktualizuje plik indeksu sesji.
-     * @param session Dane sesji do dodania do indeksu jako QVariantMap.
+     * @brief Tworzy magazyn danych wybranego typu.
+     * @param backend Nazwa magazynu ("files" lub "sqlite").
+     * @param format Format zapisu danych sesji.
+     */
+    void createStorage(const QString &backend, SessionCodec::Format format);
+
+    /**
+     * @brief Czyści pamięć podręczną sesji, jeśli inna instancja zapisała zmiany w historii.
+     */
+    void syncWithOtherInstances() const;
+
+    /**
+     * @brief Zapisuje połączone zmiany jednej sesji (w wątku zapisu).
+     * @param sessionId Identyfikator sesji.
+     * @param update Połączone zmiany sesji.
+     */
+    void writeSessionUpdate(const QString &sessionId, const SessionUpdate &update);
+
+    /**
+     * @brief Aktualizuje podsumowanie sesji po zapisaniu zmiany (w wątku zapisu).
+     * @param sessionId Identyfikator sesji.
+     * @param update Zapisana zmiana sesji.
+     */
+    void updateSummary(const QString &sessionId, const SessionUpdate &update);
+
+    /**
+     * @brief Buduje podsumowanie sesji od nowa na podstawie zapisanych danych.
+     * @param sessionId Identyfikator sesji.
+     * @return Podsumowanie sesji.
+     */
+    QVariantMap summarizeSession(const QString &sessionId) const;
+
+    /**
+     * @brief Oblicza statystyki pomiarów sensora z podanego przedziału czasu.
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek przedziału (sekundy od epoki).
+     * @param to Koniec przedziału (sekundy od epoki).
+     * @return Mapa z polami id, from, to, count, min, max i mean.
+     */
+    QVariantMap sensorStatistics(int sensorId, qint64 from, qint64 to) const;
+
+    /**
+     * @brief Wczytuje podsumowania zapisane w indeksie do m_summaries.
+     * @return Identyfikatory sesji, które nie mają jeszcze podsumowania.
+     */
+    QStringList loadSummaries();
+
+    /**
+     * @brief Wykonuje porcję przebiegu retencji (w wątku zapisu, gdy kolejka jest pusta).
+     * @return true, jeśli przebieg nie został jeszcze ukończony.
+     */
+    bool runRetentionStep();
+
+    /**
+     * @brief Wykonuje jeden krok egzekwowania limitu miejsca (usuwa najstarsze dane pomiarowe).
+     * @return true, jeśli historia wciąż przekracza limit i potrzebny jest kolejny krok.
+     */
+    bool enforceDiskQuota();
+
+    /**
+     * @brief Buduje katalog stacji i sensorów ze wszystkich zapisanych sesji.
      */
-    void updateIndexFile(const QVariantMap &session);
+    void rebuildCatalog();
 
     /**
-     * @brief Ścieżka do pliku indeksu historii.
+     * @brief Dopisuje do katalogu stacje, sensory i zakresy pomiarów z zapisanej zmiany.
+     * @param update Połączone zmiany sesji.
      */
-    QString m_indexFilePath;
+    void updateCatalog(const SessionUpdate &update);
 
     /**
      * @brief Maksymalna liczba przechowywanych sesji.
      */
     static const int MAX_SESSIONS = 100;
+
+    /**
+     * @brief Domyślny budżet pamięci podręcznej sesji (w bajtach).
+     */
+    static const qint64 DEFAULT_SESSION_CACHE_BUDGET = 16 * 1024 * 1024;
+
+    /**
+     * @brief Domyślna liczba dni przechowywania pomiarów godzinowych.
+     */
+    static const int DEFAULT_RAW_RETENTION_DAYS = 90;
+
+    /**
+     * @brief Domyślna liczba dni przechowywania przedziałów sześciogodzinnych.
+     */
+    static const int DEFAULT_ROLLUP_RETENTION_DAYS = 730;
+
+    /**
+     * @brief Liczba sensorów przetwarzanych w jednej porcji retencji.
+     */
+    static const int RETENTION_BATCH_SIZE = 16;
+
+    /**
+     * @brief Liczba sesji bez podsumowania, dla których podsumowanie jest budowane w jednej porcji.
+     */
+    static const int SUMMARY_BACKFILL_BATCH_SIZE = 4;
+
+    /**
+     * @brief Czas bezczynności wątku zapisu przed kolejnym przebiegiem retencji (ms).
+     */
+    static const int RETENTION_INTERVAL_MS = 15 * 60 * 1000;
+
+    /**
+     * @brief Okres danych usuwany w jednym kroku egzekwowania limitu miejsca (sekundy).
+     */
+    static const qint64 QUOTA_TRIM_STEP_SECONDS = 30 * 24 * 3600;
+
+    /**
+     * @brief Magazyn danych historii.
+     */
+    QScopedPointer<HistoryStorage> m_storage;
+
+    /**
+     * @brief Nazwa używanego magazynu danych.
+     */
+    QString m_backend;
+
+    /**
+     * @brief Format zapisu danych sesji.
+     */
+    SessionCodec::Format m_format;
+
+    /**
+     * @brief Muteks chroniący pamięć podręczną sesji.
+     */
+    mutable QMutex m_cacheMutex;
+
+    /**
+     * @brief Pamięć podręczna LRU wczytanych sesji, z kosztem w bajtach.
+     */
+    mutable QCache<QString, QVariantMap> m_sessionCache;
+
+    /**
+     * @brief Liczba trafień w pamięci podręcznej sesji.
+     */
+    mutable quint64 m_cacheHits;
+
+    /**
+     * @brief Liczba chybień w pamięci podręcznej sesji.
+     */
+    mutable quint64 m_cacheMisses;
+
+    /**
+     * @brief Ostatnio znana liczba zapisów innych instancji (chroniona przez m_cacheMutex).
+     */
+    mutable quint64 m_knownExternalChanges;
+
+    /**
+     * @brief Liczba dni przechowywania pomiarów godzinowych (klucz retention/rawDays).
+     */
+    int m_rawRetentionDays;
+
+    /**
+     * @brief Liczba dni przechowywania przedziałów sześciogodzinnych (klucz retention/rollupDays).
+     */
+    int m_rollupRetentionDays;
+
+    /**
+     * @brief Limit miejsca zajmowanego przez historię w bajtach; 0 oznacza brak limitu (klucz retention/quotaMB).
+     */
+    qint64 m_diskQuotaBytes;
+
+    /**
+     * @brief Sensory pozostałe do przetworzenia w bieżącym przebiegu retencji (używane tylko w wątku zapisu).
+     */
+    QList<int> m_retentionQueue;
+
+    /**
+     * @brief Granica pomiarów godzinowych w bieżącym przebiegu retencji.
+     */
+    qint64 m_rawCutoff;
+
+    /**
+     * @brief Granica przedziałów sześciogodzinnych w bieżącym przebiegu retencji.
+     */
+    qint64 m_rollupCutoff;
+
+    /**
+     * @brief Szacowane miejsce zajmowane przez historię w trwającym egzekwowaniu limitu (-1 poza nim).
+     */
+    qint64 m_quotaUsage;
+
+    /**
+     * @brief Czy w trwającym egzekwowaniu limitu usunięto dane.
+     */
+    bool m_quotaTrimmed;
+
+    /**
+     * @brief Podsumowania sesji według identyfikatora (używane tylko w wątku zapisu).
+     */
+    QHash<QString, QVariantMap> m_summaries;
+
+    /**
+     * @brief Czy podsumowania zostały wczytane z indeksu.
+     */
+    bool m_summariesLoaded;
+
+    /**
+     * @brief Sesje zapisane przez starsze wersje, którym brakuje podsumowania (używane tylko w wątku zapisu).
+     */
+    QStringList m_summaryBackfill;
+
+    /**
+     * @brief Katalog stacji i sensorów ze wszystkich sesji.
+     */
+    QScopedPointer<SensorCatalog> m_catalog;
+
+    /**
+     * @brief Wątek zapisujący zmiany sesji w tle (zadeklarowany jako ostatni, aby kończył się pierwszy).
+     */
+    HistoryWriter m_writer;
 };
 
 #endif // HISTORYMANAGER_H
@@ -0,0 +1,52 @@
+#include "historystorage.h"
+#include <QDebug>
+
+/**
+ * @brief Dołącza późniejszą zmianę tej samej sesji.
+ *
+ * Ponowne utworzenie sesji zastępuje wszystkie wcześniejsze zmiany. Sensory i pomiary
+ * są dopisywane, a dane o jakości powietrza zastępowane najnowszymi.
+ *
+ * @param later Zmiana zgłoszona później.
+ */
+void SessionUpdate::merge(const SessionUpdate &later) {
+    if (!later.session.isEmpty()) {
+        int previousOperations = operations;
+        *this = later;
+        operations += previousOperations;
+        return;
+    }
+    sensors.append(later.sensors);
+    measurements.append(later.measurements);
+    if (later.hasAirQuality) {
+        airQuality = later.airQuality;
+        hasAirQuality = true;
+    }
+    operations += later.operations;
+}
+
+/**
+ * @brief Grupuje pomiary w formacie API według sensorów.
+ *
+ * Pomiary z niepoprawną datą są pomijane, a brakujące wartości (null) oznaczane
+ * jako niepoprawne.
+ *
+ * @param measurements Pomiary z polami sensorId, date i value.
+ * @return Mapa identyfikatorów sensorów na pomiary w postaci binarnej.
+ */
+QMap<int, QVector<MeasurementPoint>> HistoryStorage::groupMeasurements(const QList<QVariantMap> &measurements) {
+    QMap<int, QVector<MeasurementPoint>> pointsBySensor;
+    for (const QVariantMap &measurement : measurements) {
+        bool ok = false;
+        MeasurementPoint point;
+        point.timestamp = SeriesStore::toEpochSeconds(measurement["date"].toString(), &ok);
+        if (!ok) {
+            qDebug() << "Invalid date format in measurement:" << measurement["date"].toString();
+            continue;
+        }
+        point.valid = measurement["value"].isValid() && !measurement["value"].isNull();
+        point.value = point.valid ? measurement["value"].toFloat() : 0.0f;
+        pointsBySensor[measurement["sensorId"].toInt()].append(point);
+    }
+    return pointsBySensor;
+}
@@ -0,0 +1,214 @@
+#ifndef HISTORYSTORAGE_H
+#define HISTORYSTORAGE_H
+
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+#include "seriesstore.h"
+#include "sessionfilter.h"
+
+class HistoryLock;
+
+/**
+ * @struct SessionUpdate
+ * @brief Zmiany w jednej sesji oczekujące na zapis.
+ *
+ * Kolejne zmiany tej samej sesji są łączone metodą merge(), dzięki czemu trafiają
+ * na dysk jednym zapisem.
+ */
+struct SessionUpdate {
+    QVariantMap session;              ///< Pełne dane nowej sesji (pusta mapa, jeśli sesja już istnieje).
+    QVariantMap indexEntry;           ///< Wpis indeksu nowej sesji.
+    QList<QVariantMap> sensors;       ///< Sensory do dodania.
+    QList<QVariantMap> measurements;  ///< Pomiary do dodania.
+    QVariantMap airQuality;           ///< Najnowsze dane o jakości powietrza.
+    bool hasAirQuality = false;       ///< Czy airQuality zawiera dane do zapisu.
+    int operations = 1;               ///< Liczba połączonych wywołań.
+
+    /**
+     * @brief Dołącza późniejszą zmianę tej samej sesji.
+     * @param later Zmiana zgłoszona później.
+     */
+    void merge(const SessionUpdate &later);
+};
+
+/**
+ * @class HistoryStorage
+ * @brief Interfejs magazynu historii sesji.
+ *
+ * HistoryManager odpowiada za kolejkę zapisu i pamięć podręczną, a sam zapis
+ * i odczyt danych deleguje do implementacji tego interfejsu (pliki JSON lub SQLite).
+ * Metody zapisu są wywoływane z wątku HistoryWriter, a metody odczytu z wątku
+ * interfejsu użytkownika, więc implementacje muszą być bezpieczne wątkowo.
+ */
+class HistoryStorage
+{
+public:
+    /**
+     * @brief Wirtualny destruktor klasy HistoryStorage.
+     */
+    virtual ~HistoryStorage() = default;
+
+    /**
+     * @brief Zapisuje nową sesję i dodaje ją do indeksu.
+     * @param sessionId Identyfikator sesji.
+     * @param sessionData Dane sesji (lokalizacja, promień, stacje).
+     * @param indexEntry Wpis indeksu z polami session_id, timestamp, location i radius.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    virtual bool writeSession(const QString &sessionId, const QVariantMap &sessionData, const QVariantMap &indexEntry) = 0;
+
+    /**
+     * @brief Zapisuje sensory, pomiary i dane o jakości powietrza istniejącej sesji.
+     * @param sessionId Identyfikator sesji.
+     * @param update Połączone zmiany sesji.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    virtual bool writeUpdate(const QString &sessionId, const SessionUpdate &update) = 0;
+
+    /**
+     * @brief Zapisuje podsumowanie sesji we wpisie indeksu.
+     * @param sessionId Identyfikator sesji.
+     * @param summary Podsumowanie sesji (zastępuje poprzednie).
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    virtual bool writeSummary(const QString &sessionId, const QVariantMap &summary) = 0;
+
+    /**
+     * @brief Wczytuje listę sesji.
+     * @return QVariantList z wpisami indeksu od najnowszego do najstarszego (z polem summary, jeśli jest znane).
+     */
+    virtual QVariantList loadSessions() const = 0;
+
+    /**
+     * @brief Wczytuje szczegóły sesji (bez pomiarów ze współdzielonych szeregów).
+     * @param sessionId Identyfikator sesji.
+     * @param cost Ustawiane na przybliżony rozmiar danych sesji w bajtach (opcjonalnie).
+     * @return QVariantMap z danymi sesji lub pusta mapa, jeśli sesja nie istnieje.
+     */
+    virtual QVariantMap loadSessionDetails(const QString &sessionId, qint64 *cost = nullptr) const = 0;
+
+    /**
+     * @brief Wczytuje wybrane pola sesji bez dekodowania pozostałych.
+     * @param sessionId Identyfikator sesji.
+     * @param keys Nazwy pól (np. "stations", "location", "radius", "airQuality").
+     * @return QVariantMap z istniejącymi polami spośród keys.
+     */
+    virtual QVariantMap loadSessionFields(const QString &sessionId, const QStringList &keys) const = 0;
+
+    /**
+     * @brief Wczytuje sensory jednej stacji zapisane w sesji.
+     * @param sessionId Identyfikator sesji.
+     * @param stationId Identyfikator stacji.
+     * @return Lista sensorów stacji (z polami seriesFrom i seriesTo, jeśli mają pomiary).
+     */
+    virtual QList<QVariantMap> loadStationSensors(const QString &sessionId, int stationId) const = 0;
+
+    /**
+     * @brief Wczytuje pomiary sensora z podanego przedziału czasu.
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek przedziału (sekundy od epoki, włącznie).
+     * @param to Koniec przedziału (sekundy od epoki, włącznie).
+     * @return Pomiary w kolejności czasu.
+     */
+    virtual QVector<MeasurementPoint> loadMeasurements(int sensorId, qint64 from, qint64 to) const = 0;
+
+    /**
+     * @brief Wczytuje zagregowane pomiary sensora nakładające się na podany przedział czasu.
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek przedziału (sekundy od epoki, włącznie).
+     * @param to Koniec przedziału (sekundy od epoki, włącznie).
+     * @return Przedziały dobowe i sześciogodzinne w kolejności czasu.
+     */
+    virtual QVector<RollupPoint> loadRollups(int sensorId, qint64 from, qint64 to) const = 0;
+
+    /**
+     * @brief Zwraca identyfikatory sensorów, które mają zapisane pomiary.
+     * @return Lista identyfikatorów sensorów.
+     */
+    virtual QList<int> seriesSensorIds() const = 0;
+
+    /**
+     * @brief Przenosi starsze pomiary sensora do poziomów zagregowanych.
+     * @param sensorId Identyfikator sensora.
+     * @param rawBefore Pomiary sprzed tej chwili trafiają do przedziałów sześciogodzinnych.
+     * @param rollupBefore Przedziały sześciogodzinne sprzed tej chwili trafiają do przedziałów dobowych.
+     * @return Liczba przeniesionych pomiarów i przedziałów lub -1 w przypadku błędu.
+     */
+    virtual int rollUpSensor(int sensorId, qint64 rawBefore, qint64 rollupBefore) = 0;
+
+    /**
+     * @brief Zwraca czas najstarszych zapisanych danych pomiarowych.
+     * @return Sekundy od epoki lub -1, jeśli magazyn nie ma pomiarów.
+     */
+    virtual qint64 oldestMeasurement() const = 0;
+
+    /**
+     * @brief Usuwa dane pomiarowe wszystkich sensorów sprzed podanej chwili.
+     * @param cutoff Dane kończące się przed tą chwilą są usuwane.
+     * @return Szacowana liczba zwolnionych bajtów lub -1 w przypadku błędu.
+     */
+    virtual qint64 trimBefore(qint64 cutoff) = 0;
+
+    /**
+     * @brief Oddaje systemowi miejsce zwolnione przez trimBefore() (np. kompaktuje bazę).
+     * @return true, jeśli operacja się powiodła; false w przeciwnym razie.
+     */
+    virtual bool reclaimSpace() = 0;
+
+    /**
+     * @brief Zwraca miejsce zajmowane przez magazyn na dysku.
+     * @return Rozmiar w bajtach.
+     */
+    virtual qint64 diskUsage() const = 0;
+
+    /**
+     * @brief Sprawdza, czy sesja istnieje.
+     * @param sessionId Identyfikator sesji.
+     * @return true, jeśli sesja istnieje; false w przeciwnym razie.
+     */
+    virtual bool sessionExists(const QString &sessionId) const = 0;
+
+    /**
+     * @brief Wyszukuje sesje, które mają sensor spełniający zapytanie.
+     * @param query Zapytanie (stacja, sensor, przedział czasu).
+     * @param stats Ustawiane na statystyki wykonania zapytania (opcjonalnie).
+     * @return Identyfikatory pasujących sesji od najnowszej do najstarszej.
+     */
+    virtual QStringList findSessions(const SessionQuery &query, SessionQueryStats *stats = nullptr) const = 0;
+
+    /**
+     * @brief Zwraca liczbę wykrytych zapisów innych instancji aplikacji.
+     * @return Licznik zwiększany przy każdym wykryciu zmian zapisanych przez inną instancję.
+     */
+    virtual quint64 externalChangeCount() const = 0;
+
+    /**
+     * @brief Zwraca blokadę zapisu magazynu.
+     *
+     * Wywołujący może założyć ją na czas kilku operacji zapisu; operacje zakładają
+     * ją wtedy ponownie bez czekania, a licznik zapisów jest zwiększany raz.
+     *
+     * @return Blokada zapisu.
+     */
+    virtual HistoryLock &writerLock() = 0;
+
+    /**
+     * @brief Przepisuje zapisane dane sesji do formatu wybranego dla magazynu.
+     * @return Liczba przepisanych plików lub wartości; -1 w przypadku błędu.
+     */
+    virtual int convertFormat() = 0;
+
+    /**
+     * @brief Grupuje pomiary w formacie API według sensorów.
+     * @param measurements Pomiary z polami sensorId, date i value.
+     * @return Mapa identyfikatorów sensorów na pomiary w postaci binarnej.
+     */
+    static QMap<int, QVector<MeasurementPoint>> groupMeasurements(const QList<QVariantMap> &measurements);
+};
+
+#endif // HISTORYSTORAGE_H
@@ -0,0 +1,276 @@
+#include "historywriter.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QDebug>
+
+/**
+ * @brief Konstruktor klasy HistoryWriter.
+ *
+ * @param handler Funkcja zapisująca zmiany jednej sesji.
+ * @param capacity Liczba oczekujących wywołań, powyżej której zgłaszane jest ostrzeżenie.
+ * @param parent Wskaźnik na obiekt nadrzędny.
+ */
+HistoryWriter::HistoryWriter(Handler handler, int capacity, QObject *parent)
+    : QThread(parent), m_handler(std::move(handler)), m_idleIntervalMs(0), m_idleWorkPending(true),
+      m_capacity(qMax(1, capacity)), m_writingUpdate(nullptr),
+      m_queueDepth(0), m_peakQueueDepth(0), m_enqueued(0), m_written(0),
+      m_completedWrites(0), m_coalescedUpdates(0), m_totalWriteNs(0), m_maxWriteNs(0),
+      m_stopping(false) {
+}
+
+/**
+ * @brief Destruktor klasy HistoryWriter.
+ */
+HistoryWriter::~HistoryWriter() {
+    stop();
+}
+
+/**
+ * @brief Ustawia zadanie wykonywane w tle, gdy nie ma zmian do zapisania.
+ *
+ * @param task Zadanie wykonywane porcjami; zwraca true, jeśli ma być wywołane ponownie od razu.
+ * @param intervalMs Czas bezczynności (w milisekundach) przed kolejnym przebiegiem.
+ */
+void HistoryWriter::setIdleTask(IdleTask task, int intervalMs) {
+    QMutexLocker locker(&m_mutex);
+    m_idleTask = std::move(task);
+    m_idleIntervalMs = qMax(1, intervalMs);
+}
+
+/**
+ * @brief Dodaje zmianę do kolejki.
+ *
+ * Jeśli sesja czeka już w kolejce, zmiana jest z nią łączona, więc kolejka rośnie
+ * tylko z liczbą sesji i metoda nie czeka na zapis (jest wywoływana z wątku interfejsu).
+ * Przekroczenie progu długości kolejki jest tylko zgłaszane w logu. Po zatrzymaniu
+ * wątku zmiana jest zapisywana od razu, w wątku wywołującym.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param update Zmiana sesji.
+ */
+void HistoryWriter::enqueue(const QString &sessionId, const SessionUpdate &update) {
+    QMutexLocker locker(&m_mutex);
+    if (m_stopping) {
+        locker.unlock();
+        m_handler(sessionId, update);
+        return;
+    }
+    auto it = m_pending.find(sessionId);
+    if (it != m_pending.end()) {
+        it->merge(update);
+        m_coalescedUpdates += update.operations;
+    } else {
+        m_pending.insert(sessionId, update);
+        m_order.append(sessionId);
+    }
+    if (m_queueDepth < m_capacity && m_queueDepth + update.operations >= m_capacity) {
+        qDebug() << "History write queue reached" << m_queueDepth + update.operations
+                 << "pending updates in" << m_order.size() << "sessions";
+    }
+    m_queueDepth += update.operations;
+    m_enqueued += update.operations;
+    m_peakQueueDepth = qMax(m_peakQueueDepth, m_queueDepth);
+    m_queueChanged.wakeAll();
+}
+
+/**
+ * @brief Czeka, aż wszystkie zmiany zgłoszone przed wywołaniem zostaną zapisane.
+ */
+void HistoryWriter::flush() const {
+    QMutexLocker locker(&m_mutex);
+    quint64 target = m_enqueued;
+    while (m_written < target && isRunning()) {
+        m_queueChanged.wait(&m_mutex);
+    }
+}
+
+/**
+ * @brief Czeka, aż zmiany danej sesji zostaną zapisane.
+ *
+ * @param sessionId Identyfikator sesji.
+ */
+void HistoryWriter::waitForSession(const QString &sessionId) const {
+    QMutexLocker locker(&m_mutex);
+    while ((m_pending.contains(sessionId) || m_writingSession == sessionId) && isRunning()) {
+        m_queueChanged.wait(&m_mutex);
+    }
+}
+
+/**
+ * @brief Czeka, aż zostaną zapisane oczekujące zmiany spełniające warunek.
+ *
+ * W przeciwieństwie do flush() nie czeka na zmiany innych sesji i sensorów, więc
+ * odczyt nie jest wstrzymywany przez zapis niezwiązanych z nim danych.
+ *
+ * @param matches Warunek wybierający zmiany.
+ */
+void HistoryWriter::waitFor(const Filter &matches) const {
+    QMutexLocker locker(&m_mutex);
+    auto hasMatch = [this, &matches]() {
+        if (m_writingUpdate && matches(*m_writingUpdate)) {
+            return true;
+        }
+        for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+            if (matches(it.value())) {
+                return true;
+            }
+        }
+        return false;
+    };
+    while (isRunning() && hasMatch()) {
+        m_queueChanged.wait(&m_mutex);
+    }
+}
+
+/**
+ * @brief Sprawdza, czy sesja ma niezapisane zmiany.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return true, jeśli zmiany sesji czekają w kolejce lub są zapisywane.
+ */
+bool HistoryWriter::hasPending(const QString &sessionId) const {
+    QMutexLocker locker(&m_mutex);
+    return m_pending.contains(sessionId) || m_writingSession == sessionId;
+}
+
+/**
+ * @brief Zapisuje oczekujące zmiany i kończy wątek.
+ */
+void HistoryWriter::stop() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_queueChanged.wakeAll();
+    }
+    wait();
+}
+
+/**
+ * @brief Pętla wątku zapisu.
+ *
+ * Pobiera sesje w kolejności zgłoszenia i zapisuje wszystkie połączone zmiany sesji
+ * jednym wywołaniem funkcji zapisu. Gdy kolejka jest pusta, wykonuje porcjami zadanie
+ * ustawione przez setIdleTask(); nowe zmiany mają pierwszeństwo przed kolejną porcją.
+ * Kończy działanie po zatrzymaniu i opróżnieniu kolejki.
+ */
+void HistoryWriter::run() {
+    QMutexLocker locker(&m_mutex);
+    forever {
+        while (m_order.isEmpty() && !m_stopping) {
+            if (!m_idleTask) {
+                m_queueChanged.wait(&m_mutex);
+                continue;
+            }
+            if (!m_idleWorkPending && !m_queueChanged.wait(&m_mutex, m_idleIntervalMs)) {
+                m_idleWorkPending = true;
+            }
+            if (m_idleWorkPending && m_order.isEmpty() && !m_stopping) {
+                IdleTask task = m_idleTask;
+                locker.unlock();
+                bool more = false;
+                try {
+                    more = task();
+                } catch (const std::exception &e) {
+                    qDebug() << "Exception in history writer idle task:" << e.what();
+                } catch (...) {
+                    qDebug() << "Unknown exception in history writer idle task";
+                }
+                locker.relock();
+                m_idleWorkPending = more;
+            }
+        }
+        if (m_order.isEmpty()) {
+            break;
+        }
+
+        QString sessionId = m_order.takeFirst();
+        SessionUpdate update = m_pending.take(sessionId);
+        m_writingSession = sessionId;
+        m_writingUpdate = &update;
+        locker.unlock();
+
+        QElapsedTimer timer;
+        timer.start();
+        try {
+            m_handler(sessionId, update);
+        } catch (const std::exception &e) {
+            qDebug() << "Exception in history writer for session" << sessionId << ":" << e.what();
+        } catch (...) {
+            qDebug() << "Unknown exception in history writer for session" << sessionId;
+        }
+        qint64 elapsedNs = timer.nsecsElapsed();
+
+        locker.relock();
+        m_writingSession.clear();
+        m_writingUpdate = nullptr;
+        m_queueDepth -= update.operations;
+        m_written += update.operations;
+        m_completedWrites++;
+        m_totalWriteNs += elapsedNs;
+        m_maxWriteNs = qMax(m_maxWriteNs, elapsedNs);
+        m_queueChanged.wakeAll();
+    }
+}
+
+/**
+ * @brief Zwraca liczbę wywołań oczekujących na zapis.
+ *
+ * @return Długość kolejki.
+ */
+int HistoryWriter::queueDepth() const {
+    QMutexLocker locker(&m_mutex);
+    return m_queueDepth;
+}
+
+/**
+ * @brief Zwraca największą zaobserwowaną długość kolejki.
+ *
+ * @return Długość kolejki.
+ */
+int HistoryWriter::peakQueueDepth() const {
+    QMutexLocker locker(&m_mutex);
+    return m_peakQueueDepth;
+}
+
+/**
+ * @brief Zwraca liczbę wykonanych zapisów.
+ *
+ * @return Liczba zapisów.
+ */
+quint64 HistoryWriter::completedWrites() const {
+    QMutexLocker locker(&m_mutex);
+    return m_completedWrites;
+}
+
+/**
+ * @brief Zwraca liczbę wywołań połączonych z wcześniej oczekującą zmianą.
+ *
+ * @return Liczba połączonych wywołań.
+ */
+quint64 HistoryWriter::coalescedUpdates() const {
+    QMutexLocker locker(&m_mutex);
+    return m_coalescedUpdates;
+}
+
+/**
+ * @brief Zwraca średni czas zapisu.
+ *
+ * @return Czas w milisekundach (0, jeśli nie wykonano jeszcze zapisu).
+ */
+double HistoryWriter::averageWriteLatencyMs() const {
+    QMutexLocker locker(&m_mutex);
+    if (m_completedWrites == 0) {
+        return 0.0;
+    }
+    return double(m_totalWriteNs) / double(m_completedWrites) / 1e6;
+}
+
+/**
+ * @brief Zwraca najdłuższy czas zapisu.
+ *
+ * @return Czas w milisekundach.
+ */
+double HistoryWriter::maxWriteLatencyMs() const {
+    QMutexLocker locker(&m_mutex);
+    return double(m_maxWriteNs) / 1e6;
+}
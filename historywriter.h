@@ -0,0 +1,173 @@
+#ifndef HISTORYWRITER_H
+#define HISTORYWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QStringList>
+#include <functional>
+#include "historystorage.h"
+
+/**
+ * @class HistoryWriter
+ * @brief Wątek zapisujący zmiany w historii sesji w tle.
+ *
+ * Zmiany trafiają do kolejki. Zmiany sesji, która czeka już w kolejce, są z nimi
+ * łączone, więc kolejka ma co najwyżej jeden wpis na sesję, a enqueue() nigdy nie
+ * blokuje wywołującego. Odczyty czekają tylko na zmiany, które ich dotyczą
+ * (waitForSession(), waitFor()). Klasa zbiera też metryki: długość kolejki i czas zapisu.
+ */
+class HistoryWriter : public QThread
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Funkcja zapisująca zmiany jednej sesji (wywoływana w wątku zapisu).
+     */
+    using Handler = std::function<void(const QString &sessionId, const SessionUpdate &update)>;
+
+    /**
+     * @brief Zadanie wykonywane w wątku zapisu, gdy kolejka jest pusta.
+     *
+     * Zwraca true, jeśli zostało jeszcze coś do zrobienia i zadanie ma być wywołane
+     * ponownie od razu (po zapisaniu zmian, które w międzyczasie trafiły do kolejki).
+     */
+    using IdleTask = std::function<bool()>;
+
+    /**
+     * @brief Warunek wybierający zmiany, na których zapis czeka odczyt.
+     */
+    using Filter = std::function<bool(const SessionUpdate &update)>;
+
+    /**
+     * @brief Konstruktor klasy HistoryWriter.
+     * @param handler Funkcja zapisująca zmiany.
+     * @param capacity Liczba oczekujących wywołań, powyżej której zgłaszane jest ostrzeżenie.
+     * @param parent Wskaźnik na obiekt nadrzędny (domyślnie nullptr).
+     */
+    explicit HistoryWriter(Handler handler, int capacity = DEFAULT_CAPACITY, QObject *parent = nullptr);
+
+    /**
+     * @brief Destruktor klasy HistoryWriter. Zapisuje oczekujące zmiany i kończy wątek.
+     */
+    ~HistoryWriter();
+
+    /**
+     * @brief Ustawia zadanie wykonywane w tle, gdy nie ma zmian do zapisania.
+     *
+     * Należy wywołać przed uruchomieniem wątku. Pierwsze wywołanie następuje zaraz po
+     * opróżnieniu kolejki, kolejne po intervalMs bez nowych zmian.
+     *
+     * @param task Zadanie wykonywane porcjami.
+     * @param intervalMs Czas bezczynności (w milisekundach) przed kolejnym przebiegiem.
+     */
+    void setIdleTask(IdleTask task, int intervalMs);
+
+    /**
+     * @brief Dodaje zmianę do kolejki.
+     * @param sessionId Identyfikator sesji.
+     * @param update Zmiana sesji.
+     */
+    void enqueue(const QString &sessionId, const SessionUpdate &update);
+
+    /**
+     * @brief Czeka, aż wszystkie zmiany zgłoszone przed wywołaniem zostaną zapisane.
+     */
+    void flush() const;
+
+    /**
+     * @brief Czeka, aż zmiany danej sesji zostaną zapisane.
+     * @param sessionId Identyfikator sesji.
+     */
+    void waitForSession(const QString &sessionId) const;
+
+    /**
+     * @brief Czeka, aż zostaną zapisane oczekujące zmiany spełniające warunek.
+     * @param matches Warunek wybierający zmiany.
+     */
+    void waitFor(const Filter &matches) const;
+
+    /**
+     * @brief Sprawdza, czy sesja ma niezapisane zmiany.
+     * @param sessionId Identyfikator sesji.
+     * @return true, jeśli zmiany sesji czekają w kolejce lub są zapisywane.
+     */
+    bool hasPending(const QString &sessionId) const;
+
+    /**
+     * @brief Zapisuje oczekujące zmiany i kończy wątek.
+     */
+    void stop();
+
+    /**
+     * @brief Zwraca liczbę wywołań oczekujących na zapis.
+     * @return Długość kolejki.
+     */
+    int queueDepth() const;
+
+    /**
+     * @brief Zwraca największą zaobserwowaną długość kolejki.
+     * @return Długość kolejki.
+     */
+    int peakQueueDepth() const;
+
+    /**
+     * @brief Zwraca liczbę wykonanych zapisów.
+     * @return Liczba zapisów.
+     */
+    quint64 completedWrites() const;
+
+    /**
+     * @brief Zwraca liczbę wywołań połączonych z wcześniej oczekującą zmianą.
+     * @return Liczba połączonych wywołań.
+     */
+    quint64 coalescedUpdates() const;
+
+    /**
+     * @brief Zwraca średni czas zapisu.
+     * @return Czas w milisekundach.
+     */
+    double averageWriteLatencyMs() const;
+
+    /**
+     * @brief Zwraca najdłuższy czas zapisu.
+     * @return Czas w milisekundach.
+     */
+    double maxWriteLatencyMs() const;
+
+    /**
+     * @brief Domyślna liczba oczekujących wywołań, powyżej której zgłaszane jest ostrzeżenie.
+     */
+    static const int DEFAULT_CAPACITY = 256;
+
+protected:
+    /**
+     * @brief Pętla wątku zapisu.
+     */
+    void run() override;
+
+private:
+    Handler m_handler;                       ///< Funkcja zapisująca zmiany.
+    IdleTask m_idleTask;                     ///< Zadanie wykonywane przy pustej kolejce.
+    int m_idleIntervalMs;                    ///< Czas bezczynności przed kolejnym przebiegiem zadania.
+    bool m_idleWorkPending;                  ///< Czy zadanie ma zostać wywołane przy najbliższej okazji.
+    const int m_capacity;                    ///< Próg ostrzeżenia o długości kolejki.
+    mutable QMutex m_mutex;                  ///< Muteks chroniący kolejkę i metryki.
+    mutable QWaitCondition m_queueChanged;   ///< Sygnalizuje zmianę stanu kolejki.
+    QHash<QString, SessionUpdate> m_pending; ///< Oczekujące zmiany według sesji.
+    QStringList m_order;                     ///< Kolejność sesji w kolejce.
+    QString m_writingSession;                ///< Sesja aktualnie zapisywana.
+    const SessionUpdate *m_writingUpdate;    ///< Zmiana aktualnie zapisywana (nullptr, jeśli brak).
+    int m_queueDepth;                        ///< Liczba oczekujących wywołań.
+    int m_peakQueueDepth;                    ///< Największa zaobserwowana długość kolejki.
+    quint64 m_enqueued;                      ///< Liczba wszystkich wywołań enqueue().
+    quint64 m_written;                       ///< Liczba wywołań już zapisanych.
+    quint64 m_completedWrites;               ///< Liczba wykonanych zapisów.
+    quint64 m_coalescedUpdates;              ///< Liczba połączonych wywołań.
+    qint64 m_totalWriteNs;                   ///< Łączny czas zapisów w nanosekundach.
+    qint64 m_maxWriteNs;                     ///< Najdłuższy zapis w nanosekundach.
+    bool m_stopping;                         ///< Czy wątek ma się zakończyć po opróżnieniu kolejki.
+};
+
+#endif // HISTORYWRITER_H
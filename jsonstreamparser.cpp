@@ -0,0 +1,174 @@
+#include "jsonstreamparser.h"
+#include <QJsonDocument>
+#include <QJsonParseError>
+
+namespace {
+
+bool isJsonWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+} // namespace
+
+/**
+ * @brief Konstruktor klasy JsonStreamParser.
+ */
+JsonStreamParser::JsonStreamParser() {
+    reset();
+}
+
+/**
+ * @brief Przywraca stan początkowy (przed nową treścią).
+ */
+void JsonStreamParser::reset() {
+    m_state = State::BeforeArray;
+    m_object.clear();
+    m_depth = 0;
+    m_inString = false;
+    m_escape = false;
+    m_bytesRead = 0;
+    m_objectCount = 0;
+    m_error.clear();
+}
+
+/**
+ * @brief Przetwarza kolejny fragment treści.
+ *
+ * Bajty obiektu są kopiowane do bufora całymi odcinkami fragmentu, a obiekt jest
+ * parsowany przez QJsonDocument po odebraniu jego nawiasu zamykającego. Po błędzie
+ * kolejne fragmenty są pomijane.
+ *
+ * @param data Fragment treści.
+ * @return Obiekty tablicy odebrane w całości w tym fragmencie.
+ */
+QList<QJsonObject> JsonStreamParser::feed(const QByteArray &data) {
+    QList<QJsonObject> objects;
+    const qint64 offset = m_bytesRead;
+    m_bytesRead += data.size();
+    qsizetype objectStart = m_state == State::InObject ? 0 : -1;
+
+    for (qsizetype i = 0; i < data.size() && m_state != State::Error; ++i) {
+        const char c = data.at(i);
+        switch (m_state) {
+        case State::BeforeArray:
+            if (c == '[') {
+                m_state = State::BetweenObjects;
+            } else if (!isJsonWhitespace(c) && !(offset + i < 3 && (uchar(c) & 0x80))) {
+                // Only whitespace and a UTF-8 byte order mark may precede the array
+                fail("Response is not a JSON array");
+            }
+            break;
+        case State::BetweenObjects:
+            if (c == '{') {
+                m_state = State::InObject;
+                m_depth = 1;
+                objectStart = i;
+            } else if (c == ']') {
+                m_state = State::AfterArray;
+            } else if (!isJsonWhitespace(c) && c != ',') {
+                fail("JSON array element is not an object");
+            }
+            break;
+        case State::InObject:
+            if (m_inString) {
+                if (m_escape) {
+                    m_escape = false;
+                } else if (c == '\\') {
+                    m_escape = true;
+                } else if (c == '"') {
+                    m_inString = false;
+                }
+            } else if (c == '"') {
+                m_inString = true;
+            } else if (c == '{' || c == '[') {
+                m_depth++;
+            } else if (c == '}' || c == ']') {
+                m_depth--;
+            }
+            if (m_depth == 0) {
+                m_object.append(data.constData() + objectStart, i - objectStart + 1);
+                objectStart = -1;
+                QJsonParseError error;
+                QJsonDocument doc = QJsonDocument::fromJson(m_object, &error);
+                m_object.clear();
+                if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+                    fail("Failed to parse JSON array element: " + error.errorString());
+                    break;
+                }
+                objects.append(doc.object());
+                m_objectCount++;
+                m_state = State::BetweenObjects;
+            }
+            break;
+        case State::AfterArray:
+            if (!isJsonWhitespace(c)) {
+                fail("Unexpected data after JSON array");
+            }
+            break;
+        case State::Error:
+            break;
+        }
+    }
+
+    // Keep the unfinished object for the next chunk
+    if (m_state == State::InObject && objectStart >= 0) {
+        m_object.append(data.constData() + objectStart, data.size() - objectStart);
+    }
+    return objects;
+}
+
+/**
+ * @brief Sprawdza, czy odebrano zamykający nawias tablicy.
+ *
+ * @return true, jeśli tablica jest kompletna.
+ */
+bool JsonStreamParser::isComplete() const {
+    return m_state == State::AfterArray;
+}
+
+/**
+ * @brief Sprawdza, czy treść nie jest poprawną tablicą JSON obiektów.
+ *
+ * @return true, jeśli wystąpił błąd.
+ */
+bool JsonStreamParser::hasError() const {
+    return m_state == State::Error;
+}
+
+/**
+ * @brief Zwraca opis błędu.
+ *
+ * @return Opis błędu lub pusty łańcuch.
+ */
+QString JsonStreamParser::errorString() const {
+    return m_error;
+}
+
+/**
+ * @brief Zwraca liczbę przetworzonych bajtów.
+ *
+ * @return Liczba bajtów.
+ */
+qint64 JsonStreamParser::bytesRead() const {
+    return m_bytesRead;
+}
+
+/**
+ * @brief Zwraca liczbę odebranych obiektów.
+ *
+ * @return Liczba obiektów.
+ */
+int JsonStreamParser::objectCount() const {
+    return m_objectCount;
+}
+
+/**
+ * @brief Przechodzi w stan błędu.
+ *
+ * @param message Opis błędu.
+ */
+void JsonStreamParser::fail(const QString &message) {
+    m_state = State::Error;
+    m_error = message;
+    m_object.clear();
+}
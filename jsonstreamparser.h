@@ -0,0 +1,128 @@
+#ifndef JSONSTREAMPARSER_H
+#define JSONSTREAMPARSER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+/**
+ * @class JsonStreamParser
+ * @brief Przyrostowy parser tablicy JSON obiektów odbieranej w częściach.
+ *
+ * Parser dostaje kolejne fragmenty treści (np. z sygnału readyRead) i zwraca
+ * obiekty tablicy, gdy tylko zostaną odebrane w całości. W pamięci przechowywany
+ * jest tylko fragment bieżącego obiektu, a nie cała treść. Granice obiektów są
+ * wyznaczane na poziomie bajtów (nawiasy poza łańcuchami), więc fragment może się
+ * kończyć w dowolnym miejscu, także wewnątrz znaku UTF-8.
+ */
+class JsonStreamParser
+{
+public:
+    /**
+     * @brief Konstruktor klasy JsonStreamParser.
+     */
+    JsonStreamParser();
+
+    /**
+     * @brief Przywraca stan początkowy (przed nową treścią).
+     */
+    void reset();
+
+    /**
+     * @brief Przetwarza kolejny fragment treści.
+     * @param data Fragment treści.
+     * @return Obiekty tablicy odebrane w całości w tym fragmencie.
+     */
+    QList<QJsonObject> feed(const QByteArray &data);
+
+    /**
+     * @brief Sprawdza, czy odebrano zamykający nawias tablicy.
+     * @return true, jeśli tablica jest kompletna.
+     */
+    bool isComplete() const;
+
+    /**
+     * @brief Sprawdza, czy treść nie jest poprawną tablicą JSON obiektów.
+     * @return true, jeśli wystąpił błąd.
+     */
+    bool hasError() const;
+
+    /**
+     * @brief Zwraca opis błędu.
+     * @return Opis błędu lub pusty łańcuch.
+     */
+    QString errorString() const;
+
+    /**
+     * @brief Zwraca liczbę przetworzonych bajtów.
+     * @return Liczba bajtów.
+     */
+    qint64 bytesRead() const;
+
+    /**
+     * @brief Zwraca liczbę odebranych obiektów.
+     * @return Liczba obiektów.
+     */
+    int objectCount() const;
+
+private:
+    /**
+     * @brief Stan parsera.
+     */
+    enum class State {
+        BeforeArray,     ///< Przed nawiasem otwierającym tablicę.
+        BetweenObjects,  ///< Między obiektami tablicy.
+        InObject,        ///< Wewnątrz obiektu.
+        AfterArray,      ///< Po nawiasie zamykającym tablicę.
+        Error            ///< Treść nie jest tablicą JSON obiektów.
+    };
+
+    /**
+     * @brief Przechodzi w stan błędu.
+     * @param message Opis błędu.
+     */
+    void fail(const QString &message);
+
+    /**
+     * @brief Bieżący stan.
+     */
+    State m_state;
+
+    /**
+     * @brief Odebrany fragment bieżącego obiektu.
+     */
+    QByteArray m_object;
+
+    /**
+     * @brief Głębokość zagnieżdżenia nawiasów w bieżącym obiekcie.
+     */
+    int m_depth;
+
+    /**
+     * @brief Czy bieżący bajt leży wewnątrz łańcucha.
+     */
+    bool m_inString;
+
+    /**
+     * @brief Czy poprzedni bajt łańcucha był znakiem ucieczki.
+     */
+    bool m_escape;
+
+    /**
+     * @brief Liczba przetworzonych bajtów.
+     */
+    qint64 m_bytesRead;
+
+    /**
+     * @brief Liczba odebranych obiektów.
+     */
+    int m_objectCount;
+
+    /**
+     * @brief Opis błędu.
+     */
+    QString m_error;
+};
+
+#endif // JSONSTREAMPARSER_H
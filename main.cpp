@@ -1,9 +1,43 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include "historybenchmark.h"
+#include "historymanager.h"
 #include "mainwindow.h"
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
 
+    // Opcja --convert-history przepisuje historię do formatu z history.ini bez uruchamiania okna
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption convertHistoryOption("convert-history", "Przepisuje zapisane sesje do formatu ustawionego w history/history.ini.");
+    parser.addOption(convertHistoryOption);
+    // Opcja --benchmark-session-filter mierzy odrzucanie sesji przez filtry na syntetycznej historii
+    QCommandLineOption benchmarkOption("benchmark-session-filter",
+                                       "Mierzy skuteczność filtrów sesji na syntetycznej historii o podanej liczbie sesji.",
+                                       "sesje", "10000");
+    parser.addOption(benchmarkOption);
+    parser.process(app);
+
+    if (parser.isSet(benchmarkOption)) {
+        QTextStream out(stdout);
+        return HistoryBenchmark::runSessionFilter(qMax(1, parser.value(benchmarkOption).toInt()), 30, out);
+    }
+
+    if (parser.isSet(convertHistoryOption)) {
+        HistoryManager historyManager(HistoryManager::defaultStoragePath());
+        int converted = historyManager.convertSessionFormat();
+        QTextStream out(stdout);
+        if (converted < 0) {
+            out << "History conversion failed\n";
+            return 1;
+        }
+        out << "Converted " << converted << " history entries to "
+            << SessionCodec::formatName(historyManager.sessionFormat()) << "\n";
+        return 0;
+    }
+
     // Utworzenie instancji MainWindow
     MainWindow mainWindow;
     mainWindow.show();
@@ -1,6 +1,9 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "window_2_data_vis.h"
+#include "apicache.h"
+#include "connectivitymonitor.h"
+#include "ratelimiter.h"
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -9,16 +12,18 @@
 #include <QUrlQuery>
 #include <QDebug>
 #include <cmath>
-#include <QTimer>
-#include <QEventLoop>
-#include <QInputDialog>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QLineEdit>
+#include <QListWidget>
 #include <stdexcept>
 
 /**
  * @brief Konstruktor klasy MainWindow.
  *
- * Inicjalizuje interfejs użytkownika, menedżera sieciowego, menedżera historii
- * i konfiguruje połączenia sygnałów i slotów.
+ * Inicjalizuje interfejs użytkownika, menedżera sieciowego (z pamięcią podręczną
+ * odpowiedzi ApiCache; żądania są wysyłane przez RateLimiter), menedżera historii i konfiguruje połączenia sygnałów i slotów.
+ * Pamięć współrzędnych jest uzupełniana w tle lokalizacjami z historii sesji.
  *
  * @param parent Wskaźnik na widget nadrzędny.
  */
@@ -31,115 +36,81 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent),
     m_locationLat(0.0),
     m_locationLon(0.0),
     m_searchRadius(-1.0),
-    m_waitingForGeocode(false),
     m_allStations(),
     ui(new Ui::MainWindow)
 {
-    m_historyManager = new HistoryManager(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/history");
+    m_historyManager = new HistoryManager(HistoryManager::defaultStoragePath());
     m_currentSessionId = "";
     ui->setupUi(this);
-    connect(m_networkManager, &QNetworkAccessManager::finished, this, [this](QNetworkReply *reply) {
-        if (m_waitingForGeocode) {
-            onGeocodeReply(reply);
-        } else {
-            onNetworkReply(reply);
-        }
-    });
+    ApiCache::install(m_networkManager);
+    ConnectivityMonitor::instance()->watch(m_networkManager);
     connect(ui->pushButton_szukaj, &QPushButton::clicked, this, &MainWindow::onSearchButtonClicked);
     connect(ui->stationList, &QListWidget::itemClicked, this, &MainWindow::onStationItemClicked);
     connect(ui->pushButton_history, &QPushButton::clicked, this, &MainWindow::onHistoryButtonClicked);
     ui->lineEdit_street_town->setPlaceholderText("ulica numer, Miasto lub Miasto");
     ui->statusLabel->setText(m_status);
+    m_geocodeCache.warmFrom(m_historyManager, this);
 }
 
 /**
  * @brief Destruktor klasy MainWindow.
  *
  * Zwalnia zasoby, takie jak interfejs użytkownika, menedżer sieciowy i menedżer historii.
+ * Okna wizualizacji są usuwane, a odczyt historii dla pamięci współrzędnych kończony,
+ * przed usunięciem menedżera historii, ponieważ zadania w tle korzystają z niego do zakończenia.
  */
 MainWindow::~MainWindow() {
+    qDeleteAll(findChildren<window_2_data_vis *>(Qt::FindDirectChildrenOnly));
+    m_geocodeCache.waitForWarmup();
     delete ui;
     delete m_networkManager;
     delete m_historyManager;
 }
 
-/**
- * @brief Sprawdza połączenie z internetem.
- *
- * Wykonuje żądania HEAD do znanych punktów końcowych, aby zweryfikować dostępność internetu.
- *
- * @return true, jeśli połączenie istnieje; false w przeciwnym razie.
- */
-bool MainWindow::checkInternetConnection() {
-    const QStringList endpoints = {"https://www.google.com", "https://cloudflare.com"};
-    bool isConnected = false;
-
-    // Temporarily disconnect the global finished signal to prevent HEAD replies from hitting onNetworkReply
-    disconnect(m_networkManager, &QNetworkAccessManager::finished, nullptr, nullptr);
-
-    for (const QString& endpoint : endpoints) {
-        QEventLoop loop;
-        QTimer timer;
-        timer.setSingleShot(true);
-        QNetworkReply *reply = nullptr;
-
-        QUrl url(endpoint);
-        QNetworkRequest request(url);
-        request.setHeader(QNetworkRequest::UserAgentHeader, "AirQualityApp/1.0");
-
-        reply = m_networkManager->head(request);
-        qDebug() << "Checking connectivity with HEAD request to:" << endpoint;
-
-        QObject::connect(reply, &QNetworkReply::finished, &loop, [&]() {
-            if (reply->error() == QNetworkReply::NoError) {
-                isConnected = true;
-                qDebug() << "HEAD request to" << reply->url().toString() << "succeeded. Internet is connected.";
-            } else {
-                qDebug() << "HEAD request to" << reply->url().toString() << "failed:" << reply->errorString();
-            }
-            loop.quit();
-        });
-
-        QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-        timer.start(2000);
-        loop.exec();
-
-        reply->deleteLater();
-
-        if (isConnected) {
-            break;
-        }
-    }
-
-    // Reconnect the global finished signal
-    connect(m_networkManager, &QNetworkAccessManager::finished, this, [this](QNetworkReply *reply) {
-        if (m_waitingForGeocode) {
-            onGeocodeReply(reply);
-        } else {
-            onNetworkReply(reply);
-        }
-    });
-
-    return isConnected;
-}
-
 /**
  * @brief Pobiera listę wszystkich stacji z API.
  *
+ * Lista jest odczytywana w częściach w trakcie pobierania (onStationsReadyRead()).
  * Jeśli brak połączenia z internetem, wyświetla odpowiedni komunikat i przerywa operację.
  */
 void MainWindow::fetchStations() {
-    if (!checkInternetConnection()) {
+    if (!ConnectivityMonitor::instance()->isOnline()) {
         m_status = "Brak połączenia z internetem. Sprawdź połączenie\nlub skorzystaj z danych historycznych";
         ui->statusLabel->setText(m_status);
         qDebug() << "No internet connection. Aborting fetchStations.";
         return;
     }
 
+    if (m_inputLocation.contains(",")) {
+        QStringList inputParts = m_inputLocation.split(",", Qt::SkipEmptyParts);
+        m_searchCity = inputParts.size() >= 2 ? inputParts[1].trimmed() : "";
+    } else {
+        m_searchCity = m_inputLocation.trimmed();
+    }
+    if (m_searchCity.isEmpty()) {
+        m_status = "Błąd pobierania danych: Invalid location format";
+        ui->statusLabel->setText(m_status);
+        return;
+    }
+
+    // Replies of an earlier search that are still downloading are ignored from now on
+    m_stationsReply = nullptr;
+
     QUrl url("https://api.gios.gov.pl/pjp-api/rest/station/findAll");
     QNetworkRequest request(url);
     qDebug() << "Fetching stations from:" << url.toString();
-    m_networkManager->get(request);
+    RateLimiter::instance()->get(m_networkManager, request, SEARCH_PRIORITY, this, [this](QNetworkReply *reply) {
+        onNetworkReply(reply);
+    }, [this](QNetworkReply *reply) {
+        // Each attempt, including retries, starts the list from scratch
+        m_stationsReply = reply;
+        m_stationParser.reset();
+        m_allStations.clear();
+        m_stations.clear();
+        connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+            onStationsReadyRead(reply);
+        });
+    });
 }
 
 /**
@@ -156,7 +127,7 @@ void MainWindow::onSearchButtonClicked() {
         return;
     }
 
-    if (!checkInternetConnection()) {
+    if (!ConnectivityMonitor::instance()->isOnline()) {
         m_status = "Brak połączenia z internetem. Sprawdź połączenie i spróbuj ponownie\nlub skorzystaj z danych historycznych";
         ui->statusLabel->setText(m_status);
         qDebug() << "No internet connection. Aborting search.";
@@ -191,12 +162,27 @@ void MainWindow::onSearchButtonClicked() {
 /**
  * @brief Pobiera współrzędne geograficzne dla lokalizacji.
  *
- * Wysyła żądanie do API Nominatim w celu uzyskania współrzędnych geograficznych.
+ * Najpierw sprawdza pamięć podręczną GeocodeCache; przy trafieniu od razu pobiera
+ * stacje, bez żądania sieciowego. W przeciwnym razie wysyła żądanie do API Nominatim
+ * w celu uzyskania współrzędnych geograficznych.
+ * RateLimiter wysyła najwyżej jedno żądanie na sekundę, zgodnie z zasadami Nominatim.
  *
  * @param location Nazwa lokalizacji.
  */
 void MainWindow::getLocationCoordinates(const QString &location) {
-    if (!checkInternetConnection()) {
+    double latitude = 0.0;
+    double longitude = 0.0;
+    if (m_geocodeCache.lookup(location, &latitude, &longitude)) {
+        m_locationLat = latitude;
+        m_locationLon = longitude;
+        qDebug() << "Geocode cache hit - Lat:" << m_locationLat << "Lon:" << m_locationLon;
+        m_status = "Znaleziono współrzędne dla: " + m_inputLocation;
+        ui->statusLabel->setText(m_status);
+        fetchStations();
+        return;
+    }
+
+    if (!ConnectivityMonitor::instance()->isOnline()) {
         m_status = "Brak połączenia z internetem. Sprawdź połączenie\nlub skorzystaj z danych historycznych";
         ui->statusLabel->setText(m_status);
         qDebug() << "No internet connection. Proceeding without geocoding.";
@@ -217,8 +203,9 @@ void MainWindow::getLocationCoordinates(const QString &location) {
     request.setHeader(QNetworkRequest::UserAgentHeader, "AirQualityApp/1.0");
     qDebug() << "Geocoding URL:" << url.toString();
 
-    m_waitingForGeocode = true;
-    m_networkManager->get(request);
+    RateLimiter::instance()->get(m_networkManager, request, SEARCH_PRIORITY, this, [this](QNetworkReply *reply) {
+        onGeocodeReply(reply);
+    });
 }
 
 /**
@@ -247,13 +234,12 @@ double MainWindow::calculateDistance(double lat1, double lon1, double lat2, doub
 /**
  * @brief Obsługuje odpowiedź sieciową dla geokodowania.
  *
- * Przetwarza odpowiedź z API Nominatim, ustawia współrzędne i kontynuuje pobieranie stacji.
+ * Przetwarza odpowiedź z API Nominatim, ustawia współrzędne (zapamiętując je w GeocodeCache)
+ * i kontynuuje pobieranie stacji.
  *
  * @param reply Wskaźnik na odpowiedź sieciową.
  */
 void MainWindow::onGeocodeReply(QNetworkReply *reply) {
-    m_waitingForGeocode = false;
-
     try {
         if (reply->error() != QNetworkReply::NoError) {
             throw std::runtime_error("Network error: " + reply->errorString().toStdString());
@@ -303,6 +289,7 @@ void MainWindow::onGeocodeReply(QNetworkReply *reply) {
         }
 
         qDebug() << "Coordinates found - Lat:" << m_locationLat << "Lon:" << m_locationLon;
+        m_geocodeCache.insert(m_inputLocation, m_locationLat, m_locationLon);
         m_status = "Znaleziono współrzędne dla: " + m_inputLocation;
         ui->statusLabel->setText(m_status);
         fetchStations();
@@ -324,16 +311,14 @@ void MainWindow::onGeocodeReply(QNetworkReply *reply) {
 /**
  * @brief Obsługuje odpowiedź sieciową dla żądania stacji.
  *
- * Przetwarza dane stacji, filtruje je według lokalizacji i promienia, zapisuje sesję
- * i aktualizuje listę stacji w interfejsie.
+ * Przetwarza ostatni fragment listy stacji, sprawdza jej kompletność, filtruje stacje
+ * według lokalizacji i promienia, zapisuje sesję i aktualizuje listę stacji w interfejsie.
  *
  * @param reply Wskaźnik na odpowiedź sieciową.
  */
 void MainWindow::onNetworkReply(QNetworkReply *reply) {
-    // Only process replies from the station endpoint
-    QString replyUrl = reply->url().toString();
-    if (!replyUrl.contains("https://api.gios.gov.pl/pjp-api/rest/station/findAll")) {
-        qDebug() << "Ignoring non-station reply from:" << replyUrl;
+    if (reply != m_stationsReply) {
+        qDebug() << "Ignoring station reply of a superseded search";
         reply->deleteLater();
         return;
     }
@@ -343,73 +328,165 @@ void MainWindow::onNetworkReply(QNetworkReply *reply) {
             throw std::runtime_error("Network error: " + reply->errorString().toStdString());
         }
 
-        QByteArray responseData = reply->readAll();
-        if (responseData.isEmpty()) {
+        const QList<QJsonObject> stations = m_stationParser.feed(reply->readAll());
+        for (const QJsonObject &station : stations) {
+            m_allStations.append(stationRecord(station));
+        }
+        if (m_stationParser.bytesRead() == 0) {
             throw std::runtime_error("Empty response from server");
         }
 
-        qDebug() << "Stations response:" << responseData;
-        QJsonDocument doc = QJsonDocument::fromJson(responseData);
-        if (doc.isNull()) {
-            throw std::runtime_error("Failed to parse stations response as JSON");
+        qDebug() << "Stations response:" << m_stationParser.bytesRead() << "bytes," << m_stationParser.objectCount() << "stations";
+        if (m_stationParser.hasError()) {
+            throw std::runtime_error("Failed to parse stations response as JSON: " + m_stationParser.errorString().toStdString());
         }
-        if (!doc.isArray()) {
-            throw std::runtime_error("Stations response is not a JSON array");
+        if (!m_stationParser.isComplete()) {
+            throw std::runtime_error("Stations response is not a complete JSON array");
         }
 
-        QJsonArray stationsArray = doc.array();
-        m_stations.clear();
-        m_allStations.clear();
-        bool found = false;
+        filterStations();
 
-        QString city;
-        if (m_inputLocation.contains(",")) {
-            QStringList inputParts = m_inputLocation.split(",", Qt::SkipEmptyParts);
-            city = inputParts.size() >= 2 ? inputParts[1].trimmed() : "";
-        } else {
-            city = m_inputLocation.trimmed();
-        }
+        m_historyManager->addSession(m_currentSessionId, m_inputLocation, m_searchRadius, m_locationLat, m_locationLon, m_stations);
+        qDebug() << "Saved session with ID:" << m_currentSessionId << "for stations:" << m_stations.size();
 
-        if (city.isEmpty()) {
-            throw std::runtime_error("Invalid location format");
-        }
+        ui->statusLabel->setText(m_status);
+        updateStationList();
+    } catch (const std::runtime_error &e) {
+        m_status = QString("Błąd pobierania danych: %1").arg(e.what());
+        qDebug() << "Network reply exception:" << e.what();
+        ui->statusLabel->setText(m_status);
+    } catch (...) {
+        m_status = "Nieznany błąd podczas pobierania danych stacji.";
+        qDebug() << "Unknown exception in onNetworkReply";
+        ui->statusLabel->setText(m_status);
+    }
 
-        for (const QJsonValue &value : stationsArray) {
-            QJsonObject station = value.toObject();
-            QJsonObject cityObj = station["city"].toObject();
-            QString cityName = cityObj["name"].toString();
-            QVariantMap stationData;
-            stationData["stationId"] = station["id"].toInt();
-            stationData["stationName"] = station["stationName"].toString();
-            stationData["lat"] = station["gegrLat"].toString();
-            stationData["lon"] = station["gegrLon"].toString();
-            stationData["address"] = station["addressStreet"].toString();
-            stationData["cityName"] = cityName;
-            stationData["sessionId"] = m_currentSessionId;
-
-            if (m_locationLat != 0.0 && m_locationLon != 0.0) {
-                double lat = stationData["lat"].toString().toDouble();
-                double lon = stationData["lon"].toString().toDouble();
-                double distance = calculateDistance(m_locationLat, m_locationLon, lat, lon);
-                stationData["distance"] = distance;
-            } else {
-                stationData["distance"] = -1;
-            }
+    reply->deleteLater();
+}
 
-            m_allStations.append(stationData);
+/**
+ * @brief Przetwarza fragment listy stacji odebrany w trakcie pobierania.
+ *
+ * Stacje odebrane w całości są dołączane do listy wszystkich stacji i od razu
+ * filtrowane, więc pierwsze pasujące stacje pojawiają się przed końcem pobierania.
+ * Lista w interfejsie jest przebudowywana tylko wtedy, gdy wynik filtrowania się
+ * zmienił. Odpowiedzi inne niż 200 (np. przed ponowieniem) są pomijane.
+ *
+ * @param reply Wskaźnik na odpowiedź sieciową.
+ */
+void MainWindow::onStationsReadyRead(QNetworkReply *reply) {
+    if (reply != m_stationsReply || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        return;
+    }
 
-            if (cityName.toLower() == city.toLower()) {
-                found = true;
-                m_stations.append(stationData);
-            }
+    const QList<QJsonObject> stations = m_stationParser.feed(reply->readAll());
+    if (stations.isEmpty()) {
+        return;
+    }
+    for (const QJsonObject &station : stations) {
+        m_allStations.append(stationRecord(station));
+    }
+
+    const QVariantList previousStations = m_stations;
+    filterStations();
+    ui->statusLabel->setText(m_status + QString("\nPobieranie listy stacji... (%1)").arg(m_allStations.size()));
+    if (m_stations != previousStations) {
+        updateStationList();
+    }
+}
+
+/**
+ * @brief Tworzy rekord stacji z obiektu JSON API.
+ *
+ * @param station Obiekt JSON stacji.
+ * @return Dane stacji (z odległością od wyszukiwanej lokalizacji, jeśli jest znana).
+ */
+QVariantMap MainWindow::stationRecord(const QJsonObject &station) {
+    QVariantMap stationData;
+    stationData["stationId"] = station["id"].toInt();
+    stationData["stationName"] = station["stationName"].toString();
+    stationData["lat"] = station["gegrLat"].toString();
+    stationData["lon"] = station["gegrLon"].toString();
+    stationData["address"] = station["addressStreet"].toString();
+    stationData["cityName"] = station["city"].toObject()["name"].toString();
+    stationData["sessionId"] = m_currentSessionId;
+
+    if (m_locationLat != 0.0 && m_locationLon != 0.0) {
+        double lat = stationData["lat"].toString().toDouble();
+        double lon = stationData["lon"].toString().toDouble();
+        stationData["distance"] = calculateDistance(m_locationLat, m_locationLon, lat, lon);
+    } else {
+        stationData["distance"] = -1;
+    }
+    return stationData;
+}
+
+/**
+ * @brief Wybiera stacje z odebranej części listy według miasta lub promienia.
+ *
+ * Jeśli są stacje w wyszukiwanym mieście, wybierane są one (posortowane według
+ * odległości). W przeciwnym razie wybierane są stacje w zadanym promieniu lub
+ * najbliższa stacja. Wywoływana dla każdego fragmentu listy, więc wynik może się
+ * zmieniać, dopóki lista nie zostanie pobrana w całości.
+ */
+void MainWindow::filterStations() {
+    m_stations.clear();
+    bool found = false;
+    const QString &city = m_searchCity;
+    for (const QVariant &station : m_allStations) {
+        if (station.toMap()["cityName"].toString().toLower() == city.toLower()) {
+            found = true;
+            m_stations.append(station);
         }
+    }
 
-        if (found) {
-            m_status = "Znaleziono stacje w: " + city;
-            if (m_locationLat != 0.0 && m_locationLon != 0.0) {
-                QVariantList sortedStations;
+    if (found) {
+        m_status = "Znaleziono stacje w: " + city;
+        if (m_locationLat != 0.0 && m_locationLon != 0.0) {
+            QVariantList sortedStations;
+            QList<QPair<double, QVariantMap>> stationsWithDistance;
+            for (const QVariant &station : m_stations) {
+                QVariantMap stationData = station.toMap();
+                double distance = stationData["distance"].toDouble();
+                stationsWithDistance.append(qMakePair(distance, stationData));
+            }
+            std::sort(stationsWithDistance.begin(), stationsWithDistance.end(),
+                      [](const QPair<double, QVariantMap> &a, const QPair<double, QVariantMap> &b) {
+                          return a.first < b.first;
+                      });
+            for (const auto &pair : stationsWithDistance) {
+                sortedStations.append(pair.second);
+            }
+            m_stations = sortedStations;
+        }
+    } else {
+        m_status = "Nie znaleziono stacji w: " + city;
+        if (m_locationLat != 0.0 && m_locationLon != 0.0) {
+            QVariantList nearbyStations;
+            QStringList nearbyCities;
+            for (const QVariant &station : m_allStations) {
+                QVariantMap stationData = station.toMap();
+                double distance = stationData["distance"].toDouble();
+                if (m_searchRadius > 0) {
+                    if (distance <= m_searchRadius) {
+                        nearbyStations.append(stationData);
+                        QString cityName = stationData["cityName"].toString();
+                        if (!nearbyCities.contains(cityName)) {
+                            nearbyCities.append(cityName);
+                        }
+                    }
+                } else {
+                    if (nearbyStations.isEmpty() || distance < nearbyStations[0].toMap()["distance"].toDouble()) {
+                        nearbyStations.clear();
+                        nearbyStations.append(stationData);
+                        nearbyCities.clear();
+                        nearbyCities.append(stationData["cityName"].toString());
+                    }
+                }
+            }
+            if (!nearbyStations.isEmpty()) {
                 QList<QPair<double, QVariantMap>> stationsWithDistance;
-                for (const QVariant &station : m_stations) {
+                for (const QVariant &station : nearbyStations) {
                     QVariantMap stationData = station.toMap();
                     double distance = stationData["distance"].toDouble();
                     stationsWithDistance.append(qMakePair(distance, stationData));
@@ -418,75 +495,17 @@ void MainWindow::onNetworkReply(QNetworkReply *reply) {
                           [](const QPair<double, QVariantMap> &a, const QPair<double, QVariantMap> &b) {
                               return a.first < b.first;
                           });
+                nearbyStations.clear();
                 for (const auto &pair : stationsWithDistance) {
-                    sortedStations.append(pair.second);
-                }
-                m_stations = sortedStations;
-            }
-        } else {
-            m_status = "Nie znaleziono stacji w: " + city;
-            if (m_locationLat != 0.0 && m_locationLon != 0.0) {
-                QVariantList nearbyStations;
-                QStringList nearbyCities;
-                for (const QVariant &station : m_allStations) {
-                    QVariantMap stationData = station.toMap();
-                    double distance = stationData["distance"].toDouble();
-                    if (m_searchRadius > 0) {
-                        if (distance <= m_searchRadius) {
-                            nearbyStations.append(stationData);
-                            QString cityName = stationData["cityName"].toString();
-                            if (!nearbyCities.contains(cityName)) {
-                                nearbyCities.append(cityName);
-                            }
-                        }
-                    } else {
-                        if (nearbyStations.isEmpty() || distance < nearbyStations[0].toMap()["distance"].toDouble()) {
-                            nearbyStations.clear();
-                            nearbyStations.append(stationData);
-                            nearbyCities.clear();
-                            nearbyCities.append(stationData["cityName"].toString());
-                        }
-                    }
-                }
-                if (!nearbyStations.isEmpty()) {
-                    QList<QPair<double, QVariantMap>> stationsWithDistance;
-                    for (const QVariant &station : nearbyStations) {
-                        QVariantMap stationData = station.toMap();
-                        double distance = stationData["distance"].toDouble();
-                        stationsWithDistance.append(qMakePair(distance, stationData));
-                    }
-                    std::sort(stationsWithDistance.begin(), stationsWithDistance.end(),
-                              [](const QPair<double, QVariantMap> &a, const QPair<double, QVariantMap> &b) {
-                                  return a.first < b.first;
-                              });
-                    nearbyStations.clear();
-                    for (const auto &pair : stationsWithDistance) {
-                        nearbyStations.append(pair.second);
-                    }
-                    m_stations = nearbyStations;
-                    m_status += "\nZnaleziono stacje w pobliżu: " + nearbyCities.join(", ");
-                } else {
-                    m_status += "\nBrak stacji w zadanym promieniu.";
+                    nearbyStations.append(pair.second);
                 }
+                m_stations = nearbyStations;
+                m_status += "\nZnaleziono stacje w pobliżu: " + nearbyCities.join(", ");
+            } else {
+                m_status += "\nBrak stacji w zadanym promieniu.";
             }
         }
-
-        m_historyManager->addSession(m_currentSessionId, m_inputLocation, m_searchRadius, m_locationLat, m_locationLon, m_stations);
-        qDebug() << "Saved session with ID:" << m_currentSessionId << "for stations:" << m_stations.size();
-
-        ui->statusLabel->setText(m_status);
-        updateStationList();
-    } catch (const std::runtime_error &e) {
-        m_status = QString("Błąd pobierania danych: %1").arg(e.what());
-        qDebug() << "Network reply exception:" << e.what();
-        ui->statusLabel->setText(m_status);
-    } catch (...) {
-        m_status = "Nieznany błąd podczas pobierania danych stacji.";
-        qDebug() << "Unknown exception in onNetworkReply";
-        ui->statusLabel->setText(m_status);
     }
-
-    reply->deleteLater();
 }
 
 /**
@@ -561,24 +580,31 @@ void MainWindow::onStationItemClicked(QListWidgetItem *item) {
 }
 
 /**
- * @brief Obsługuje kliknięcie przycisku historii.
+ * @brief Wyświetla przeglądarkę historii z filtrem i podsumowaniami sesji.
  *
- * Wyświetla listę zapisanych sesji i pozwala użytkownikowi wybrać jedną do wczytania.
+ * Lista jest budowana wyłącznie z wpisów indeksu i zapisanych w nich podsumowań
+ * (liczba stacji i sensorów, zakres dat, statystyki pomiarów), bez otwierania
+ * plików sesji. Filtr przeszukuje opis sesji i nazwy parametrów jej sensorów.
+ *
+ * @param sessions Wpisy indeksu sesji (z polem summary, jeśli jest znane).
+ * @return Identyfikator wybranej sesji lub pusty ciąg, jeśli nie wybrano sesji.
  */
-void MainWindow::onHistoryButtonClicked() {
-    QVariantList sessions = m_historyManager->loadSessions();
-    if (sessions.isEmpty()) {
-        m_status = "Brak zapisanych sesji w historii.";
-        ui->statusLabel->setText(m_status);
-        qDebug() << "No sessions found in history.";
-        return;
-    }
+QString MainWindow::selectHistorySession(const QVariantList &sessions) {
+    QDialog dialog(this);
+    dialog.setWindowTitle("Wybierz sesję");
+    dialog.resize(520, 420);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel("Wybierz sesję z historii:", &dialog));
+    QLineEdit *filterEdit = new QLineEdit(&dialog);
+    filterEdit->setPlaceholderText("Filtruj (lokalizacja, data, parametr)...");
+    layout->addWidget(filterEdit);
+    QListWidget *sessionList = new QListWidget(&dialog);
+    layout->addWidget(sessionList);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    layout->addWidget(buttons);
 
-    QStringList sessionDescriptions;
-    QMap<QString, QString> sessionIdToDescription;
     for (const QVariant &session : sessions) {
         QVariantMap sessionData = session.toMap();
-        QString sessionId = sessionData["session_id"].toString();
         QString location = sessionData["location"].toString();
         QString timestamp = sessionData["timestamp"].toString();
         double radius = sessionData["radius"].toDouble();
@@ -588,23 +614,86 @@ void MainWindow::onHistoryButtonClicked() {
         } else {
             description += ")";
         }
-        sessionDescriptions.append(description);
-        sessionIdToDescription[description] = sessionId;
+
+        QStringList details;
+        if (sessionData.contains("summary")) {
+            QVariantMap summary = sessionData["summary"].toMap();
+            QVariantList sensors = summary["sensors"].toList();
+            QString line = QString("Stacje: %1, sensory: %2").arg(summary["stations"].toInt()).arg(sensors.size());
+            if (summary.contains("from")) {
+                line += QString(", pomiary: %1 – %2").arg(SeriesStore::fromEpochSeconds(summary["from"].toLongLong()).left(10),
+                                                          SeriesStore::fromEpochSeconds(summary["to"].toLongLong()).left(10));
+            }
+            description += "\n" + line;
+            for (const QVariant &sensorVariant : sensors) {
+                QVariantMap sensor = sensorVariant.toMap();
+                QString param = m_historyManager->catalogSensor(sensor["id"].toInt())["param"].toMap()["paramName"].toString();
+                if (param.isEmpty()) {
+                    param = QString("Sensor %1").arg(sensor["id"].toInt());
+                }
+                if (sensor.contains("mean")) {
+                    details.append(QString("%1: min %2, max %3, średnia %4 (%5 pomiarów)")
+                                       .arg(param)
+                                       .arg(sensor["min"].toDouble(), 0, 'f', 1)
+                                       .arg(sensor["max"].toDouble(), 0, 'f', 1)
+                                       .arg(sensor["mean"].toDouble(), 0, 'f', 1)
+                                       .arg(sensor["count"].toLongLong()));
+                } else {
+                    details.append(QString("%1: brak pomiarów").arg(param));
+                }
+            }
+        }
+
+        QListWidgetItem *item = new QListWidgetItem(description, sessionList);
+        item->setData(Qt::UserRole, sessionData["session_id"].toString());
+        if (!details.isEmpty()) {
+            item->setToolTip(details.join("\n"));
+        }
     }
+    sessionList->setCurrentRow(0);
+
+    connect(filterEdit, &QLineEdit::textChanged, &dialog, [sessionList](const QString &text) {
+        for (int i = 0; i < sessionList->count(); ++i) {
+            QListWidgetItem *item = sessionList->item(i);
+            bool matches = item->text().contains(text, Qt::CaseInsensitive)
+                           || item->toolTip().contains(text, Qt::CaseInsensitive);
+            item->setHidden(!matches);
+        }
+    });
+    connect(sessionList, &QListWidget::itemDoubleClicked, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
 
-    bool ok;
-    QString selectedDescription = QInputDialog::getItem(this, "Wybierz sesję",
-                                                        "Wybierz sesję z historii:", sessionDescriptions,
-                                                        0, false, &ok);
-    if (!ok || selectedDescription.isEmpty()) {
+    if (dialog.exec() != QDialog::Accepted || !sessionList->currentItem() || sessionList->currentItem()->isHidden()) {
+        return QString();
+    }
+    return sessionList->currentItem()->data(Qt::UserRole).toString();
+}
+
+/**
+ * @brief Obsługuje kliknięcie przycisku historii.
+ *
+ * Wyświetla listę zapisanych sesji i pozwala użytkownikowi wybrać jedną do wczytania.
+ */
+void MainWindow::onHistoryButtonClicked() {
+    QVariantList sessions = m_historyManager->loadSessions();
+    if (sessions.isEmpty()) {
+        m_status = "Brak zapisanych sesji w historii.";
+        ui->statusLabel->setText(m_status);
+        qDebug() << "No sessions found in history.";
+        return;
+    }
+
+    QString selectedSessionId = selectHistorySession(sessions);
+    if (selectedSessionId.isEmpty()) {
         m_status = "Nie wybrano sesji.";
         ui->statusLabel->setText(m_status);
         qDebug() << "No session selected from history.";
         return;
     }
 
-    QString selectedSessionId = sessionIdToDescription[selectedDescription];
-    QVariantMap sessionDetails = m_historyManager->loadSessionDetails(selectedSessionId);
+    // Sensors are not needed here; they are loaded per station by the visualization window
+    QVariantMap sessionDetails = m_historyManager->loadSessionFields(selectedSessionId, {"stations", "location", "radius"});
     if (sessionDetails.isEmpty()) {
         m_status = "Nie udało się załadować szczegółów sesji.";
         ui->statusLabel->setText(m_status);
@@ -5,8 +5,11 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QListWidgetItem>
+#include <QPointer>
 #include <QStandardPaths>
+#include "geocodecache.h"
 #include "historymanager.h"
+#include "jsonstreamparser.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -66,16 +69,35 @@ private slots:
 
 private:
     /**
-     * @brief Sprawdza połączenie z internetem.
-     * @return true, jeśli połączenie istnieje; false w przeciwnym razie.
+     * @brief Wyświetla przeglądarkę historii z filtrem i podsumowaniami sesji.
+     * @param sessions Wpisy indeksu sesji (z polem summary, jeśli jest znane).
+     * @return Identyfikator wybranej sesji lub pusty ciąg, jeśli nie wybrano sesji.
      */
-    bool checkInternetConnection();
+    QString selectHistorySession(const QVariantList &sessions);
 
     /**
      * @brief Pobiera listę wszystkich stacji z API.
      */
     void fetchStations();
 
+    /**
+     * @brief Przetwarza fragment listy stacji odebrany w trakcie pobierania.
+     * @param reply Wskaźnik na odpowiedź sieciową.
+     */
+    void onStationsReadyRead(QNetworkReply *reply);
+
+    /**
+     * @brief Tworzy rekord stacji z obiektu JSON API.
+     * @param station Obiekt JSON stacji.
+     * @return Dane stacji (z odległością od wyszukiwanej lokalizacji, jeśli jest znana).
+     */
+    QVariantMap stationRecord(const QJsonObject &station);
+
+    /**
+     * @brief Wybiera stacje z odebranej części listy według miasta lub promienia.
+     */
+    void filterStations();
+
     /**
      * @brief Pobiera współrzędne geograficzne dla podanej lokalizacji.
      * @param location Nazwa lokalizacji (np. miasto lub adres).
@@ -143,20 +165,40 @@ private:
     double m_searchRadius;
 
     /**
-     * @brief Flaga wskazująca, czy oczekiwana jest odpowiedź geokodowania.
+     * @brief Priorytet żądań wyszukiwania w kolejce RateLimiter (wyższy niż pobieranie pomiarów w tle).
      */
-    bool m_waitingForGeocode;
+    static const int SEARCH_PRIORITY = 2;
 
     /**
      * @brief Lista wszystkich stacji (przed filtrowaniem).
      */
     QVariantList m_allStations;
 
+    /**
+     * @brief Miasto wyszukiwane na liście stacji.
+     */
+    QString m_searchCity;
+
+    /**
+     * @brief Odpowiedź z listą stacji dla bieżącego wyszukiwania.
+     */
+    QPointer<QNetworkReply> m_stationsReply;
+
+    /**
+     * @brief Parser listy stacji odbieranej w częściach.
+     */
+    JsonStreamParser m_stationParser;
+
     /**
      * @brief Wskaźnik na menedżera historii sesji.
      */
     HistoryManager *m_historyManager;
 
+    /**
+     * @brief Pamięć podręczna współrzędnych lokalizacji (sprawdzana przed zapytaniem do Nominatim).
+     */
+    GeocodeCache m_geocodeCache;
+
     /**
      * @brief Identyfikator bieżącej sesji.
      */
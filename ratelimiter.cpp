@@ -0,0 +1,239 @@
+#include "ratelimiter.h"
+#include <QCoreApplication>
+#include <QRandomGenerator>
+#include <QDebug>
+#include <cmath>
+
+namespace {
+
+/**
+ * @brief Limit liczby żądań do hosta.
+ */
+struct HostRate {
+    const char *host;          ///< Nazwa hosta.
+    double requestsPerSecond;  ///< Liczba żądań na sekundę w dłuższym okresie.
+    int burst;                 ///< Liczba żądań, które można wysłać naraz.
+};
+
+// Nominatim's usage policy allows at most one request per second; GIOŚ throttles bulk clients
+const HostRate HOST_RATES[] = {
+    {"api.gios.gov.pl", 2.0, 5},
+    {"nominatim.openstreetmap.org", 1.0, 1},
+};
+
+} // namespace
+
+/**
+ * @brief Zwraca wspólny ogranicznik, tworząc go przy pierwszym użyciu.
+ *
+ * @return Ogranicznik należący do obiektu aplikacji.
+ */
+RateLimiter *RateLimiter::instance() {
+    static RateLimiter *limiter = new RateLimiter(QCoreApplication::instance());
+    return limiter;
+}
+
+/**
+ * @brief Konstruktor klasy RateLimiter.
+ *
+ * @param parent Wskaźnik na obiekt nadrzędny.
+ */
+RateLimiter::RateLimiter(QObject *parent)
+    : QObject(parent) {
+    m_clock.start();
+    m_dispatchTimer.setSingleShot(true);
+    connect(&m_dispatchTimer, &QTimer::timeout, this, &RateLimiter::dispatch);
+}
+
+/**
+ * @brief Dodaje żądanie GET do kolejki hosta.
+ *
+ * @param manager Menedżer sieciowy wysyłający żądanie.
+ * @param request Żądanie GET.
+ * @param priority Priorytet (większy jest wysyłany wcześniej).
+ * @param receiver Obiekt oczekujący; po jego usunięciu żądanie nie jest wysyłane ani ponawiane.
+ * @param callback Funkcja wywoływana z ostateczną odpowiedzią.
+ * @param started Funkcja wywoływana z każdą wysłaną odpowiedzią, także ponowieniem (np. do odczytu
+ *        treści w trakcie pobierania; nie przejmuje odpowiedzi na własność).
+ */
+void RateLimiter::get(QNetworkAccessManager *manager, const QNetworkRequest &request, int priority, QObject *receiver, Callback callback,
+                      Callback started) {
+    enqueue(Pending{manager, request, priority, receiver, std::move(callback), std::move(started), 0});
+}
+
+/**
+ * @brief Podnosi priorytet żądań czekających w kolejce.
+ *
+ * @param url Adres żądania.
+ * @param priority Nowy priorytet (niższy od obecnego jest pomijany).
+ */
+void RateLimiter::boost(const QUrl &url, int priority) {
+    Bucket *bucket = bucketFor(url.host());
+    if (!bucket) {
+        return;
+    }
+    for (Pending &pending : bucket->queue) {
+        if (pending.request.url() == url) {
+            pending.priority = qMax(pending.priority, priority);
+        }
+    }
+}
+
+/**
+ * @brief Zwraca wiadro hosta, tworząc je przy pierwszym użyciu.
+ *
+ * Nowe wiadro jest pełne.
+ *
+ * @param host Nazwa hosta.
+ * @return Wiadro hosta lub nullptr, jeśli host nie ma limitu.
+ */
+RateLimiter::Bucket *RateLimiter::bucketFor(const QString &host) {
+    auto it = m_buckets.find(host);
+    if (it != m_buckets.end()) {
+        return &it.value();
+    }
+    for (const HostRate &rate : HOST_RATES) {
+        if (host == QLatin1String(rate.host)) {
+            Bucket bucket{rate.requestsPerSecond, double(rate.burst), double(rate.burst), m_clock.elapsed(), {}};
+            return &m_buckets.insert(host, bucket).value();
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Dodaje żądanie do kolejki hosta lub wysyła je od razu, jeśli host nie ma limitu.
+ *
+ * @param pending Żądanie.
+ */
+void RateLimiter::enqueue(const Pending &pending) {
+    Bucket *bucket = bucketFor(pending.request.url().host());
+    if (!bucket) {
+        send(pending);
+        return;
+    }
+    bucket->queue.append(pending);
+    dispatch();
+}
+
+/**
+ * @brief Wysyła żądania, dla których są żetony, i planuje kolejne wywołanie.
+ *
+ * Żądania, których obiekt oczekujący lub menedżer sieciowy zostały usunięte, są
+ * pomijane bez zużycia żetonu. Jeśli w kolejce zostały żądania, zegar jest ustawiany
+ * na chwilę przybycia najbliższego żetonu.
+ */
+void RateLimiter::dispatch() {
+    const qint64 now = m_clock.elapsed();
+    qint64 nextTokenMs = -1;
+    for (auto it = m_buckets.begin(); it != m_buckets.end(); ++it) {
+        Bucket &bucket = it.value();
+        bucket.tokens = qMin(bucket.capacity, bucket.tokens + (now - bucket.refilledAt) * bucket.rate / 1000.0);
+        bucket.refilledAt = now;
+
+        while (!bucket.queue.isEmpty() && bucket.tokens >= 1.0) {
+            qsizetype next = 0;
+            for (qsizetype i = 1; i < bucket.queue.size(); ++i) {
+                if (bucket.queue[i].priority > bucket.queue[next].priority) {
+                    next = i;
+                }
+            }
+            Pending pending = bucket.queue.takeAt(next);
+            if (!pending.receiver || !pending.manager) {
+                continue;
+            }
+            bucket.tokens -= 1.0;
+            send(pending);
+        }
+
+        if (!bucket.queue.isEmpty()) {
+            qint64 waitMs = qint64(std::ceil((1.0 - bucket.tokens) * 1000.0 / bucket.rate));
+            nextTokenMs = nextTokenMs < 0 ? waitMs : qMin(nextTokenMs, waitMs);
+        }
+    }
+    if (nextTokenMs >= 0) {
+        m_dispatchTimer.start(int(qMax<qint64>(1, nextTokenMs)));
+    }
+}
+
+/**
+ * @brief Wysyła żądanie.
+ *
+ * @param pending Żądanie.
+ */
+void RateLimiter::send(const Pending &pending) {
+    if (!pending.receiver || !pending.manager) {
+        return;
+    }
+    QNetworkReply *reply = pending.manager->get(pending.request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, pending]() {
+        onReplyFinished(reply, pending);
+    });
+    if (pending.started) {
+        pending.started(reply);
+    }
+}
+
+/**
+ * @brief Przekazuje ostateczną odpowiedź lub planuje ponowienie.
+ *
+ * Ponawiane są odpowiedzi 429 i 5xx, dopóki nie wyczerpie się limit ponowień
+ * i obiekt oczekujący istnieje. Ponowienie wraca do kolejki hosta z tym samym
+ * priorytetem, więc zużywa żeton jak nowe żądanie.
+ *
+ * @param reply Zakończona odpowiedź.
+ * @param pending Żądanie, którego dotyczy odpowiedź.
+ */
+void RateLimiter::onReplyFinished(QNetworkReply *reply, const Pending &pending) {
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool retryable = status == 429 || (status >= 500 && status <= 599);
+    if (!retryable || pending.attempt >= MAX_RETRIES || !pending.receiver) {
+        if (pending.receiver) {
+            pending.callback(reply);
+        } else {
+            reply->deleteLater();
+        }
+        return;
+    }
+
+    int delayMs = backoffMs(reply, pending.attempt);
+    reply->deleteLater();
+    if (status == 429) {
+        // The server throttles the whole host, not just this URL
+        if (Bucket *bucket = bucketFor(pending.request.url().host())) {
+            bucket->tokens = 0.0;
+            bucket->refilledAt = m_clock.elapsed();
+        }
+    }
+    qDebug() << "Request to" << pending.request.url().toString() << "returned HTTP" << status << ", retry"
+             << (pending.attempt + 1) << "of" << MAX_RETRIES << "in" << delayMs << "ms";
+
+    Pending retry = pending;
+    retry.attempt++;
+    QTimer::singleShot(delayMs, this, [this, retry]() {
+        enqueue(retry);
+    });
+}
+
+/**
+ * @brief Oblicza czas oczekiwania przed ponowieniem.
+ *
+ * Czas rośnie dwukrotnie z każdym ponowieniem (do MAX_BACKOFF_MS) i jest losowany
+ * z przedziału od połowy do całości tej wartości, aby ponowienia wielu żądań się
+ * nie nakładały. Dłuższy czas z nagłówka Retry-After (w sekundach) ma pierwszeństwo.
+ *
+ * @param reply Odpowiedź, która ma zostać ponowiona.
+ * @param attempt Numer ponowienia (od 0).
+ * @return Czas oczekiwania w milisekundach.
+ */
+int RateLimiter::backoffMs(QNetworkReply *reply, int attempt) {
+    int ceiling = qMin(int(MAX_BACKOFF_MS), BASE_BACKOFF_MS << qMin(attempt, 16));
+    int delayMs = ceiling / 2 + int(QRandomGenerator::global()->bounded(ceiling / 2 + 1));
+
+    bool ok = false;
+    int retryAfterSeconds = reply->rawHeader("Retry-After").trimmed().toInt(&ok);
+    if (ok && retryAfterSeconds > 0) {
+        delayMs = qMax(delayMs, qMin(int(MAX_BACKOFF_MS), retryAfterSeconds * 1000));
+    }
+    return delayMs;
+}
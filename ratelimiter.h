@@ -0,0 +1,169 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QTimer>
+#include <functional>
+
+/**
+ * @class RateLimiter
+ * @brief Wspólny ogranicznik liczby żądań GET na host, z ponawianiem i priorytetami.
+ *
+ * Każdy host z ustalonym limitem (API GIOŚ, Nominatim) ma wiadro żetonów: żądanie
+ * jest wysyłane, gdy w wiadrze jest żeton, a żetony przybywają ze stałą szybkością
+ * do pojemności wiadra. Żądania czekające na żeton są wysyłane od najwyższego
+ * priorytetu (przy równych priorytetach w kolejności dodania). Żądania do innych
+ * hostów są wysyłane od razu.
+ *
+ * Odpowiedź 429 lub 5xx jest ponawiana (najwyżej MAX_RETRIES razy) po czasie
+ * rosnącym wykładniczo od BASE_BACKOFF_MS, z losowym rozrzutem, lub po czasie
+ * z nagłówka Retry-After, jeśli jest dłuższy. Odpowiedź 429 opróżnia także wiadro
+ * hosta, spowalniając pozostałe żądania do niego. Funkcja zwrotna otrzymuje
+ * ostateczną odpowiedź i przejmuje ją na własność.
+ */
+class RateLimiter : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Funkcja wywoływana z ostateczną odpowiedzią (odpowiada za jej usunięcie).
+     */
+    using Callback = std::function<void(QNetworkReply *)>;
+
+    /**
+     * @brief Zwraca wspólny ogranicznik, tworząc go przy pierwszym użyciu.
+     * @return Ogranicznik należący do obiektu aplikacji.
+     */
+    static RateLimiter *instance();
+
+    /**
+     * @brief Dodaje żądanie GET do kolejki hosta.
+     * @param manager Menedżer sieciowy wysyłający żądanie.
+     * @param request Żądanie GET.
+     * @param priority Priorytet (większy jest wysyłany wcześniej).
+     * @param receiver Obiekt oczekujący; po jego usunięciu żądanie nie jest wysyłane ani ponawiane.
+     * @param callback Funkcja wywoływana z ostateczną odpowiedzią.
+     * @param started Funkcja wywoływana z każdą wysłaną odpowiedzią, także ponowieniem (np. do odczytu
+     *        treści w trakcie pobierania; nie przejmuje odpowiedzi na własność).
+     */
+    void get(QNetworkAccessManager *manager, const QNetworkRequest &request, int priority, QObject *receiver, Callback callback,
+             Callback started = Callback());
+
+    /**
+     * @brief Podnosi priorytet żądań czekających w kolejce.
+     * @param url Adres żądania.
+     * @param priority Nowy priorytet (niższy od obecnego jest pomijany).
+     */
+    void boost(const QUrl &url, int priority);
+
+    /**
+     * @brief Maksymalna liczba ponowień jednego żądania.
+     */
+    static const int MAX_RETRIES = 4;
+
+    /**
+     * @brief Czas oczekiwania przed pierwszym ponowieniem (ms).
+     */
+    static const int BASE_BACKOFF_MS = 1000;
+
+    /**
+     * @brief Maksymalny czas oczekiwania przed ponowieniem (ms).
+     */
+    static const int MAX_BACKOFF_MS = 60000;
+
+private:
+    /**
+     * @struct Pending
+     * @brief Żądanie czekające na wysłanie lub ponowienie.
+     */
+    struct Pending {
+        QPointer<QNetworkAccessManager> manager; ///< Menedżer sieciowy wysyłający żądanie.
+        QNetworkRequest request;                 ///< Żądanie GET.
+        int priority;                            ///< Priorytet żądania.
+        QPointer<QObject> receiver;              ///< Obiekt oczekujący.
+        Callback callback;                       ///< Funkcja wywoływana z ostateczną odpowiedzią.
+        Callback started;                        ///< Funkcja wywoływana z każdą wysłaną odpowiedzią.
+        int attempt;                             ///< Liczba dotychczasowych ponowień.
+    };
+
+    /**
+     * @struct Bucket
+     * @brief Wiadro żetonów i kolejka żądań jednego hosta.
+     */
+    struct Bucket {
+        double rate;          ///< Liczba żetonów przybywających na sekundę.
+        double capacity;      ///< Pojemność wiadra.
+        double tokens;        ///< Dostępne żetony.
+        qint64 refilledAt;    ///< Chwila ostatniego uzupełnienia (ms od utworzenia ogranicznika).
+        QList<Pending> queue; ///< Żądania czekające na żeton.
+    };
+
+    /**
+     * @brief Konstruktor klasy RateLimiter.
+     * @param parent Wskaźnik na obiekt nadrzędny.
+     */
+    explicit RateLimiter(QObject *parent);
+
+    /**
+     * @brief Zwraca wiadro hosta, tworząc je przy pierwszym użyciu.
+     * @param host Nazwa hosta.
+     * @return Wiadro hosta lub nullptr, jeśli host nie ma limitu.
+     */
+    Bucket *bucketFor(const QString &host);
+
+    /**
+     * @brief Dodaje żądanie do kolejki hosta lub wysyła je od razu, jeśli host nie ma limitu.
+     * @param pending Żądanie.
+     */
+    void enqueue(const Pending &pending);
+
+    /**
+     * @brief Wysyła żądania, dla których są żetony, i planuje kolejne wywołanie.
+     */
+    void dispatch();
+
+    /**
+     * @brief Wysyła żądanie.
+     * @param pending Żądanie.
+     */
+    void send(const Pending &pending);
+
+    /**
+     * @brief Przekazuje ostateczną odpowiedź lub planuje ponowienie.
+     * @param reply Zakończona odpowiedź.
+     * @param pending Żądanie, którego dotyczy odpowiedź.
+     */
+    void onReplyFinished(QNetworkReply *reply, const Pending &pending);
+
+    /**
+     * @brief Oblicza czas oczekiwania przed ponowieniem.
+     * @param reply Odpowiedź, która ma zostać ponowiona.
+     * @param attempt Numer ponowienia (od 0).
+     * @return Czas oczekiwania w milisekundach.
+     */
+    static int backoffMs(QNetworkReply *reply, int attempt);
+
+    /**
+     * @brief Wiadra hostów z ustalonym limitem, według nazwy hosta.
+     */
+    QHash<QString, Bucket> m_buckets;
+
+    /**
+     * @brief Zegar wywołujący dispatch(), gdy przybędzie żeton.
+     */
+    QTimer m_dispatchTimer;
+
+    /**
+     * @brief Czas od utworzenia ogranicznika, używany do uzupełniania wiader.
+     */
+    QElapsedTimer m_clock;
+};
+
+#endif // RATELIMITER_H
@@ -0,0 +1,110 @@
+#include "requestbroker.h"
+#include "apicache.h"
+#include "connectivitymonitor.h"
+#include "ratelimiter.h"
+#include <QCoreApplication>
+#include <QDebug>
+
+/**
+ * @brief Zwraca wspólnego pośrednika, tworząc go przy pierwszym użyciu.
+ *
+ * @return Pośrednik należący do obiektu aplikacji.
+ */
+RequestBroker *RequestBroker::instance() {
+    static RequestBroker *broker = new RequestBroker(QCoreApplication::instance());
+    return broker;
+}
+
+/**
+ * @brief Konstruktor klasy RequestBroker.
+ *
+ * Tworzy menedżer sieciowy z pamięcią podręczną ApiCache i zgłasza jego odpowiedzi
+ * do ConnectivityMonitor.
+ *
+ * @param parent Wskaźnik na obiekt nadrzędny.
+ */
+RequestBroker::RequestBroker(QObject *parent)
+    : QObject(parent), m_manager(new QNetworkAccessManager(this)), m_requestCount(0), m_coalescedCount(0) {
+    ApiCache::install(m_manager);
+    ConnectivityMonitor::instance()->watch(m_manager);
+}
+
+/**
+ * @brief Wysyła żądanie GET lub dołącza do identycznego żądania w toku.
+ *
+ * Dołączenie z wyższym priorytetem podnosi priorytet żądania, jeśli czeka jeszcze
+ * w kolejce RateLimiter.
+ *
+ * @param request Żądanie GET.
+ * @param priority Priorytet w kolejce RateLimiter (większy jest wysyłany wcześniej).
+ * @param receiver Obiekt oczekujący; po jego usunięciu funkcja nie jest wywoływana.
+ * @param callback Funkcja wywoływana z wynikiem żądania.
+ */
+void RequestBroker::get(const QNetworkRequest &request, int priority, QObject *receiver, Callback callback) {
+    const QUrl url = request.url();
+    auto it = m_waiters.find(url);
+    if (it != m_waiters.end()) {
+        it->append(Waiter{receiver, std::move(callback)});
+        RateLimiter::instance()->boost(url, priority);
+        m_coalescedCount++;
+        qDebug() << "Coalesced request to" << url.toString() << "with" << (it->size() - 1) << "waiting ("
+                 << m_coalescedCount << "of" << (m_requestCount + m_coalescedCount) << "requests coalesced)";
+        return;
+    }
+
+    m_waiters.insert(url, {Waiter{receiver, std::move(callback)}});
+    m_requestCount++;
+    RateLimiter::instance()->get(m_manager, request, priority, this, [this](QNetworkReply *reply) {
+        onReplyFinished(reply);
+    });
+}
+
+/**
+ * @brief Sprawdza, czy żądanie o danym adresie jest w toku.
+ *
+ * @param url Adres żądania.
+ * @return true, jeśli żądanie nie zostało jeszcze zakończone.
+ */
+bool RequestBroker::isInFlight(const QUrl &url) const {
+    return m_waiters.contains(url);
+}
+
+/**
+ * @brief Zwraca liczbę żądań dołączonych do żądań w toku.
+ *
+ * @return Liczba żądań, które nie zostały wysłane dzięki połączeniu.
+ */
+int RequestBroker::coalescedCount() const {
+    return m_coalescedCount;
+}
+
+/**
+ * @brief Przekazuje wynik zakończonego żądania wszystkim oczekującym.
+ *
+ * Treść jest odczytywana i parsowana raz. Oczekujący, których obiekt został usunięty
+ * (np. zamknięte okno), są pomijani. Lista oczekujących jest zdejmowana przed
+ * wywołaniem funkcji, więc funkcja może od razu wysłać to samo żądanie ponownie.
+ *
+ * @param reply Zakończona odpowiedź.
+ */
+void RequestBroker::onReplyFinished(QNetworkReply *reply) {
+    reply->deleteLater();
+    const QUrl url = reply->request().url();
+    const QList<Waiter> waiters = m_waiters.take(url);
+
+    Response response;
+    response.url = url;
+    response.error = reply->error();
+    response.errorString = reply->errorString();
+    response.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    response.data = reply->readAll();
+    if (response.error == QNetworkReply::NoError) {
+        response.json = QJsonDocument::fromJson(response.data);
+    }
+
+    for (const Waiter &waiter : waiters) {
+        if (waiter.receiver) {
+            waiter.callback(response);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef REQUESTBROKER_H
+#define REQUESTBROKER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QJsonDocument>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QUrl>
+#include <functional>
+
+/**
+ * @class RequestBroker
+ * @brief Wspólny pośrednik żądań GET łączący identyczne żądania w toku.
+ *
+ * Żądania są kluczowane adresem URL. Jeśli żądanie o tym samym adresie jest już
+ * w toku, kolejny wywołujący jest dołączany do istniejącej odpowiedzi zamiast
+ * wysyłać nowe żądanie. Odpowiedź jest odczytywana i parsowana jako JSON raz,
+ * a wynik trafia do wszystkich oczekujących. Pośrednik ma własny menedżer sieciowy
+ * (z pamięcią podręczną ApiCache, obserwowany przez ConnectivityMonitor), więc
+ * zamknięcie okna nie przerywa żądań, na które czekają inne okna. Żądania są
+ * wysyłane przez RateLimiter, który ogranicza ich liczbę i ponawia odpowiedzi 429/5xx.
+ */
+class RequestBroker : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @struct Response
+     * @brief Wynik żądania przekazywany wszystkim oczekującym.
+     */
+    struct Response {
+        QUrl url;                          ///< Adres żądania.
+        QNetworkReply::NetworkError error; ///< Błąd odpowiedzi (NoError, jeśli się powiodła).
+        QString errorString;               ///< Opis błędu.
+        int httpStatus;                    ///< Kod HTTP lub 0, jeśli serwer nie odpowiedział.
+        QByteArray data;                   ///< Treść odpowiedzi.
+        QJsonDocument json;                ///< Treść sparsowana jako JSON (pusty dokument, jeśli nie jest JSON).
+    };
+
+    /**
+     * @brief Funkcja wywoływana po zakończeniu żądania.
+     */
+    using Callback = std::function<void(const Response &)>;
+
+    /**
+     * @brief Zwraca wspólnego pośrednika, tworząc go przy pierwszym użyciu.
+     * @return Pośrednik należący do obiektu aplikacji.
+     */
+    static RequestBroker *instance();
+
+    /**
+     * @brief Wysyła żądanie GET lub dołącza do identycznego żądania w toku.
+     * @param request Żądanie GET.
+     * @param priority Priorytet w kolejce RateLimiter (większy jest wysyłany wcześniej).
+     * @param receiver Obiekt oczekujący; po jego usunięciu funkcja nie jest wywoływana.
+     * @param callback Funkcja wywoływana z wynikiem żądania.
+     */
+    void get(const QNetworkRequest &request, int priority, QObject *receiver, Callback callback);
+
+    /**
+     * @brief Sprawdza, czy żądanie o danym adresie jest w toku.
+     * @param url Adres żądania.
+     * @return true, jeśli żądanie nie zostało jeszcze zakończone.
+     */
+    bool isInFlight(const QUrl &url) const;
+
+    /**
+     * @brief Zwraca liczbę żądań dołączonych do żądań w toku.
+     * @return Liczba żądań, które nie zostały wysłane dzięki połączeniu.
+     */
+    int coalescedCount() const;
+
+private:
+    /**
+     * @struct Waiter
+     * @brief Wywołujący oczekujący na wynik żądania.
+     */
+    struct Waiter {
+        QPointer<QObject> receiver; ///< Obiekt oczekujący.
+        Callback callback;          ///< Funkcja wywoływana z wynikiem.
+    };
+
+    /**
+     * @brief Konstruktor klasy RequestBroker.
+     * @param parent Wskaźnik na obiekt nadrzędny.
+     */
+    explicit RequestBroker(QObject *parent);
+
+    /**
+     * @brief Przekazuje wynik zakończonego żądania wszystkim oczekującym.
+     * @param reply Zakończona odpowiedź.
+     */
+    void onReplyFinished(QNetworkReply *reply);
+
+    /**
+     * @brief Menedżer sieciowy wysyłający żądania.
+     */
+    QNetworkAccessManager *m_manager;
+
+    /**
+     * @brief Oczekujący na żądania w toku, według adresu.
+     */
+    QHash<QUrl, QList<Waiter>> m_waiters;
+
+    /**
+     * @brief Liczba wysłanych żądań.
+     */
+    int m_requestCount;
+
+    /**
+     * @brief Liczba żądań dołączonych do żądań w toku.
+     */
+    int m_coalescedCount;
+};
+
+#endif // REQUESTBROKER_H
@@ -0,0 +1,443 @@
+#include "sensorcatalog.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+
+const char *const CATALOG_NAME = "catalog";
+const QStringList GENERATION_SUFFIXES = {"snapshot", "journal"};
+
+} // namespace
+
+/**
+ * @brief Konstruktor klasy SensorCatalog.
+ *
+ * @param directory Katalog, w którym przechowywane są pliki katalogu.
+ * @param format Format zapisu migawki katalogu.
+ */
+SensorCatalog::SensorCatalog(const QString &directory, SessionCodec::Format format)
+    : m_dir(directory), m_generationPath(m_dir.filePath(QString(CATALOG_NAME) + ".generation")),
+      m_generation(0), m_journalOffset(0), m_format(format), m_lock(directory, CATALOG_NAME) {
+}
+
+/**
+ * @brief Wczytuje migawkę i dziennik katalogu.
+ *
+ * Migawka może być zapisana w dowolnym formacie (rozpoznawanym po zawartości).
+ * Uszkodzone linie dziennika są pomijane.
+ *
+ * @return true, jeśli katalog istniał na dysku; false, jeśli trzeba go zbudować.
+ */
+bool SensorCatalog::load() {
+    QMutexLocker locker(&m_mutex);
+    m_generation = HistoryLock::readGeneration(m_generationPath);
+    m_journalOffset = 0;
+    bool exists = readSnapshot();
+    exists = readJournal() || exists;
+
+    if (exists) {
+        qDebug() << "Loaded sensor catalog:" << m_stations.size() << "stations," << m_sensors.size() << "sensors";
+    }
+    return exists;
+}
+
+/**
+ * @brief Dodaje lub aktualizuje stacje.
+ *
+ * @param stations Lista stacji (elementy typu QVariantMap z polem stationId).
+ */
+void SensorCatalog::addStations(const QVariantList &stations) {
+    QMutexLocker locker(&m_mutex);
+    for (const QVariant &stationVariant : stations) {
+        QVariantMap station = stationVariant.toMap();
+        int stationId = station["stationId"].toInt();
+        if (stationId == 0 || m_stations.value(stationId) == station) {
+            continue;
+        }
+        m_stations.insert(stationId, station);
+        m_dirtyStations.insert(stationId, station);
+    }
+}
+
+/**
+ * @brief Dodaje lub aktualizuje sensory, zachowując znane zakresy szeregów.
+ *
+ * Dane sensora są zastępowane nowszymi, a zakres seriesFrom..seriesTo jest sumą
+ * zakresu już znanego i zakresu przekazanego. Listy pomiarów nie są przechowywane.
+ *
+ * @param sensors Lista sensorów z polami id i stationId.
+ */
+void SensorCatalog::addSensors(const QList<QVariantMap> &sensors) {
+    QMutexLocker locker(&m_mutex);
+    for (const QVariantMap &sensorData : sensors) {
+        QVariantMap sensor = sensorData;
+        sensor.remove("measurements");
+        int sensorId = sensor["id"].toInt();
+        if (sensorId == 0) {
+            continue;
+        }
+
+        QVariantMap existing = m_sensors.value(sensorId);
+        if (existing.contains("seriesFrom")) {
+            qint64 from = existing["seriesFrom"].toLongLong();
+            qint64 to = existing["seriesTo"].toLongLong();
+            if (sensor.contains("seriesFrom")) {
+                from = qMin(from, sensor["seriesFrom"].toLongLong());
+                to = qMax(to, sensor["seriesTo"].toLongLong());
+            }
+            sensor["seriesFrom"] = from;
+            sensor["seriesTo"] = to;
+        }
+        if (existing == sensor) {
+            continue;
+        }
+        putSensor(sensor);
+        m_dirtySensors.insert(sensorId, sensor);
+    }
+}
+
+/**
+ * @brief Rozszerza zakres czasu szeregu pomiarów sensora.
+ *
+ * Nieznany sensor jest dodawany z samym identyfikatorem; jego pozostałe dane
+ * uzupełni późniejsze addSensors().
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek zakresu (sekundy od epoki).
+ * @param to Koniec zakresu (sekundy od epoki).
+ */
+void SensorCatalog::extendSeries(int sensorId, qint64 from, qint64 to) {
+    QMutexLocker locker(&m_mutex);
+    QVariantMap sensor = m_sensors.value(sensorId);
+    if (sensor.isEmpty()) {
+        sensor["id"] = sensorId;
+    }
+    if (sensor.contains("seriesFrom")) {
+        from = qMin(from, sensor["seriesFrom"].toLongLong());
+        to = qMax(to, sensor["seriesTo"].toLongLong());
+        if (from == sensor["seriesFrom"].toLongLong() && to == sensor["seriesTo"].toLongLong()) {
+            return;
+        }
+    }
+    sensor["seriesFrom"] = from;
+    sensor["seriesTo"] = to;
+    putSensor(sensor);
+    m_dirtySensors.insert(sensorId, sensor);
+}
+
+/**
+ * @brief Zapisuje zmiany od ostatniego wywołania jednym rekordem dziennika.
+ *
+ * Rekord zawiera pełne dane zmienionych stacji i sensorów. Przed zapisem, pod blokadą
+ * katalogu, wczytywane są rekordy dopisane przez inne instancje, dzięki czemu zapisane
+ * zakresy szeregów obejmują także ich zmiany. Gdy dziennik przekroczy próg
+ * JOURNAL_COMPACT_THRESHOLD, cały katalog jest zapisywany do migawki. Zmiany pozostają
+ * oznaczone do zapisu, dopóki rekord nie zostanie dopisany, więc po błędzie zapisu
+ * trafią do dziennika przy kolejnym wywołaniu.
+ *
+ * @return true, jeśli zapis się powiódł lub nie było zmian.
+ */
+bool SensorCatalog::commit() {
+    QMutexLocker locker(&m_mutex);
+    if (m_dirtyStations.isEmpty() && m_dirtySensors.isEmpty()) {
+        return true;
+    }
+    HistoryLock::Locker writer(m_lock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    refresh();
+
+    QVariantList stations;
+    for (auto it = m_dirtyStations.constBegin(); it != m_dirtyStations.constEnd(); ++it) {
+        stations.append(m_stations.value(it.key()));
+    }
+    QVariantList sensors;
+    for (auto it = m_dirtySensors.constBegin(); it != m_dirtySensors.constEnd(); ++it) {
+        sensors.append(m_sensors.value(it.key()));
+    }
+
+    QString journalPath = filePath(m_generation, "journal");
+    QFile journal(journalPath);
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open catalog journal for writing:" << journalPath << "Error:" << journal.errorString();
+        return false;
+    }
+    QVariantMap record{{"stations", stations}, {"sensors", sensors}};
+    QByteArray line = QJsonDocument(QJsonObject::fromVariantMap(record)).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    qint64 previousSize = journal.size();
+    bool ok = journal.write(line) == line.size() && journal.flush();
+    qint64 journalSize = journal.size();
+    if (!ok) {
+        qDebug() << "Failed to append to catalog journal:" << journalPath << "Error:" << journal.errorString();
+        // Drop a partially written record; the changes stay dirty for the next commit
+        journal.resize(previousSize);
+        return false;
+    }
+    journal.close();
+    m_journalOffset = journalSize;
+    m_dirtyStations.clear();
+    m_dirtySensors.clear();
+
+    if (journalSize > JOURNAL_COMPACT_THRESHOLD) {
+        return writeSnapshot();
+    }
+    return true;
+}
+
+/**
+ * @brief Zapisuje cały katalog do migawki i czyści dziennik.
+ *
+ * Przed zapisem wczytywane są zmiany innych instancji, więc migawka obejmuje
+ * także je (oraz niezatwierdzone jeszcze zmiany tej instancji).
+ *
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SensorCatalog::compact() {
+    QMutexLocker locker(&m_mutex);
+    HistoryLock::Locker writer(m_lock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    refresh();
+    return writeSnapshot();
+}
+
+/**
+ * @brief Zapisuje cały katalog jako migawkę nowego pokolenia.
+ *
+ * Migawka jest zapisywana atomowo, przez QSaveFile; dziennik nowego pokolenia jest
+ * początkowo pusty. Następnie wskaźnik pokolenia jest przełączany, a pliki pokoleń
+ * sprzed bieżącego są usuwane. Wywołujący musi trzymać m_mutex i blokadę katalogu.
+ *
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SensorCatalog::writeSnapshot() {
+    QVariantList stations;
+    for (const QVariantMap &station : std::as_const(m_stations)) {
+        stations.append(station);
+    }
+    QVariantList sensors;
+    for (const QVariantMap &sensor : std::as_const(m_sensors)) {
+        sensors.append(sensor);
+    }
+
+    QString snapshotPath = filePath(m_generation + 1, "snapshot");
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open catalog snapshot for writing:" << snapshotPath << "Error:" << file.errorString();
+        return false;
+    }
+    file.write(SessionCodec::encode(QVariantMap{{"stations", stations}, {"sensors", sensors}}, m_format));
+    if (!file.commit()) {
+        qDebug() << "Failed to write catalog snapshot:" << snapshotPath << "Error:" << file.errorString();
+        return false;
+    }
+    if (!HistoryLock::writeGeneration(m_generationPath, m_generation + 1)) {
+        return false;
+    }
+    HistoryLock::removeGenerationsBefore(m_dir, CATALOG_NAME, GENERATION_SUFFIXES, m_generation);
+    m_generation++;
+    m_journalOffset = 0;
+    m_dirtyStations.clear();
+    m_dirtySensors.clear();
+    qDebug() << "Compacted sensor catalog:" << stations.size() << "stations," << sensors.size() << "sensors";
+    return true;
+}
+
+/**
+ * @brief Wczytuje zmiany katalogu, jeśli inna instancja je zapisała.
+ *
+ * Sprawdzenie to odczyt licznika zapisów blokady katalogu, więc jest wykonywane przed
+ * odczytami katalogu.
+ */
+void SensorCatalog::sync() {
+    QMutexLocker locker(&m_mutex);
+    if (m_lock.hasExternalChanges()) {
+        refresh();
+        qDebug() << "Sensor catalog was changed by another instance, reloaded";
+    }
+}
+
+/**
+ * @brief Zwraca dane stacji.
+ *
+ * @param stationId Identyfikator stacji.
+ * @return Dane stacji lub pusta mapa, jeśli stacja nie jest znana.
+ */
+QVariantMap SensorCatalog::station(int stationId) const {
+    QMutexLocker locker(&m_mutex);
+    return m_stations.value(stationId);
+}
+
+/**
+ * @brief Zwraca dane sensora.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @return Dane sensora lub pusta mapa, jeśli sensor nie jest znany.
+ */
+QVariantMap SensorCatalog::sensor(int sensorId) const {
+    QMutexLocker locker(&m_mutex);
+    return m_sensors.value(sensorId);
+}
+
+/**
+ * @brief Zwraca sensory stacji.
+ *
+ * @param stationId Identyfikator stacji.
+ * @return Lista sensorów stacji w kolejności dodania.
+ */
+QList<QVariantMap> SensorCatalog::stationSensors(int stationId) const {
+    QMutexLocker locker(&m_mutex);
+    QList<QVariantMap> sensors;
+    for (int sensorId : m_stationSensorIds.value(stationId)) {
+        sensors.append(m_sensors.value(sensorId));
+    }
+    return sensors;
+}
+
+/**
+ * @brief Nakłada rekord dziennika lub migawkę na katalog w pamięci.
+ *
+ * Rekordy zawierają pełne dane stacji i sensorów, więc wpisy są zastępowane. Zakres
+ * szeregu sensora jest sumowany ze znanym zakresem, bo rekordy różnych instancji
+ * mogą opisywać różne części szeregu.
+ *
+ * @param record Mapa z listami stations i sensors.
+ */
+void SensorCatalog::apply(const QVariantMap &record) {
+    for (const QVariant &stationVariant : record["stations"].toList()) {
+        QVariantMap station = stationVariant.toMap();
+        m_stations.insert(station["stationId"].toInt(), station);
+    }
+    for (const QVariant &sensorVariant : record["sensors"].toList()) {
+        QVariantMap sensor = sensorVariant.toMap();
+        QVariantMap existing = m_sensors.value(sensor["id"].toInt());
+        if (existing.contains("seriesFrom")) {
+            qint64 from = existing["seriesFrom"].toLongLong();
+            qint64 to = existing["seriesTo"].toLongLong();
+            if (sensor.contains("seriesFrom")) {
+                from = qMin(from, sensor["seriesFrom"].toLongLong());
+                to = qMax(to, sensor["seriesTo"].toLongLong());
+            }
+            sensor["seriesFrom"] = from;
+            sensor["seriesTo"] = to;
+        }
+        putSensor(sensor);
+    }
+}
+
+/**
+ * @brief Wczytuje migawkę bieżącego pokolenia.
+ *
+ * Migawka może być zapisana w dowolnym formacie (rozpoznawanym po zawartości).
+ * Wywołujący musi trzymać m_mutex.
+ *
+ * @return true, jeśli migawka istnieje.
+ */
+bool SensorCatalog::readSnapshot() {
+    QString snapshotPath = filePath(m_generation, "snapshot");
+    QFile snapshot(snapshotPath);
+    if (!snapshot.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    bool ok = false;
+    QVariantMap data = SessionCodec::decode(snapshot.readAll(), &ok);
+    snapshot.close();
+    if (!ok) {
+        qDebug() << "Failed to parse catalog snapshot:" << snapshotPath;
+        return false;
+    }
+    apply(data);
+    return true;
+}
+
+/**
+ * @brief Wczytuje rekordy dopisane do dziennika od ostatniego odczytu.
+ *
+ * Czytane są tylko pełne linie; niedokończony rekord innej instancji zostanie
+ * wczytany przy następnym wywołaniu. Uszkodzone linie są pomijane. Wywołujący
+ * musi trzymać m_mutex.
+ *
+ * @return true, jeśli dziennik istnieje.
+ */
+bool SensorCatalog::readJournal() {
+    QString journalPath = filePath(m_generation, "journal");
+    QFile journal(journalPath);
+    if (!journal.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    if (journal.size() < m_journalOffset) {
+        m_journalOffset = 0;
+    }
+    journal.seek(m_journalOffset);
+    QByteArray data = journal.readAll();
+    journal.close();
+
+    qsizetype complete = data.lastIndexOf('\n') + 1;
+    for (const QByteArray &rawLine : data.left(complete).split('\n')) {
+        QByteArray line = rawLine.trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (doc.isNull() || !doc.isObject()) {
+            qDebug() << "Skipping malformed catalog record in:" << journalPath;
+            continue;
+        }
+        apply(doc.object().toVariantMap());
+    }
+    m_journalOffset += complete;
+    return true;
+}
+
+/**
+ * @brief Wczytuje zmiany zapisane przez inne instancje.
+ *
+ * Jeśli inna instancja scaliła katalog, wczytywana jest migawka nowego pokolenia;
+ * w przeciwnym razie tylko nowe rekordy dziennika. Niezatwierdzone zmiany tej instancji
+ * pozostają w katalogu. Wywołujący musi trzymać m_mutex.
+ */
+void SensorCatalog::refresh() {
+    quint64 generation = HistoryLock::readGeneration(m_generationPath);
+    if (generation != m_generation) {
+        m_generation = generation;
+        m_journalOffset = 0;
+        readSnapshot();
+    }
+    readJournal();
+}
+
+/**
+ * @brief Zwraca ścieżkę pliku katalogu danego pokolenia.
+ *
+ * @param generation Numer pokolenia.
+ * @param suffix Rozszerzenie pliku (snapshot lub journal).
+ * @return Ścieżka pliku.
+ */
+QString SensorCatalog::filePath(quint64 generation, const QString &suffix) const {
+    return HistoryLock::generationPrefix(m_dir.filePath(CATALOG_NAME), generation) + "." + suffix;
+}
+
+/**
+ * @brief Wstawia sensor i aktualizuje indeks sensorów stacji.
+ *
+ * @param sensor Dane sensora.
+ */
+void SensorCatalog::putSensor(const QVariantMap &sensor) {
+    int sensorId = sensor["id"].toInt();
+    int previousStationId = m_sensors.value(sensorId)["stationId"].toInt();
+    int stationId = sensor["stationId"].toInt();
+    if (previousStationId != 0 && previousStationId != stationId) {
+        m_stationSensorIds[previousStationId].removeAll(sensorId);
+    }
+    if (stationId != 0 && !m_stationSensorIds[stationId].contains(sensorId)) {
+        m_stationSensorIds[stationId].append(sensorId);
+    }
+    m_sensors.insert(sensorId, sensor);
+}
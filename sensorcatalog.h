@@ -0,0 +1,169 @@
+#ifndef SENSORCATALOG_H
+#define SENSORCATALOG_H
+
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+#include "historylock.h"
+#include "sessioncodec.h"
+
+/**
+ * @class SensorCatalog
+ * @brief Trwały katalog stacji i sensorów ze wszystkich sesji.
+ *
+ * Katalog przechowuje najnowsze dane każdej stacji i każdego sensora oraz łączny
+ * zakres czasu szeregu pomiarów sensora (seriesFrom..seriesTo) ze wszystkich sesji.
+ * Wyszukiwanie według identyfikatora stacji lub sensora to jedno odwołanie do tablicy
+ * mieszającej. Zmiany są dopisywane do dziennika catalog.journal, który jest okresowo
+ * scalany z migawką catalog.snapshot (CBOR lub JSON, zależnie od formatu zapisu).
+ *
+ * Katalog może być współdzielony przez kilka instancji aplikacji. Zapis odbywa się
+ * pod blokadą HistoryLock (plik catalog.lock) i jest poprzedzony wczytaniem rekordów
+ * dopisanych przez inne instancje (odczyty korzystają z katalogu w pamięci i nie
+ * czekają na blokadę). Scalanie zapisuje migawkę jako nowe pokolenie
+ * (catalog.g<n>.snapshot, z nowym dziennikiem catalog.g<n>.journal) wskazywane przez
+ * plik catalog.generation. Zakresy szeregów są przy nakładaniu rekordów sumowane,
+ * więc zmiany różnych instancji nie nadpisują się nawzajem.
+ */
+class SensorCatalog
+{
+public:
+    /**
+     * @brief Konstruktor klasy SensorCatalog.
+     * @param directory Katalog, w którym przechowywane są pliki katalogu.
+     * @param format Format zapisu migawki katalogu.
+     */
+    SensorCatalog(const QString &directory, SessionCodec::Format format);
+
+    /**
+     * @brief Wczytuje migawkę i dziennik katalogu.
+     * @return true, jeśli katalog istniał na dysku; false, jeśli trzeba go zbudować.
+     */
+    bool load();
+
+    /**
+     * @brief Dodaje lub aktualizuje stacje.
+     * @param stations Lista stacji (elementy typu QVariantMap z polem stationId).
+     */
+    void addStations(const QVariantList &stations);
+
+    /**
+     * @brief Dodaje lub aktualizuje sensory, zachowując znane zakresy szeregów.
+     * @param sensors Lista sensorów z polami id i stationId.
+     */
+    void addSensors(const QList<QVariantMap> &sensors);
+
+    /**
+     * @brief Rozszerza zakres czasu szeregu pomiarów sensora.
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek zakresu (sekundy od epoki).
+     * @param to Koniec zakresu (sekundy od epoki).
+     */
+    void extendSeries(int sensorId, qint64 from, qint64 to);
+
+    /**
+     * @brief Zapisuje zmiany od ostatniego wywołania jednym rekordem dziennika.
+     * @return true, jeśli zapis się powiódł lub nie było zmian.
+     */
+    bool commit();
+
+    /**
+     * @brief Zapisuje cały katalog do migawki i czyści dziennik.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool compact();
+
+    /**
+     * @brief Wczytuje zmiany katalogu, jeśli inna instancja je zapisała.
+     */
+    void sync();
+
+    /**
+     * @brief Zwraca dane stacji.
+     * @param stationId Identyfikator stacji.
+     * @return Dane stacji lub pusta mapa, jeśli stacja nie jest znana.
+     */
+    QVariantMap station(int stationId) const;
+
+    /**
+     * @brief Zwraca dane sensora.
+     * @param sensorId Identyfikator sensora.
+     * @return Dane sensora lub pusta mapa, jeśli sensor nie jest znany.
+     */
+    QVariantMap sensor(int sensorId) const;
+
+    /**
+     * @brief Zwraca sensory stacji.
+     * @param stationId Identyfikator stacji.
+     * @return Lista sensorów stacji.
+     */
+    QList<QVariantMap> stationSensors(int stationId) const;
+
+    /**
+     * @brief Rozmiar dziennika (w bajtach), po którego przekroczeniu katalog jest scalany.
+     */
+    static const qint64 JOURNAL_COMPACT_THRESHOLD = 256 * 1024;
+
+private:
+    /**
+     * @brief Nakłada rekord dziennika lub migawkę na katalog w pamięci.
+     * @param record Mapa z listami stations i sensors.
+     */
+    void apply(const QVariantMap &record);
+
+    /**
+     * @brief Wczytuje migawkę bieżącego pokolenia.
+     * @return true, jeśli migawka istnieje.
+     */
+    bool readSnapshot();
+
+    /**
+     * @brief Wczytuje rekordy dopisane do dziennika od ostatniego odczytu.
+     * @return true, jeśli dziennik istnieje.
+     */
+    bool readJournal();
+
+    /**
+     * @brief Wczytuje zmiany zapisane przez inne instancje.
+     */
+    void refresh();
+
+    /**
+     * @brief Zapisuje cały katalog jako migawkę nowego pokolenia.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool writeSnapshot();
+
+    /**
+     * @brief Zwraca ścieżkę pliku katalogu danego pokolenia.
+     * @param generation Numer pokolenia.
+     * @param suffix Rozszerzenie pliku (snapshot lub journal).
+     * @return Ścieżka pliku.
+     */
+    QString filePath(quint64 generation, const QString &suffix) const;
+
+    /**
+     * @brief Wstawia sensor i aktualizuje indeks sensorów stacji.
+     * @param sensor Dane sensora.
+     */
+    void putSensor(const QVariantMap &sensor);
+
+    QDir m_dir;                                   ///< Katalog plików katalogu.
+    QString m_generationPath;                     ///< Ścieżka do wskaźnika bieżącego pokolenia.
+    quint64 m_generation;                         ///< Pokolenie wczytanej migawki.
+    qint64 m_journalOffset;                       ///< Liczba wczytanych bajtów dziennika.
+    const SessionCodec::Format m_format;          ///< Format zapisu migawki.
+    mutable QMutex m_mutex;                       ///< Muteks chroniący katalog.
+    HistoryLock m_lock;                           ///< Blokada zapisu współdzielona z innymi instancjami.
+    QHash<int, QVariantMap> m_stations;           ///< Stacje według identyfikatora.
+    QHash<int, QVariantMap> m_sensors;            ///< Sensory według identyfikatora.
+    QHash<int, QVector<int>> m_stationSensorIds;  ///< Identyfikatory sensorów według stacji.
+    QHash<int, QVariantMap> m_dirtyStations;      ///< Stacje zmienione od ostatniego commit().
+    QHash<int, QVariantMap> m_dirtySensors;       ///< Sensory zmienione od ostatniego commit().
+};
+
+#endif // SENSORCATALOG_H
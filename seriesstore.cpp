@@ -0,0 +1,894 @@
+#include "seriesstore.h"
+#include "historylock.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMap>
+#include <QSet>
+#include <QTimeZone>
+#include <QDebug>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief Oblicza liczbę kompletnych pomiarów na podstawie rozmiarów kolumn.
+ *
+ * Przerwany zapis może pozostawić kolumny o różnej długości, dlatego brana jest
+ * najkrótsza z nich.
+ */
+qsizetype seriesLength(qint64 timestampBytes, qint64 valueBytes, qint64 validityBytes) {
+    qint64 length = timestampBytes / qint64(sizeof(qint64));
+    length = qMin(length, valueBytes / qint64(sizeof(float)));
+    length = qMin(length, validityBytes * 8);
+    return qsizetype(length);
+}
+
+const char *DATE_FORMAT = "yyyy-MM-dd HH:mm:ss";
+
+/**
+ * @brief Rozmiar rekordu poziomu agregacji: początek przedziału, min, max, średnia i liczba pomiarów.
+ */
+const qsizetype ROLLUP_RECORD_SIZE = sizeof(qint64) + 3 * sizeof(float) + sizeof(quint32);
+
+/**
+ * @brief Zaokrągla czas w dół do początku przedziału o podanej długości.
+ */
+qint64 bucketStart(qint64 timestamp, qint64 bucketSeconds) {
+    qint64 remainder = timestamp % bucketSeconds;
+    return remainder < 0 ? timestamp - remainder - bucketSeconds : timestamp - remainder;
+}
+
+/**
+ * @brief Rozszerzenia plików kolumn jednego pokolenia szeregu.
+ */
+const QStringList COLUMN_SUFFIXES = {"ts", "val", "valid"};
+
+/**
+ * @brief Liczba prób otwarcia szeregu, gdy inna instancja usuwa otwierane pokolenie.
+ */
+const int MAX_OPEN_ATTEMPTS = 3;
+
+/**
+ * @brief Zwraca ścieżkę pliku wskaźnika bieżącego pokolenia kolumn szeregu.
+ */
+QString generationFilePath(const QString &base) {
+    return base + ".generation";
+}
+
+} // namespace
+
+/**
+ * @brief Konstruktor klasy SensorSeries.
+ */
+SensorSeries::SensorSeries()
+    : m_timestamps(nullptr), m_values(nullptr), m_validity(nullptr), m_size(0) {
+}
+
+/**
+ * @brief Destruktor klasy SensorSeries.
+ *
+ * Zwalnia mapowania i zamyka pliki kolumn.
+ */
+SensorSeries::~SensorSeries() {
+    if (m_timestamps) {
+        m_timestampFile.unmap(reinterpret_cast<uchar *>(const_cast<qint64 *>(m_timestamps)));
+    }
+    if (m_values) {
+        m_valueFile.unmap(reinterpret_cast<uchar *>(const_cast<float *>(m_values)));
+    }
+    if (m_validity) {
+        m_validityFile.unmap(const_cast<uchar *>(m_validity));
+    }
+}
+
+/**
+ * @brief Otwiera i mapuje w pamięci pliki szeregu.
+ *
+ * Otwierane są kolumny bieżącego pokolenia szeregu. Otwarte pliki pozostają dostępne
+ * także po przełączeniu szeregu na nowe pokolenie. Jeśli pokolenie zostało usunięte
+ * przed otwarciem (dwa przepisania szeregu w innej instancji), otwarcie jest powtarzane.
+ *
+ * @param basePath Ścieżka do plików szeregu bez rozszerzenia.
+ * @return Wskaźnik na szereg lub pusty wskaźnik, jeśli szereg nie istnieje lub nie da się go zmapować.
+ */
+QSharedPointer<SensorSeries> SensorSeries::open(const QString &basePath) {
+    QSharedPointer<SensorSeries> series;
+    for (int attempt = 0; attempt < MAX_OPEN_ATTEMPTS; ++attempt) {
+        quint64 generation = HistoryLock::readGeneration(generationFilePath(basePath));
+        QString columnsPath = HistoryLock::generationPrefix(basePath, generation);
+        series.reset(new SensorSeries());
+        series->m_timestampFile.setFileName(columnsPath + ".ts");
+        series->m_valueFile.setFileName(columnsPath + ".val");
+        series->m_validityFile.setFileName(columnsPath + ".valid");
+        if (series->m_timestampFile.open(QIODevice::ReadOnly)
+            && series->m_valueFile.open(QIODevice::ReadOnly)
+            && series->m_validityFile.open(QIODevice::ReadOnly)) {
+            break;
+        }
+        if (HistoryLock::readGeneration(generationFilePath(basePath)) == generation) {
+            if (series->m_timestampFile.exists()) {
+                qDebug() << "Failed to open series files:" << columnsPath;
+            }
+            return QSharedPointer<SensorSeries>();
+        }
+        series.reset();
+    }
+    if (!series) {
+        return series;
+    }
+
+    qsizetype length = seriesLength(series->m_timestampFile.size(), series->m_valueFile.size(), series->m_validityFile.size());
+    if (length == 0) {
+        return series;
+    }
+
+    uchar *timestamps = series->m_timestampFile.map(0, length * qint64(sizeof(qint64)));
+    uchar *values = series->m_valueFile.map(0, length * qint64(sizeof(float)));
+    uchar *validity = series->m_validityFile.map(0, (length + 7) / 8);
+    if (!timestamps || !values || !validity) {
+        qDebug() << "Failed to map series files:" << basePath;
+        return QSharedPointer<SensorSeries>();
+    }
+
+    series->m_timestamps = reinterpret_cast<const qint64 *>(timestamps);
+    series->m_values = reinterpret_cast<const float *>(values);
+    series->m_validity = validity;
+    series->m_size = length;
+    return series;
+}
+
+/**
+ * @brief Konstruktor klasy SeriesStore.
+ *
+ * @param rootPath Katalog główny magazynu.
+ */
+SeriesStore::SeriesStore(const QString &rootPath)
+    : m_rootDir(rootPath) {
+    if (!m_rootDir.exists() && !m_rootDir.mkpath(".")) {
+        qDebug() << "Failed to create series directory:" << m_rootDir.path();
+    }
+}
+
+/**
+ * @brief Scala pomiary z szeregiem sensora.
+ *
+ * Szereg jest utrzymywany w kolejności znaczników czasu, z jednym pomiarem na godzinę.
+ * Nowe pomiary są sortowane, a pierwsza godzina pokrywająca się z szeregiem jest
+ * wyszukiwana binarnie. Wartości godzin już zapisanych są nadpisywane w miejscu
+ * (nowszy pomiar zastępuje wcześniejszy), a godziny późniejsze niż koniec szeregu
+ * są dopisywane na jego końcu. Szereg jest przepisywany w całości tylko wtedy, gdy
+ * pomiary trafiają między zapisane godziny.
+ *
+ * Każde pokolenie kolumn zapisane przez rewriteColumns() jest posortowane, więc
+ * szereg z plikiem pokolenia nie wymaga sprawdzania kolejności. Szereg zapisany przez
+ * starsze wersje (pokolenie 0) mógł nie być posortowany; jest porządkowany
+ * i przepisywany jako nowe pokolenie przy pierwszym zapisie.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param incoming Pomiary do zapisania.
+ * @return Liczba nowych lub zmienionych pomiarów lub -1 w przypadku błędu.
+ */
+int SeriesStore::append(int sensorId, const QVector<MeasurementPoint> &incoming) {
+    QString base = basePath(sensorId);
+    QVector<MeasurementPoint> points = sortedUnique(incoming);
+    if (points.isEmpty()) {
+        return 0;
+    }
+
+    QSharedPointer<SensorSeries> existingSeries = SensorSeries::open(base);
+    qsizetype size = existingSeries ? existingSeries->size() : 0;
+    // A new series starts as the first generation, which marks it as sorted
+    if (size == 0) {
+        existingSeries.reset();
+        return rewriteColumns(base, points) ? int(points.size()) : -1;
+    }
+    const qint64 *timestamps = existingSeries->timestamps();
+    const bool sorted = HistoryLock::readGeneration(generationFilePath(base)) > 0;
+
+    if (sorted) {
+        // Match the batch against the stored hours, starting from the first overlapping one
+        QVector<qsizetype> slots;
+        qsizetype i = 0;
+        qsizetype j = 0;
+        bool inserts = false;
+        while (j < points.size()) {
+            i = std::lower_bound(timestamps + i, timestamps + size, points[j].timestamp) - timestamps;
+            if (i == size) {
+                break;
+            }
+            if (timestamps[i] != points[j].timestamp) {
+                inserts = true;
+                break;
+            }
+            slots.append(i++);
+            j++;
+        }
+
+        if (!inserts) {
+            int changed = 0;
+            qsizetype first = -1;
+            qsizetype last = -1;
+            for (qsizetype k = 0; k < slots.size(); ++k) {
+                const MeasurementPoint &point = points[k];
+                bool stored = existingSeries->isValid(slots[k]);
+                if (point.valid != stored || (point.valid && point.value != existingSeries->values()[slots[k]])) {
+                    changed++;
+                    first = first < 0 ? slots[k] : first;
+                    last = slots[k];
+                }
+            }
+
+            QVector<MeasurementPoint> window;
+            if (changed > 0) {
+                window.reserve(last - first + 1);
+                for (qsizetype k = first; k <= last; ++k) {
+                    window.append({timestamps[k], existingSeries->values()[k], existingSeries->isValid(k)});
+                }
+                for (qsizetype k = 0; k < slots.size(); ++k) {
+                    if (slots[k] >= first && slots[k] <= last) {
+                        window[slots[k] - first] = points[k];
+                    }
+                }
+            }
+            existingSeries.reset();
+
+            if (changed > 0 && !overwriteColumns(base, first, window)) {
+                return -1;
+            }
+            if (j < points.size() && !appendColumns(base, points.mid(j))) {
+                return -1;
+            }
+            return changed + int(points.size() - j);
+        }
+    }
+
+    QVector<MeasurementPoint> current;
+    current.reserve(size);
+    for (qsizetype i = 0; i < size; ++i) {
+        current.append({timestamps[i], existingSeries->values()[i], existingSeries->isValid(i)});
+    }
+    existingSeries.reset();
+    // Series written before generations were introduced may be unsorted; sort them once
+    if (!sorted) {
+        current = sortedUnique(current);
+    }
+
+    QVector<MeasurementPoint> merged;
+    merged.reserve(current.size() + points.size());
+    int changed = 0;
+    qsizetype i = 0;
+    qsizetype j = 0;
+    while (i < current.size() || j < points.size()) {
+        if (j == points.size() || (i < current.size() && current[i].timestamp < points[j].timestamp)) {
+            merged.append(current[i++]);
+        } else if (i == current.size() || points[j].timestamp < current[i].timestamp) {
+            merged.append(points[j++]);
+            changed++;
+        } else {
+            // Same hour: the later value wins
+            if (points[j].valid != current[i].valid || (points[j].valid && points[j].value != current[i].value)) {
+                changed++;
+            }
+            merged.append(points[j++]);
+            i++;
+        }
+    }
+
+    // An unchanged legacy series is still rewritten, so it is checked only once
+    return rewriteColumns(base, merged) ? changed : -1;
+}
+
+/**
+ * @brief Otwiera szereg sensora do odczytu.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @return Wskaźnik na zmapowany szereg lub pusty wskaźnik.
+ */
+QSharedPointer<const SensorSeries> SeriesStore::open(int sensorId) const {
+    return SensorSeries::open(basePath(sensorId));
+}
+
+/**
+ * @brief Zwraca pomiary sensora z podanego przedziału czasu.
+ *
+ * Posortowana kolumna znaczników czasu służy jako indeks: granice przedziału są
+ * wyszukiwane binarnie, więc koszt zależy od liczby zwróconych pomiarów, a nie
+ * od długości szeregu.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @return Pomiary w kolejności czasu.
+ */
+QVector<MeasurementPoint> SeriesStore::range(int sensorId, qint64 from, qint64 to) const {
+    QVector<MeasurementPoint> points;
+    QSharedPointer<SensorSeries> series = SensorSeries::open(basePath(sensorId));
+    if (!series || series->size() == 0 || from > to) {
+        return points;
+    }
+
+    const qint64 *begin = series->timestamps();
+    const qint64 *end = begin + series->size();
+    qsizetype first = std::lower_bound(begin, end, from) - begin;
+    qsizetype last = std::upper_bound(begin + first, end, to) - begin;
+
+    points.reserve(last - first);
+    for (qsizetype i = first; i < last; ++i) {
+        points.append({begin[i], series->values()[i], series->isValid(i)});
+    }
+    return points;
+}
+
+/**
+ * @brief Przenosi starsze pomiary sensora do poziomów zagregowanych.
+ *
+ * Pomiary sprzed rawBefore są agregowane w przedziały sześciogodzinne i usuwane
+ * z szeregu, a przedziały sześciogodzinne sprzed rollupBefore są łączone w przedziały
+ * dobowe. Obie granice są zaokrąglane w dół do początku przedziału, więc przedział
+ * nigdy nie jest dzielony między poziomy. Plik poziomu jest zapisywany przed
+ * usunięciem danych z poziomu niższego.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param rawBefore Pomiary sprzed tej chwili trafiają do przedziałów sześciogodzinnych.
+ * @param rollupBefore Przedziały sześciogodzinne sprzed tej chwili trafiają do przedziałów dobowych.
+ * @return Liczba przeniesionych pomiarów i przedziałów lub -1 w przypadku błędu.
+ */
+int SeriesStore::rollUp(int sensorId, qint64 rawBefore, qint64 rollupBefore) {
+    QString base = basePath(sensorId);
+    rawBefore = bucketStart(rawBefore, ROLLUP_BUCKET_SECONDS);
+    rollupBefore = bucketStart(rollupBefore, DAILY_BUCKET_SECONDS);
+    int moved = 0;
+
+    QSharedPointer<SensorSeries> series = SensorSeries::open(base);
+    if (series && series->size() > 0 && series->timestamps()[0] < rawBefore) {
+        QVector<MeasurementPoint> points;
+        points.reserve(series->size());
+        for (qsizetype i = 0; i < series->size(); ++i) {
+            points.append({series->timestamps()[i], series->values()[i], series->isValid(i)});
+        }
+        series.reset();
+        points = sortedUnique(points);
+
+        auto split = std::lower_bound(points.cbegin(), points.cend(), rawBefore, [](const MeasurementPoint &point, qint64 timestamp) {
+            return point.timestamp < timestamp;
+        });
+        qsizetype count = split - points.cbegin();
+        QVector<RollupPoint> rollups = readRollups(base + ".r6h", ROLLUP_BUCKET_SECONDS);
+        rollups += rollUpPoints(points.mid(0, count), ROLLUP_BUCKET_SECONDS);
+        if (!writeRollups(base + ".r6h", combineRollups(rollups, ROLLUP_BUCKET_SECONDS))
+            || !rewriteColumns(base, points.mid(count))) {
+            return -1;
+        }
+        moved += int(count);
+    }
+
+    QVector<RollupPoint> rollups = readRollups(base + ".r6h", ROLLUP_BUCKET_SECONDS);
+    qsizetype count = 0;
+    while (count < rollups.size() && rollups[count].timestamp < rollupBefore) {
+        ++count;
+    }
+    if (count > 0) {
+        QVector<RollupPoint> daily = readRollups(base + ".r1d", DAILY_BUCKET_SECONDS);
+        daily += rollups.mid(0, count);
+        if (!writeRollups(base + ".r1d", combineRollups(daily, DAILY_BUCKET_SECONDS))
+            || !writeRollups(base + ".r6h", rollups.mid(count))) {
+            return -1;
+        }
+        moved += int(count);
+    }
+    return moved;
+}
+
+/**
+ * @brief Zwraca zagregowane pomiary sensora nakładające się na podany przedział czasu.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @return Przedziały dobowe i sześciogodzinne w kolejności czasu.
+ */
+QVector<RollupPoint> SeriesStore::rollups(int sensorId, qint64 from, qint64 to) const {
+    QString base = basePath(sensorId);
+    QVector<RollupPoint> result;
+    const QVector<RollupPoint> tiers[] = {
+        readRollups(base + ".r1d", DAILY_BUCKET_SECONDS),
+        readRollups(base + ".r6h", ROLLUP_BUCKET_SECONDS)
+    };
+    for (const QVector<RollupPoint> &tier : tiers) {
+        for (const RollupPoint &rollup : tier) {
+            if (rollup.timestamp <= to && rollup.timestamp + rollup.duration > from) {
+                result.append(rollup);
+            }
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const RollupPoint &a, const RollupPoint &b) {
+        return a.timestamp < b.timestamp;
+    });
+    return result;
+}
+
+/**
+ * @brief Usuwa dane sensora sprzed podanej chwili.
+ *
+ * Usuwane są pomiary sprzed cutoff oraz przedziały, które kończą się nie później niż cutoff.
+ * Liczba zwolnionych bajtów jest wyliczana z liczby usuniętych wierszy kolumn i rekordów
+ * poziomów, bez sprawdzania rozmiarów plików.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param cutoff Dane kończące się przed tą chwilą są usuwane.
+ * @return Szacowana liczba zwolnionych bajtów lub -1 w przypadku błędu.
+ */
+qint64 SeriesStore::trimBefore(int sensorId, qint64 cutoff) {
+    QString base = basePath(sensorId);
+    bool ok = true;
+    qint64 freed = 0;
+
+    QSharedPointer<SensorSeries> series = SensorSeries::open(base);
+    if (series && series->size() > 0 && series->timestamps()[0] < cutoff) {
+        QVector<MeasurementPoint> kept;
+        for (qsizetype i = 0; i < series->size(); ++i) {
+            if (series->timestamps()[i] >= cutoff) {
+                kept.append({series->timestamps()[i], series->values()[i], series->isValid(i)});
+            }
+        }
+        const qsizetype size = series->size();
+        series.reset();
+        // Every rewritten generation must be sorted (see append())
+        kept = sortedUnique(kept);
+        ok = rewriteColumns(base, kept);
+        freed += (size - kept.size()) * qint64(sizeof(qint64) + sizeof(float))
+                 + (size + 7) / 8 - (kept.size() + 7) / 8;
+    }
+
+    const QList<QPair<QString, qint64>> tiers = {
+        {base + ".r6h", qint64(ROLLUP_BUCKET_SECONDS)},
+        {base + ".r1d", qint64(DAILY_BUCKET_SECONDS)}
+    };
+    for (const auto &tier : tiers) {
+        QVector<RollupPoint> rollups = readRollups(tier.first, tier.second);
+        QVector<RollupPoint> kept;
+        for (const RollupPoint &rollup : rollups) {
+            if (rollup.timestamp + rollup.duration > cutoff) {
+                kept.append(rollup);
+            }
+        }
+        if (kept.size() != rollups.size()) {
+            ok = writeRollups(tier.first, kept) && ok;
+            freed += (rollups.size() - kept.size()) * ROLLUP_RECORD_SIZE;
+        }
+    }
+    return ok ? freed : -1;
+}
+
+/**
+ * @brief Zwraca czas najstarszych danych sensora na dowolnym poziomie.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @return Sekundy od epoki lub -1, jeśli sensor nie ma danych.
+ */
+qint64 SeriesStore::oldestTimestamp(int sensorId) const {
+    QString base = basePath(sensorId);
+    qint64 oldest = -1;
+    auto consider = [&oldest](qint64 timestamp) {
+        oldest = oldest < 0 ? timestamp : qMin(oldest, timestamp);
+    };
+
+    QSharedPointer<SensorSeries> series = SensorSeries::open(base);
+    if (series && series->size() > 0) {
+        consider(series->timestamps()[0]);
+    }
+    QVector<RollupPoint> daily = readRollups(base + ".r1d", DAILY_BUCKET_SECONDS);
+    if (!daily.isEmpty()) {
+        consider(daily.first().timestamp);
+    }
+    QVector<RollupPoint> sixHour = readRollups(base + ".r6h", ROLLUP_BUCKET_SECONDS);
+    if (!sixHour.isEmpty()) {
+        consider(sixHour.first().timestamp);
+    }
+    return oldest;
+}
+
+/**
+ * @brief Zwraca identyfikatory sensorów, które mają dane w magazynie.
+ *
+ * @return Lista identyfikatorów sensorów w kolejności rosnącej.
+ */
+QList<int> SeriesStore::sensorIds() const {
+    QSet<int> ids;
+    const QStringList files = m_rootDir.entryList({"sensor_*.ts", "sensor_*.r6h", "sensor_*.r1d"}, QDir::Files);
+    for (const QString &file : files) {
+        bool ok = false;
+        int sensorId = file.mid(7, file.indexOf('.') - 7).toInt(&ok);
+        if (ok) {
+            ids.insert(sensorId);
+        }
+    }
+    QList<int> sorted(ids.cbegin(), ids.cend());
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+/**
+ * @brief Agreguje pomiary godzinowe w przedziały o podanej długości.
+ *
+ * Niepoprawne pomiary (null z API) są pomijane; przedział bez poprawnych pomiarów
+ * nie jest tworzony.
+ *
+ * @param points Pomiary w kolejności czasu.
+ * @param bucketSeconds Długość przedziału w sekundach.
+ * @return Przedziały w kolejności czasu.
+ */
+QVector<RollupPoint> SeriesStore::rollUpPoints(const QVector<MeasurementPoint> &points, qint64 bucketSeconds) {
+    QVector<RollupPoint> rollups;
+    for (const MeasurementPoint &point : points) {
+        if (!point.valid) {
+            continue;
+        }
+        qint64 start = bucketStart(point.timestamp, bucketSeconds);
+        if (rollups.isEmpty() || rollups.last().timestamp != start) {
+            rollups.append({start, qint32(bucketSeconds), 1, point.value, point.value, point.value});
+            continue;
+        }
+        RollupPoint &rollup = rollups.last();
+        rollup.min = qMin(rollup.min, point.value);
+        rollup.max = qMax(rollup.max, point.value);
+        rollup.count++;
+        rollup.mean += (point.value - rollup.mean) / float(rollup.count);
+    }
+    return rollups;
+}
+
+/**
+ * @brief Łączy przedziały w przedziały o podanej długości.
+ *
+ * Średnia połączonego przedziału jest ważona liczbą pomiarów. Przedziały dłuższe
+ * niż bucketSeconds (np. dobowe przy łączeniu w przedziały sześciogodzinne)
+ * są zachowywane bez zmian.
+ *
+ * @param rollups Przedziały w dowolnej kolejności.
+ * @param bucketSeconds Długość przedziału w sekundach.
+ * @return Połączone przedziały w kolejności czasu.
+ */
+QVector<RollupPoint> SeriesStore::combineRollups(const QVector<RollupPoint> &rollups, qint64 bucketSeconds) {
+    QMap<qint64, RollupPoint> buckets;
+    for (const RollupPoint &rollup : rollups) {
+        if (rollup.count == 0) {
+            continue;
+        }
+        qint64 start = rollup.duration >= bucketSeconds ? rollup.timestamp : bucketStart(rollup.timestamp, bucketSeconds);
+        auto it = buckets.find(start);
+        if (it == buckets.end()) {
+            RollupPoint combined = rollup;
+            combined.timestamp = start;
+            combined.duration = qint32(qMax(qint64(rollup.duration), bucketSeconds));
+            buckets.insert(start, combined);
+            continue;
+        }
+        quint32 total = it->count + rollup.count;
+        it->mean = float((double(it->mean) * it->count + double(rollup.mean) * rollup.count) / total);
+        it->min = qMin(it->min, rollup.min);
+        it->max = qMax(it->max, rollup.max);
+        it->count = total;
+        it->duration = qMax(it->duration, rollup.duration);
+    }
+    return QVector<RollupPoint>(buckets.cbegin(), buckets.cend());
+}
+
+/**
+ * @brief Zamienia datę pomiaru na sekundy od epoki.
+ *
+ * Daty z API GIOŚ są podawane w czasie lokalnym stacji bez strefy czasowej. Są one
+ * interpretowane jako UTC, dzięki czemu konwersja jest odwracalna i nie zależy
+ * od strefy czasowej komputera.
+ *
+ * @param date Data w formacie "yyyy-MM-dd HH:mm:ss".
+ * @param ok Ustawiane na false, jeśli data jest niepoprawna.
+ * @return Sekundy od epoki.
+ */
+qint64 SeriesStore::toEpochSeconds(const QString &date, bool *ok) {
+    QDateTime dateTime = QDateTime::fromString(date, DATE_FORMAT);
+    if (ok) {
+        *ok = dateTime.isValid();
+    }
+    if (!dateTime.isValid()) {
+        return 0;
+    }
+    return QDateTime(dateTime.date(), dateTime.time(), QTimeZone::utc()).toSecsSinceEpoch();
+}
+
+/**
+ * @brief Zamienia sekundy od epoki na datę pomiaru.
+ *
+ * @param seconds Sekundy od epoki.
+ * @return Data w formacie "yyyy-MM-dd HH:mm:ss".
+ */
+QString SeriesStore::fromEpochSeconds(qint64 seconds) {
+    return QDateTime::fromSecsSinceEpoch(seconds, QTimeZone::utc()).toString(DATE_FORMAT);
+}
+
+/**
+ * @brief Sortuje pomiary według znaczników czasu i usuwa powtórzone godziny.
+ *
+ * Dla powtórzonego znacznika czasu zachowywany jest ostatni pomiar.
+ *
+ * @param points Pomiary w dowolnej kolejności.
+ * @return Posortowane pomiary z unikalnymi znacznikami czasu.
+ */
+QVector<MeasurementPoint> SeriesStore::sortedUnique(QVector<MeasurementPoint> points) {
+    std::stable_sort(points.begin(), points.end(), [](const MeasurementPoint &a, const MeasurementPoint &b) {
+        return a.timestamp < b.timestamp;
+    });
+    QVector<MeasurementPoint> unique;
+    unique.reserve(points.size());
+    for (const MeasurementPoint &point : points) {
+        if (!unique.isEmpty() && unique.last().timestamp == point.timestamp) {
+            unique.last() = point;
+        } else {
+            unique.append(point);
+        }
+    }
+    return unique;
+}
+
+/**
+ * @brief Dopisuje pomiary na końcu kolumn szeregu.
+ *
+ * Pomiary są dopisywane do kolumn bieżącego pokolenia. Kolumny są najpierw przycinane
+ * do wspólnej długości (na wypadek przerwanego wcześniejszego zapisu), a następnie
+ * nowe wartości są dopisywane na ich końcu. Czytelnicy tego pokolenia widzą tylko
+ * kompletne pomiary, bo długość szeregu wyznacza najkrótsza kolumna.
+ *
+ * @param base Ścieżka plików szeregu bez rozszerzenia.
+ * @param points Pomiary do dopisania.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SeriesStore::appendColumns(const QString &base, const QVector<MeasurementPoint> &points) {
+    QString columnsPath = HistoryLock::generationPrefix(base, HistoryLock::readGeneration(generationFilePath(base)));
+    QFile timestampFile(columnsPath + ".ts");
+    QFile valueFile(columnsPath + ".val");
+    QFile validityFile(columnsPath + ".valid");
+    if (!timestampFile.open(QIODevice::ReadWrite)
+        || !valueFile.open(QIODevice::ReadWrite)
+        || !validityFile.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open series files for writing:" << columnsPath;
+        return false;
+    }
+
+    qsizetype existing = seriesLength(timestampFile.size(), valueFile.size(), validityFile.size());
+    QByteArray timestampBytes;
+    QByteArray valueBytes;
+    QByteArray validityBytes;
+    encodeColumns(points, existing, timestampBytes, valueBytes, validityBytes);
+
+    // Keep the already written bits of a partially filled last bitmap byte
+    if (existing % 8 != 0) {
+        validityFile.seek(existing / 8);
+        char lastByte = 0;
+        validityFile.getChar(&lastByte);
+        validityBytes[0] = char(uchar(validityBytes[0]) | (uchar(lastByte) & ((1 << (existing % 8)) - 1)));
+    }
+
+    // Timestamps are written last, so an interrupted append never exposes a row without its value
+    bool ok = valueFile.resize(existing * qint64(sizeof(float))) && valueFile.seek(valueFile.size())
+              && valueFile.write(valueBytes) == valueBytes.size();
+    ok = ok && validityFile.seek(existing / 8) && validityFile.write(validityBytes) == validityBytes.size();
+    ok = ok && timestampFile.resize(existing * qint64(sizeof(qint64))) && timestampFile.seek(timestampFile.size())
+         && timestampFile.write(timestampBytes) == timestampBytes.size();
+
+    if (!ok) {
+        qDebug() << "Failed to append to series:" << columnsPath;
+    }
+    return ok;
+}
+
+/**
+ * @brief Nadpisuje wartości i bity poprawności kolejnych pomiarów szeregu w miejscu.
+ *
+ * Znaczniki czasu się nie zmieniają, więc zapisywane są tylko kolumna wartości
+ * i fragment bitmapy. Bity sąsiednich pomiarów we wspólnych bajtach bitmapy są
+ * zachowywane. Czytelnicy bieżącego pokolenia widzą starą lub nową wartość pomiaru.
+ *
+ * @param base Ścieżka plików szeregu bez rozszerzenia.
+ * @param offset Indeks pierwszego nadpisywanego pomiaru.
+ * @param points Nowe pomiary od indeksu offset (ze znacznikami czasu jak w szeregu).
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SeriesStore::overwriteColumns(const QString &base, qsizetype offset, const QVector<MeasurementPoint> &points) {
+    QString columnsPath = HistoryLock::generationPrefix(base, HistoryLock::readGeneration(generationFilePath(base)));
+    QFile valueFile(columnsPath + ".val");
+    QFile validityFile(columnsPath + ".valid");
+    if (!valueFile.open(QIODevice::ReadWrite) || !validityFile.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open series files for writing:" << columnsPath;
+        return false;
+    }
+
+    QByteArray timestampBytes;
+    QByteArray valueBytes;
+    QByteArray validityBytes;
+    encodeColumns(points, offset, timestampBytes, valueBytes, validityBytes);
+
+    // Keep the bits of neighbouring rows that share the first and last bitmap bytes
+    QByteArray storedBytes;
+    if (validityFile.seek(offset / 8)) {
+        storedBytes = validityFile.read(validityBytes.size());
+    }
+    if (storedBytes.size() != validityBytes.size()) {
+        qDebug() << "Failed to read series validity:" << columnsPath;
+        return false;
+    }
+    const qsizetype end = offset + points.size();
+    for (qsizetype b = 0; b < validityBytes.size(); ++b) {
+        uchar covered = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            qsizetype index = (offset / 8 + b) * 8 + bit;
+            if (index >= offset && index < end) {
+                covered |= uchar(1 << bit);
+            }
+        }
+        validityBytes[b] = char((uchar(validityBytes[b]) & covered) | (uchar(storedBytes[b]) & ~covered));
+    }
+
+    bool ok = valueFile.seek(offset * qint64(sizeof(float))) && valueFile.write(valueBytes) == valueBytes.size();
+    ok = ok && validityFile.seek(offset / 8) && validityFile.write(validityBytes) == validityBytes.size();
+    if (!ok) {
+        qDebug() << "Failed to overwrite series:" << columnsPath;
+    }
+    return ok;
+}
+
+/**
+ * @brief Przepisuje wszystkie kolumny szeregu.
+ *
+ * Kolumny są zapisywane jako nowe pokolenie szeregu (każda atomowo, przez QSaveFile),
+ * po czym wskaźnik pokolenia jest przełączany na nie, a pokolenia starsze niż
+ * dotychczasowe są usuwane. Czytelnicy dotychczasowego pokolenia, w tym otwarte
+ * wcześniej obiekty SensorSeries, nie widzą częściowo przepisanego szeregu.
+ *
+ * @param base Ścieżka plików szeregu bez rozszerzenia.
+ * @param points Pełna zawartość szeregu.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SeriesStore::rewriteColumns(const QString &base, const QVector<MeasurementPoint> &points) {
+    QByteArray timestampBytes;
+    QByteArray valueBytes;
+    QByteArray validityBytes;
+    encodeColumns(points, 0, timestampBytes, valueBytes, validityBytes);
+
+    quint64 generation = HistoryLock::readGeneration(generationFilePath(base));
+    QString columnsPath = HistoryLock::generationPrefix(base, generation + 1);
+    const QList<QPair<QString, const QByteArray *>> columns = {
+        {columnsPath + ".val", &valueBytes},
+        {columnsPath + ".valid", &validityBytes},
+        {columnsPath + ".ts", &timestampBytes}
+    };
+    for (const auto &column : columns) {
+        QSaveFile file(column.first);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qDebug() << "Failed to open series file for writing:" << column.first << "Error:" << file.errorString();
+            return false;
+        }
+        file.write(*column.second);
+        if (!file.commit()) {
+            qDebug() << "Failed to rewrite series file:" << column.first << "Error:" << file.errorString();
+            return false;
+        }
+    }
+
+    if (!HistoryLock::writeGeneration(generationFilePath(base), generation + 1)) {
+        return false;
+    }
+    QFileInfo baseInfo(base);
+    HistoryLock::removeGenerationsBefore(baseInfo.dir(), baseInfo.fileName(), COLUMN_SUFFIXES, generation);
+    return true;
+}
+
+/**
+ * @brief Koduje pomiary jako bajty kolumn szeregu.
+ *
+ * @param points Pomiary do zakodowania.
+ * @param offset Indeks pierwszego pomiaru w szeregu (określa położenie bitów w bitmapie).
+ * @param timestampBytes Bajty kolumny znaczników czasu.
+ * @param valueBytes Bajty kolumny wartości.
+ * @param validityBytes Bajty bitmapy, począwszy od bajtu zawierającego bit offset.
+ */
+void SeriesStore::encodeColumns(const QVector<MeasurementPoint> &points, qsizetype offset,
+                                QByteArray &timestampBytes, QByteArray &valueBytes, QByteArray &validityBytes) {
+    qsizetype total = offset + points.size();
+    timestampBytes = QByteArray(points.size() * qsizetype(sizeof(qint64)), Qt::Uninitialized);
+    valueBytes = QByteArray(points.size() * qsizetype(sizeof(float)), Qt::Uninitialized);
+    validityBytes = QByteArray((total + 7) / 8 - offset / 8, '\0');
+
+    for (qsizetype i = 0; i < points.size(); ++i) {
+        const MeasurementPoint &point = points[i];
+        std::memcpy(timestampBytes.data() + i * sizeof(qint64), &point.timestamp, sizeof(qint64));
+        std::memcpy(valueBytes.data() + i * sizeof(float), &point.value, sizeof(float));
+        if (point.valid) {
+            qsizetype bit = offset + i;
+            validityBytes[bit / 8 - offset / 8] = char(uchar(validityBytes[bit / 8 - offset / 8]) | (1 << (bit % 8)));
+        }
+    }
+}
+
+/**
+ * @brief Wczytuje przedziały jednego poziomu agregacji.
+ *
+ * Niepełny rekord na końcu pliku (przerwany zapis) jest pomijany.
+ *
+ * @param path Ścieżka pliku poziomu.
+ * @param duration Długość przedziału w sekundach.
+ * @return Przedziały w kolejności czasu.
+ */
+QVector<RollupPoint> SeriesStore::readRollups(const QString &path, qint64 duration) {
+    QVector<RollupPoint> rollups;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return rollups;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    qsizetype count = data.size() / ROLLUP_RECORD_SIZE;
+    rollups.reserve(count);
+    const char *record = data.constData();
+    for (qsizetype i = 0; i < count; ++i, record += ROLLUP_RECORD_SIZE) {
+        RollupPoint rollup;
+        rollup.duration = qint32(duration);
+        std::memcpy(&rollup.timestamp, record, sizeof(qint64));
+        std::memcpy(&rollup.min, record + 8, sizeof(float));
+        std::memcpy(&rollup.max, record + 12, sizeof(float));
+        std::memcpy(&rollup.mean, record + 16, sizeof(float));
+        std::memcpy(&rollup.count, record + 20, sizeof(quint32));
+        rollups.append(rollup);
+    }
+    return rollups;
+}
+
+/**
+ * @brief Przepisuje plik poziomu agregacji.
+ *
+ * Plik jest zapisywany atomowo przez QSaveFile; pusta lista usuwa plik.
+ *
+ * @param path Ścieżka pliku poziomu.
+ * @param rollups Pełna zawartość poziomu.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SeriesStore::writeRollups(const QString &path, const QVector<RollupPoint> &rollups) {
+    if (rollups.isEmpty()) {
+        return !QFile::exists(path) || QFile::remove(path);
+    }
+
+    QByteArray data(rollups.size() * ROLLUP_RECORD_SIZE, Qt::Uninitialized);
+    char *record = data.data();
+    for (const RollupPoint &rollup : rollups) {
+        std::memcpy(record, &rollup.timestamp, sizeof(qint64));
+        std::memcpy(record + 8, &rollup.min, sizeof(float));
+        std::memcpy(record + 12, &rollup.max, sizeof(float));
+        std::memcpy(record + 16, &rollup.mean, sizeof(float));
+        std::memcpy(record + 20, &rollup.count, sizeof(quint32));
+        record += ROLLUP_RECORD_SIZE;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open rollup file for writing:" << path << "Error:" << file.errorString();
+        return false;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        qDebug() << "Failed to write rollup file:" << path << "Error:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Zwraca ścieżkę plików szeregu bez rozszerzenia.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @return Ścieżka bazowa plików szeregu.
+ */
+QString SeriesStore::basePath(int sensorId) const {
+    return m_rootDir.filePath(QString("sensor_%1").arg(sensorId));
+}
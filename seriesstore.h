@@ -0,0 +1,306 @@
+#ifndef SERIESSTORE_H
+#define SERIESSTORE_H
+
+#include <QDir>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+/**
+ * @struct MeasurementPoint
+ * @brief Pojedynczy pomiar sensora w postaci binarnej.
+ */
+struct MeasurementPoint {
+    qint64 timestamp; ///< Czas pomiaru w sekundach od epoki (czas lokalny stacji zapisany jako UTC).
+    float value;      ///< Wartość pomiaru.
+    bool valid;       ///< Czy wartość jest dostępna (API zwraca null dla brakujących pomiarów).
+};
+
+/**
+ * @struct RollupPoint
+ * @brief Zagregowane pomiary sensora z jednego przedziału czasu (min/max/średnia).
+ */
+struct RollupPoint {
+    qint64 timestamp; ///< Początek przedziału w sekundach od epoki.
+    qint32 duration;  ///< Długość przedziału w sekundach.
+    quint32 count;    ///< Liczba poprawnych pomiarów godzinowych w przedziale.
+    float min;        ///< Najmniejsza wartość.
+    float max;        ///< Największa wartość.
+    float mean;       ///< Średnia wartość.
+};
+
+/**
+ * @class SensorSeries
+ * @brief Zmapowany w pamięci szereg czasowy jednego sensora.
+ *
+ * Dane są przechowywane kolumnowo w trzech plikach: znaczniki czasu (qint64),
+ * wartości (float) oraz bitmapa poprawności wartości. Obiekt udostępnia surowe
+ * tablice bez kopiowania i bez parsowania tekstu.
+ */
+class SensorSeries
+{
+public:
+    /**
+     * @brief Destruktor klasy SensorSeries. Zwalnia mapowania plików.
+     */
+    ~SensorSeries();
+
+    /**
+     * @brief Otwiera i mapuje w pamięci pliki szeregu.
+     * @param basePath Ścieżka do plików szeregu bez rozszerzenia.
+     * @return Wskaźnik na szereg lub pusty wskaźnik, jeśli szereg nie istnieje.
+     */
+    static QSharedPointer<SensorSeries> open(const QString &basePath);
+
+    /**
+     * @brief Zwraca liczbę pomiarów w szeregu.
+     * @return Liczba pomiarów.
+     */
+    qsizetype size() const { return m_size; }
+
+    /**
+     * @brief Zwraca kolumnę znaczników czasu.
+     * @return Wskaźnik na tablicę size() znaczników czasu.
+     */
+    const qint64 *timestamps() const { return m_timestamps; }
+
+    /**
+     * @brief Zwraca kolumnę wartości.
+     * @return Wskaźnik na tablicę size() wartości.
+     */
+    const float *values() const { return m_values; }
+
+    /**
+     * @brief Sprawdza, czy wartość pod danym indeksem jest dostępna.
+     * @param index Indeks pomiaru.
+     * @return true, jeśli wartość jest poprawna; false w przeciwnym razie.
+     */
+    bool isValid(qsizetype index) const { return (m_validity[index / 8] >> (index % 8)) & 1; }
+
+private:
+    /**
+     * @brief Konstruktor klasy SensorSeries (używany przez open()).
+     */
+    SensorSeries();
+    Q_DISABLE_COPY(SensorSeries)
+
+    QFile m_timestampFile;        ///< Plik ze znacznikami czasu.
+    QFile m_valueFile;            ///< Plik z wartościami.
+    QFile m_validityFile;         ///< Plik z bitmapą poprawności.
+    const qint64 *m_timestamps;   ///< Zmapowana kolumna znaczników czasu.
+    const float *m_values;        ///< Zmapowana kolumna wartości.
+    const uchar *m_validity;      ///< Zmapowana bitmapa poprawności.
+    qsizetype m_size;             ///< Liczba pomiarów.
+};
+
+/**
+ * @class SeriesStore
+ * @brief Kolumnowy magazyn szeregów czasowych sensorów.
+ *
+ * Dla każdego sensora przechowuje jeden szereg (pliki sensor_<id>.ts, sensor_<id>.val
+ * i sensor_<id>.valid), współdzielony przez wszystkie sesje. Szereg jest posortowany
+ * według czasu i zawiera jeden pomiar na godzinę, a sesje odwołują się do zakresu
+ * czasu w szeregu.
+ * Odczyt odbywa się przez mapowanie plików w pamięci. Pliki są zapisywane
+ * w natywnej kolejności bajtów i nie są przenośne między platformami.
+ *
+ * Starsze pomiary mogą być przeniesione przez rollUp() do poziomów zagregowanych:
+ * przedziałów sześciogodzinnych (sensor_<id>.r6h), a potem dobowych (sensor_<id>.r1d).
+ * Pliki poziomów zawierają posortowane rekordy o stałym rozmiarze.
+ *
+ * Przepisanie szeregu tworzy nowe pokolenie kolumn (sensor_<id>.g<n>.ts itd.),
+ * wskazywane przez plik sensor_<id>.generation, więc odczyt nie wymaga blokady.
+ * Nowe pomiary są dopisywane do bieżącego pokolenia, a zmienione wartości zapisanych
+ * godzin nadpisywane w miejscu; nowe pokolenie powstaje tylko przy wstawieniu
+ * pomiaru między zapisane godziny, agregacji i usuwaniu danych.
+ * Metody zapisujące (append(), rollUp(), trimBefore()) muszą być wywoływane
+ * z założoną blokadą zapisu historii (HistoryLock).
+ */
+class SeriesStore
+{
+public:
+    /**
+     * @brief Konstruktor klasy SeriesStore.
+     * @param rootPath Katalog główny magazynu.
+     */
+    explicit SeriesStore(const QString &rootPath);
+
+    /**
+     * @brief Scala pomiary z szeregiem sensora (nowszy pomiar tej samej godziny wygrywa).
+     * @param sensorId Identyfikator sensora.
+     * @param incoming Pomiary do zapisania.
+     * @return Liczba nowych lub zmienionych pomiarów lub -1 w przypadku błędu.
+     */
+    int append(int sensorId, const QVector<MeasurementPoint> &incoming);
+
+    /**
+     * @brief Otwiera szereg sensora do odczytu.
+     * @param sensorId Identyfikator sensora.
+     * @return Wskaźnik na zmapowany szereg lub pusty wskaźnik.
+     */
+    QSharedPointer<const SensorSeries> open(int sensorId) const;
+
+    /**
+     * @brief Zwraca pomiary sensora z podanego przedziału czasu (wyszukiwanie binarne).
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek przedziału (sekundy od epoki, włącznie).
+     * @param to Koniec przedziału (sekundy od epoki, włącznie).
+     * @return Pomiary w kolejności czasu.
+     */
+    QVector<MeasurementPoint> range(int sensorId, qint64 from, qint64 to) const;
+
+    /**
+     * @brief Przenosi starsze pomiary sensora do poziomów zagregowanych.
+     * @param sensorId Identyfikator sensora.
+     * @param rawBefore Pomiary sprzed tej chwili trafiają do przedziałów sześciogodzinnych.
+     * @param rollupBefore Przedziały sześciogodzinne sprzed tej chwili trafiają do przedziałów dobowych.
+     * @return Liczba przeniesionych pomiarów i przedziałów lub -1 w przypadku błędu.
+     */
+    int rollUp(int sensorId, qint64 rawBefore, qint64 rollupBefore);
+
+    /**
+     * @brief Zwraca zagregowane pomiary sensora nakładające się na podany przedział czasu.
+     * @param sensorId Identyfikator sensora.
+     * @param from Początek przedziału (sekundy od epoki, włącznie).
+     * @param to Koniec przedziału (sekundy od epoki, włącznie).
+     * @return Przedziały dobowe i sześciogodzinne w kolejności czasu.
+     */
+    QVector<RollupPoint> rollups(int sensorId, qint64 from, qint64 to) const;
+
+    /**
+     * @brief Usuwa dane sensora (ze wszystkich poziomów) sprzed podanej chwili.
+     * @param sensorId Identyfikator sensora.
+     * @param cutoff Dane kończące się przed tą chwilą są usuwane.
+     * @return Szacowana liczba zwolnionych bajtów lub -1 w przypadku błędu.
+     */
+    qint64 trimBefore(int sensorId, qint64 cutoff);
+
+    /**
+     * @brief Zwraca czas najstarszych danych sensora na dowolnym poziomie.
+     * @param sensorId Identyfikator sensora.
+     * @return Sekundy od epoki lub -1, jeśli sensor nie ma danych.
+     */
+    qint64 oldestTimestamp(int sensorId) const;
+
+    /**
+     * @brief Zwraca identyfikatory sensorów, które mają dane w magazynie.
+     * @return Lista identyfikatorów sensorów.
+     */
+    QList<int> sensorIds() const;
+
+    /**
+     * @brief Agreguje pomiary godzinowe w przedziały o podanej długości.
+     * @param points Pomiary w kolejności czasu.
+     * @param bucketSeconds Długość przedziału w sekundach.
+     * @return Przedziały w kolejności czasu (bez przedziałów bez poprawnych pomiarów).
+     */
+    static QVector<RollupPoint> rollUpPoints(const QVector<MeasurementPoint> &points, qint64 bucketSeconds);
+
+    /**
+     * @brief Łączy przedziały w przedziały o podanej długości.
+     * @param rollups Przedziały w dowolnej kolejności.
+     * @param bucketSeconds Długość przedziału w sekundach; dłuższe przedziały nie są dzielone.
+     * @return Połączone przedziały w kolejności czasu.
+     */
+    static QVector<RollupPoint> combineRollups(const QVector<RollupPoint> &rollups, qint64 bucketSeconds);
+
+    /**
+     * @brief Długość przedziału pierwszego poziomu agregacji (sekundy).
+     */
+    static const qint64 ROLLUP_BUCKET_SECONDS = 6 * 3600;
+
+    /**
+     * @brief Długość przedziału poziomu dobowego (sekundy).
+     */
+    static const qint64 DAILY_BUCKET_SECONDS = 24 * 3600;
+
+    /**
+     * @brief Zamienia datę w formacie "yyyy-MM-dd HH:mm:ss" na sekundy od epoki.
+     * @param date Data pomiaru.
+     * @param ok Ustawiane na false, jeśli data jest niepoprawna.
+     * @return Sekundy od epoki.
+     */
+    static qint64 toEpochSeconds(const QString &date, bool *ok = nullptr);
+
+    /**
+     * @brief Zamienia sekundy od epoki na datę w formacie "yyyy-MM-dd HH:mm:ss".
+     * @param seconds Sekundy od epoki.
+     * @return Data pomiaru.
+     */
+    static QString fromEpochSeconds(qint64 seconds);
+
+    /**
+     * @brief Sortuje pomiary według znaczników czasu, zachowując ostatni pomiar danej godziny.
+     * @param points Pomiary w dowolnej kolejności.
+     * @return Posortowane pomiary z unikalnymi znacznikami czasu.
+     */
+    static QVector<MeasurementPoint> sortedUnique(QVector<MeasurementPoint> points);
+
+private:
+    /**
+     * @brief Dopisuje pomiary na końcu kolumn szeregu.
+     * @param base Ścieżka plików szeregu bez rozszerzenia.
+     * @param points Pomiary do dopisania.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    static bool appendColumns(const QString &base, const QVector<MeasurementPoint> &points);
+
+    /**
+     * @brief Nadpisuje wartości i bity poprawności kolejnych pomiarów szeregu w miejscu.
+     * @param base Ścieżka plików szeregu bez rozszerzenia.
+     * @param offset Indeks pierwszego nadpisywanego pomiaru.
+     * @param points Nowe pomiary od indeksu offset.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    static bool overwriteColumns(const QString &base, qsizetype offset, const QVector<MeasurementPoint> &points);
+
+    /**
+     * @brief Przepisuje wszystkie kolumny szeregu.
+     * @param base Ścieżka plików szeregu bez rozszerzenia.
+     * @param points Pełna zawartość szeregu.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    static bool rewriteColumns(const QString &base, const QVector<MeasurementPoint> &points);
+
+    /**
+     * @brief Koduje pomiary jako bajty kolumn szeregu.
+     * @param points Pomiary do zakodowania.
+     * @param offset Indeks pierwszego pomiaru w szeregu.
+     * @param timestampBytes Bajty kolumny znaczników czasu.
+     * @param valueBytes Bajty kolumny wartości.
+     * @param validityBytes Bajty bitmapy poprawności.
+     */
+    static void encodeColumns(const QVector<MeasurementPoint> &points, qsizetype offset,
+                              QByteArray &timestampBytes, QByteArray &valueBytes, QByteArray &validityBytes);
+
+    /**
+     * @brief Wczytuje przedziały jednego poziomu agregacji.
+     * @param path Ścieżka pliku poziomu.
+     * @param duration Długość przedziału w sekundach.
+     * @return Przedziały w kolejności czasu.
+     */
+    static QVector<RollupPoint> readRollups(const QString &path, qint64 duration);
+
+    /**
+     * @brief Przepisuje plik poziomu agregacji (pusta lista usuwa plik).
+     * @param path Ścieżka pliku poziomu.
+     * @param rollups Pełna zawartość poziomu.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    static bool writeRollups(const QString &path, const QVector<RollupPoint> &rollups);
+
+    /**
+     * @brief Zwraca ścieżkę plików szeregu bez rozszerzenia.
+     * @param sensorId Identyfikator sensora.
+     * @return Ścieżka bazowa plików szeregu.
+     */
+    QString basePath(int sensorId) const;
+
+    /**
+     * @brief Katalog główny magazynu.
+     */
+    QDir m_rootDir;
+};
+
+#endif // SERIESSTORE_H
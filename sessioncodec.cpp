@@ -0,0 +1,155 @@
+#include "sessioncodec.h"
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace {
+
+// CBOR self-describe tag (RFC 8949, section 3.4.6) and the compressed payload header
+const QByteArray CBOR_SIGNATURE("\xD9\xD9\xF7", 3);
+const QByteArray COMPRESSED_MAGIC("QCBZ");
+
+} // namespace
+
+/**
+ * @brief Koduje dane sesji w podanym formacie.
+ *
+ * JSON jest zapisywany w trybie Compact. CBOR jest oznaczany znacznikiem samoopisu,
+ * a wersja skompresowana dodatkowo nagłówkiem COMPRESSED_MAGIC.
+ *
+ * @param data Dane sesji.
+ * @param format Format zapisu.
+ * @return Zakodowane dane.
+ */
+QByteArray SessionCodec::encode(const QVariantMap &data, Format format) {
+    if (format == Json) {
+        return QJsonDocument(QJsonObject::fromVariantMap(data)).toJson(QJsonDocument::Compact);
+    }
+
+    QByteArray cbor = QCborValue(QCborKnownTags::Signature, QCborMap::fromVariantMap(data)).toCbor();
+    if (format == CompressedCbor) {
+        return COMPRESSED_MAGIC + qCompress(cbor);
+    }
+    return cbor;
+}
+
+/**
+ * @brief Dekoduje dane sesji, rozpoznając format po zawartości.
+ *
+ * @param encoded Zakodowane dane.
+ * @param ok Ustawiane na true, jeśli dekodowanie się powiodło (opcjonalnie).
+ * @return Dane sesji lub pusta mapa w przypadku błędu.
+ */
+QVariantMap SessionCodec::decode(const QByteArray &encoded, bool *ok) {
+    if (ok) {
+        *ok = false;
+    }
+
+    Format format = detect(encoded);
+    if (format == Json) {
+        QJsonDocument doc = QJsonDocument::fromJson(encoded);
+        if (doc.isNull() || !doc.isObject()) {
+            return QVariantMap();
+        }
+        if (ok) {
+            *ok = true;
+        }
+        return doc.object().toVariantMap();
+    }
+
+    QByteArray cbor = uncompressed(encoded);
+    if (cbor.isEmpty()) {
+        return QVariantMap();
+    }
+
+    QCborParserError error;
+    QCborValue value = QCborValue::fromCbor(cbor, &error);
+    if (error.error != QCborError::NoError) {
+        qDebug() << "Failed to parse CBOR session data:" << error.errorString();
+        return QVariantMap();
+    }
+    if (value.isTag()) {
+        value = value.taggedValue();
+    }
+    if (!value.isMap()) {
+        return QVariantMap();
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return value.toMap().toVariantMap();
+}
+
+/**
+ * @brief Zwraca dane po dekompresji.
+ *
+ * @param encoded Zakodowane dane.
+ * @return Dane CBOR lub JSON; pusta tablica, jeśli dekompresja się nie powiodła.
+ */
+QByteArray SessionCodec::uncompressed(const QByteArray &encoded) {
+    if (detect(encoded) != CompressedCbor) {
+        return encoded;
+    }
+    QByteArray data = qUncompress(encoded.mid(COMPRESSED_MAGIC.size()));
+    if (data.isEmpty()) {
+        qDebug() << "Failed to decompress CBOR session data";
+    }
+    return data;
+}
+
+/**
+ * @brief Rozpoznaje format zakodowanych danych.
+ *
+ * @param encoded Zakodowane dane.
+ * @return Format danych (Json, jeśli dane nie mają nagłówka CBOR).
+ */
+SessionCodec::Format SessionCodec::detect(const QByteArray &encoded) {
+    if (encoded.startsWith(COMPRESSED_MAGIC)) {
+        return CompressedCbor;
+    }
+    if (encoded.startsWith(CBOR_SIGNATURE)) {
+        return Cbor;
+    }
+    return Json;
+}
+
+/**
+ * @brief Zwraca format o podanej nazwie.
+ *
+ * @param name Nazwa formatu ("json", "cbor" lub "cbor-compressed").
+ * @param fallback Format zwracany dla nieznanej nazwy.
+ * @return Format zapisu.
+ */
+SessionCodec::Format SessionCodec::formatFromName(const QString &name, Format fallback) {
+    if (name == "json") {
+        return Json;
+    }
+    if (name == "cbor") {
+        return Cbor;
+    }
+    if (name == "cbor-compressed") {
+        return CompressedCbor;
+    }
+    qDebug() << "Unknown session format:" << name << "- using" << formatName(fallback);
+    return fallback;
+}
+
+/**
+ * @brief Zwraca nazwę formatu.
+ *
+ * @param format Format zapisu.
+ * @return Nazwa formatu.
+ */
+QString SessionCodec::formatName(Format format) {
+    switch (format) {
+    case Json:
+        return "json";
+    case Cbor:
+        return "cbor";
+    case CompressedCbor:
+        return "cbor-compressed";
+    }
+    return QString();
+}
@@ -0,0 +1,74 @@
+#ifndef SESSIONCODEC_H
+#define SESSIONCODEC_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariantMap>
+
+/**
+ * @class SessionCodec
+ * @brief Kodowanie danych sesji w formacie JSON lub binarnym CBOR.
+ *
+ * Dane CBOR są poprzedzone znacznikiem samoopisu (0xD9D9F7), a skompresowany CBOR
+ * nagłówkiem "QCBZ". Dzięki temu odczyt rozpoznaje format po zawartości i nadal
+ * obsługuje pliki JSON zapisane przez starsze wersje.
+ */
+class SessionCodec
+{
+public:
+    /**
+     * @brief Format zapisu danych sesji.
+     */
+    enum Format {
+        Json,           ///< Tekst JSON (format starszych wersji).
+        Cbor,           ///< Binarny CBOR.
+        CompressedCbor  ///< CBOR skompresowany funkcją qCompress().
+    };
+
+    /**
+     * @brief Koduje dane sesji w podanym formacie.
+     * @param data Dane sesji.
+     * @param format Format zapisu.
+     * @return Zakodowane dane.
+     */
+    static QByteArray encode(const QVariantMap &data, Format format);
+
+    /**
+     * @brief Dekoduje dane sesji, rozpoznając format po zawartości.
+     * @param encoded Zakodowane dane.
+     * @param ok Ustawiane na true, jeśli dekodowanie się powiodło (opcjonalnie).
+     * @return Dane sesji lub pusta mapa w przypadku błędu.
+     */
+    static QVariantMap decode(const QByteArray &encoded, bool *ok = nullptr);
+
+    /**
+     * @brief Zwraca dane po dekompresji (dla formatu CompressedCbor).
+     * @param encoded Zakodowane dane.
+     * @return Dane CBOR lub JSON; dla nieskompresowanych danych - dane wejściowe.
+     */
+    static QByteArray uncompressed(const QByteArray &encoded);
+
+    /**
+     * @brief Rozpoznaje format zakodowanych danych.
+     * @param encoded Zakodowane dane.
+     * @return Format danych (Json, jeśli dane nie mają nagłówka CBOR).
+     */
+    static Format detect(const QByteArray &encoded);
+
+    /**
+     * @brief Zwraca format o podanej nazwie.
+     * @param name Nazwa formatu ("json", "cbor" lub "cbor-compressed").
+     * @param fallback Format zwracany dla nieznanej nazwy.
+     * @return Format zapisu.
+     */
+    static Format formatFromName(const QString &name, Format fallback = Cbor);
+
+    /**
+     * @brief Zwraca nazwę formatu.
+     * @param format Format zapisu.
+     * @return Nazwa formatu.
+     */
+    static QString formatName(Format format);
+};
+
+#endif // SESSIONCODEC_H
@@ -0,0 +1,363 @@
+#include "sessiondocument.h"
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+
+namespace {
+
+/**
+ * @brief Odczytuje cały (także dzielony na fragmenty) tekst CBOR i przechodzi za niego.
+ */
+bool readCborText(QCborStreamReader &reader, QString &text) {
+    text.clear();
+    if (!reader.isString()) {
+        return false;
+    }
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        text += chunk.data;
+        chunk = reader.readString();
+    }
+    return chunk.status == QCborStreamReader::EndOfString;
+}
+
+/**
+ * @brief Odczytuje liczbę CBOR (całkowitą lub zmiennoprzecinkową) i przechodzi za nią.
+ */
+int readCborInt(QCborStreamReader &reader) {
+    int value = 0;
+    if (reader.isInteger()) {
+        value = int(reader.toInteger());
+    } else if (reader.isDouble()) {
+        value = int(reader.toDouble());
+    } else if (reader.isFloat()) {
+        value = int(reader.toFloat());
+    }
+    reader.next();
+    return value;
+}
+
+/**
+ * @brief Pomija białe znaki JSON.
+ */
+qsizetype skipJsonSpace(const QByteArray &data, qsizetype pos) {
+    while (pos < data.size() && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) {
+        ++pos;
+    }
+    return pos;
+}
+
+/**
+ * @brief Pomija tekst JSON zaczynający się od cudzysłowu.
+ * @return Pozycja za cudzysłowem zamykającym lub -1.
+ */
+qsizetype skipJsonString(const QByteArray &data, qsizetype pos) {
+    if (pos >= data.size() || data[pos] != '"') {
+        return -1;
+    }
+    for (++pos; pos < data.size(); ++pos) {
+        if (data[pos] == '\\') {
+            ++pos;
+        } else if (data[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Pomija dowolną wartość JSON bez jej dekodowania.
+ * @return Pozycja za wartością lub -1.
+ */
+qsizetype skipJsonValue(const QByteArray &data, qsizetype pos) {
+    if (pos >= data.size()) {
+        return -1;
+    }
+    char c = data[pos];
+    if (c == '"') {
+        return skipJsonString(data, pos);
+    }
+    if (c == '{' || c == '[') {
+        int depth = 0;
+        while (pos < data.size()) {
+            c = data[pos];
+            if (c == '"') {
+                pos = skipJsonString(data, pos);
+                if (pos < 0) {
+                    return -1;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return pos + 1;
+            }
+            ++pos;
+        }
+        return -1;
+    }
+
+    // Number, true, false or null
+    qsizetype begin = pos;
+    while (pos < data.size() && data[pos] != ',' && data[pos] != '}' && data[pos] != ']'
+           && data[pos] != ' ' && data[pos] != '\n' && data[pos] != '\r' && data[pos] != '\t') {
+        ++pos;
+    }
+    return pos > begin ? pos : -1;
+}
+
+/**
+ * @brief Dekoduje klucz JSON zajmujący fragment [begin, end) (razem z cudzysłowami).
+ */
+QString jsonKey(const QByteArray &data, qsizetype begin, qsizetype end) {
+    QByteArray raw = data.mid(begin + 1, end - begin - 2);
+    if (!raw.contains('\\')) {
+        return QString::fromUtf8(raw);
+    }
+    return QJsonDocument::fromJson("[" + data.mid(begin, end - begin) + "]").array().at(0).toString();
+}
+
+/**
+ * @brief Wywołuje visit(klucz, początek, koniec) dla każdego pola obiektu JSON.
+ * @return Pozycja za obiektem lub -1 w przypadku błędu.
+ */
+template<typename Visitor>
+qsizetype forEachJsonMember(const QByteArray &data, qsizetype pos, Visitor visit) {
+    pos = skipJsonSpace(data, pos);
+    if (pos >= data.size() || data[pos] != '{') {
+        return -1;
+    }
+    pos = skipJsonSpace(data, pos + 1);
+    if (pos < data.size() && data[pos] == '}') {
+        return pos + 1;
+    }
+    while (pos < data.size()) {
+        qsizetype keyEnd = skipJsonString(data, pos);
+        if (keyEnd < 0) {
+            return -1;
+        }
+        QString key = jsonKey(data, pos, keyEnd);
+        pos = skipJsonSpace(data, keyEnd);
+        if (pos >= data.size() || data[pos] != ':') {
+            return -1;
+        }
+        qsizetype valueBegin = skipJsonSpace(data, pos + 1);
+        qsizetype valueEnd = skipJsonValue(data, valueBegin);
+        if (valueEnd < 0 || !visit(key, valueBegin, valueEnd)) {
+            return -1;
+        }
+        pos = skipJsonSpace(data, valueEnd);
+        if (pos < data.size() && data[pos] == ',') {
+            pos = skipJsonSpace(data, pos + 1);
+        } else if (pos < data.size() && data[pos] == '}') {
+            return pos + 1;
+        } else {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Wywołuje visit(początek, koniec) dla każdego elementu tablicy JSON.
+ * @return Pozycja za tablicą lub -1 w przypadku błędu.
+ */
+template<typename Visitor>
+qsizetype forEachJsonElement(const QByteArray &data, qsizetype pos, Visitor visit) {
+    pos = skipJsonSpace(data, pos);
+    if (pos >= data.size() || data[pos] != '[') {
+        return -1;
+    }
+    pos = skipJsonSpace(data, pos + 1);
+    if (pos < data.size() && data[pos] == ']') {
+        return pos + 1;
+    }
+    while (pos < data.size()) {
+        qsizetype valueEnd = skipJsonValue(data, pos);
+        if (valueEnd < 0 || !visit(pos, valueEnd)) {
+            return -1;
+        }
+        pos = skipJsonSpace(data, valueEnd);
+        if (pos < data.size() && data[pos] == ',') {
+            pos = skipJsonSpace(data, pos + 1);
+        } else if (pos < data.size() && data[pos] == ']') {
+            return pos + 1;
+        } else {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+/**
+ * @brief Tworzy indeks zakodowanych danych sesji.
+ *
+ * Skompresowany CBOR jest najpierw rozpakowywany. Dane są przeglądane jeden raz;
+ * wartości pól są pomijane bez dekodowania.
+ *
+ * @param data Zawartość pliku sesji (CBOR lub JSON).
+ * @return Dokument; isValid() zwraca false, jeśli danych nie udało się zindeksować.
+ */
+SessionDocument SessionDocument::index(const QByteArray &data) {
+    SessionDocument document;
+    document.m_format = SessionCodec::detect(data);
+    document.m_data = SessionCodec::uncompressed(data);
+    document.m_valid = document.m_format == SessionCodec::Json ? document.indexJson() : document.indexCbor();
+    if (!document.m_valid) {
+        qDebug() << "Failed to index session data of" << data.size() << "bytes";
+        document.m_fields.clear();
+        document.m_sensors.clear();
+    }
+    return document;
+}
+
+/**
+ * @brief Dekoduje pole głównego obiektu sesji.
+ *
+ * @param key Nazwa pola (np. "stations", "location", "airQuality").
+ * @return Wartość pola lub niepoprawny QVariant, jeśli pole nie istnieje.
+ */
+QVariant SessionDocument::value(const QString &key) const {
+    auto it = m_fields.constFind(key);
+    if (it == m_fields.constEnd()) {
+        return QVariant();
+    }
+    return decode(it.value());
+}
+
+/**
+ * @brief Dekoduje sensory jednej stacji.
+ *
+ * Sensory innych stacji nie są dekodowane.
+ *
+ * @param stationId Identyfikator stacji.
+ * @return Lista sensorów stacji (elementy typu QVariantMap).
+ */
+QVariantList SessionDocument::stationSensors(int stationId) const {
+    QVariantList sensors;
+    for (const SensorSpan &sensor : m_sensors) {
+        if (sensor.stationId == stationId) {
+            sensors.append(decode(sensor.span));
+        }
+    }
+    return sensors;
+}
+
+/**
+ * @brief Indeksuje dane w formacie CBOR.
+ *
+ * Główny obiekt może być poprzedzony znacznikiem samoopisu CBOR.
+ *
+ * @return true, jeśli indeksowanie się powiodło.
+ */
+bool SessionDocument::indexCbor() {
+    QCborStreamReader reader(m_data);
+    if (reader.isTag()) {
+        reader.next();
+    }
+    if (!reader.isMap() || !reader.enterContainer()) {
+        return false;
+    }
+
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        QString key;
+        if (!readCborText(reader, key)) {
+            return false;
+        }
+        Span span;
+        span.offset = reader.currentOffset();
+
+        if (key == "sensors" && reader.isArray() && reader.enterContainer()) {
+            while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                SensorSpan sensor;
+                sensor.span.offset = reader.currentOffset();
+                if (reader.isMap() && reader.enterContainer()) {
+                    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                        QString sensorKey;
+                        if (!readCborText(reader, sensorKey)) {
+                            return false;
+                        }
+                        if (sensorKey == "id") {
+                            sensor.id = readCborInt(reader);
+                        } else if (sensorKey == "stationId") {
+                            sensor.stationId = readCborInt(reader);
+                        } else {
+                            reader.next();
+                        }
+                    }
+                    reader.leaveContainer();
+                } else {
+                    reader.next();
+                }
+                sensor.span.length = reader.currentOffset() - sensor.span.offset;
+                m_sensors.append(sensor);
+            }
+            reader.leaveContainer();
+        } else {
+            reader.next();
+        }
+
+        span.length = reader.currentOffset() - span.offset;
+        m_fields.insert(key, span);
+    }
+    return reader.lastError() == QCborError::NoError;
+}
+
+/**
+ * @brief Indeksuje dane w formacie JSON.
+ *
+ * Wartości są pomijane przez dopasowanie nawiasów i cudzysłowów, bez budowania
+ * drzewa QJsonValue.
+ *
+ * @return true, jeśli indeksowanie się powiodło.
+ */
+bool SessionDocument::indexJson() {
+    qsizetype parsed = forEachJsonMember(m_data, 0, [this](const QString &key, qsizetype begin, qsizetype end) {
+        m_fields.insert(key, Span{begin, end - begin});
+        if (key != "sensors" || m_data[begin] != '[') {
+            return true;
+        }
+        return forEachJsonElement(m_data, begin, [this](qsizetype sensorBegin, qsizetype sensorEnd) {
+            SensorSpan sensor;
+            sensor.span = Span{sensorBegin, sensorEnd - sensorBegin};
+            if (m_data[sensorBegin] == '{') {
+                qsizetype membersEnd = forEachJsonMember(m_data, sensorBegin, [this, &sensor](const QString &sensorKey, qsizetype valueBegin, qsizetype valueEnd) {
+                    if (sensorKey == "id") {
+                        sensor.id = int(m_data.mid(valueBegin, valueEnd - valueBegin).toDouble());
+                    } else if (sensorKey == "stationId") {
+                        sensor.stationId = int(m_data.mid(valueBegin, valueEnd - valueBegin).toDouble());
+                    }
+                    return true;
+                });
+                if (membersEnd < 0) {
+                    return false;
+                }
+            }
+            m_sensors.append(sensor);
+            return true;
+        }) >= 0;
+    });
+    return parsed >= 0;
+}
+
+/**
+ * @brief Dekoduje wartość z podanego fragmentu danych.
+ *
+ * Wartość JSON jest opakowywana w tablicę, bo QJsonDocument przyjmuje tylko
+ * obiekty i tablice.
+ *
+ * @param span Fragment danych.
+ * @return Zdekodowana wartość.
+ */
+QVariant SessionDocument::decode(const Span &span) const {
+    if (m_format == SessionCodec::Json) {
+        QByteArray wrapped = "[" + m_data.mid(span.offset, span.length) + "]";
+        return QJsonDocument::fromJson(wrapped).array().at(0).toVariant();
+    }
+    return QCborValue::fromCbor(m_data.constData() + span.offset, span.length).toVariant();
+}
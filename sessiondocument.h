@@ -0,0 +1,103 @@
+#ifndef SESSIONDOCUMENT_H
+#define SESSIONDOCUMENT_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVariant>
+#include <QVariantList>
+#include <QVector>
+#include "sessioncodec.h"
+
+/**
+ * @class SessionDocument
+ * @brief Indeks surowych bajtów pliku sesji z dekodowaniem na żądanie.
+ *
+ * Przy otwarciu plik jest przeglądany jeden raz bez tworzenia obiektów QVariant:
+ * zapamiętywane są przesunięcia pól głównego obiektu oraz każdego sensora wraz
+ * z jego identyfikatorem i identyfikatorem stacji. Dekodowane jest tylko to
+ * poddrzewo, o które poproszono. Obsługiwane są formaty CBOR i JSON.
+ */
+class SessionDocument
+{
+public:
+    /**
+     * @brief Tworzy indeks zakodowanych danych sesji.
+     * @param data Zawartość pliku sesji (CBOR lub JSON).
+     * @return Dokument; isValid() zwraca false, jeśli danych nie udało się zindeksować.
+     */
+    static SessionDocument index(const QByteArray &data);
+
+    /**
+     * @brief Sprawdza, czy dokument został poprawnie zindeksowany.
+     * @return true, jeśli dokument jest poprawny.
+     */
+    bool isValid() const { return m_valid; }
+
+    /**
+     * @brief Zwraca rozmiar zindeksowanych danych.
+     * @return Rozmiar w bajtach.
+     */
+    qsizetype size() const { return m_data.size(); }
+
+    /**
+     * @brief Dekoduje pole głównego obiektu sesji.
+     * @param key Nazwa pola (np. "stations", "location", "airQuality").
+     * @return Wartość pola lub niepoprawny QVariant, jeśli pole nie istnieje.
+     */
+    QVariant value(const QString &key) const;
+
+    /**
+     * @brief Dekoduje sensory jednej stacji.
+     * @param stationId Identyfikator stacji.
+     * @return Lista sensorów stacji (elementy typu QVariantMap).
+     */
+    QVariantList stationSensors(int stationId) const;
+
+private:
+    /**
+     * @struct Span
+     * @brief Fragment danych zajmowany przez jedną wartość.
+     */
+    struct Span {
+        qsizetype offset = 0; ///< Przesunięcie początku wartości.
+        qsizetype length = 0; ///< Długość wartości w bajtach.
+    };
+
+    /**
+     * @struct SensorSpan
+     * @brief Położenie jednego sensora w danych sesji.
+     */
+    struct SensorSpan {
+        int id = 0;        ///< Identyfikator sensora.
+        int stationId = 0; ///< Identyfikator stacji sensora.
+        Span span;         ///< Fragment danych sensora.
+    };
+
+    /**
+     * @brief Indeksuje dane w formacie CBOR.
+     * @return true, jeśli indeksowanie się powiodło.
+     */
+    bool indexCbor();
+
+    /**
+     * @brief Indeksuje dane w formacie JSON.
+     * @return true, jeśli indeksowanie się powiodło.
+     */
+    bool indexJson();
+
+    /**
+     * @brief Dekoduje wartość z podanego fragmentu danych.
+     * @param span Fragment danych.
+     * @return Zdekodowana wartość.
+     */
+    QVariant decode(const Span &span) const;
+
+    QByteArray m_data;                ///< Zawartość pliku (dla skompresowanego CBOR - po dekompresji).
+    SessionCodec::Format m_format = SessionCodec::Json; ///< Format danych.
+    QHash<QString, Span> m_fields;    ///< Pola głównego obiektu.
+    QVector<SensorSpan> m_sensors;    ///< Sensory w kolejności zapisu.
+    bool m_valid = false;             ///< Czy dokument został zindeksowany.
+};
+
+#endif // SESSIONDOCUMENT_H
@@ -0,0 +1,224 @@
+#include "sessionfilter.h"
+#include "seriesstore.h"
+#include <QVariantList>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief Nagłówek pliku filtra sesji.
+ *
+ * Wersja 1 pomijała stacje sesji (odczytywane z pola id zamiast stationId), więc
+ * takie filtry są traktowane jako uszkodzone i tworzone od nowa.
+ */
+const char FILTER_MAGIC[4] = {'Q', 'S', 'F', '2'};
+
+/**
+ * @brief Przedrostki kluczy odróżniające identyfikatory stacji od identyfikatorów sensorów.
+ */
+const quint64 STATION_KEY = quint64(1) << 32;
+const quint64 SENSOR_KEY = quint64(2) << 32;
+
+/**
+ * @brief Miesza bity klucza (SplitMix64), niezależnie od ziarna qHash() procesu.
+ */
+quint64 mixKey(quint64 key) {
+    key += 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+} // namespace
+
+/**
+ * @brief Sprawdza, czy sensor zapisany w sesji spełnia zapytanie.
+ *
+ * Zakres pomiarów sensora jest brany z pól seriesFrom i seriesTo, a dla sesji
+ * zapisanych przez starsze wersje - z dat pomiarów zapisanych w sensorze.
+ *
+ * @param sensor Dane sensora (z polami seriesFrom/seriesTo lub listą measurements).
+ * @return true, jeśli sensor pasuje do zapytania.
+ */
+bool SessionQuery::matchesSensor(const QVariantMap &sensor) const {
+    if (sensorId != 0 && sensor["id"].toInt() != sensorId) {
+        return false;
+    }
+    if (stationId != 0 && sensor["stationId"].toInt() != stationId) {
+        return false;
+    }
+    if (!hasTimeRange()) {
+        return true;
+    }
+    if (sensor.contains("seriesFrom")) {
+        return sensor["seriesFrom"].toLongLong() <= to && sensor["seriesTo"].toLongLong() >= from;
+    }
+    for (const QVariant &measurementVariant : sensor["measurements"].toList()) {
+        bool ok = false;
+        qint64 timestamp = SeriesStore::toEpochSeconds(measurementVariant.toMap()["date"].toString(), &ok);
+        if (ok && timestamp >= from && timestamp <= to) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Tworzy pusty filtr.
+ */
+SessionFilter::SessionFilter()
+    : m_bits(BLOOM_BITS / 8, '\0'), m_from(std::numeric_limits<qint64>::max()), m_to(std::numeric_limits<qint64>::min()) {
+}
+
+/**
+ * @brief Dodaje identyfikator stacji.
+ *
+ * @param stationId Identyfikator stacji.
+ */
+void SessionFilter::addStation(int stationId) {
+    addKey(STATION_KEY | quint32(stationId));
+}
+
+/**
+ * @brief Dodaje identyfikator sensora i jego stacji.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param stationId Identyfikator stacji sensora (0, jeśli nieznany).
+ */
+void SessionFilter::addSensor(int sensorId, int stationId) {
+    addKey(SENSOR_KEY | quint32(sensorId));
+    if (stationId != 0) {
+        addStation(stationId);
+    }
+}
+
+/**
+ * @brief Rozszerza zakres czasu pomiarów sesji.
+ *
+ * @param from Początek zakresu (sekundy od epoki).
+ * @param to Koniec zakresu (sekundy od epoki).
+ */
+void SessionFilter::extendRange(qint64 from, qint64 to) {
+    m_from = qMin(m_from, from);
+    m_to = qMax(m_to, to);
+}
+
+/**
+ * @brief Dodaje stacje, sensory i zakresy pomiarów z danych sesji.
+ *
+ * Uwzględniane są zakresy szeregów (seriesFrom, seriesTo) oraz daty pomiarów
+ * zapisanych w sensorach przez starsze wersje.
+ *
+ * @param sessionData Dane sesji (pola stations i sensors).
+ */
+void SessionFilter::addSession(const QVariantMap &sessionData) {
+    for (const QVariant &stationVariant : sessionData["stations"].toList()) {
+        addStation(stationVariant.toMap()["stationId"].toInt());
+    }
+    for (const QVariant &sensorVariant : sessionData["sensors"].toList()) {
+        QVariantMap sensor = sensorVariant.toMap();
+        addSensor(sensor["id"].toInt(), sensor["stationId"].toInt());
+        if (sensor.contains("seriesFrom")) {
+            extendRange(sensor["seriesFrom"].toLongLong(), sensor["seriesTo"].toLongLong());
+        }
+        for (const QVariant &measurementVariant : sensor["measurements"].toList()) {
+            bool ok = false;
+            qint64 timestamp = SeriesStore::toEpochSeconds(measurementVariant.toMap()["date"].toString(), &ok);
+            if (ok) {
+                extendRange(timestamp, timestamp);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Sprawdza, czy sesja może pasować do zapytania.
+ *
+ * @param query Zapytanie.
+ * @return false, jeśli sesja na pewno nie pasuje; true w przeciwnym razie.
+ */
+bool SessionFilter::mayMatch(const SessionQuery &query) const {
+    if (query.sensorId != 0 && !mayContainKey(SENSOR_KEY | quint32(query.sensorId))) {
+        return false;
+    }
+    if (query.stationId != 0 && !mayContainKey(STATION_KEY | quint32(query.stationId))) {
+        return false;
+    }
+    if (query.hasTimeRange() && (m_from > query.to || m_to < query.from)) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Koduje filtr do zapisu w pliku.
+ *
+ * @return Dane o rozmiarze FILE_SIZE bajtów.
+ */
+QByteArray SessionFilter::toBytes() const {
+    QByteArray data(FILE_SIZE, '\0');
+    char *raw = data.data();
+    std::memcpy(raw, FILTER_MAGIC, sizeof(FILTER_MAGIC));
+    qToLittleEndian(m_from, raw + 4);
+    qToLittleEndian(m_to, raw + 12);
+    std::memcpy(raw + 20, m_bits.constData(), m_bits.size());
+    return data;
+}
+
+/**
+ * @brief Dekoduje filtr zapisany przez toBytes().
+ *
+ * @param data Dane pliku filtra.
+ * @param ok Ustawiane na true, jeśli dane są poprawne (opcjonalnie).
+ * @return Filtr lub pusty filtr w przypadku błędu.
+ */
+SessionFilter SessionFilter::fromBytes(const QByteArray &data, bool *ok) {
+    SessionFilter filter;
+    bool valid = data.size() == FILE_SIZE && std::memcmp(data.constData(), FILTER_MAGIC, sizeof(FILTER_MAGIC)) == 0;
+    if (valid) {
+        filter.m_from = qFromLittleEndian<qint64>(data.constData() + 4);
+        filter.m_to = qFromLittleEndian<qint64>(data.constData() + 12);
+        filter.m_bits = data.mid(20);
+    }
+    if (ok) {
+        *ok = valid;
+    }
+    return filter;
+}
+
+/**
+ * @brief Ustawia bity klucza w filtrze Blooma.
+ *
+ * Kolejne pozycje są wyznaczane podwójnym haszowaniem z dwóch połówek skrótu klucza.
+ *
+ * @param key Klucz (identyfikator z przedrostkiem rodzaju).
+ */
+void SessionFilter::addKey(quint64 key) {
+    quint64 hash = mixKey(key);
+    quint32 h1 = quint32(hash);
+    quint32 h2 = quint32(hash >> 32) | 1;
+    for (int i = 0; i < HASH_COUNT; ++i) {
+        quint32 bit = (h1 + quint32(i) * h2) % BLOOM_BITS;
+        m_bits[bit / 8] = char(quint8(m_bits[bit / 8]) | (1u << (bit % 8)));
+    }
+}
+
+/**
+ * @brief Sprawdza, czy wszystkie bity klucza są ustawione.
+ *
+ * @param key Klucz (identyfikator z przedrostkiem rodzaju).
+ * @return true, jeśli klucz mógł zostać dodany.
+ */
+bool SessionFilter::mayContainKey(quint64 key) const {
+    quint64 hash = mixKey(key);
+    quint32 h1 = quint32(hash);
+    quint32 h2 = quint32(hash >> 32) | 1;
+    for (int i = 0; i < HASH_COUNT; ++i) {
+        quint32 bit = (h1 + quint32(i) * h2) % BLOOM_BITS;
+        if ((quint8(m_bits[bit / 8]) & (1u << (bit % 8))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
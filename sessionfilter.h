@@ -0,0 +1,147 @@
+#ifndef SESSIONFILTER_H
+#define SESSIONFILTER_H
+
+#include <QByteArray>
+#include <QVariantMap>
+#include <limits>
+
+/**
+ * @struct SessionQuery
+ * @brief Zapytanie o sesje zawierające dane sensora, stacji lub przedziału czasu.
+ *
+ * Sesja pasuje do zapytania, jeśli ma sensor spełniający wszystkie podane warunki.
+ * Pole równe 0 (identyfikatory) lub pozostawione domyślne (przedział) nie ogranicza wyniku.
+ */
+struct SessionQuery {
+    int stationId = 0;                                   ///< Identyfikator stacji (0 - dowolna).
+    int sensorId = 0;                                    ///< Identyfikator sensora (0 - dowolny).
+    qint64 from = std::numeric_limits<qint64>::min();    ///< Początek przedziału (sekundy od epoki, włącznie).
+    qint64 to = std::numeric_limits<qint64>::max();      ///< Koniec przedziału (sekundy od epoki, włącznie).
+
+    /**
+     * @brief Sprawdza, czy zapytanie ogranicza przedział czasu.
+     * @return true, jeśli podano from lub to.
+     */
+    bool hasTimeRange() const {
+        return from != std::numeric_limits<qint64>::min() || to != std::numeric_limits<qint64>::max();
+    }
+
+    /**
+     * @brief Sprawdza, czy sensor zapisany w sesji spełnia zapytanie.
+     * @param sensor Dane sensora (z polami seriesFrom/seriesTo lub listą measurements).
+     * @return true, jeśli sensor pasuje do zapytania.
+     */
+    bool matchesSensor(const QVariantMap &sensor) const;
+};
+
+/**
+ * @struct SessionQueryStats
+ * @brief Statystyki wykonania zapytania o sesje.
+ */
+struct SessionQueryStats {
+    int sessions = 0; ///< Liczba sprawdzonych sesji.
+    int pruned = 0;   ///< Liczba sesji odrzuconych bez otwierania pliku sesji.
+    int opened = 0;   ///< Liczba otwartych plików sesji.
+    int matched = 0;  ///< Liczba sesji pasujących do zapytania.
+};
+
+/**
+ * @class SessionFilter
+ * @brief Filtr Blooma identyfikatorów stacji i sensorów sesji wraz z zakresem czasu pomiarów.
+ *
+ * Filtr pozwala odrzucić sesję bez otwierania jej pliku: jeśli mayMatch() zwraca
+ * false, sesja na pewno nie pasuje do zapytania. Wynik true wymaga sprawdzenia
+ * sesji (filtr Blooma może dawać fałszywie dodatnie odpowiedzi, około 2% przy
+ * 120 identyfikatorach). Filtr jest zapisywany w pliku o stałym rozmiarze
+ * FILE_SIZE bajtów; dodawanie identyfikatorów i zakresów tylko go rozszerza.
+ */
+class SessionFilter
+{
+public:
+    /**
+     * @brief Tworzy pusty filtr.
+     */
+    SessionFilter();
+
+    /**
+     * @brief Dodaje identyfikator stacji.
+     * @param stationId Identyfikator stacji.
+     */
+    void addStation(int stationId);
+
+    /**
+     * @brief Dodaje identyfikator sensora i jego stacji.
+     * @param sensorId Identyfikator sensora.
+     * @param stationId Identyfikator stacji sensora (0, jeśli nieznany).
+     */
+    void addSensor(int sensorId, int stationId = 0);
+
+    /**
+     * @brief Rozszerza zakres czasu pomiarów sesji.
+     * @param from Początek zakresu (sekundy od epoki).
+     * @param to Koniec zakresu (sekundy od epoki).
+     */
+    void extendRange(qint64 from, qint64 to);
+
+    /**
+     * @brief Dodaje stacje, sensory i zakresy pomiarów z danych sesji.
+     * @param sessionData Dane sesji (pola stations i sensors).
+     */
+    void addSession(const QVariantMap &sessionData);
+
+    /**
+     * @brief Sprawdza, czy sesja może pasować do zapytania.
+     * @param query Zapytanie.
+     * @return false, jeśli sesja na pewno nie pasuje; true w przeciwnym razie.
+     */
+    bool mayMatch(const SessionQuery &query) const;
+
+    /**
+     * @brief Koduje filtr do zapisu w pliku.
+     * @return Dane o rozmiarze FILE_SIZE bajtów.
+     */
+    QByteArray toBytes() const;
+
+    /**
+     * @brief Dekoduje filtr zapisany przez toBytes().
+     * @param data Dane pliku filtra.
+     * @param ok Ustawiane na true, jeśli dane są poprawne (opcjonalnie).
+     * @return Filtr lub pusty filtr w przypadku błędu.
+     */
+    static SessionFilter fromBytes(const QByteArray &data, bool *ok = nullptr);
+
+    /**
+     * @brief Liczba bitów filtra Blooma.
+     */
+    static const int BLOOM_BITS = 1024;
+
+    /**
+     * @brief Liczba funkcji skrótu filtra Blooma.
+     */
+    static const int HASH_COUNT = 4;
+
+    /**
+     * @brief Rozmiar zakodowanego filtra (nagłówek, zakres czasu i bity filtra).
+     */
+    static const int FILE_SIZE = 4 + 2 * 8 + BLOOM_BITS / 8;
+
+private:
+    /**
+     * @brief Ustawia bity klucza w filtrze Blooma.
+     * @param key Klucz (identyfikator z przedrostkiem rodzaju).
+     */
+    void addKey(quint64 key);
+
+    /**
+     * @brief Sprawdza, czy wszystkie bity klucza są ustawione.
+     * @param key Klucz (identyfikator z przedrostkiem rodzaju).
+     * @return true, jeśli klucz mógł zostać dodany.
+     */
+    bool mayContainKey(quint64 key) const;
+
+    QByteArray m_bits; ///< Bity filtra Blooma (BLOOM_BITS / 8 bajtów).
+    qint64 m_from;     ///< Najwcześniejszy pomiar (większy od m_to, jeśli sesja nie ma pomiarów).
+    qint64 m_to;       ///< Najpóźniejszy pomiar.
+};
+
+#endif // SESSIONFILTER_H
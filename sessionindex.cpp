@@ -0,0 +1,458 @@
+#include "sessionindex.h"
+#include "historylock.h"
+#include "sessioncodec.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+// Record layout: marker, session ID, timestamp, radius, location length, location, end marker
+const char RECORD_BEGIN = 'S';
+const char RECORD_END = 'E';
+const int SESSION_ID_OFFSET = 1;
+const int SESSION_ID_SIZE = 36;
+const int TIMESTAMP_OFFSET = SESSION_ID_OFFSET + SESSION_ID_SIZE;
+const int TIMESTAMP_SIZE = 32;
+const int RADIUS_OFFSET = TIMESTAMP_OFFSET + TIMESTAMP_SIZE;
+const int LOCATION_LENGTH_OFFSET = RADIUS_OFFSET + 8;
+const int LOCATION_OFFSET = LOCATION_LENGTH_OFFSET + 2;
+const int LOCATION_SIZE = SessionIndex::RECORD_SIZE - 1 - LOCATION_OFFSET;
+
+const char *const INDEX_NAME = "history_index";
+const QStringList GENERATION_SUFFIXES = {"log", "snapshot", "summaries.log", "summaries"};
+
+/**
+ * @brief Liczba prób odczytu indeksu, gdy scalanie w innej instancji usuwa czytane pokolenie.
+ */
+const int MAX_READ_ATTEMPTS = 3;
+
+/**
+ * @brief Przycina tekst UTF-8 do podanej liczby bajtów, nie rozcinając znaków.
+ */
+QByteArray truncatedUtf8(const QString &text, int maxBytes) {
+    QByteArray utf8 = text.toUtf8();
+    if (utf8.size() > maxBytes) {
+        int length = maxBytes;
+        while (length > 0 && (uchar(utf8[length]) & 0xC0) == 0x80) {
+            --length;
+        }
+        utf8.truncate(length);
+    }
+    return utf8;
+}
+
+/**
+ * @brief Odczytuje pole tekstowe uzupełnione zerami.
+ */
+QString paddedField(const char *data, int size) {
+    int length = 0;
+    while (length < size && data[length] != '\0') {
+        ++length;
+    }
+    return QString::fromLatin1(data, length);
+}
+
+/**
+ * @brief Odwraca kolejność wpisów i pomija powtórzone identyfikatory sesji.
+ *
+ * Powtórzenia pojawiają się, gdy scalanie zostało przerwane przed wyczyszczeniem dziennika.
+ */
+QVariantList newestFirst(const QList<QVariantMap> &entries) {
+    QVariantList sessions;
+    QSet<QString> seenIds;
+    for (auto it = entries.crbegin(); it != entries.crend(); ++it) {
+        QString sessionId = (*it)["session_id"].toString();
+        if (seenIds.contains(sessionId)) {
+            continue;
+        }
+        seenIds.insert(sessionId);
+        sessions.append(*it);
+    }
+    return sessions;
+}
+
+} // namespace
+
+/**
+ * @brief Konstruktor klasy SessionIndex.
+ *
+ * @param directory Katalog, w którym przechowywane są pliki indeksu.
+ */
+SessionIndex::SessionIndex(const QString &directory)
+    : m_dir(directory), m_generationPath(m_dir.filePath(QString(INDEX_NAME) + ".generation")) {
+}
+
+/**
+ * @brief Dopisuje wpis sesji na końcu dziennika.
+ *
+ * Niekompletny rekord pozostawiony przez przerwany zapis jest wcześniej obcinany.
+ *
+ * @param entry Wpis z polami session_id, timestamp, location i radius.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SessionIndex::append(const QVariantMap &entry) {
+    QMutexLocker locker(&m_mutex);
+    QString logPath = filePath(currentGeneration(), "log");
+    QFile file(logPath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open index log for writing:" << logPath << "Error:" << file.errorString();
+        return false;
+    }
+
+    qint64 completeSize = file.size() - file.size() % RECORD_SIZE;
+    if (completeSize != file.size()) {
+        qDebug() << "Truncating incomplete record in index log:" << logPath;
+        file.resize(completeSize);
+    }
+
+    QByteArray record = encodeRecord(entry);
+    bool ok = file.seek(completeSize) && file.write(record) == record.size();
+    file.close();
+    if (!ok) {
+        qDebug() << "Failed to append to index log:" << logPath << "Error:" << file.errorString();
+    }
+    return ok;
+}
+
+/**
+ * @brief Dopisuje podsumowanie sesji do dziennika podsumowań.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param summary Podsumowanie sesji (zastępuje poprzednie).
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SessionIndex::appendSummary(const QString &sessionId, const QVariantMap &summary) {
+    QByteArray line = QJsonDocument(QJsonObject::fromVariantMap({{"session_id", sessionId}, {"summary", summary}}))
+                          .toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    QMutexLocker locker(&m_mutex);
+    QString summaryLogPath = filePath(currentGeneration(), "summaries.log");
+    QFile file(summaryLogPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open summary log for writing:" << summaryLogPath << "Error:" << file.errorString();
+        return false;
+    }
+    bool ok = file.write(line) == line.size();
+    file.close();
+    if (!ok) {
+        qDebug() << "Failed to append to summary log:" << summaryLogPath << "Error:" << file.errorString();
+    }
+    return ok;
+}
+
+/**
+ * @brief Wczytuje wszystkie wpisy indeksu.
+ *
+ * Migawka i dziennik są czytane sekwencyjnie, każdy jednym odczytem. Pliki sesji
+ * nie są otwierane: podsumowania pochodzą z plików podsumowań indeksu.
+ * Odczyt nie zakłada blokady. Pliki pokolenia g są usuwane dopiero przez scalanie
+ * do pokolenia g + 2, więc odczyt jest powtarzany tylko wtedy, gdy w tym czasie
+ * inna instancja scaliła indeks dwukrotnie.
+ *
+ * @return QVariantList z wpisami od najnowszego do najstarszego.
+ */
+QVariantList SessionIndex::readAll() const {
+    QList<QVariantMap> entries;
+    QHash<QString, QVariantMap> summaries;
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+        entries.clear();
+        quint64 generation = currentGeneration();
+        readRecords(filePath(generation, "snapshot"), entries);
+        readRecords(filePath(generation, "log"), entries);
+        summaries = readSummaries(generation);
+        if (currentGeneration() <= generation + 1) {
+            break;
+        }
+    }
+    for (QVariantMap &entry : entries) {
+        auto it = summaries.constFind(entry["session_id"].toString());
+        if (it != summaries.constEnd()) {
+            entry["summary"] = it.value();
+        }
+    }
+    return newestFirst(entries);
+}
+
+/**
+ * @brief Zwraca rozmiar dziennika podsumowań.
+ *
+ * @return Rozmiar w bajtach.
+ */
+qint64 SessionIndex::summaryLogSize() const {
+    return QFileInfo(filePath(currentGeneration(), "summaries.log")).size();
+}
+
+/**
+ * @brief Zwraca liczbę rekordów w dzienniku od ostatniego scalenia.
+ *
+ * @return Liczba rekordów.
+ */
+qsizetype SessionIndex::logRecordCount() const {
+    return qsizetype(QFileInfo(filePath(currentGeneration(), "log")).size() / RECORD_SIZE);
+}
+
+/**
+ * @brief Scala dziennik z migawką i ogranicza liczbę wpisów.
+ *
+ * Zapisuje najnowsze maxSessions wpisów i ich podsumowania do migawek następnego
+ * pokolenia (z pustymi dziennikami), przełącza na nie wskaźnik pokolenia, a następnie
+ * usuwa pliki pokolenia sprzed bieżącego. Czytelnicy bieżącego pokolenia mogą
+ * dokończyć odczyt.
+ *
+ * @param maxSessions Maksymalna liczba zachowanych wpisów.
+ * @return QVariantList z usuniętymi wpisami (od najnowszego do najstarszego).
+ */
+QVariantList SessionIndex::compact(int maxSessions) {
+    QMutexLocker locker(&m_mutex);
+    quint64 generation = currentGeneration();
+    QList<QVariantMap> entries;
+    readRecords(filePath(generation, "snapshot"), entries);
+    readRecords(filePath(generation, "log"), entries);
+
+    QVariantList sessions = newestFirst(entries);
+    QVariantList evicted;
+    while (sessions.size() > maxSessions) {
+        evicted.append(sessions.takeLast());
+    }
+
+    QByteArray snapshot;
+    snapshot.reserve(sessions.size() * RECORD_SIZE);
+    for (auto it = sessions.crbegin(); it != sessions.crend(); ++it) {
+        snapshot.append(encodeRecord(it->toMap()));
+    }
+
+    QString snapshotPath = filePath(generation + 1, "snapshot");
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open index snapshot for writing:" << snapshotPath << "Error:" << file.errorString();
+        return QVariantList();
+    }
+    file.write(snapshot);
+    if (!file.commit()) {
+        qDebug() << "Failed to write index snapshot:" << snapshotPath << "Error:" << file.errorString();
+        return QVariantList();
+    }
+
+    // Summaries of the kept sessions only; evicted sessions drop out of the snapshot
+    QHash<QString, QVariantMap> summaries = readSummaries(generation);
+    QVariantMap keptSummaries;
+    for (const QVariant &session : std::as_const(sessions)) {
+        QString sessionId = session.toMap()["session_id"].toString();
+        if (summaries.contains(sessionId)) {
+            keptSummaries.insert(sessionId, summaries.value(sessionId));
+        }
+    }
+    QString summarySnapshotPath = filePath(generation + 1, "summaries");
+    QSaveFile summaryFile(summarySnapshotPath);
+    if (!summaryFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open summary snapshot for writing:" << summarySnapshotPath << "Error:" << summaryFile.errorString();
+        return QVariantList();
+    }
+    summaryFile.write(SessionCodec::encode(keptSummaries, SessionCodec::Cbor));
+    if (!summaryFile.commit()) {
+        qDebug() << "Failed to write summary snapshot:" << summarySnapshotPath << "Error:" << summaryFile.errorString();
+        return QVariantList();
+    }
+
+    // The new generation starts with empty logs; readers of the current one can finish
+    if (!HistoryLock::writeGeneration(m_generationPath, generation + 1)) {
+        return QVariantList();
+    }
+    HistoryLock::removeGenerationsBefore(m_dir, INDEX_NAME, GENERATION_SUFFIXES, generation);
+
+    qDebug() << "Compacted session index:" << sessions.size() << "sessions kept," << evicted.size() << "evicted";
+    return evicted;
+}
+
+/**
+ * @brief Importuje indeks zapisany w starym formacie JSON.
+ *
+ * Wpisy są zapisywane do migawki w kolejności od najstarszego do najnowszego.
+ *
+ * @param legacyIndexPath Ścieżka do pliku history_index.json.
+ * @return true, jeśli import się powiódł; false w przeciwnym razie.
+ */
+bool SessionIndex::importLegacy(const QString &legacyIndexPath) {
+    QFile legacy(legacyIndexPath);
+    if (!legacy.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to read legacy index file:" << legacyIndexPath << "Error:" << legacy.errorString();
+        return false;
+    }
+    bool ok = false;
+    QVariantMap index = SessionCodec::decode(legacy.readAll(), &ok);
+    legacy.close();
+    if (!ok) {
+        qDebug() << "Failed to parse legacy index file:" << legacyIndexPath;
+        return false;
+    }
+
+    QVariantList sessions = index["sessions"].toList();
+    QByteArray snapshot;
+    for (auto it = sessions.crbegin(); it != sessions.crend(); ++it) {
+        snapshot.append(encodeRecord(it->toMap()));
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QString snapshotPath = filePath(currentGeneration(), "snapshot");
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open index snapshot for writing:" << snapshotPath << "Error:" << file.errorString();
+        return false;
+    }
+    file.write(snapshot);
+    if (!file.commit()) {
+        qDebug() << "Failed to write index snapshot:" << snapshotPath << "Error:" << file.errorString();
+        return false;
+    }
+    qDebug() << "Imported" << sessions.size() << "sessions from legacy index:" << legacyIndexPath;
+    return true;
+}
+
+/**
+ * @brief Zwraca bieżące pokolenie plików indeksu.
+ *
+ * @return Numer pokolenia (0 dla indeksu zapisanego przed wprowadzeniem pokoleń).
+ */
+quint64 SessionIndex::currentGeneration() const {
+    return HistoryLock::readGeneration(m_generationPath);
+}
+
+/**
+ * @brief Zwraca ścieżkę pliku indeksu danego pokolenia.
+ *
+ * @param generation Numer pokolenia.
+ * @param suffix Rozszerzenie pliku (log, snapshot, summaries.log lub summaries).
+ * @return Ścieżka pliku.
+ */
+QString SessionIndex::filePath(quint64 generation, const QString &suffix) const {
+    return HistoryLock::generationPrefix(m_dir.filePath(INDEX_NAME), generation) + "." + suffix;
+}
+
+/**
+ * @brief Wczytuje podsumowania sesji z migawki i dziennika.
+ *
+ * Uszkodzone lub niedokończone linie dziennika są pomijane.
+ *
+ * @param generation Pokolenie plików indeksu.
+ * @return Podsumowania według identyfikatora sesji (najnowsze wygrywa).
+ */
+QHash<QString, QVariantMap> SessionIndex::readSummaries(quint64 generation) const {
+    QHash<QString, QVariantMap> summaries;
+    QString summarySnapshotPath = filePath(generation, "summaries");
+    QString summaryLogPath = filePath(generation, "summaries.log");
+    QFile snapshot(summarySnapshotPath);
+    if (snapshot.open(QIODevice::ReadOnly)) {
+        QVariantMap stored = SessionCodec::decode(snapshot.readAll());
+        snapshot.close();
+        for (auto it = stored.constBegin(); it != stored.constEnd(); ++it) {
+            summaries.insert(it.key(), it.value().toMap());
+        }
+    }
+
+    QFile log(summaryLogPath);
+    if (log.open(QIODevice::ReadOnly)) {
+        while (!log.atEnd()) {
+            QByteArray line = log.readLine().trimmed();
+            if (line.isEmpty()) {
+                continue;
+            }
+            QJsonDocument doc = QJsonDocument::fromJson(line);
+            if (!doc.isObject()) {
+                qDebug() << "Skipping malformed summary record in:" << summaryLogPath;
+                continue;
+            }
+            QVariantMap record = doc.object().toVariantMap();
+            summaries.insert(record["session_id"].toString(), record["summary"].toMap());
+        }
+        log.close();
+    }
+    return summaries;
+}
+
+/**
+ * @brief Koduje wpis sesji jako rekord o stałym rozmiarze.
+ *
+ * Nazwa lokalizacji dłuższa niż pole rekordu jest przycinana.
+ *
+ * @param entry Wpis sesji.
+ * @return Rekord o rozmiarze RECORD_SIZE.
+ */
+QByteArray SessionIndex::encodeRecord(const QVariantMap &entry) {
+    QByteArray record(RECORD_SIZE, '\0');
+    char *data = record.data();
+    data[0] = RECORD_BEGIN;
+    data[RECORD_SIZE - 1] = RECORD_END;
+
+    QByteArray sessionId = entry["session_id"].toString().toLatin1().left(SESSION_ID_SIZE);
+    std::memcpy(data + SESSION_ID_OFFSET, sessionId.constData(), sessionId.size());
+
+    QByteArray timestamp = entry["timestamp"].toString().toLatin1().left(TIMESTAMP_SIZE);
+    std::memcpy(data + TIMESTAMP_OFFSET, timestamp.constData(), timestamp.size());
+
+    qToLittleEndian(entry["radius"].toDouble(), data + RADIUS_OFFSET);
+
+    QByteArray location = truncatedUtf8(entry["location"].toString(), LOCATION_SIZE);
+    qToLittleEndian(quint16(location.size()), data + LOCATION_LENGTH_OFFSET);
+    std::memcpy(data + LOCATION_OFFSET, location.constData(), location.size());
+    return record;
+}
+
+/**
+ * @brief Dekoduje rekord o stałym rozmiarze.
+ *
+ * @param record Wskaźnik na RECORD_SIZE bajtów rekordu.
+ * @return Wpis sesji lub pusta mapa, jeśli rekord jest uszkodzony.
+ */
+QVariantMap SessionIndex::decodeRecord(const char *record) {
+    if (record[0] != RECORD_BEGIN || record[RECORD_SIZE - 1] != RECORD_END) {
+        return QVariantMap();
+    }
+    quint16 locationLength = qMin<quint16>(qFromLittleEndian<quint16>(record + LOCATION_LENGTH_OFFSET), LOCATION_SIZE);
+
+    QVariantMap entry;
+    entry["session_id"] = paddedField(record + SESSION_ID_OFFSET, SESSION_ID_SIZE);
+    entry["timestamp"] = paddedField(record + TIMESTAMP_OFFSET, TIMESTAMP_SIZE);
+    entry["radius"] = qFromLittleEndian<double>(record + RADIUS_OFFSET);
+    entry["location"] = QString::fromUtf8(record + LOCATION_OFFSET, locationLength);
+    return entry;
+}
+
+/**
+ * @brief Wczytuje rekordy z pliku w kolejności zapisu.
+ *
+ * Cały plik jest wczytywany jednym odczytem, a uszkodzone lub niekompletne rekordy
+ * są pomijane.
+ *
+ * @param path Ścieżka do pliku.
+ * @param entries Lista, do której dopisywane są wpisy.
+ */
+void SessionIndex::readRecords(const QString &path, QList<QVariantMap> &entries) {
+    QFile file(path);
+    if (!file.exists()) {
+        return;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to read index file:" << path << "Error:" << file.errorString();
+        return;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    for (qsizetype offset = 0; offset + RECORD_SIZE <= data.size(); offset += RECORD_SIZE) {
+        QVariantMap entry = decodeRecord(data.constData() + offset);
+        if (entry.isEmpty()) {
+            qDebug() << "Skipping corrupted index record at offset" << offset << "in:" << path;
+            continue;
+        }
+        entries.append(entry);
+    }
+}
@@ -0,0 +1,153 @@
+#ifndef SESSIONINDEX_H
+#define SESSIONINDEX_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+
+/**
+ * @class SessionIndex
+ * @brief Indeks sesji oparty na dzienniku rekordów o stałym rozmiarze.
+ *
+ * Nowe wpisy są dopisywane na końcu pliku history_index.log (O(1) na wpis).
+ * Okresowe scalanie przepisuje najnowsze wpisy do pliku history_index.snapshot,
+ * czyści dziennik i zwraca wpisy, które wypadły poza limit sesji.
+ * Odczyt to jedno sekwencyjne przejście przez migawkę i dziennik.
+ *
+ * Podsumowania sesji (liczba stacji, sensory, zakres dat, statystyki pomiarów) mają
+ * zmienny rozmiar, dlatego są przechowywane obok rekordów: w dzienniku
+ * history_index.summaries.log (jedna linia JSON na zmianę) i w migawce
+ * history_index.summaries (CBOR). readAll() dołącza je do wpisów jako pole summary.
+ *
+ * Pliki indeksu należą do pokolenia wskazanego przez plik history_index.generation
+ * (pokolenie g > 0 ma pliki history_index.g<g>.*). Scalanie zapisuje nowe pokolenie,
+ * przełącza na nie wskaźnik i usuwa pokolenie sprzed poprzedniego, więc czytelnicy
+ * nie zakładają żadnej blokady: jeśli w trakcie odczytu pokolenie przesunęło się
+ * o więcej niż jedno, odczyt jest powtarzany. Zapisujący (append(), appendSummary(),
+ * compact(), importLegacy()) muszą trzymać blokadę zapisu historii (HistoryLock).
+ */
+class SessionIndex
+{
+public:
+    /**
+     * @brief Konstruktor klasy SessionIndex.
+     * @param directory Katalog, w którym przechowywane są pliki indeksu.
+     */
+    explicit SessionIndex(const QString &directory);
+
+    /**
+     * @brief Dopisuje wpis sesji na końcu dziennika.
+     * @param entry Wpis z polami session_id, timestamp, location i radius.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    bool append(const QVariantMap &entry);
+
+    /**
+     * @brief Dopisuje podsumowanie sesji do dziennika podsumowań.
+     * @param sessionId Identyfikator sesji.
+     * @param summary Podsumowanie sesji (zastępuje poprzednie).
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    bool appendSummary(const QString &sessionId, const QVariantMap &summary);
+
+    /**
+     * @brief Wczytuje wszystkie wpisy indeksu.
+     * @return QVariantList z wpisami od najnowszego do najstarszego (z polem summary, jeśli jest znane).
+     */
+    QVariantList readAll() const;
+
+    /**
+     * @brief Zwraca rozmiar dziennika podsumowań.
+     * @return Rozmiar w bajtach.
+     */
+    qint64 summaryLogSize() const;
+
+    /**
+     * @brief Zwraca liczbę rekordów w dzienniku od ostatniego scalenia.
+     * @return Liczba rekordów.
+     */
+    qsizetype logRecordCount() const;
+
+    /**
+     * @brief Scala dziennik z migawką i ogranicza liczbę wpisów.
+     * @param maxSessions Maksymalna liczba zachowanych wpisów.
+     * @return QVariantList z usuniętymi wpisami.
+     */
+    QVariantList compact(int maxSessions);
+
+    /**
+     * @brief Importuje indeks zapisany w starym formacie JSON (history_index.json).
+     * @param legacyIndexPath Ścieżka do starego pliku indeksu.
+     * @return true, jeśli import się powiódł; false w przeciwnym razie.
+     */
+    bool importLegacy(const QString &legacyIndexPath);
+
+    /**
+     * @brief Rozmiar pojedynczego rekordu w bajtach.
+     */
+    static const int RECORD_SIZE = 256;
+
+private:
+    /**
+     * @brief Koduje wpis sesji jako rekord o stałym rozmiarze.
+     * @param entry Wpis sesji.
+     * @return Rekord o rozmiarze RECORD_SIZE.
+     */
+    static QByteArray encodeRecord(const QVariantMap &entry);
+
+    /**
+     * @brief Dekoduje rekord o stałym rozmiarze.
+     * @param record Wskaźnik na RECORD_SIZE bajtów rekordu.
+     * @return Wpis sesji lub pusta mapa, jeśli rekord jest uszkodzony.
+     */
+    static QVariantMap decodeRecord(const char *record);
+
+    /**
+     * @brief Zwraca bieżące pokolenie plików indeksu.
+     * @return Numer pokolenia.
+     */
+    quint64 currentGeneration() const;
+
+    /**
+     * @brief Zwraca ścieżkę pliku indeksu danego pokolenia.
+     * @param generation Numer pokolenia.
+     * @param suffix Rozszerzenie pliku (log, snapshot, summaries.log lub summaries).
+     * @return Ścieżka pliku.
+     */
+    QString filePath(quint64 generation, const QString &suffix) const;
+
+    /**
+     * @brief Wczytuje rekordy z pliku w kolejności zapisu.
+     * @param path Ścieżka do pliku.
+     * @param entries Lista, do której dopisywane są wpisy.
+     */
+    static void readRecords(const QString &path, QList<QVariantMap> &entries);
+
+    /**
+     * @brief Wczytuje podsumowania sesji z migawki i dziennika.
+     * @param generation Pokolenie plików indeksu.
+     * @return Podsumowania według identyfikatora sesji (najnowsze wygrywa).
+     */
+    QHash<QString, QVariantMap> readSummaries(quint64 generation) const;
+
+    /**
+     * @brief Katalog plików indeksu.
+     */
+    QDir m_dir;
+
+    /**
+     * @brief Ścieżka do pliku wskaźnika bieżącego pokolenia.
+     */
+    QString m_generationPath;
+
+    /**
+     * @brief Muteks porządkujący zapisy wątków tej instancji.
+     */
+    mutable QMutex m_mutex;
+};
+
+#endif // SESSIONINDEX_H
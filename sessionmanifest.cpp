@@ -0,0 +1,218 @@
+#include "sessionmanifest.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QMutexLocker>
+#include <QDebug>
+
+const char *const SessionManifest::SESSIONS_DIR = "sessions";
+
+/**
+ * @brief Konstruktor klasy SessionManifest.
+ *
+ * @param directory Katalog historii.
+ */
+SessionManifest::SessionManifest(const QString &directory)
+    : m_dir(directory), m_path(m_dir.filePath("sessions.manifest")), m_removals(0) {
+    reload();
+}
+
+/**
+ * @brief Wczytuje manifest od nowa.
+ *
+ * Plik jest czytany jednym odczytem. Niedokończona ostatnia linia (zapis trwający
+ * w innej instancji) jest pomijana; zostanie wczytana przy kolejnym wywołaniu.
+ */
+void SessionManifest::reload() {
+    QHash<QString, QString> partitions;
+    int lines = 0;
+    QFile file(m_path);
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray data = file.readAll();
+        file.close();
+        qsizetype complete = data.lastIndexOf('\n') + 1;
+        for (const QByteArray &line : data.left(complete).split('\n')) {
+            qsizetype tab = line.indexOf('\t');
+            if (tab <= 0) {
+                continue;
+            }
+            lines++;
+            QString sessionId = QString::fromUtf8(line.left(tab));
+            QString partition = QString::fromUtf8(line.mid(tab + 1));
+            if (partition.isEmpty()) {
+                partitions.remove(sessionId);
+            } else {
+                partitions.insert(sessionId, partition);
+            }
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_partitions = partitions;
+    m_removals = lines - partitions.size();
+}
+
+/**
+ * @brief Sprawdza, czy sesja ma przypisaną partycję.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return true, jeśli sesja jest w manifeście.
+ */
+bool SessionManifest::contains(const QString &sessionId) const {
+    QMutexLocker locker(&m_mutex);
+    return m_partitions.contains(sessionId);
+}
+
+/**
+ * @brief Zwraca katalog plików sesji względem katalogu historii.
+ *
+ * Sesje spoza manifestu (np. pliki starszych wersji, których nie udało się przenieść)
+ * pozostają bezpośrednio w katalogu historii.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return Katalog partycji lub pusty tekst dla sesji spoza manifestu.
+ */
+QString SessionManifest::directoryOf(const QString &sessionId) const {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_partitions.constFind(sessionId);
+    if (it == m_partitions.constEnd()) {
+        return QString();
+    }
+    return QString(SESSIONS_DIR) + '/' + it.value();
+}
+
+/**
+ * @brief Zwraca identyfikatory wszystkich sesji z manifestu.
+ *
+ * @return Lista identyfikatorów.
+ */
+QStringList SessionManifest::sessionIds() const {
+    QMutexLocker locker(&m_mutex);
+    return m_partitions.keys();
+}
+
+/**
+ * @brief Przypisuje sesji partycję i tworzy jej katalog.
+ *
+ * Sesja, która ma już partycję, zachowuje ją.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param created Data utworzenia sesji.
+ * @return Katalog partycji względem katalogu historii lub pusty tekst w przypadku błędu.
+ */
+QString SessionManifest::assign(const QString &sessionId, const QDate &created) {
+    QString directory = directoryOf(sessionId);
+    if (!directory.isEmpty()) {
+        return directory;
+    }
+
+    QString partition = partitionFor(sessionId, created);
+    directory = QString(SESSIONS_DIR) + '/' + partition;
+    if (!m_dir.mkpath(directory)) {
+        qDebug() << "Failed to create session directory:" << m_dir.filePath(directory);
+        return QString();
+    }
+    if (!appendLine(sessionId, partition)) {
+        return QString();
+    }
+    QMutexLocker locker(&m_mutex);
+    m_partitions.insert(sessionId, partition);
+    return directory;
+}
+
+/**
+ * @brief Usuwa sesję z manifestu.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SessionManifest::remove(const QString &sessionId) {
+    if (!contains(sessionId)) {
+        return true;
+    }
+    if (!appendLine(sessionId, QString())) {
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_partitions.remove(sessionId);
+    // Both the assignment and the removal line are now dead
+    m_removals += 2;
+    return true;
+}
+
+/**
+ * @brief Przepisuje manifest bez usuniętych sesji, jeśli usunięć jest więcej niż sesji.
+ *
+ * Nowy plik jest zapisywany atomowo (QSaveFile), więc czytelnicy widzą stary albo nowy manifest.
+ *
+ * @return true, jeśli manifest nie wymagał scalania lub scalanie się powiodło.
+ */
+bool SessionManifest::compact() {
+    QByteArray data;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_removals <= m_partitions.size()) {
+            return true;
+        }
+        for (auto it = m_partitions.constBegin(); it != m_partitions.constEnd(); ++it) {
+            data += it.key().toUtf8() + '\t' + it.value().toUtf8() + '\n';
+        }
+    }
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open session manifest for writing:" << m_path << "Error:" << file.errorString();
+        return false;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        qDebug() << "Failed to write session manifest:" << m_path << "Error:" << file.errorString();
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_removals = 0;
+    qDebug() << "Compacted session manifest:" << m_partitions.size() << "sessions";
+    return true;
+}
+
+/**
+ * @brief Zwraca partycję sesji.
+ *
+ * Skrót identyfikatora (CRC-16) nie zależy od ziarna qHash() procesu, więc wszystkie
+ * instancje i wersje aplikacji wyznaczają tę samą partycję.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param created Data utworzenia sesji.
+ * @return Partycja w postaci <rok>/<miesiąc>/<xx>.
+ */
+QString SessionManifest::partitionFor(const QString &sessionId, const QDate &created) {
+    QDate date = created.isValid() ? created : QDate::currentDate();
+    quint16 hash = qChecksum(sessionId.toUtf8());
+    return QString("%1/%2/%3").arg(date.year(), 4, 10, QChar('0'))
+                              .arg(date.month(), 2, 10, QChar('0'))
+                              .arg(hash & 0xFF, 2, 16, QChar('0'));
+}
+
+/**
+ * @brief Dopisuje linię do manifestu.
+ *
+ * Linia jest zapisywana jednym wywołaniem write(), więc czytelnik widzi ją w całości
+ * albo jako niedokończoną linię, którą pomija.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param partition Partycja (pusta dla usunięcia).
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SessionManifest::appendLine(const QString &sessionId, const QString &partition) {
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open session manifest for writing:" << m_path << "Error:" << file.errorString();
+        return false;
+    }
+    QByteArray line = sessionId.toUtf8() + '\t' + partition.toUtf8() + '\n';
+    if (file.write(line) != line.size()) {
+        qDebug() << "Failed to append to session manifest:" << m_path << "Error:" << file.errorString();
+        return false;
+    }
+    return true;
+}
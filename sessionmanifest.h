@@ -0,0 +1,130 @@
+#ifndef SESSIONMANIFEST_H
+#define SESSIONMANIFEST_H
+
+#include <QDate>
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @class SessionManifest
+ * @brief Manifest katalogów partycji plików sesji.
+ *
+ * Pliki sesji są przechowywane w podkatalogach sessions/<rok>/<miesiąc>/<xx>, gdzie
+ * rok i miesiąc pochodzą z daty utworzenia sesji, a xx to dwa znaki szesnastkowe
+ * skrótu identyfikatora sesji, więc żaden katalog nie rośnie wraz z całą historią.
+ * Manifest (plik sessions.manifest) przypisuje identyfikatorowi sesji jego partycję:
+ * każda linia to "<id>\t<partycja>", a pusta partycja oznacza usunięcie sesji.
+ * Manifest jest wczytywany raz do tablicy mieszającej, więc ustalenie ścieżki pliku
+ * sesji nie wymaga listowania katalogów.
+ *
+ * Zapisujący (assign(), remove(), compact()) muszą trzymać blokadę zapisu historii
+ * (HistoryLock). Linie są dopisywane w całości, a scalanie podmienia plik atomowo,
+ * więc reload() nie zakłada blokady i pomija niedokończoną ostatnią linię.
+ */
+class SessionManifest
+{
+public:
+    /**
+     * @brief Konstruktor klasy SessionManifest.
+     * @param directory Katalog historii.
+     */
+    explicit SessionManifest(const QString &directory);
+
+    /**
+     * @brief Wczytuje manifest od nowa.
+     */
+    void reload();
+
+    /**
+     * @brief Sprawdza, czy sesja ma przypisaną partycję.
+     * @param sessionId Identyfikator sesji.
+     * @return true, jeśli sesja jest w manifeście.
+     */
+    bool contains(const QString &sessionId) const;
+
+    /**
+     * @brief Zwraca katalog plików sesji względem katalogu historii.
+     * @param sessionId Identyfikator sesji.
+     * @return Katalog partycji lub pusty tekst dla sesji spoza manifestu (katalog historii).
+     */
+    QString directoryOf(const QString &sessionId) const;
+
+    /**
+     * @brief Zwraca identyfikatory wszystkich sesji z manifestu.
+     * @return Lista identyfikatorów.
+     */
+    QStringList sessionIds() const;
+
+    /**
+     * @brief Przypisuje sesji partycję i tworzy jej katalog.
+     * @param sessionId Identyfikator sesji.
+     * @param created Data utworzenia sesji.
+     * @return Katalog partycji względem katalogu historii lub pusty tekst w przypadku błędu.
+     */
+    QString assign(const QString &sessionId, const QDate &created);
+
+    /**
+     * @brief Usuwa sesję z manifestu.
+     * @param sessionId Identyfikator sesji.
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    bool remove(const QString &sessionId);
+
+    /**
+     * @brief Przepisuje manifest bez usuniętych sesji, jeśli usunięć jest więcej niż sesji.
+     * @return true, jeśli manifest nie wymagał scalania lub scalanie się powiodło.
+     */
+    bool compact();
+
+    /**
+     * @brief Zwraca partycję sesji.
+     * @param sessionId Identyfikator sesji.
+     * @param created Data utworzenia sesji.
+     * @return Partycja w postaci <rok>/<miesiąc>/<xx>.
+     */
+    static QString partitionFor(const QString &sessionId, const QDate &created);
+
+    /**
+     * @brief Katalog partycji względem katalogu historii.
+     */
+    static const char *const SESSIONS_DIR;
+
+private:
+    /**
+     * @brief Dopisuje linię do manifestu.
+     * @param sessionId Identyfikator sesji.
+     * @param partition Partycja (pusta dla usunięcia).
+     * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+     */
+    bool appendLine(const QString &sessionId, const QString &partition);
+
+    /**
+     * @brief Katalog historii.
+     */
+    QDir m_dir;
+
+    /**
+     * @brief Ścieżka do pliku manifestu.
+     */
+    QString m_path;
+
+    /**
+     * @brief Partycje sesji według identyfikatora.
+     */
+    QHash<QString, QString> m_partitions;
+
+    /**
+     * @brief Liczba linii usunięć w pliku manifestu.
+     */
+    int m_removals;
+
+    /**
+     * @brief Muteks chroniący m_partitions i m_removals.
+     */
+    mutable QMutex m_mutex;
+};
+
+#endif // SESSIONMANIFEST_H
@@ -0,0 +1,1156 @@
+#include "sqlitehistorystorage.h"
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSet>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QAtomicInteger>
+#include <QThreadStorage>
+#include <QDebug>
+
+namespace {
+
+/**
+ * @brief Wykonuje zapytanie i loguje błąd.
+ */
+bool execLogged(QSqlQuery &query, const char *context) {
+    if (!query.exec()) {
+        qDebug() << "SQLite error in" << context << ":" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Odczytuje przedział z bieżącego wiersza zapytania (duration, ts, min, max, mean, samples).
+ */
+RollupPoint rollupFromQuery(const QSqlQuery &query) {
+    RollupPoint rollup;
+    rollup.duration = query.value(0).toInt();
+    rollup.timestamp = query.value(1).toLongLong();
+    rollup.min = query.value(2).toFloat();
+    rollup.max = query.value(3).toFloat();
+    rollup.mean = query.value(4).toFloat();
+    rollup.count = query.value(5).toUInt();
+    return rollup;
+}
+
+// Connection names are never reused, unlike the addresses of finished threads
+QAtomicInteger<quint64> nextConnectionId;
+
+} // namespace
+
+/**
+ * @brief Połączenie z bazą należące do jednego wątku.
+ *
+ * QThreadStorage usuwa obiekt po zakończeniu wątku, a destruktor zamyka i usuwa
+ * połączenie, więc połączenia nie gromadzą się wraz z krótkotrwałymi wątkami.
+ */
+struct SqliteHistoryStorage::ThreadConnection {
+    QString name; ///< Nazwa połączenia QtSql.
+
+    ~ThreadConnection() {
+        {
+            QSqlDatabase db = QSqlDatabase::database(name, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    }
+};
+
+/**
+ * @brief Konstruktor klasy SqliteHistoryStorage.
+ *
+ * Otwiera bazę danych w wątku wywołującym i tworzy schemat.
+ *
+ * @param databasePath Ścieżka do pliku bazy danych.
+ * @param maxSessions Maksymalna liczba przechowywanych sesji.
+ * @param format Format zapisu danych sesji i sensorów w kolumnach data.
+ */
+SqliteHistoryStorage::SqliteHistoryStorage(const QString &databasePath, int maxSessions, SessionCodec::Format format)
+    : m_databasePath(databasePath), m_maxSessions(maxSessions), m_format(format), m_open(false),
+      m_writerLock(QFileInfo(databasePath).absolutePath(), "history"), m_externalChanges(0) {
+    m_open = createSchema();
+}
+
+/**
+ * @brief Destruktor klasy SqliteHistoryStorage.
+ *
+ * Zamyka i usuwa połączenia otwarte przez wszystkie wątki, które jeszcze działają.
+ * Wątki korzystające z magazynu muszą być wcześniej zakończone.
+ */
+SqliteHistoryStorage::~SqliteHistoryStorage() {
+    QStringList names;
+    {
+        QMutexLocker locker(&m_connectionMutex);
+        names = m_connectionNames;
+        m_connectionNames.clear();
+    }
+    for (const QString &name : names) {
+        {
+            QSqlDatabase db = QSqlDatabase::database(name, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    }
+}
+
+/**
+ * @brief Sprawdza, czy baza została otwarta i ma poprawny schemat.
+ *
+ * @return true, jeśli baza jest gotowa do użycia.
+ */
+bool SqliteHistoryStorage::isOpen() const {
+    return m_open;
+}
+
+/**
+ * @brief Sprawdza, czy dane z magazynu plikowego zostały już zaimportowane.
+ *
+ * @return true, jeśli import został wykonany.
+ */
+bool SqliteHistoryStorage::isMigrated() const {
+    QSqlQuery query(database());
+    query.prepare("SELECT value FROM meta WHERE key = 'migrated'");
+    return execLogged(query, "isMigrated") && query.next() && query.value(0).toString() == "1";
+}
+
+/**
+ * @brief Jednorazowo importuje sesje, sensory i pomiary z innego magazynu.
+ *
+ * Sesje są przepisywane od najstarszej do najnowszej, aby zachować ich kolejność.
+ * Pomiary z szeregów oraz z list zapisanych w plikach sesji przez starsze wersje
+ * trafiają do tabeli measurements. Cały import odbywa się w jednej transakcji,
+ * a jego wykonanie jest zapamiętywane w tabeli meta.
+ *
+ * @param source Magazyn źródłowy.
+ * @return true, jeśli import się powiódł; false w przeciwnym razie.
+ */
+bool SqliteHistoryStorage::importFrom(const HistoryStorage &source) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start import transaction:" << db.lastError().text();
+        return false;
+    }
+
+    bool ok = true;
+    int imported = 0;
+    QVariantList sessions = source.loadSessions();
+    for (auto it = sessions.crbegin(); it != sessions.crend() && ok; ++it) {
+        QVariantMap indexEntry = it->toMap();
+        QString sessionId = indexEntry["session_id"].toString();
+        QVariantMap sessionData = source.loadSessionDetails(sessionId);
+        if (sessionData.isEmpty()) {
+            continue;
+        }
+        QVariantList sensors = sessionData.take("sensors").toList();
+        QVariantMap airQuality = sessionData.take("airQuality").toMap();
+
+        QList<QVariantMap> sensorEntries;
+        QMap<int, QVector<MeasurementPoint>> pointsBySensor;
+        for (const QVariant &sensorVariant : sensors) {
+            QVariantMap sensor = sensorVariant.toMap();
+            int sensorId = sensor["id"].toInt();
+            if (sensor.contains("seriesFrom")) {
+                pointsBySensor[sensorId] = source.loadMeasurements(sensorId, sensor.take("seriesFrom").toLongLong(),
+                                                                   sensor.take("seriesTo").toLongLong());
+            }
+
+            // Measurements stored inside the session file by older versions
+            QList<QVariantMap> legacyMeasurements;
+            for (const QVariant &measurementVariant : sensor["measurements"].toList()) {
+                QVariantMap measurement = measurementVariant.toMap();
+                measurement["sensorId"] = sensorId;
+                legacyMeasurements.append(measurement);
+            }
+            if (!legacyMeasurements.isEmpty()) {
+                pointsBySensor[sensorId].append(groupMeasurements(legacyMeasurements).value(sensorId));
+            }
+
+            sensor["measurements"] = QVariantList();
+            sensorEntries.append(sensor);
+        }
+
+        ok = insertSession(db, sessionId, sessionData, indexEntry)
+             && insertSensors(db, sessionId, sensorEntries)
+             && insertMeasurements(db, sessionId, pointsBySensor)
+             && (airQuality.isEmpty() || updateAirQuality(db, sessionId, airQuality));
+        imported++;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES ('migrated', '1')");
+    ok = ok && execLogged(query, "importFrom");
+
+    if (!ok || !db.commit()) {
+        qDebug() << "Failed to import history into SQLite:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    qDebug() << "Imported" << imported << "sessions into SQLite history:" << m_databasePath;
+    return true;
+}
+
+/**
+ * @brief Zapisuje nową sesję i dodaje ją do listy sesji.
+ *
+ * Sesje ponad limit są usuwane w tej samej transakcji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param sessionData Dane sesji.
+ * @param indexEntry Wpis indeksu sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SqliteHistoryStorage::writeSession(const QString &sessionId, const QVariantMap &sessionData, const QVariantMap &indexEntry) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start transaction for session" << sessionId << ":" << db.lastError().text();
+        return false;
+    }
+    if (!insertSession(db, sessionId, sessionData, indexEntry) || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+    qDebug() << "Wrote session to SQLite history:" << sessionId;
+    return true;
+}
+
+/**
+ * @brief Zapisuje sensory, pomiary i dane o jakości powietrza sesji.
+ *
+ * Wszystkie zmiany trafiają do bazy w jednej transakcji, a pomiary są wstawiane
+ * wsadowo jednym przygotowanym zapytaniem.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param update Połączone zmiany sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SqliteHistoryStorage::writeUpdate(const QString &sessionId, const SessionUpdate &update) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    if (!sessionExists(sessionId)) {
+        qDebug() << "Failed to update session:" << sessionId << "Error: session does not exist";
+        return false;
+    }
+
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start transaction for session" << sessionId << ":" << db.lastError().text();
+        return false;
+    }
+    bool ok = insertSensors(db, sessionId, update.sensors)
+              && insertMeasurements(db, sessionId, groupMeasurements(update.measurements))
+              && (!update.hasAirQuality || updateAirQuality(db, sessionId, update.airQuality));
+    if (!ok || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+    qDebug() << "Stored" << update.operations << "updates in SQLite history for session:" << sessionId;
+    return true;
+}
+
+/**
+ * @brief Zapisuje podsumowanie sesji w kolumnie summary.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param summary Podsumowanie sesji.
+ * @return true, jeśli zapis się powiódł; false w przeciwnym razie.
+ */
+bool SqliteHistoryStorage::writeSummary(const QString &sessionId, const QVariantMap &summary) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    QSqlQuery query(database());
+    query.prepare("UPDATE sessions SET summary = ? WHERE session_id = ?");
+    query.addBindValue(SessionCodec::encode(summary, m_format));
+    query.addBindValue(sessionId);
+    return execLogged(query, "writeSummary");
+}
+
+/**
+ * @brief Wczytuje listę sesji.
+ *
+ * @return QVariantList z co najwyżej m_maxSessions wpisami od najnowszego do najstarszego.
+ */
+QVariantList SqliteHistoryStorage::loadSessions() const {
+    QVariantList sessions;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare("SELECT session_id, timestamp, location, radius, summary FROM sessions ORDER BY seq DESC LIMIT ?");
+    query.addBindValue(m_maxSessions);
+    if (!execLogged(query, "loadSessions")) {
+        return sessions;
+    }
+    while (query.next()) {
+        QVariantMap entry;
+        entry["session_id"] = query.value(0).toString();
+        entry["timestamp"] = query.value(1).toString();
+        entry["location"] = query.value(2).toString();
+        entry["radius"] = query.value(3).toDouble();
+        if (!query.value(4).isNull()) {
+            entry["summary"] = SessionCodec::decode(query.value(4).toByteArray());
+        }
+        sessions.append(entry);
+    }
+    return sessions;
+}
+
+/**
+ * @brief Wczytuje szczegóły sesji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param cost Ustawiane na łączny rozmiar zakodowanych danych sesji i jej sensorów.
+ * @return QVariantMap zawierający szczegóły sesji.
+ */
+QVariantMap SqliteHistoryStorage::loadSessionDetails(const QString &sessionId, qint64 *cost) const {
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.prepare("SELECT data, air_quality FROM sessions WHERE session_id = ?");
+    query.addBindValue(sessionId);
+    if (!execLogged(query, "loadSessionDetails") || !query.next()) {
+        return QVariantMap();
+    }
+    QByteArray data = query.value(0).toByteArray();
+    qint64 size = data.size();
+    QVariantMap sessionData = SessionCodec::decode(data);
+    if (!query.value(1).isNull()) {
+        sessionData["airQuality"] = SessionCodec::decode(query.value(1).toByteArray());
+    }
+
+    QVariantList sensors;
+    query.prepare("SELECT data, series_from, series_to FROM sensors WHERE session_id = ? ORDER BY rowid");
+    query.addBindValue(sessionId);
+    if (execLogged(query, "loadSessionDetails")) {
+        while (query.next()) {
+            QByteArray sensorData = query.value(0).toByteArray();
+            size += sensorData.size();
+            QVariantMap sensor = SessionCodec::decode(sensorData);
+            if (!query.value(1).isNull()) {
+                sensor["seriesFrom"] = query.value(1).toLongLong();
+                sensor["seriesTo"] = query.value(2).toLongLong();
+            }
+            sensors.append(sensor);
+        }
+    }
+    sessionData["sensors"] = sensors;
+
+    if (cost) {
+        *cost = size;
+    }
+    return sessionData;
+}
+
+/**
+ * @brief Wczytuje wybrane pola sesji.
+ *
+ * Dane o jakości powietrza są dekodowane tylko wtedy, gdy o nie poproszono.
+ * Sensory są przechowywane w osobnej tabeli i nie są tu wczytywane.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param keys Nazwy pól.
+ * @return QVariantMap z istniejącymi polami spośród keys.
+ */
+QVariantMap SqliteHistoryStorage::loadSessionFields(const QString &sessionId, const QStringList &keys) const {
+    QSqlQuery query(database());
+    query.prepare("SELECT data, air_quality FROM sessions WHERE session_id = ?");
+    query.addBindValue(sessionId);
+    if (!execLogged(query, "loadSessionFields") || !query.next()) {
+        return QVariantMap();
+    }
+
+    QVariantMap fields;
+    QVariantMap sessionData = SessionCodec::decode(query.value(0).toByteArray());
+    for (const QString &key : keys) {
+        if (sessionData.contains(key)) {
+            fields[key] = sessionData[key];
+        }
+    }
+    if (keys.contains("airQuality") && !query.value(1).isNull()) {
+        fields["airQuality"] = SessionCodec::decode(query.value(1).toByteArray());
+    }
+    return fields;
+}
+
+/**
+ * @brief Wczytuje sensory jednej stacji zapisane w sesji.
+ *
+ * Zapytanie korzysta z klucza głównego (session_id, sensor_id) i dekoduje tylko
+ * sensory wybranej stacji.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @param stationId Identyfikator stacji.
+ * @return Lista sensorów stacji.
+ */
+QList<QVariantMap> SqliteHistoryStorage::loadStationSensors(const QString &sessionId, int stationId) const {
+    QList<QVariantMap> sensors;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare("SELECT data, series_from, series_to FROM sensors WHERE session_id = ? AND station_id = ? ORDER BY rowid");
+    query.addBindValue(sessionId);
+    query.addBindValue(stationId);
+    if (!execLogged(query, "loadStationSensors")) {
+        return sensors;
+    }
+    while (query.next()) {
+        QVariantMap sensor = SessionCodec::decode(query.value(0).toByteArray());
+        if (!query.value(1).isNull()) {
+            sensor["seriesFrom"] = query.value(1).toLongLong();
+            sensor["seriesTo"] = query.value(2).toLongLong();
+        }
+        sensors.append(sensor);
+    }
+    return sensors;
+}
+
+/**
+ * @brief Wczytuje pomiary sensora z podanego przedziału czasu.
+ *
+ * Zapytanie korzysta z klucza głównego (sensor_id, ts) tabeli measurements.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @return Pomiary w kolejności czasu.
+ */
+QVector<MeasurementPoint> SqliteHistoryStorage::loadMeasurements(int sensorId, qint64 from, qint64 to) const {
+    QVector<MeasurementPoint> points;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare("SELECT ts, value FROM measurements WHERE sensor_id = ? AND ts BETWEEN ? AND ? ORDER BY ts");
+    query.addBindValue(sensorId);
+    query.addBindValue(from);
+    query.addBindValue(to);
+    if (!execLogged(query, "loadMeasurements")) {
+        return points;
+    }
+    while (query.next()) {
+        MeasurementPoint point;
+        point.timestamp = query.value(0).toLongLong();
+        point.valid = !query.value(1).isNull();
+        point.value = point.valid ? query.value(1).toFloat() : 0.0f;
+        points.append(point);
+    }
+    return points;
+}
+
+/**
+ * @brief Wczytuje zagregowane pomiary sensora nakładające się na podany przedział czasu.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param from Początek przedziału (sekundy od epoki, włącznie).
+ * @param to Koniec przedziału (sekundy od epoki, włącznie).
+ * @return Przedziały dobowe i sześciogodzinne w kolejności czasu.
+ */
+QVector<RollupPoint> SqliteHistoryStorage::loadRollups(int sensorId, qint64 from, qint64 to) const {
+    QVector<RollupPoint> rollups;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare("SELECT duration, ts, min_value, max_value, mean_value, samples FROM rollups "
+                  "WHERE sensor_id = ? AND ts <= ? AND ts + duration > ? ORDER BY ts");
+    query.addBindValue(sensorId);
+    query.addBindValue(to);
+    query.addBindValue(from);
+    if (!execLogged(query, "loadRollups")) {
+        return rollups;
+    }
+    while (query.next()) {
+        rollups.append(rollupFromQuery(query));
+    }
+    return rollups;
+}
+
+/**
+ * @brief Zwraca identyfikatory sensorów, które mają zapisane pomiary.
+ *
+ * @return Lista identyfikatorów sensorów w kolejności rosnącej.
+ */
+QList<int> SqliteHistoryStorage::seriesSensorIds() const {
+    QList<int> sensorIds;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare("SELECT DISTINCT sensor_id FROM measurements UNION SELECT DISTINCT sensor_id FROM rollups ORDER BY 1");
+    if (!execLogged(query, "seriesSensorIds")) {
+        return sensorIds;
+    }
+    while (query.next()) {
+        sensorIds.append(query.value(0).toInt());
+    }
+    return sensorIds;
+}
+
+/**
+ * @brief Przenosi starsze pomiary sensora do poziomów zagregowanych.
+ *
+ * Pomiary sprzed rawBefore są agregowane w przedziały sześciogodzinne, a przedziały
+ * sześciogodzinne sprzed rollupBefore w przedziały dobowe. Granice są zaokrąglane
+ * w dół do początku przedziału. Całość odbywa się w jednej transakcji.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param rawBefore Pomiary sprzed tej chwili trafiają do przedziałów sześciogodzinnych.
+ * @param rollupBefore Przedziały sześciogodzinne sprzed tej chwili trafiają do przedziałów dobowych.
+ * @return Liczba przeniesionych pomiarów i przedziałów lub -1 w przypadku błędu.
+ */
+int SqliteHistoryStorage::rollUpSensor(int sensorId, qint64 rawBefore, qint64 rollupBefore) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return -1;
+    }
+    rawBefore -= rawBefore % SeriesStore::ROLLUP_BUCKET_SECONDS;
+    rollupBefore -= rollupBefore % SeriesStore::DAILY_BUCKET_SECONDS;
+
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start rollup transaction:" << db.lastError().text();
+        return -1;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT ts, value FROM measurements WHERE sensor_id = ? AND ts < ? ORDER BY ts");
+    query.addBindValue(sensorId);
+    query.addBindValue(rawBefore);
+    bool ok = execLogged(query, "rollUpSensor");
+    QVector<MeasurementPoint> points;
+    while (ok && query.next()) {
+        MeasurementPoint point;
+        point.timestamp = query.value(0).toLongLong();
+        point.valid = !query.value(1).isNull();
+        point.value = point.valid ? query.value(1).toFloat() : 0.0f;
+        points.append(point);
+    }
+    if (ok && !points.isEmpty()) {
+        ok = upsertRollups(db, sensorId, SeriesStore::rollUpPoints(points, SeriesStore::ROLLUP_BUCKET_SECONDS));
+        query.prepare("DELETE FROM measurements WHERE sensor_id = ? AND ts < ?");
+        query.addBindValue(sensorId);
+        query.addBindValue(rawBefore);
+        ok = ok && execLogged(query, "rollUpSensor");
+    }
+
+    QVector<RollupPoint> sixHour;
+    if (ok) {
+        query.prepare("SELECT duration, ts, min_value, max_value, mean_value, samples FROM rollups "
+                      "WHERE sensor_id = ? AND duration = ? AND ts < ?");
+        query.addBindValue(sensorId);
+        query.addBindValue(SeriesStore::ROLLUP_BUCKET_SECONDS);
+        query.addBindValue(rollupBefore);
+        ok = execLogged(query, "rollUpSensor");
+        while (ok && query.next()) {
+            sixHour.append(rollupFromQuery(query));
+        }
+    }
+    if (ok && !sixHour.isEmpty()) {
+        ok = upsertRollups(db, sensorId, SeriesStore::combineRollups(sixHour, SeriesStore::DAILY_BUCKET_SECONDS));
+        query.prepare("DELETE FROM rollups WHERE sensor_id = ? AND duration = ? AND ts < ?");
+        query.addBindValue(sensorId);
+        query.addBindValue(SeriesStore::ROLLUP_BUCKET_SECONDS);
+        query.addBindValue(rollupBefore);
+        ok = ok && execLogged(query, "rollUpSensor");
+    }
+
+    if (!ok || !db.commit()) {
+        db.rollback();
+        return -1;
+    }
+    return int(points.size() + sixHour.size());
+}
+
+/**
+ * @brief Zwraca czas najstarszych zapisanych danych pomiarowych.
+ *
+ * @return Sekundy od epoki lub -1, jeśli magazyn nie ma pomiarów.
+ */
+qint64 SqliteHistoryStorage::oldestMeasurement() const {
+    QSqlQuery query(database());
+    query.prepare("SELECT min(ts) FROM (SELECT min(ts) AS ts FROM measurements UNION ALL SELECT min(ts) FROM rollups)");
+    if (!execLogged(query, "oldestMeasurement") || !query.next() || query.value(0).isNull()) {
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+/**
+ * @brief Usuwa dane pomiarowe wszystkich sensorów sprzed podanej chwili.
+ *
+ * Usunięte strony trafiają na listę wolnych stron bazy, a plik nie jest zmniejszany;
+ * robi to dopiero reclaimSpace(). Zwracana liczba bajtów to przyrost listy wolnych stron.
+ *
+ * @param cutoff Dane kończące się przed tą chwilą są usuwane.
+ * @return Szacowana liczba zwolnionych bajtów lub -1 w przypadku błędu.
+ */
+qint64 SqliteHistoryStorage::trimBefore(qint64 cutoff) {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return -1;
+    }
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    auto freeBytes = [&query]() -> qint64 {
+        if (!query.exec("PRAGMA freelist_count") || !query.next()) {
+            return 0;
+        }
+        qint64 pages = query.value(0).toLongLong();
+        if (!query.exec("PRAGMA page_size") || !query.next()) {
+            return 0;
+        }
+        return pages * query.value(0).toLongLong();
+    };
+    const qint64 freeBefore = freeBytes();
+
+    if (!db.transaction()) {
+        qDebug() << "Failed to start trim transaction:" << db.lastError().text();
+        return -1;
+    }
+    query.prepare("DELETE FROM measurements WHERE ts < ?");
+    query.addBindValue(cutoff);
+    bool ok = execLogged(query, "trimBefore");
+    query.prepare("DELETE FROM rollups WHERE ts + duration <= ?");
+    query.addBindValue(cutoff);
+    ok = ok && execLogged(query, "trimBefore");
+    if (!ok || !db.commit()) {
+        db.rollback();
+        return -1;
+    }
+    return qMax<qint64>(0, freeBytes() - freeBefore);
+}
+
+/**
+ * @brief Kompaktuje bazę (VACUUM) i przycina plik WAL, aby zwolnić miejsce na dysku.
+ *
+ * @return true, jeśli operacja się powiodła; false w przeciwnym razie.
+ */
+bool SqliteHistoryStorage::reclaimSpace() {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return false;
+    }
+    QSqlQuery query(database());
+    if (!query.exec("VACUUM") || !query.exec("PRAGMA wal_checkpoint(TRUNCATE)")) {
+        qDebug() << "Failed to compact history database:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Zwraca miejsce zajmowane przez bazę na dysku.
+ *
+ * @return Rozmiar pliku bazy wraz z plikami WAL i SHM (w bajtach).
+ */
+qint64 SqliteHistoryStorage::diskUsage() const {
+    qint64 total = 0;
+    for (const QString &suffix : {QString(), QString("-wal"), QString("-shm")}) {
+        QFileInfo info(m_databasePath + suffix);
+        if (info.exists()) {
+            total += info.size();
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Sprawdza, czy sesja istnieje.
+ *
+ * @param sessionId Identyfikator sesji.
+ * @return true, jeśli sesja istnieje; false w przeciwnym razie.
+ */
+bool SqliteHistoryStorage::sessionExists(const QString &sessionId) const {
+    QSqlQuery query(database());
+    query.prepare("SELECT 1 FROM sessions WHERE session_id = ?");
+    query.addBindValue(sessionId);
+    return execLogged(query, "sessionExists") && query.next();
+}
+
+/**
+ * @brief Wyszukuje sesje, które mają sensor spełniający zapytanie.
+ *
+ * Warunki na sensor, stację i zakres szeregu są sprawdzane w zapytaniu SQL
+ * z użyciem indeksów sensors_sensor i sensors_station, więc niepasujące sensory
+ * nie są dekodowane. Dekodowane są tylko sensory bez zakresu szeregu (pomiary
+ * zapisane w sensorze przez starsze wersje), gdy zapytanie ogranicza czas.
+ *
+ * @param query Zapytanie (stacja, sensor, przedział czasu).
+ * @param stats Ustawiane na statystyki wykonania zapytania (opcjonalnie).
+ * @return Identyfikatory pasujących sesji od najnowszej do najstarszej.
+ */
+QStringList SqliteHistoryStorage::findSessions(const SessionQuery &query, SessionQueryStats *stats) const {
+    SessionQueryStats queryStats;
+    QStringList matches;
+    QSqlQuery countQuery(database());
+    countQuery.prepare("SELECT min(count(*), ?) FROM sessions");
+    countQuery.addBindValue(m_maxSessions);
+    if (execLogged(countQuery, "findSessions") && countQuery.next()) {
+        queryStats.sessions = countQuery.value(0).toInt();
+    }
+
+    QSqlQuery sensorQuery(database());
+    sensorQuery.setForwardOnly(true);
+    sensorQuery.prepare("SELECT sensors.session_id, sensors.series_from, sensors.data FROM sensors "
+                        "JOIN (SELECT session_id, seq FROM sessions ORDER BY seq DESC LIMIT ?) AS recent "
+                        "ON recent.session_id = sensors.session_id "
+                        "WHERE (? = 0 OR sensors.sensor_id = ?) AND (? = 0 OR sensors.station_id = ?) "
+                        "AND (sensors.series_from IS NULL OR (sensors.series_from <= ? AND sensors.series_to >= ?)) "
+                        "ORDER BY recent.seq DESC");
+    sensorQuery.addBindValue(m_maxSessions);
+    sensorQuery.addBindValue(query.sensorId);
+    sensorQuery.addBindValue(query.sensorId);
+    sensorQuery.addBindValue(query.stationId);
+    sensorQuery.addBindValue(query.stationId);
+    sensorQuery.addBindValue(query.to);
+    sensorQuery.addBindValue(query.from);
+    if (!execLogged(sensorQuery, "findSessions")) {
+        return matches;
+    }
+
+    QSet<QString> candidates;
+    QSet<QString> decodedSessions;
+    while (sensorQuery.next()) {
+        QString sessionId = sensorQuery.value(0).toString();
+        candidates.insert(sessionId);
+        if (!matches.isEmpty() && matches.last() == sessionId) {
+            continue;
+        }
+        if (sensorQuery.value(1).isNull() && query.hasTimeRange()) {
+            decodedSessions.insert(sessionId);
+            if (!query.matchesSensor(SessionCodec::decode(sensorQuery.value(2).toByteArray()))) {
+                continue;
+            }
+        }
+        matches.append(sessionId);
+    }
+
+    queryStats.matched = matches.size();
+    queryStats.opened = decodedSessions.size();
+    queryStats.pruned = queryStats.sessions - int(candidates.size());
+    if (stats) {
+        *stats = queryStats;
+    }
+    return matches;
+}
+
+/**
+ * @brief Zwraca liczbę wykrytych zapisów innych instancji aplikacji.
+ *
+ * Zapisy wszystkich instancji są wykonywane pod blokadą history.lock, której licznik
+ * zapisów pozwala wykryć zmiany wprowadzone przez inną instancję.
+ *
+ * @return Licznik zwiększany przy każdym wykryciu zmian zapisanych przez inną instancję.
+ */
+quint64 SqliteHistoryStorage::externalChangeCount() const {
+    if (m_writerLock.hasExternalChanges()) {
+        return ++m_externalChanges;
+    }
+    return m_externalChanges;
+}
+
+/**
+ * @brief Zwraca blokadę zapisu bazy.
+ *
+ * @return Blokada history.lock współdzielona przez instancje aplikacji.
+ */
+HistoryLock &SqliteHistoryStorage::writerLock() {
+    return m_writerLock;
+}
+
+/**
+ * @brief Przepisuje dane sesji i sensorów do formatu m_format.
+ *
+ * Przepisywane są tylko wartości zapisane w innym formacie. Cała konwersja
+ * odbywa się w jednej transakcji.
+ *
+ * @return Liczba przepisanych wartości lub -1 w przypadku błędu.
+ */
+int SqliteHistoryStorage::convertFormat() {
+    HistoryLock::Locker writer(m_writerLock);
+    if (!writer.isLocked()) {
+        return -1;
+    }
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start conversion transaction:" << db.lastError().text();
+        return -1;
+    }
+    int converted = 0;
+    bool ok = convertColumn(db, "sessions", "data", converted)
+              && convertColumn(db, "sessions", "air_quality", converted)
+              && convertColumn(db, "sessions", "summary", converted)
+              && convertColumn(db, "sensors", "data", converted);
+    if (!ok || !db.commit()) {
+        db.rollback();
+        return -1;
+    }
+    qDebug() << "Converted" << converted << "SQLite history values to" << SessionCodec::formatName(m_format);
+    return converted;
+}
+
+/**
+ * @brief Przepisuje jedną kolumnę tabeli do formatu m_format.
+ *
+ * @param db Połączenie z bazą (z otwartą transakcją).
+ * @param table Nazwa tabeli.
+ * @param column Nazwa kolumny z zakodowanymi danymi.
+ * @param converted Licznik przepisanych wartości, zwiększany o liczbę zmienionych wierszy.
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SqliteHistoryStorage::convertColumn(QSqlDatabase &db, const QString &table, const QString &column, int &converted) {
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    if (!select.exec(QString("SELECT rowid, %1 FROM %2 WHERE %1 IS NOT NULL").arg(column, table))) {
+        qDebug() << "SQLite error in convertColumn:" << select.lastError().text();
+        return false;
+    }
+
+    QVariantList rowIds;
+    QVariantList values;
+    while (select.next()) {
+        QByteArray encoded = select.value(1).toByteArray();
+        if (SessionCodec::detect(encoded) == m_format) {
+            continue;
+        }
+        bool decoded = false;
+        QVariantMap data = SessionCodec::decode(encoded, &decoded);
+        if (!decoded) {
+            qDebug() << "Skipping undecodable value in" << table << "row" << select.value(0).toLongLong();
+            continue;
+        }
+        rowIds.append(select.value(0));
+        values.append(SessionCodec::encode(data, m_format));
+    }
+    if (rowIds.isEmpty()) {
+        return true;
+    }
+
+    QSqlQuery update(db);
+    update.prepare(QString("UPDATE %1 SET %2 = ? WHERE rowid = ?").arg(table, column));
+    update.addBindValue(values);
+    update.addBindValue(rowIds);
+    if (!update.execBatch()) {
+        qDebug() << "SQLite error in convertColumn:" << update.lastError().text();
+        return false;
+    }
+    converted += rowIds.size();
+    return true;
+}
+
+/**
+ * @brief Zwraca połączenie z bazą dla bieżącego wątku.
+ *
+ * Połączenia QtSql nie mogą być współdzielone między wątkami, dlatego każdy wątek
+ * otrzymuje własne połączenie o niepowtarzalnej nazwie, przechowywane w QThreadStorage
+ * i usuwane po zakończeniu wątku (np. wątku puli QtConcurrent). Nowe połączenie włącza
+ * tryb WAL, dzięki któremu odczyty w wątku interfejsu nie czekają na zapisy w wątku
+ * HistoryWriter.
+ *
+ * @return Połączenie z bazą.
+ */
+QSqlDatabase SqliteHistoryStorage::database() const {
+    if (ThreadConnection *connection = m_threadConnections.localData()) {
+        return QSqlDatabase::database(connection->name);
+    }
+
+    const QString name = QString("history_%1").arg(nextConnectionId.fetchAndAddRelaxed(1));
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(m_databasePath);
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (db.open()) {
+        QSqlQuery pragma(db);
+        pragma.exec("PRAGMA journal_mode=WAL");
+        pragma.exec("PRAGMA synchronous=NORMAL");
+    } else {
+        qDebug() << "Failed to open history database:" << m_databasePath << "Error:" << db.lastError().text();
+    }
+    m_threadConnections.setLocalData(new ThreadConnection{name});
+
+    QMutexLocker locker(&m_connectionMutex);
+    // Drop the names of connections already removed by their finished threads
+    m_connectionNames.removeIf([](const QString &connectionName) {
+        return !QSqlDatabase::contains(connectionName);
+    });
+    m_connectionNames.append(name);
+    return db;
+}
+
+/**
+ * @brief Tworzy tabele i indeksy, jeśli nie istnieją.
+ *
+ * Tabela measurements nie ma kolumny rowid, więc jej klucz główny (sensor_id, ts)
+ * jest jednocześnie indeksem, według którego wiersze są fizycznie uporządkowane.
+ * Tabela rollups przechowuje przedziały sześciogodzinne i dobowe (kolumna duration).
+ *
+ * @return true, jeśli schemat jest gotowy.
+ */
+bool SqliteHistoryStorage::createSchema() {
+    QSqlDatabase db = database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value TEXT)",
+        "CREATE TABLE IF NOT EXISTS sessions ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, session_id TEXT NOT NULL UNIQUE, timestamp TEXT, "
+        "location TEXT, radius REAL, data TEXT NOT NULL, air_quality TEXT, summary BLOB)",
+        "CREATE TABLE IF NOT EXISTS sensors ("
+        "session_id TEXT NOT NULL, sensor_id INTEGER NOT NULL, station_id INTEGER, data TEXT NOT NULL, "
+        "series_from INTEGER, series_to INTEGER, PRIMARY KEY (session_id, sensor_id))",
+        "CREATE INDEX IF NOT EXISTS sensors_station ON sensors (station_id)",
+        "CREATE INDEX IF NOT EXISTS sensors_sensor ON sensors (sensor_id, series_from, series_to)",
+        "CREATE TABLE IF NOT EXISTS measurements ("
+        "sensor_id INTEGER NOT NULL, ts INTEGER NOT NULL, value REAL, PRIMARY KEY (sensor_id, ts)) WITHOUT ROWID",
+        "CREATE TABLE IF NOT EXISTS rollups ("
+        "sensor_id INTEGER NOT NULL, duration INTEGER NOT NULL, ts INTEGER NOT NULL, min_value REAL, max_value REAL, "
+        "mean_value REAL, samples INTEGER NOT NULL, PRIMARY KEY (sensor_id, duration, ts)) WITHOUT ROWID"
+    };
+    QSqlQuery query(db);
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Failed to create history schema:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // Databases created by older versions have no summary column
+    if (!query.exec("SELECT summary FROM sessions LIMIT 0")
+        && !query.exec("ALTER TABLE sessions ADD COLUMN summary BLOB")) {
+        qDebug() << "Failed to add the session summary column:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Zapisuje sesję i usuwa najstarsze sesje ponad limit.
+ *
+ * Ponowny zapis tej samej sesji zastępuje ją i usuwa jej sensory. Pomiary
+ * pozostają, bo są współdzielone przez sesje.
+ *
+ * @param db Połączenie z bazą (z otwartą transakcją).
+ * @param sessionId Identyfikator sesji.
+ * @param sessionData Dane sesji.
+ * @param indexEntry Wpis indeksu sesji.
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SqliteHistoryStorage::insertSession(QSqlDatabase &db, const QString &sessionId, const QVariantMap &sessionData, const QVariantMap &indexEntry) {
+    QVariantMap data = sessionData;
+    data.remove("sensors");
+    data.remove("airQuality");
+
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO sessions (session_id, timestamp, location, radius, data, summary) VALUES (?, ?, ?, ?, ?, ?)");
+    query.addBindValue(sessionId);
+    query.addBindValue(indexEntry["timestamp"].toString());
+    query.addBindValue(indexEntry["location"].toString());
+    query.addBindValue(indexEntry["radius"].toDouble());
+    query.addBindValue(SessionCodec::encode(data, m_format));
+    query.addBindValue(indexEntry.contains("summary") ? QVariant(SessionCodec::encode(indexEntry["summary"].toMap(), m_format))
+                                                      : QVariant(QMetaType::fromType<QByteArray>()));
+    if (!execLogged(query, "insertSession")) {
+        return false;
+    }
+    query.prepare("DELETE FROM sensors WHERE session_id = ?");
+    query.addBindValue(sessionId);
+    if (!execLogged(query, "insertSession")) {
+        return false;
+    }
+
+    QStringList evicted;
+    query.prepare("SELECT session_id FROM sessions ORDER BY seq DESC LIMIT -1 OFFSET ?");
+    query.addBindValue(m_maxSessions);
+    if (!execLogged(query, "insertSession")) {
+        return false;
+    }
+    while (query.next()) {
+        evicted.append(query.value(0).toString());
+    }
+    for (const QString &evictedId : evicted) {
+        query.prepare("DELETE FROM sensors WHERE session_id = ?");
+        query.addBindValue(evictedId);
+        if (!execLogged(query, "insertSession")) {
+            return false;
+        }
+        query.prepare("DELETE FROM sessions WHERE session_id = ?");
+        query.addBindValue(evictedId);
+        if (!execLogged(query, "insertSession")) {
+            return false;
+        }
+        qDebug() << "Removed old session from SQLite history:" << evictedId;
+    }
+    return true;
+}
+
+/**
+ * @brief Dodaje sensory do sesji, pomijając duplikaty.
+ *
+ * @param db Połączenie z bazą (z otwartą transakcją).
+ * @param sessionId Identyfikator sesji.
+ * @param sensors Lista sensorów.
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SqliteHistoryStorage::insertSensors(QSqlDatabase &db, const QString &sessionId, const QList<QVariantMap> &sensors) {
+    if (sensors.isEmpty()) {
+        return true;
+    }
+    QVariantList sessionIds;
+    QVariantList sensorIds;
+    QVariantList stationIds;
+    QVariantList data;
+    for (const QVariantMap &sensor : sensors) {
+        sessionIds.append(sessionId);
+        sensorIds.append(sensor["id"].toInt());
+        stationIds.append(sensor["stationId"].toInt());
+        data.append(SessionCodec::encode(sensor, m_format));
+    }
+
+    QSqlQuery query(db);
+    query.prepare("INSERT OR IGNORE INTO sensors (session_id, sensor_id, station_id, data) VALUES (?, ?, ?, ?)");
+    query.addBindValue(sessionIds);
+    query.addBindValue(sensorIds);
+    query.addBindValue(stationIds);
+    query.addBindValue(data);
+    if (!query.execBatch()) {
+        qDebug() << "SQLite error in insertSensors:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Zapisuje pomiary i rozszerza zakresy czasu sensorów sesji.
+ *
+ * Pomiary są wstawiane wsadowo; dla tej samej godziny nowsza wartość zastępuje
+ * wcześniejszą. Zakres seriesFrom..seriesTo sensora sesji obejmuje wszystkie
+ * zapisane dla niej pomiary.
+ *
+ * @param db Połączenie z bazą (z otwartą transakcją).
+ * @param sessionId Identyfikator sesji.
+ * @param pointsBySensor Pomiary pogrupowane według sensorów.
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SqliteHistoryStorage::insertMeasurements(QSqlDatabase &db, const QString &sessionId, const QMap<int, QVector<MeasurementPoint>> &pointsBySensor) {
+    QVariantList sensorIds;
+    QVariantList timestamps;
+    QVariantList values;
+    for (auto it = pointsBySensor.constBegin(); it != pointsBySensor.constEnd(); ++it) {
+        for (const MeasurementPoint &point : it.value()) {
+            sensorIds.append(it.key());
+            timestamps.append(point.timestamp);
+            values.append(point.valid ? QVariant(double(point.value)) : QVariant(QMetaType::fromType<double>()));
+        }
+    }
+    if (sensorIds.isEmpty()) {
+        return true;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO measurements (sensor_id, ts, value) VALUES (?, ?, ?) "
+                  "ON CONFLICT (sensor_id, ts) DO UPDATE SET value = excluded.value");
+    query.addBindValue(sensorIds);
+    query.addBindValue(timestamps);
+    query.addBindValue(values);
+    if (!query.execBatch()) {
+        qDebug() << "SQLite error in insertMeasurements:" << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("UPDATE sensors SET series_from = min(coalesce(series_from, ?), ?), series_to = max(coalesce(series_to, ?), ?) "
+                  "WHERE session_id = ? AND sensor_id = ?");
+    for (auto it = pointsBySensor.constBegin(); it != pointsBySensor.constEnd(); ++it) {
+        if (it.value().isEmpty()) {
+            continue;
+        }
+        qint64 from = it.value().first().timestamp;
+        qint64 to = from;
+        for (const MeasurementPoint &point : it.value()) {
+            from = qMin(from, point.timestamp);
+            to = qMax(to, point.timestamp);
+        }
+        query.bindValue(0, from);
+        query.bindValue(1, from);
+        query.bindValue(2, to);
+        query.bindValue(3, to);
+        query.bindValue(4, sessionId);
+        query.bindValue(5, it.key());
+        if (!execLogged(query, "insertMeasurements")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Dołącza przedziały do tabeli rollups (w otwartej transakcji).
+ *
+ * Przedział, który już istnieje, jest łączony z nowym: minimum i maksimum są
+ * aktualizowane, a średnia jest ważona liczbą pomiarów.
+ *
+ * @param db Połączenie z bazą (z otwartą transakcją).
+ * @param sensorId Identyfikator sensora.
+ * @param rollups Przedziały do dołączenia.
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SqliteHistoryStorage::upsertRollups(QSqlDatabase &db, int sensorId, const QVector<RollupPoint> &rollups) {
+    if (rollups.isEmpty()) {
+        return true;
+    }
+    QVariantList sensorIds;
+    QVariantList durations;
+    QVariantList timestamps;
+    QVariantList minimums;
+    QVariantList maximums;
+    QVariantList means;
+    QVariantList samples;
+    for (const RollupPoint &rollup : rollups) {
+        sensorIds.append(sensorId);
+        durations.append(rollup.duration);
+        timestamps.append(rollup.timestamp);
+        minimums.append(double(rollup.min));
+        maximums.append(double(rollup.max));
+        means.append(double(rollup.mean));
+        samples.append(rollup.count);
+    }
+
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO rollups (sensor_id, duration, ts, min_value, max_value, mean_value, samples) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?) ON CONFLICT (sensor_id, duration, ts) DO UPDATE SET "
+                  "min_value = min(min_value, excluded.min_value), max_value = max(max_value, excluded.max_value), "
+                  "mean_value = (mean_value * samples + excluded.mean_value * excluded.samples) / (samples + excluded.samples), "
+                  "samples = samples + excluded.samples");
+    query.addBindValue(sensorIds);
+    query.addBindValue(durations);
+    query.addBindValue(timestamps);
+    query.addBindValue(minimums);
+    query.addBindValue(maximums);
+    query.addBindValue(means);
+    query.addBindValue(samples);
+    if (!query.execBatch()) {
+        qDebug() << "SQLite error in upsertRollups:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Zapisuje dane o jakości powietrza sesji.
+ *
+ * @param db Połączenie z bazą (z otwartą transakcją).
+ * @param sessionId Identyfikator sesji.
+ * @param airQuality Dane o jakości powietrza.
+ * @return true, jeśli zapis się powiódł.
+ */
+bool SqliteHistoryStorage::updateAirQuality(QSqlDatabase &db, const QString &sessionId, const QVariantMap &airQuality) {
+    QSqlQuery query(db);
+    query.prepare("UPDATE sessions SET air_quality = ? WHERE session_id = ?");
+    query.addBindValue(SessionCodec::encode(airQuality, m_format));
+    query.addBindValue(sessionId);
+    return execLogged(query, "updateAirQuality");
+}
@@ -0,0 +1,201 @@
+#ifndef SQLITEHISTORYSTORAGE_H
+#define SQLITEHISTORYSTORAGE_H
+
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QThreadStorage>
+#include "historylock.h"
+#include "historystorage.h"
+#include "sessioncodec.h"
+
+/**
+ * @class SqliteHistoryStorage
+ * @brief Magazyn historii sesji oparty na bazie SQLite (QtSql).
+ *
+ * Sesje, sensory sesji i pomiary są przechowywane w tabelach sessions, sensors
+ * i measurements. Pomiary są współdzielone przez sesje i indeksowane kluczem
+ * (sensor_id, ts), a sensory indeksem na station_id. Starsze pomiary są przenoszone
+ * do tabeli rollups (przedziały sześciogodzinne i dobowe). Baza działa w trybie WAL,
+ * a każda paczka zmian jest zapisywana w jednej transakcji, pod blokadą history.lock
+ * współdzieloną z innymi instancjami aplikacji. Każdy wątek korzysta
+ * z własnego połączenia z bazą. Dane sesji i sensorów są zapisywane w formacie
+ * wybranym w SessionCodec, a odczyt rozpoznaje format każdej wartości.
+ */
+class SqliteHistoryStorage : public HistoryStorage
+{
+public:
+    /**
+     * @brief Konstruktor klasy SqliteHistoryStorage. Otwiera bazę i tworzy schemat.
+     * @param databasePath Ścieżka do pliku bazy danych.
+     * @param maxSessions Maksymalna liczba przechowywanych sesji.
+     * @param format Format zapisu danych sesji i sensorów.
+     */
+    SqliteHistoryStorage(const QString &databasePath, int maxSessions, SessionCodec::Format format = SessionCodec::Cbor);
+
+    /**
+     * @brief Destruktor klasy SqliteHistoryStorage. Zamyka połączenia z bazą.
+     */
+    ~SqliteHistoryStorage() override;
+
+    /**
+     * @brief Sprawdza, czy baza została otwarta i ma poprawny schemat.
+     * @return true, jeśli baza jest gotowa do użycia.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Sprawdza, czy dane z magazynu plikowego zostały już zaimportowane.
+     * @return true, jeśli import został wykonany.
+     */
+    bool isMigrated() const;
+
+    /**
+     * @brief Jednorazowo importuje sesje, sensory i pomiary z innego magazynu.
+     * @param source Magazyn źródłowy (zwykle FileHistoryStorage).
+     * @return true, jeśli import się powiódł; false w przeciwnym razie.
+     */
+    bool importFrom(const HistoryStorage &source);
+
+    bool writeSession(const QString &sessionId, const QVariantMap &sessionData, const QVariantMap &indexEntry) override;
+    bool writeUpdate(const QString &sessionId, const SessionUpdate &update) override;
+    bool writeSummary(const QString &sessionId, const QVariantMap &summary) override;
+    QVariantList loadSessions() const override;
+    QVariantMap loadSessionDetails(const QString &sessionId, qint64 *cost = nullptr) const override;
+    QVariantMap loadSessionFields(const QString &sessionId, const QStringList &keys) const override;
+    QList<QVariantMap> loadStationSensors(const QString &sessionId, int stationId) const override;
+    QVector<MeasurementPoint> loadMeasurements(int sensorId, qint64 from, qint64 to) const override;
+    QVector<RollupPoint> loadRollups(int sensorId, qint64 from, qint64 to) const override;
+    QList<int> seriesSensorIds() const override;
+    int rollUpSensor(int sensorId, qint64 rawBefore, qint64 rollupBefore) override;
+    qint64 oldestMeasurement() const override;
+    qint64 trimBefore(qint64 cutoff) override;
+    bool reclaimSpace() override;
+    qint64 diskUsage() const override;
+    bool sessionExists(const QString &sessionId) const override;
+    QStringList findSessions(const SessionQuery &query, SessionQueryStats *stats = nullptr) const override;
+    quint64 externalChangeCount() const override;
+    HistoryLock &writerLock() override;
+    int convertFormat() override;
+
+private:
+    /**
+     * @brief Połączenie z bazą należące do jednego wątku.
+     */
+    struct ThreadConnection;
+
+    /**
+     * @brief Zwraca połączenie z bazą dla bieżącego wątku, otwierając je w razie potrzeby.
+     * @return Połączenie z bazą.
+     */
+    QSqlDatabase database() const;
+
+    /**
+     * @brief Tworzy tabele i indeksy, jeśli nie istnieją.
+     * @return true, jeśli schemat jest gotowy.
+     */
+    bool createSchema();
+
+    /**
+     * @brief Zapisuje sesję i usuwa najstarsze sesje ponad limit (w otwartej transakcji).
+     * @param db Połączenie z bazą.
+     * @param sessionId Identyfikator sesji.
+     * @param sessionData Dane sesji.
+     * @param indexEntry Wpis indeksu sesji.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool insertSession(QSqlDatabase &db, const QString &sessionId, const QVariantMap &sessionData, const QVariantMap &indexEntry);
+
+    /**
+     * @brief Dodaje sensory do sesji, pomijając duplikaty (w otwartej transakcji).
+     * @param db Połączenie z bazą.
+     * @param sessionId Identyfikator sesji.
+     * @param sensors Lista sensorów.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool insertSensors(QSqlDatabase &db, const QString &sessionId, const QList<QVariantMap> &sensors);
+
+    /**
+     * @brief Zapisuje pomiary i rozszerza zakresy czasu sensorów sesji (w otwartej transakcji).
+     * @param db Połączenie z bazą.
+     * @param sessionId Identyfikator sesji.
+     * @param pointsBySensor Pomiary pogrupowane według sensorów.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool insertMeasurements(QSqlDatabase &db, const QString &sessionId, const QMap<int, QVector<MeasurementPoint>> &pointsBySensor);
+
+    /**
+     * @brief Dołącza przedziały do tabeli rollups, łącząc je z istniejącymi (w otwartej transakcji).
+     * @param db Połączenie z bazą.
+     * @param sensorId Identyfikator sensora.
+     * @param rollups Przedziały do dołączenia.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool upsertRollups(QSqlDatabase &db, int sensorId, const QVector<RollupPoint> &rollups);
+
+    /**
+     * @brief Zapisuje dane o jakości powietrza sesji (w otwartej transakcji).
+     * @param db Połączenie z bazą.
+     * @param sessionId Identyfikator sesji.
+     * @param airQuality Dane o jakości powietrza.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool updateAirQuality(QSqlDatabase &db, const QString &sessionId, const QVariantMap &airQuality);
+
+    /**
+     * @brief Przepisuje jedną kolumnę tabeli do formatu m_format.
+     * @param db Połączenie z bazą.
+     * @param table Nazwa tabeli.
+     * @param column Nazwa kolumny z zakodowanymi danymi.
+     * @param converted Licznik przepisanych wartości.
+     * @return true, jeśli zapis się powiódł.
+     */
+    bool convertColumn(QSqlDatabase &db, const QString &table, const QString &column, int &converted);
+
+    /**
+     * @brief Ścieżka do pliku bazy danych.
+     */
+    QString m_databasePath;
+
+    /**
+     * @brief Maksymalna liczba przechowywanych sesji.
+     */
+    const int m_maxSessions;
+
+    /**
+     * @brief Format zapisu danych sesji i sensorów.
+     */
+    const SessionCodec::Format m_format;
+
+    /**
+     * @brief Czy schemat bazy został utworzony.
+     */
+    bool m_open;
+
+    /**
+     * @brief Muteks chroniący listę połączeń.
+     */
+    mutable QMutex m_connectionMutex;
+
+    /**
+     * @brief Nazwy połączeń otwartych przez poszczególne wątki.
+     */
+    mutable QStringList m_connectionNames;
+
+    /**
+     * @brief Połączenie bieżącego wątku (usuwane po zakończeniu wątku).
+     */
+    mutable QThreadStorage<ThreadConnection *> m_threadConnections;
+
+    /**
+     * @brief Blokada zapisu współdzielona z innymi instancjami aplikacji.
+     */
+    mutable HistoryLock m_writerLock;
+
+    /**
+     * @brief Liczba wykrytych zapisów innych instancji.
+     */
+    mutable QAtomicInteger<quint64> m_externalChanges;
+};
+
+#endif // SQLITEHISTORYSTORAGE_H
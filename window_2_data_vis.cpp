@@ -9,6 +9,7 @@
 
 #include "window_2_data_vis.h"
 #include "ui_window_2_data_vis.h"
+#include "connectivitymonitor.h"
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -20,17 +21,16 @@
 #include <QtCharts/QValueAxis>
 #include <QtCharts/QCategoryAxis>
 #include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QVBoxLayout>
 #include <cmath>
-#include <QEventLoop>
-#include <thread>
 //#include <mutex>
 
 /**
  * @brief Konstruktor klasy window_2_data_vis.
  *
- * Inicjalizuje okno wizualizacji danych, ustawia interfejs użytkownika, menedżera sieciowego
- * oraz konfiguruje połączenia sygnałów i slotów. Pobiera dane sensorów i jakości powietrza
+ * Inicjalizuje okno wizualizacji danych, ustawia interfejs użytkownika, kolejkę pobierania
+ * pomiarów oraz konfiguruje połączenia sygnałów i slotów. Pobiera dane sensorów i jakości powietrza
  * dla podanej stacji.
  *
  * @param stationId Identyfikator stacji pomiarowej.
@@ -41,12 +41,14 @@
 window_2_data_vis::window_2_data_vis(int stationId, HistoryManager *historyManager, const QString &sessionId, QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::window_2_data_vis)
-    , m_networkManager(new QNetworkAccessManager(this))
+    , m_fetchScheduler(new FetchScheduler(MAX_CONCURRENT_FETCHES, this))
     , m_stationId(stationId)
     , m_chart(nullptr)
     , m_chartView(nullptr)
     , m_historyManager(historyManager)
     , m_sessionId(sessionId)
+    , m_displayGeneration(0)
+    , m_runningAggregations(0)
 {
     ui->setupUi(this);
 
@@ -59,14 +61,9 @@ window_2_data_vis::window_2_data_vis(int stationId, HistoryManager *historyManag
         ui->grBox_sensors->setLayout(m_sensorLayout);
     }
 
-    connect(m_networkManager, &QNetworkAccessManager::finished, this, [this](QNetworkReply *reply) {
-        if (reply->url().toString().contains("/data/getData/")) {
-            onMeasurementReply(reply);
-        } else if (reply->url().toString().contains("/aqindex/getIndex/")) {
-            onAirQualityReply(reply);
-        } else {
-            onSensorReply(reply);
-        }
+    connect(m_fetchScheduler, &FetchScheduler::replyReady, this, [this](const RequestBroker::Response &response) {
+        onMeasurementReply(response);
+        finishMeasurement(response.url.toString().split("/").last().toInt());
     });
 
     ui->calendarWidget->setSelectionMode(QCalendarWidget::SingleSelection);
@@ -83,60 +80,17 @@ window_2_data_vis::window_2_data_vis(int stationId, HistoryManager *historyManag
 /**
  * @brief Destruktor klasy window_2_data_vis.
  *
- * Zwalnia zasoby, takie jak interfejs użytkownika i menedżer sieciowy.
+ * Zwalnia zasoby, takie jak interfejs użytkownika. Żądania w toku nie są przerywane,
+ * ponieważ mogą na nie czekać inne okna; ich wyniki nie trafiają już do tego okna.
+ * Czeka na zakończenie agregacji w puli wątków, ponieważ korzystają one z menedżera
+ * historii, który może zostać usunięty zaraz po oknie.
  */
 window_2_data_vis::~window_2_data_vis()
 {
-    delete ui;
-    delete m_networkManager;
-}
-
-/**
- * @brief Sprawdza dostępność połączenia internetowego.
- *
- * Wykonuje żądania HEAD do znanych punktów końcowych w celu weryfikacji połączenia z internetem.
- *
- * @return true, jeśli połączenie istnieje; false w przeciwnym razie.
- */
-bool window_2_data_vis::checkInternetConnection() {
-    const QStringList endpoints = {"https://www.google.com", "https://cloudflare.com"};
-    bool isConnected = false;
-
-    for (const QString& endpoint : endpoints) {
-        QEventLoop loop;
-        QTimer timer;
-        timer.setSingleShot(true);
-        QNetworkReply *reply = nullptr;
-
-        QUrl url(endpoint);
-        QNetworkRequest request(url);
-        request.setHeader(QNetworkRequest::UserAgentHeader, "AirQualityApp/1.0");
-
-        reply = m_networkManager->head(request);
-        qDebug() << "Checking connectivity with HEAD request to:" << endpoint;
-
-        QObject::connect(reply, &QNetworkReply::finished, &loop, [&]() {
-            if (reply->error() == QNetworkReply::NoError) {
-                isConnected = true;
-                qDebug() << "HEAD request to" << reply->url().toString() << "succeeded.";
-            } else {
-                qDebug() << "HEAD request to" << reply->url().toString() << "failed:" << reply->errorString();
-            }
-            loop.quit();
-        });
-
-        QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-        timer.start(2000);
-        loop.exec();
-
-        reply->deleteLater();
-
-        if (isConnected) {
-            break;
-        }
+    for (QFuture<AggregationResult> &task : m_aggregationTasks) {
+        task.waitForFinished();
     }
-
-    return isConnected;
+    delete ui;
 }
 
 /**
@@ -149,37 +103,32 @@ bool window_2_data_vis::checkInternetConnection() {
  */
 void window_2_data_vis::fetchSensors(int stationId)
 {
-    if (checkInternetConnection()) {
+    if (ConnectivityMonitor::instance()->isOnline()) {
         QUrl url("https://api.gios.gov.pl/pjp-api/rest/station/sensors/" + QString::number(stationId));
-        QNetworkRequest request(url);
         qDebug() << "Fetching sensors for station ID:" << stationId << "from:" << url.toString();
-        m_networkManager->get(request);
+        RequestBroker::instance()->get(QNetworkRequest(url), DISPLAY_PRIORITY, this, [this](const RequestBroker::Response &response) {
+            onSensorReply(response);
+        });
     } else {
         qDebug() << "No internet connection. Loading sensors from history for station ID:" << stationId;
-        QVariantMap sessionData = m_historyManager->loadSessionDetails(m_sessionId);
-        if (sessionData.isEmpty()) {
-            qDebug() << "No session data found for session ID:" << m_sessionId;
-            populateSensors(QJsonArray());
-            return;
+        // The catalog knows the sensors of this station from every session; fall back to the session itself
+        QList<QVariantMap> sensors = m_historyManager->catalogStationSensors(stationId);
+        if (sensors.isEmpty()) {
+            sensors = m_historyManager->loadStationSensors(m_sessionId, stationId);
         }
-
-        QVariantList sensors = sessionData["sensors"].toList();
         QJsonArray sensorsArray;
-        for (const QVariant &sensorVariant : sensors) {
-            QVariantMap sensor = sensorVariant.toMap();
-            if (sensor["stationId"].toInt() == stationId) {
-                QJsonObject sensorObj;
-                sensorObj["id"] = sensor["id"].toInt();
-                sensorObj["stationId"] = sensor["stationId"].toInt();
-                QJsonObject paramObj;
-                QVariantMap param = sensor["param"].toMap();
-                paramObj["paramName"] = param["paramName"].toString();
-                paramObj["paramFormula"] = param["paramFormula"].toString();
-                paramObj["paramCode"] = param["paramCode"].toString();
-                paramObj["idParam"] = param["idParam"].toInt();
-                sensorObj["param"] = paramObj;
-                sensorsArray.append(sensorObj);
-            }
+        for (const QVariantMap &sensor : sensors) {
+            QJsonObject sensorObj;
+            sensorObj["id"] = sensor["id"].toInt();
+            sensorObj["stationId"] = sensor["stationId"].toInt();
+            QJsonObject paramObj;
+            QVariantMap param = sensor["param"].toMap();
+            paramObj["paramName"] = param["paramName"].toString();
+            paramObj["paramFormula"] = param["paramFormula"].toString();
+            paramObj["paramCode"] = param["paramCode"].toString();
+            paramObj["idParam"] = param["idParam"].toInt();
+            sensorObj["param"] = paramObj;
+            sensorsArray.append(sensorObj);
         }
 
         if (sensorsArray.isEmpty()) {
@@ -194,30 +143,30 @@ void window_2_data_vis::fetchSensors(int stationId)
 /**
  * @brief Pobiera dane pomiarowe dla wybranego sensora.
  *
- * Jeśli połączenie internetowe jest dostępne, pobiera dane z API. W przeciwnym razie
- * ładuje pomiary z historii sesji.
+ * Jeśli połączenie internetowe jest dostępne, dodaje żądanie do kolejki pobierania
+ * z najwyższym priorytetem (żądanie pobierane już w tle nie jest wysyłane ponownie).
+ * W przeciwnym razie ładuje pomiary z historii sesji.
  *
  * @param sensorId Identyfikator sensora.
  */
 void window_2_data_vis::fetchMeasurementData(int sensorId)
 {
-    if (checkInternetConnection()) {
-        QUrl url("https://api.gios.gov.pl/pjp-api/rest/data/getData/" + QString::number(sensorId));
-        QNetworkRequest request(url);
+    if (ConnectivityMonitor::instance()->isOnline()) {
+        QUrl url = measurementUrl(sensorId);
         qDebug() << "Fetching measurement data for sensor ID:" << sensorId << "from:" << url.toString();
-        m_networkManager->get(request);
+        m_fetchScheduler->enqueue(QNetworkRequest(url), DISPLAY_PRIORITY);
     } else {
         qDebug() << "No internet connection. Loading measurements from history for sensor ID:" << sensorId;
-        QVariantMap sessionData = m_historyManager->loadSessionDetails(m_sessionId);
-        if (sessionData.isEmpty()) {
-            qDebug() << "No session data found for session ID:" << m_sessionId;
+
+        // Measurements kept in the shared series are queried by time range in aggregateData()
+        if (m_historyManager->catalogSensor(sensorId).contains("seriesFrom")) {
+            qDebug() << "Measurements for sensor ID:" << sensorId << "are kept in the history series";
             return;
         }
 
-        QVariantList sensors = sessionData["sensors"].toList();
+        const QList<QVariantMap> sensors = m_historyManager->loadStationSensors(m_sessionId, m_stationId);
         QJsonArray measurementsArray;
-        for (const QVariant &sensorVariant : sensors) {
-            QVariantMap sensor = sensorVariant.toMap();
+        for (const QVariantMap &sensor : sensors) {
             if (sensor["id"].toInt() == sensorId) {
                 QVariantList measurements = sensor["measurements"].toList();
                 for (const QVariant &measurementVariant : measurements) {
@@ -241,6 +190,37 @@ void window_2_data_vis::fetchMeasurementData(int sensorId)
     }
 }
 
+/**
+ * @brief Zwraca adres pomiarów sensora w API GIOŚ.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @return Adres żądania getData.
+ */
+QUrl window_2_data_vis::measurementUrl(int sensorId)
+{
+    return QUrl("https://api.gios.gov.pl/pjp-api/rest/data/getData/" + QString::number(sensorId));
+}
+
+/**
+ * @brief Rozpoczyna pobieranie w tle pomiarów wszystkich sensorów stacji.
+ *
+ * Żądania trafiają do kolejki z najniższym priorytetem, więc pomiary sensorów
+ * zaznaczonych przez użytkownika są pobierane przed pozostałymi. Odpowiedzi są
+ * obsługiwane przez onMeasurementReply(), zanim użytkownik kliknie „Wyświetl dane”.
+ *
+ * @param sensors Tablica JSON z danymi sensorów.
+ */
+void window_2_data_vis::prefetchMeasurements(const QJsonArray &sensors)
+{
+    for (const QJsonValue &value : sensors) {
+        int sensorId = value.toObject()["id"].toInt();
+        if (sensorId != 0 && !m_measurementData.contains(sensorId)) {
+            m_fetchScheduler->enqueue(QNetworkRequest(measurementUrl(sensorId)), PREFETCH_PRIORITY);
+        }
+    }
+    qDebug() << "Prefetching measurements of" << m_fetchScheduler->pendingCount() << "sensors for station ID:" << m_stationId;
+}
+
 /**
  * @brief Pobiera indeks jakości powietrza dla wybranej stacji.
  *
@@ -251,22 +231,15 @@ void window_2_data_vis::fetchMeasurementData(int sensorId)
  */
 void window_2_data_vis::fetchAirQualityIndex(int stationId)
 {
-    if (checkInternetConnection()) {
+    if (ConnectivityMonitor::instance()->isOnline()) {
         QUrl url("https://api.gios.gov.pl/pjp-api/rest/aqindex/getIndex/" + QString::number(stationId));
-        QNetworkRequest request(url);
         qDebug() << "Fetching air quality index for station ID:" << stationId << "from:" << url.toString();
-        m_networkManager->get(request);
+        RequestBroker::instance()->get(QNetworkRequest(url), DISPLAY_PRIORITY, this, [this](const RequestBroker::Response &response) {
+            onAirQualityReply(response);
+        });
     } else {
         qDebug() << "No internet connection. Loading air quality index from history for station ID:" << stationId;
-        QVariantMap sessionData = m_historyManager->loadSessionDetails(m_sessionId);
-        if (sessionData.isEmpty()) {
-            qDebug() << "No session data found for session ID:" << m_sessionId;
-            m_airQualityData = QJsonObject();
-            displayAirQuality();
-            return;
-        }
-
-        QVariantMap airQuality = sessionData["airQuality"].toMap();
+        QVariantMap airQuality = m_historyManager->loadSessionFields(m_sessionId, {"airQuality"}).value("airQuality").toMap();
         if (airQuality.isEmpty()) {
             qDebug() << "No air quality data found in history for session ID:" << m_sessionId;
             m_airQualityData = QJsonObject();
@@ -286,7 +259,7 @@ void window_2_data_vis::fetchAirQualityIndex(int stationId)
 /**
  * @brief Sprawdza poprawność identyfikatora sesji.
  *
- * Weryfikuje, czy podany identyfikator sesji jest niepusty i czy odpowiadający mu plik sesji istnieje.
+ * Weryfikuje, czy podany identyfikator sesji jest niepusty i czy sesja istnieje (lub czeka na zapis).
  *
  * @param sessionId Identyfikator sesji.
  * @return true, jeśli sesja jest ważna; false w przeciwnym razie.
@@ -297,10 +270,8 @@ bool window_2_data_vis::isValidSessionId(const QString &sessionId) const
         qDebug() << "Invalid session ID: empty";
         return false;
     }
-    QString sessionFile = QString("session_%1.json").arg(sessionId);
-    QFile file(m_historyManager->m_historyDir.filePath(sessionFile));
-    if (!file.exists()) {
-        qDebug() << "Invalid session ID: session file does not exist:" << sessionFile;
+    if (!m_historyManager->sessionExists(sessionId)) {
+        qDebug() << "Invalid session ID: session does not exist:" << sessionId;
         return false;
     }
     return true;
@@ -309,31 +280,28 @@ bool window_2_data_vis::isValidSessionId(const QString &sessionId) const
 /**
  * @brief Obsługuje odpowiedź sieciową dla żądania sensorów.
  *
- * Przetwarza dane sensorów z API, zapisuje je do historii sesji (jeśli sesja jest ważna)
- * i aktualizuje listę sensorów w interfejsie użytkownika.
+ * Przetwarza dane sensorów z API, zapisuje je do historii sesji (jeśli sesja jest ważna),
+ * aktualizuje listę sensorów w interfejsie użytkownika i rozpoczyna pobieranie w tle
+ * pomiarów wszystkich sensorów.
  *
- * @param reply Wskaźnik na odpowiedź sieciową.
+ * @param response Wynik żądania.
  */
-void window_2_data_vis::onSensorReply(QNetworkReply *reply)
+void window_2_data_vis::onSensorReply(const RequestBroker::Response &response)
 {
-    if (reply->error() != QNetworkReply::NoError) {
-        qDebug() << "Sensor fetch error:" << reply->errorString();
-        reply->deleteLater();
+    if (response.error != QNetworkReply::NoError) {
+        qDebug() << "Sensor fetch error:" << response.errorString;
         return;
     }
 
-    QByteArray responseData = reply->readAll();
-    qDebug() << "Sensor request reply for station ID" << m_stationId << ":" << responseData;
+    qDebug() << "Sensor request reply for station ID" << m_stationId << ":" << response.data.size() << "bytes";
 
-    QJsonDocument doc = QJsonDocument::fromJson(responseData);
-    if (doc.isNull() || !doc.isArray()) {
-        qDebug() << "Failed to parse sensor response as JSON array. Response:" << responseData;
-        reply->deleteLater();
+    if (response.json.isNull() || !response.json.isArray()) {
+        qDebug() << "Failed to parse sensor response as JSON array. Response:" << response.data;
         return;
     }
 
-    QJsonArray sensorsArray = doc.array();
-    qDebug() << "Parsed sensors array:" << QJsonDocument(sensorsArray).toJson(QJsonDocument::Indented);
+    QJsonArray sensorsArray = response.json.array();
+    qDebug() << "Parsed" << sensorsArray.size() << "sensors for station ID" << m_stationId;
 
     QList<QVariantMap> sensorsList;
     for (const QJsonValue &value : sensorsArray) {
@@ -361,8 +329,7 @@ void window_2_data_vis::onSensorReply(QNetworkReply *reply)
     }
 
     populateSensors(sensorsArray);
-
-    reply->deleteLater();
+    prefetchMeasurements(sensorsArray);
 }
 
 /**
@@ -370,26 +337,22 @@ void window_2_data_vis::onSensorReply(QNetworkReply *reply)
  *
  * Przetwarza dane pomiarowe z API, zapisuje je do historii sesji i przechowuje w lokalnej strukturze danych.
  *
- * @param reply Wskaźnik na odpowiedź sieciową.
+ * @param response Wynik żądania.
  */
-void window_2_data_vis::onMeasurementReply(QNetworkReply *reply)
+void window_2_data_vis::onMeasurementReply(const RequestBroker::Response &response)
 {
-    if (reply->error() != QNetworkReply::NoError) {
-        qDebug() << "Measurement fetch error:" << reply->errorString();
-        reply->deleteLater();
+    if (response.error != QNetworkReply::NoError) {
+        qDebug() << "Measurement fetch error:" << response.errorString;
         return;
     }
 
-    QByteArray responseData = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(responseData);
-    if (doc.isNull() || !doc.isObject()) {
-        qDebug() << "Failed to parse measurement response as JSON object. Response:" << responseData;
-        reply->deleteLater();
+    if (response.json.isNull() || !response.json.isObject()) {
+        qDebug() << "Failed to parse measurement response as JSON object. Response:" << response.data;
         return;
     }
 
-    QJsonObject obj = doc.object();
-    int sensorId = reply->url().toString().split("/").last().toInt();
+    QJsonObject obj = response.json.object();
+    int sensorId = response.url.toString().split("/").last().toInt();
     m_measurementData[sensorId] = obj["values"].toArray();
 
     QList<QVariantMap> measurementsList;
@@ -409,9 +372,7 @@ void window_2_data_vis::onMeasurementReply(QNetworkReply *reply)
         qDebug() << "Skipped saving measurements due to invalid session ID:" << m_sessionId;
     }
 
-    qDebug() << "Stored measurement data for sensor ID" << sensorId << ":" << QJsonDocument(obj).toJson(QJsonDocument::Indented);
-
-    reply->deleteLater();
+    qDebug() << "Stored" << values.size() << "measurements for sensor ID" << sensorId;
 }
 
 /**
@@ -420,25 +381,21 @@ void window_2_data_vis::onMeasurementReply(QNetworkReply *reply)
  * Przetwarza dane o jakości powietrza, zapisuje je do historii sesji i aktualizuje
  * wyświetlanie w interfejsie użytkownika.
  *
- * @param reply Wskaźnik na odpowiedź sieciową.
+ * @param response Wynik żądania.
  */
-void window_2_data_vis::onAirQualityReply(QNetworkReply *reply)
+void window_2_data_vis::onAirQualityReply(const RequestBroker::Response &response)
 {
-    if (reply->error() != QNetworkReply::NoError) {
-        qDebug() << "Air quality fetch error:" << reply->errorString();
-        reply->deleteLater();
+    if (response.error != QNetworkReply::NoError) {
+        qDebug() << "Air quality fetch error:" << response.errorString;
         return;
     }
 
-    QByteArray responseData = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(responseData);
-    if (doc.isNull() || !doc.isObject()) {
-        qDebug() << "Failed to parse air quality response as JSON object. Response:" << responseData;
-        reply->deleteLater();
+    if (response.json.isNull() || !response.json.isObject()) {
+        qDebug() << "Failed to parse air quality response as JSON object. Response:" << response.data;
         return;
     }
 
-    m_airQualityData = doc.object();
+    m_airQualityData = response.json.object();
     qDebug() << "Stored air quality data for station ID" << m_stationId << ":" << QJsonDocument(m_airQualityData).toJson(QJsonDocument::Indented);
 
     QVariantMap airQualityData;
@@ -454,13 +411,13 @@ void window_2_data_vis::onAirQualityReply(QNetworkReply *reply)
     }
 
     displayAirQuality();
-    reply->deleteLater();
 }
 
 /**
  * @brief Wypełnia listę sensorów w interfejsie użytkownika.
  *
  * Tworzy pola wyboru dla każdego sensora na podstawie danych z tablicy JSON.
+ * Zaznaczenie sensora podnosi priorytet pobierania jego pomiarów.
  * Jeśli brak sensorów, wyświetla odpowiedni komunikat.
  *
  * @param sensors Tablica JSON z danymi sensorów.
@@ -494,6 +451,11 @@ void window_2_data_vis::populateSensors(const QJsonArray &sensors)
             QString checkBoxText = QString("sensor: '%1' -> '%2'").arg(paramName, paramFormula);
             QCheckBox *checkBox = new QCheckBox(checkBoxText);
             checkBox->setProperty("sensorId", sensorId);
+            connect(checkBox, &QCheckBox::toggled, this, [this, sensorId](bool checked) {
+                if (checked) {
+                    m_fetchScheduler->boost(measurementUrl(sensorId), CHECKED_PRIORITY);
+                }
+            });
             m_sensorLayout->addWidget(checkBox);
             m_sensorCheckBoxes.append(checkBox);
             m_sensorIdToName[sensorId] = paramName;
@@ -572,17 +534,12 @@ void window_2_data_vis::displayAirQuality()
         calcDate = m_airQualityData["stCalcDate"].toString();
         QJsonObject indexLevelObj = m_airQualityData["stIndexLevel"].toObject();
         indexLevel = indexLevelObj["indexLevelName"].toString();
-    } else if (!checkInternetConnection()) {
-        QVariantMap sessionData = m_historyManager->loadSessionDetails(m_sessionId);
-        if (!sessionData.isEmpty()) {
-            QVariantMap airQuality = sessionData["airQuality"].toMap();
-            if (!airQuality.isEmpty()) {
-                calcDate = airQuality["stCalcDate"].toString();
-                indexLevel = airQuality["indexLevelName"].toString();
-                qDebug() << "Loaded air quality data from history: calcDate=" << calcDate << ", indexLevel=" << indexLevel;
-            } else {
-                indexLevel = "Niedostępne w trybie offline";
-            }
+    } else if (!ConnectivityMonitor::instance()->isOnline()) {
+        QVariantMap airQuality = m_historyManager->loadSessionFields(m_sessionId, {"airQuality"}).value("airQuality").toMap();
+        if (!airQuality.isEmpty()) {
+            calcDate = airQuality["stCalcDate"].toString();
+            indexLevel = airQuality["indexLevelName"].toString();
+            qDebug() << "Loaded air quality data from history: calcDate=" << calcDate << ", indexLevel=" << indexLevel;
         } else {
             indexLevel = "Niedostępne w trybie offline";
         }
@@ -621,14 +578,15 @@ void window_2_data_vis::onChartTypeClicked()
 /**
  * @brief Obsługuje kliknięcie przycisku wyświetlania danych.
  *
- * Inicjuje proces pobierania i agregacji danych dla wybranych sensorów i dat,
- * a następnie wyświetla wykresy i statystyki.
+ * Czeka na pomiary wybranych sensorów (pomiary pobrane w tle są dostępne od razu)
+ * i wyświetla statystyki oraz wykres każdego sensora, gdy tylko jego dane zostaną
+ * zagregowane. Sensory, których pomiary nie dotarły w ciągu DISPLAY_TIMEOUT_MS,
+ * są wyświetlane na podstawie historii.
  */
 void window_2_data_vis::onDisplayButtonClicked()
 {
     ui->listWidget->clear();
     displayAirQuality();
-    m_measurementData.clear();
 
     QList<int> selectedSensorIds;
     for (QCheckBox *checkBox : m_sensorCheckBoxes) {
@@ -654,69 +612,262 @@ void window_2_data_vis::onDisplayButtonClicked()
         return;
     }
 
-    //bool hasInternet = checkInternetConnection();
+    // Every click starts a new display; continuations of earlier clicks compare the generation and stop
+    const int generation = ++m_displayGeneration;
+    m_aggregatedData.clear();
+    m_pendingDisplaySensors = QSet<int>(selectedSensorIds.begin(), selectedSensorIds.end());
+    m_runningAggregations = 0;
+
+    // Pokazanie komunikatu ładowania
+    ui->listWidget->addItem("Agregowanie danych...");
+
+    // Each sensor is aggregated and drawn as soon as its measurements are available
     for (int sensorId : selectedSensorIds) {
+        measurementReady(sensorId).then(this, [this, sensorId, generation]() {
+            if (generation == m_displayGeneration && m_pendingDisplaySensors.remove(sensorId)) {
+                aggregateAndDisplaySensor(sensorId, generation, false);
+            }
+        });
+    }
+
+    // Sensors still waiting after the deadline are drawn from history; their late replies are kept for the next click
+    QTimer::singleShot(DISPLAY_TIMEOUT_MS, this, [this, generation]() {
+        if (generation != m_displayGeneration) {
+            return;
+        }
+        const QSet<int> lateSensorIds = m_pendingDisplaySensors;
+        m_pendingDisplaySensors.clear();
+        for (int sensorId : lateSensorIds) {
+            aggregateAndDisplaySensor(sensorId, generation, true);
+        }
+    });
+}
+
+/**
+ * @brief Zwraca przyszły wynik pobierania pomiarów sensora.
+ *
+ * Pomiary pobrane wcześniej (także w tle) oraz pomiary z historii w trybie offline
+ * są dostępne od razu. W pozostałych przypadkach żądanie jest dodawane do kolejki
+ * z najwyższym priorytetem, a wynik kończy się po odpowiedzi (także błędnej)
+ * w finishMeasurement().
+ *
+ * @param sensorId Identyfikator sensora.
+ * @return Przyszły wynik zakończony, gdy pomiary są dostępne lokalnie lub żądanie się zakończyło.
+ */
+QFuture<void> window_2_data_vis::measurementReady(int sensorId)
+{
+    if (!m_measurementData.contains(sensorId) && ConnectivityMonitor::instance()->isOnline()) {
+        auto it = m_measurementPromises.find(sensorId);
+        if (it == m_measurementPromises.end()) {
+            auto promise = std::make_shared<QPromise<void>>();
+            promise->start();
+            it = m_measurementPromises.insert(sensorId, promise);
+        }
         fetchMeasurementData(sensorId);
+        return it.value()->future();
     }
 
-    // Pokazanie komunikatu ładowania
-    ui->listWidget->addItem("Agregowanie danych...");
+    if (!m_measurementData.contains(sensorId)) {
+        fetchMeasurementData(sensorId);
+    }
+    QPromise<void> ready;
+    ready.start();
+    ready.finish();
+    return ready.future();
+}
+
+/**
+ * @brief Kończy oczekiwanie na pomiary sensora.
+ *
+ * Wywoływana po każdej odpowiedzi na żądanie pomiarów, także pobieranych w tle,
+ * na które nikt nie czeka.
+ *
+ * @param sensorId Identyfikator sensora.
+ */
+void window_2_data_vis::finishMeasurement(int sensorId)
+{
+    std::shared_ptr<QPromise<void>> promise = m_measurementPromises.take(sensorId);
+    if (promise) {
+        promise->finish();
+    }
+}
+
+/**
+ * @brief Agreguje w tle dane sensora i wyświetla jego wykres.
+ *
+ * Dane potrzebne do agregacji są kopiowane w wątku interfejsu, a agregacja i obliczenie
+ * statystyk wykresu działają w puli wątków (QtConcurrent). Wynik wraca do wątku interfejsu,
+ * jest dołączany do danych zagregowanych i od razu wyświetlany. Wynik wyświetlania, które zostało
+ * zastąpione nowym kliknięciem, jest pomijany. Po ostatnim sensorze usuwany jest
+ * komunikat ładowania.
+ *
+ * @param sensorId Identyfikator sensora.
+ * @param generation Numer wyświetlania, do którego należy sensor.
+ * @param timedOut Czy pomiary online nie dotarły na czas.
+ */
+void window_2_data_vis::aggregateAndDisplaySensor(int sensorId, int generation, bool timedOut)
+{
+    if (timedOut) {
+        qDebug() << "Measurements for sensor ID" << sensorId << "did not arrive within" << DISPLAY_TIMEOUT_MS << "ms, using history";
+        ui->listWidget->addItem(QString("Dane online dla sensora %1 nie dotarły na czas, wyświetlono dane z historii.")
+                                    .arg(m_sensorIdToName.value(sensorId)));
+    }
 
-    // Uruchomienie agregacji danych w osobnym wątku
-    std::thread t([this]() {
-        m_aggregatedData = aggregateData();
+    AggregationInput input{m_historyManager, m_stationId, m_sessionId, {sensorId}, m_selectedDates, m_sensorIdToName, {}};
+    if (m_measurementData.contains(sensorId)) {
+        input.measurementData.insert(sensorId, m_measurementData.value(sensorId));
+    }
+
+    m_runningAggregations++;
+    m_aggregationTasks.removeIf([](const QFuture<AggregationResult> &task) {
+        return task.isFinished();
+    });
+    QFuture<AggregationResult> task = QtConcurrent::run([input]() {
+        AggregationResult result;
+        result.data = aggregateData(input);
+        QSet<QString> sensorNames;
+        for (auto dateIt = result.data.cbegin(); dateIt != result.data.cend(); ++dateIt) {
+            for (auto sensorIt = dateIt.value().cbegin(); sensorIt != dateIt.value().cend(); ++sensorIt) {
+                sensorNames.insert(sensorIt.key());
+            }
+        }
+        for (const QString &sensorName : sensorNames) {
+            result.charts.append(computeChartData(result.data, sensorName, input.dates));
+        }
+        return result;
     });
+    m_aggregationTasks.append(task);
+    task.then(this, [this, generation](const AggregationResult &result) {
+        if (generation != m_displayGeneration) {
+            return;
+        }
+        m_runningAggregations--;
 
-    // Oczekiwanie na zakończenie wątku
-    t.join();
+        for (auto dateIt = result.data.cbegin(); dateIt != result.data.cend(); ++dateIt) {
+            for (auto sensorIt = dateIt.value().cbegin(); sensorIt != dateIt.value().cend(); ++sensorIt) {
+                m_aggregatedData[dateIt.key()][sensorIt.key()] = sensorIt.value();
+            }
+        }
+        for (const SensorChartData &chartData : result.charts) {
+            displaySensorChart(chartData);
+        }
 
-    // Usunięcie komunikatu ładowania
-    for (int i = 0; i < ui->listWidget->count(); ++i) {
-        if (ui->listWidget->item(i)->text() == "Agregowanie danych...") {
-            delete ui->listWidget->takeItem(i);
-            break;
+        if (!m_pendingDisplaySensors.isEmpty() || m_runningAggregations > 0) {
+            return;
         }
-    }
 
-    // Wyświetlenie wykresów z zagregowanymi danymi
-    displayCharts();//isLineChart);
+        // Usunięcie komunikatu ładowania
+        for (int i = 0; i < ui->listWidget->count(); ++i) {
+            if (ui->listWidget->item(i)->text() == "Agregowanie danych...") {
+                delete ui->listWidget->takeItem(i);
+                break;
+            }
+        }
+        if (m_aggregatedData.isEmpty()) {
+            ui->listWidget->addItem("Brak danych do wyświetlenia dla wybranych dat i sensorów.");
+        }
+    });
 }
 
 /**
  * @brief Agreguje dane pomiarowe według dat i sensorów.
  *
  * Łączy dane z historii sesji i dane online, organizując je według dat, nazw sensorów
- * i godzin pomiarów.
+ * i godzin pomiarów. Każda godzina ma jedną wartość: pomiar przetworzony później
+ * (w tym dane online) zastępuje wcześniejszy, zamiast być do niego dodawany.
+ * Funkcja korzysta tylko z kopii danych w input i z menedżera historii, więc może
+ * działać poza wątkiem interfejsu.
  *
+ * @param input Dane wejściowe agregacji.
  * @return Mapa z danymi zagregowanymi.
  */
-QMap<QDate, QMap<QString, QMap<int, double>>> window_2_data_vis::aggregateData()
+QMap<QDate, QMap<QString, QMap<int, double>>> window_2_data_vis::aggregateData(const AggregationInput &input)
 {
     QMap<QDate, QMap<QString, QMap<int, double>>> aggregatedData;
 
-    // Wczytanie danych sesji
-    QVariantMap sessionData = m_historyManager->loadSessionDetails(m_sessionId);
-    if (sessionData.isEmpty()) {
-        qDebug() << "No session data found for session ID:" << m_sessionId;
-        return aggregatedData;
+    const QSet<int> &selectedSensorIds = input.sensorIds;
+
+    // Selected dates as day numbers since the epoch, matching the series timestamps
+    const qint64 secondsPerDay = 24 * 3600;
+    const qint64 epochJulianDay = QDate(1970, 1, 1).toJulianDay();
+    QList<qint64> selectedDays;
+    for (const QDate &date : input.dates) {
+        selectedDays.append(date.toJulianDay() - epochJulianDay);
     }
 
-    QVariantList sensors = sessionData["sensors"].toList();
-    QSet<int> selectedSensorIds;
-    for (QCheckBox *checkBox : m_sensorCheckBoxes) {
-        if (checkBox->isChecked()) {
-            selectedSensorIds.insert(checkBox->property("sensorId").toInt());
+    // Agregacja danych z historii wszystkich sesji (katalog sensorów stacji)
+    QSet<int> seriesSensorIds;
+    const QList<QVariantMap> catalogSensors = input.historyManager->catalogStationSensors(input.stationId);
+    for (const QVariantMap &sensor : catalogSensors) {
+        int sensorId = sensor["id"].toInt();
+        if (!selectedSensorIds.contains(sensorId) || !sensor.contains("seriesFrom")) {
+            continue;
+        }
+        seriesSensorIds.insert(sensorId);
+        QString sensorName = sensor["param"].toMap()["paramName"].toString();
+        if (sensorName.isEmpty()) {
+            sensorName = input.sensorNames.value(sensorId);
+        }
+
+        // Query the shared series for each selected day within the range recorded by all sessions
+        const qint64 seriesFrom = sensor["seriesFrom"].toLongLong();
+        const qint64 seriesTo = sensor["seriesTo"].toLongLong();
+        for (qint64 day : selectedDays) {
+            qint64 from = qMax(seriesFrom, day * secondsPerDay);
+            qint64 to = qMin(seriesTo, (day + 1) * secondsPerDay - 1);
+            if (from > to) {
+                continue;
+            }
+            const QVector<MeasurementPoint> points = input.historyManager->loadMeasurements(sensorId, from, to);
+            QDate date = QDate::fromJulianDay(day + epochJulianDay);
+            for (const MeasurementPoint &point : points) {
+                if (point.valid && point.value != 0.0f) {
+                    int hour = int((point.timestamp - day * secondsPerDay) / 3600);
+                    aggregatedData[date][sensorName][hour] = point.value;
+                }
+            }
+            if (!points.isEmpty()) {
+                continue;
+            }
+
+            // Older days are kept only as rollups; plot the mean at the start of each bucket
+            const QVector<RollupPoint> rollups = input.historyManager->loadRollups(sensorId, from, to, SeriesStore::ROLLUP_BUCKET_SECONDS);
+            for (const RollupPoint &rollup : rollups) {
+                if (rollup.count > 0 && rollup.mean != 0.0f && rollup.timestamp >= day * secondsPerDay) {
+                    int hour = int((rollup.timestamp - day * secondsPerDay) / 3600);
+                    aggregatedData[date][sensorName][hour] = rollup.mean;
+                }
+            }
         }
     }
 
-    // Agregacja danych z historii
-    for (const QVariant &sensorVariant : sensors) {
-        QVariantMap sensor = sensorVariant.toMap();
+    // Sensors not in the catalog series, including measurements stored inside the session file by older versions
+    const QList<QVariantMap> sensors = input.historyManager->loadStationSensors(input.sessionId, input.stationId);
+    for (const QVariantMap &sensor : sensors) {
         int sensorId = sensor["id"].toInt();
-        if (!selectedSensorIds.contains(sensorId) || sensor["stationId"].toInt() != m_stationId) {
+        if (!selectedSensorIds.contains(sensorId) || seriesSensorIds.contains(sensorId)) {
             continue;
         }
         QString sensorName = sensor["param"].toMap()["paramName"].toString();
+
+        if (sensor.contains("seriesFrom")) {
+            const qint64 sessionFrom = sensor["seriesFrom"].toLongLong();
+            const qint64 sessionTo = sensor["seriesTo"].toLongLong();
+            for (qint64 day : selectedDays) {
+                qint64 from = qMax(sessionFrom, day * secondsPerDay);
+                qint64 to = qMin(sessionTo, (day + 1) * secondsPerDay - 1);
+                const QVector<MeasurementPoint> points = input.historyManager->loadMeasurements(sensorId, from, to);
+                QDate date = QDate::fromJulianDay(day + epochJulianDay);
+                for (const MeasurementPoint &point : points) {
+                    if (point.valid && point.value != 0.0f) {
+                        int hour = int((point.timestamp - day * secondsPerDay) / 3600);
+                        aggregatedData[date][sensorName][hour] = point.value;
+                    }
+                }
+            }
+            continue;
+        }
+
         QVariantList measurements = sensor["measurements"].toList();
 
         for (const QVariant &measurementVariant : measurements) {
@@ -729,25 +880,26 @@ QMap<QDate, QMap<QString, QMap<int, double>>> window_2_data_vis::aggregateData()
             }
 
             QDate date = dateTime.date();
-            if (!m_selectedDates.contains(date)) {
+            if (!input.dates.contains(date)) {
                 continue;
             }
 
             int hour = dateTime.time().hour();
             double value = measurement["value"].isValid() ? measurement["value"].toDouble() : 0.0;
             if (value != 0.0) {
-                aggregatedData[date][sensorName][hour] += value;
+                aggregatedData[date][sensorName][hour] = value;
             }
         }
     }
 
     // Włączenie danych online, jeśli dostępne
-    for (int sensorId : m_measurementData.keys()) {
+    for (auto it = input.measurementData.cbegin(); it != input.measurementData.cend(); ++it) {
+        int sensorId = it.key();
         if (!selectedSensorIds.contains(sensorId)) {
             continue;
         }
-        QString sensorName = m_sensorIdToName[sensorId];
-        QJsonArray values = m_measurementData[sensorId];
+        QString sensorName = input.sensorNames.value(sensorId);
+        const QJsonArray &values = it.value();
 
         for (const QJsonValue &value : values) {
             QJsonObject obj = value.toObject();
@@ -759,20 +911,20 @@ QMap<QDate, QMap<QString, QMap<int, double>>> window_2_data_vis::aggregateData()
             }
 
             QDate date = dateTime.date();
-            if (!m_selectedDates.contains(date)) {
+            if (!input.dates.contains(date)) {
                 continue;
             }
 
             int hour = dateTime.time().hour();
             double measurementValue = obj["value"].isNull() ? 0.0 : obj["value"].toDouble();
             if (measurementValue != 0.0) {
-                aggregatedData[date][sensorName][hour] += measurementValue;
+                aggregatedData[date][sensorName][hour] = measurementValue;
             }
         }
     }
 
     if (aggregatedData.isEmpty()) {
-        qDebug() << "No data aggregated for session ID:" << m_sessionId << "for selected dates and sensors";
+        qDebug() << "No data aggregated for session ID:" << input.sessionId << "for selected dates and sensors";
     } else {
         qDebug() << "Aggregated data for" << aggregatedData.size() << "dates and" << selectedSensorIds.size() << "sensors";
     }
@@ -781,274 +933,283 @@ QMap<QDate, QMap<QString, QMap<int, double>>> window_2_data_vis::aggregateData()
 }
 
 /**
- * @brief Wyświetla wykresy danych dla wybranych sensorów.
+ * @brief Oblicza statystyki i punkty wykresu jednego sensora.
  *
- * Tworzy wykresy liniowe dla każdego sensora, wyświetla statystyki (maksimum, minimum, średnia, trend)
- * i dodaje je do listy w interfejsie użytkownika.
+ * Dla jednego dnia punktami są godziny z pomiarem; dla kilku dni każda godzina każdego
+ * dnia (brak pomiaru jako 0). Trend jest wyznaczany z nachylenia prostej regresji.
+ * Funkcja korzysta tylko z przekazanych danych, więc działa w zadaniu agregacji poza
+ * wątkiem interfejsu.
  *
+ * @param aggregatedData Dane zagregowane.
+ * @param sensorName Nazwa sensora.
+ * @param dates Wybrane daty.
+ * @return Dane wykresu sensora.
  */
-void window_2_data_vis::displayCharts()//bool isLineChart)
+window_2_data_vis::SensorChartData window_2_data_vis::computeChartData(const QMap<QDate, QMap<QString, QMap<int, double>>> &aggregatedData,
+                                                                       const QString &sensorName, const QList<QDate> &dates)
 {
-    if (m_aggregatedData.isEmpty()) {
-        ui->listWidget->addItem("Brak danych do wyświetlenia dla wybranych dat i sensorów.");
-        return;
+    SensorChartData chartData;
+    chartData.sensorName = sensorName;
+    chartData.dates = dates;
+    std::sort(chartData.dates.begin(), chartData.dates.end());
+    const QList<QDate> &sortedDates = chartData.dates;
+    const bool singleDay = sortedDates.size() == 1;
+
+    double minValue = std::numeric_limits<double>::max();
+    double maxValue = std::numeric_limits<double>::lowest();
+    double sum = 0.0;
+    int count = 0;
+    QVector<QPointF> points;
+
+    if (singleDay) {
+        const QMap<int, double> hourlyData = aggregatedData.value(sortedDates.first()).value(sensorName);
+        for (int hour = 0; hour < 24; ++hour) {
+            double value = hourlyData.value(hour, 0.0);
+            if (value != 0.0) {
+                if (value < minValue) minValue = value;
+                if (value > maxValue) maxValue = value;
+                sum += value;
+                count++;
+                points.append(QPointF(hour, value));
+            }
+        }
+    } else {
+        QDate earliestDate = sortedDates.first();
+        for (const QDate &date : sortedDates) {
+            const QMap<int, double> hourlyData = aggregatedData.value(date).value(sensorName);
+            qint64 daysSinceEarliest = earliestDate.daysTo(date);
+            double xBase = daysSinceEarliest * 24.0;
+            for (int hour = 0; hour < 24; ++hour) {
+                double value = hourlyData.value(hour, 0.0);
+                if (value < minValue) minValue = value;
+                if (value > maxValue) maxValue = value;
+                sum += value;
+                count++;
+                double x = xBase + hour;
+                points.append(QPointF(x, value));
+            }
+        }
     }
 
-    bool singleDay = m_selectedDates.size() == 1;
-    QList<QDate> sortedDates = m_selectedDates;
-    std::sort(sortedDates.begin(), sortedDates.end());
-
-    // Przetwarzanie danych każdego sensora w osobnym wątku
-    for (const QString &sensorName : m_aggregatedData[sortedDates.first()].keys()) {
-        SensorChartData chartData;
-        chartData.sensorName = sensorName;
-
-        // Uruchomienie przetwarzania danych w osobnym wątku
-        std::thread t([this, &chartData, sensorName, singleDay, &sortedDates]() {
-            double minValue = std::numeric_limits<double>::max();
-            double maxValue = std::numeric_limits<double>::lowest();
-            double sum = 0.0;
-            int count = 0;
-            QVector<QPointF> points;
-
-            if (singleDay) {
-                QMap<int, double> hourlyData = m_aggregatedData[sortedDates.first()][sensorName];
-                for (int hour = 0; hour < 24; ++hour) {
-                    double value = hourlyData.value(hour, 0.0);
-                    if (value != 0.0) {
-                        if (value < minValue) minValue = value;
-                        if (value > maxValue) maxValue = value;
-                        sum += value;
-                        count++;
-                        points.append(QPointF(hour, value));
-                    }
-                }
-            } else {
-                QDate earliestDate = sortedDates.first();
-                for (const QDate &date : sortedDates) {
-                    QMap<int, double> hourlyData = m_aggregatedData[date][sensorName];
-                    qint64 daysSinceEarliest = earliestDate.daysTo(date);
-                    double xBase = daysSinceEarliest * 24.0;
-                    for (int hour = 0; hour < 24; ++hour) {
-                        double value = hourlyData.value(hour, 0.0);
-                        if (value < minValue) minValue = value;
-                        if (value > maxValue) maxValue = value;
-                        sum += value;
-                        count++;
-                        double x = xBase + hour;
-                        points.append(QPointF(x, value));
-                    }
-                }
-            }
+    chartData.average = count > 0 ? sum / count : 0.0;
 
-            chartData.average = count > 0 ? sum / count : 0.0;
+    if (points.size() >= 2) {
+        double sumX = 0.0, sumY = 0.0, sumXY = 0.0, sumXX = 0.0;
+        int n = points.size();
+        for (const QPointF &p : points) {
+            sumX += p.x();
+            sumY += p.y();
+            sumXY += p.x() * p.y();
+            sumXX += p.x() * p.x();
+        }
+        double m = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
+        if (std::abs(m) < 0.01) {
+            chartData.trend = "stabilny";
+        } else if (m > 0) {
+            chartData.trend = "rosnący";
+        } else {
+            chartData.trend = "malejący";
+        }
+    } else {
+        chartData.trend = "brak danych do analizy trendu";
+    }
 
-            if (points.size() >= 2) {
-                double sumX = 0.0, sumY = 0.0, sumXY = 0.0, sumXX = 0.0;
-                int n = points.size();
-                for (const QPointF &p : points) {
-                    sumX += p.x();
-                    sumY += p.y();
-                    sumXY += p.x() * p.y();
-                    sumXX += p.x() * p.x();
-                }
-                double m = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
-                if (std::abs(m) < 0.01) {
-                    chartData.trend = "stabilny";
-                } else if (m > 0) {
-                    chartData.trend = "rosnący";
-                } else {
-                    chartData.trend = "malejący";
-                }
-            } else {
-                chartData.trend = "brak danych do analizy trendu";
-            }
+    if (count == 0) {
+        minValue = 0.0;
+        maxValue = 0.0;
+        chartData.trend = "brak danych";
+    }
 
-            if (count == 0) {
-                minValue = 0.0;
-                maxValue = 0.0;
-                chartData.trend = "brak danych";
-            }
+    chartData.minValue = minValue;
+    chartData.maxValue = maxValue;
+    chartData.points = points;
+    return chartData;
+}
 
-            chartData.minValue = minValue;
-            chartData.maxValue = maxValue;
-            chartData.points = points;
-        });
+/**
+ * @brief Wyświetla statystyki i wykres jednego sensora.
+ *
+ * Tworzy wykres liniowy sensora z danych obliczonych w zadaniu agregacji, wyświetla
+ * statystyki (maksimum, minimum, średnia, trend) i dodaje je na końcu listy w interfejsie
+ * użytkownika.
+ *
+ * @param chartData Dane wykresu sensora.
+ */
+void window_2_data_vis::displaySensorChart(const SensorChartData &chartData)
+{
+    const QList<QDate> &sortedDates = chartData.dates;
+    bool singleDay = sortedDates.size() == 1;
 
-        // Oczekiwanie na zakończenie wątku
-        t.join();
-
-        // Tworzenie i wyświetlanie widżetu ze statystykami
-        QWidget *statsWidget = new QWidget();
-        QVBoxLayout *statsLayout = new QVBoxLayout(statsWidget);
-        statsLayout->setContentsMargins(5, 5, 5, 5);
-        statsLayout->setSpacing(4);
-
-        QLabel *titleLabel = new QLabel("<b>Statystyki dla: " + chartData.sensorName + "</b>");
-        QLabel *maxLabel = new QLabel(QString("<b>Wartość maksymalna:</b> %1").arg(chartData.maxValue, 0, 'f', 2));
-        QLabel *minLabel = new QLabel(QString("<b>Wartość minimalna:</b> %1").arg(chartData.minValue, 0, 'f', 2));
-        QLabel *avgLabel = new QLabel(QString("<b>Wartość średnia:</b> %1").arg(chartData.average, 0, 'f', 2));
-        QLabel *trendLabel = new QLabel("<b>Trend:</b> " + chartData.trend);
-
-        titleLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
-        maxLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
-        minLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
-        avgLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
-        trendLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
-
-        statsLayout->addWidget(titleLabel);
-        statsLayout->addWidget(maxLabel);
-        statsLayout->addWidget(minLabel);
-        statsLayout->addWidget(avgLabel);
-        statsLayout->addWidget(trendLabel);
-
-        QListWidgetItem *statsItem = new QListWidgetItem();
-        statsItem->setSizeHint(QSize(0, 150));
-        ui->listWidget->addItem(statsItem);
-        ui->listWidget->setItemWidget(statsItem, statsWidget);
-
-        // Tworzenie wykresu
-        m_chart = new QChart();
-        m_chart->setTitle(chartData.sensorName);
-        m_chart->setMargins(QMargins(50, 50, 50, 50));
-
-        QLineSeries *series = new QLineSeries();
-        series->setName(chartData.sensorName);
-        series->setPen(QPen(Qt::blue, 2));
-        series->setPointsVisible(true);
-        series->setPointLabelsVisible(true);
-        series->setPointLabelsFormat("@yPoint");
-        series->setPointLabelsClipping(false);
-
-        double maxY = chartData.maxValue;
-
-        for (const QPointF &point : chartData.points) {
-            series->append(point);
-        }
+    // Tworzenie i wyświetlanie widżetu ze statystykami
+    QWidget *statsWidget = new QWidget();
+    QVBoxLayout *statsLayout = new QVBoxLayout(statsWidget);
+    statsLayout->setContentsMargins(5, 5, 5, 5);
+    statsLayout->setSpacing(4);
 
-        if (singleDay) {
-            QValueAxis *axisX = new QValueAxis();
-            axisX->setTitleText("Czas (godziny)");
-            axisX->setRange(0, 23);
-            axisX->setTickCount(24);
-            axisX->setLabelFormat("%d");
-            axisX->setGridLineVisible(true);
-            axisX->setLabelsFont(QFont("Arial", 10, QFont::Bold));
-            axisX->setTitleFont(QFont("Arial", 12, QFont::Bold));
-            axisX->setLinePen(QPen(Qt::black, 2));
-            axisX->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
-
-            QValueAxis *axisY = new QValueAxis();
-            axisY->setTitleText(chartData.sensorName);
-            double yRange = maxY * 0.1;
-            double yMin = 0.0;
-            double yMax = maxY + yRange;
-            if (yMax <= 1.0) {
-                yMax = 10.0;
-            }
-            axisY->setRange(yMin, yMax);
-            int tickCount = std::min(10, std::max(5, static_cast<int>(yMax / 5)));
-            axisY->setTickCount(tickCount);
-            axisY->setLabelFormat("%.2f");
-            axisY->setGridLineVisible(true);
-            axisY->setLabelsFont(QFont("Arial", 10, QFont::Bold));
-            axisY->setTitleFont(QFont("Arial", 12, QFont::Bold));
-            axisY->setLinePen(QPen(Qt::black, 2));
-            axisY->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
-
-            m_chart->addSeries(series);
-            m_chart->addAxis(axisX, Qt::AlignBottom);
-            m_chart->addAxis(axisY, Qt::AlignLeft);
-            series->attachAxis(axisX);
-            series->attachAxis(axisY);
-
-            for (int i = 0; i < chartData.points.size(); ++i) {
-                if (chartData.points[i].y() > 0) {
-                    QPointF pos = m_chart->mapToPosition(chartData.points[i], series);
-                    QGraphicsEllipseItem *dot = new QGraphicsEllipseItem(m_chart);
-                    dot->setRect(pos.x() - 4, pos.y() - 4, 8, 8);
-                    dot->setBrush(QBrush(Qt::red));
-                    dot->setPen(QPen(Qt::black, 1));
-                    QGraphicsTextItem *label = new QGraphicsTextItem(QString::number(chartData.points[i].y(), 'f', 2), m_chart);
-                    label->setFont(QFont("Arial", 8));
-                    label->setDefaultTextColor(Qt::black);
-                    label->setPos(pos.x() - label->boundingRect().width() / 2,
-                                  pos.y() - label->boundingRect().height() - 5);
-                }
+    QLabel *titleLabel = new QLabel("<b>Statystyki dla: " + chartData.sensorName + "</b>");
+    QLabel *maxLabel = new QLabel(QString("<b>Wartość maksymalna:</b> %1").arg(chartData.maxValue, 0, 'f', 2));
+    QLabel *minLabel = new QLabel(QString("<b>Wartość minimalna:</b> %1").arg(chartData.minValue, 0, 'f', 2));
+    QLabel *avgLabel = new QLabel(QString("<b>Wartość średnia:</b> %1").arg(chartData.average, 0, 'f', 2));
+    QLabel *trendLabel = new QLabel("<b>Trend:</b> " + chartData.trend);
+
+    titleLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
+    maxLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
+    minLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
+    avgLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
+    trendLabel->setStyleSheet("font-size: 14px; color: #FFFFFF;");
+
+    statsLayout->addWidget(titleLabel);
+    statsLayout->addWidget(maxLabel);
+    statsLayout->addWidget(minLabel);
+    statsLayout->addWidget(avgLabel);
+    statsLayout->addWidget(trendLabel);
+
+    QListWidgetItem *statsItem = new QListWidgetItem();
+    statsItem->setSizeHint(QSize(0, 150));
+    ui->listWidget->addItem(statsItem);
+    ui->listWidget->setItemWidget(statsItem, statsWidget);
+
+    // Tworzenie wykresu
+    m_chart = new QChart();
+    m_chart->setTitle(chartData.sensorName);
+    m_chart->setMargins(QMargins(50, 50, 50, 50));
+
+    QLineSeries *series = new QLineSeries();
+    series->setName(chartData.sensorName);
+    series->setPen(QPen(Qt::blue, 2));
+    series->setPointsVisible(true);
+    series->setPointLabelsVisible(true);
+    series->setPointLabelsFormat("@yPoint");
+    series->setPointLabelsClipping(false);
+
+    double maxY = chartData.maxValue;
+
+    for (const QPointF &point : chartData.points) {
+        series->append(point);
+    }
+
+    if (singleDay) {
+        QValueAxis *axisX = new QValueAxis();
+        axisX->setTitleText("Czas (godziny)");
+        axisX->setRange(0, 23);
+        axisX->setTickCount(24);
+        axisX->setLabelFormat("%d");
+        axisX->setGridLineVisible(true);
+        axisX->setLabelsFont(QFont("Arial", 10, QFont::Bold));
+        axisX->setTitleFont(QFont("Arial", 12, QFont::Bold));
+        axisX->setLinePen(QPen(Qt::black, 2));
+        axisX->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
+
+        QValueAxis *axisY = new QValueAxis();
+        axisY->setTitleText(chartData.sensorName);
+        double yRange = maxY * 0.1;
+        double yMin = 0.0;
+        double yMax = maxY + yRange;
+        if (yMax <= 1.0) {
+            yMax = 10.0;
+        }
+        axisY->setRange(yMin, yMax);
+        int tickCount = std::min(10, std::max(5, static_cast<int>(yMax / 5)));
+        axisY->setTickCount(tickCount);
+        axisY->setLabelFormat("%.2f");
+        axisY->setGridLineVisible(true);
+        axisY->setLabelsFont(QFont("Arial", 10, QFont::Bold));
+        axisY->setTitleFont(QFont("Arial", 12, QFont::Bold));
+        axisY->setLinePen(QPen(Qt::black, 2));
+        axisY->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
+
+        m_chart->addSeries(series);
+        m_chart->addAxis(axisX, Qt::AlignBottom);
+        m_chart->addAxis(axisY, Qt::AlignLeft);
+        series->attachAxis(axisX);
+        series->attachAxis(axisY);
+
+        for (int i = 0; i < chartData.points.size(); ++i) {
+            if (chartData.points[i].y() > 0) {
+                QPointF pos = m_chart->mapToPosition(chartData.points[i], series);
+                QGraphicsEllipseItem *dot = new QGraphicsEllipseItem(m_chart);
+                dot->setRect(pos.x() - 4, pos.y() - 4, 8, 8);
+                dot->setBrush(QBrush(Qt::red));
+                dot->setPen(QPen(Qt::black, 1));
+                QGraphicsTextItem *label = new QGraphicsTextItem(QString::number(chartData.points[i].y(), 'f', 2), m_chart);
+                label->setFont(QFont("Arial", 8));
+                label->setDefaultTextColor(Qt::black);
+                label->setPos(pos.x() - label->boundingRect().width() / 2,
+                              pos.y() - label->boundingRect().height() - 5);
             }
-        } else {
-            QCategoryAxis *axisX = new QCategoryAxis();
-            axisX->setTitleText("Data i czas");
-            axisX->setGridLineVisible(true);
-            axisX->setLabelsFont(QFont("Arial", 10, QFont::Bold));
-            axisX->setTitleFont(QFont("Arial", 12, QFont::Bold));
-            axisX->setLinePen(QPen(Qt::black, 2));
-            axisX->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
-
-            QDate earliestDate = sortedDates.first();
-            for (const QDate &date : sortedDates) {
-                qint64 daysSinceEarliest = earliestDate.daysTo(date);
-                double xStart = daysSinceEarliest * 24.0;
-                double xEnd = xStart + 23.0;
-                axisX->append(date.toString("yyyy-MM-dd"), xEnd);
-                for (int hour = 0; hour < 24; ++hour) {
-                    double xHour = xStart + hour;
-                    axisX->append(QString("%1 %2").arg(date.toString("yyyy-MM-dd")).arg(hour, 2, 10, QChar('0')), xHour);
-                }
+        }
+    } else {
+        QCategoryAxis *axisX = new QCategoryAxis();
+        axisX->setTitleText("Data i czas");
+        axisX->setGridLineVisible(true);
+        axisX->setLabelsFont(QFont("Arial", 10, QFont::Bold));
+        axisX->setTitleFont(QFont("Arial", 12, QFont::Bold));
+        axisX->setLinePen(QPen(Qt::black, 2));
+        axisX->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
+
+        QDate earliestDate = sortedDates.first();
+        for (const QDate &date : sortedDates) {
+            qint64 daysSinceEarliest = earliestDate.daysTo(date);
+            double xStart = daysSinceEarliest * 24.0;
+            double xEnd = xStart + 23.0;
+            axisX->append(date.toString("yyyy-MM-dd"), xEnd);
+            for (int hour = 0; hour < 24; ++hour) {
+                double xHour = xStart + hour;
+                axisX->append(QString("%1 %2").arg(date.toString("yyyy-MM-dd")).arg(hour, 2, 10, QChar('0')), xHour);
             }
+        }
 
-            QDate latestDate = sortedDates.last();
-            qint64 daysSinceEarliest = earliestDate.daysTo(latestDate);
-            double xEnd = (daysSinceEarliest + 1) * 24.0;
-            axisX->setRange(0, xEnd);
-
-            QValueAxis *axisY = new QValueAxis();
-            axisY->setTitleText(chartData.sensorName);
-            double yRange = maxY * 0.1;
-            double yMin = 0.0;
-            double yMax = maxY + yRange;
-            if (yMax <= 1.0) {
-                yMax = 10.0;
-            }
-            axisY->setRange(yMin, yMax);
-            int tickCount = std::min(10, std::max(5, static_cast<int>(yMax / 5)));
-            axisY->setTickCount(tickCount);
-            axisY->setLabelFormat("%.2f");
-            axisY->setGridLineVisible(true);
-            axisY->setLabelsFont(QFont("Arial", 10, QFont::Bold));
-            axisY->setTitleFont(QFont("Arial", 12, QFont::Bold));
-            axisY->setLinePen(QPen(Qt::black, 2));
-            axisY->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
-
-            m_chart->addSeries(series);
-            m_chart->addAxis(axisX, Qt::AlignBottom);
-            m_chart->addAxis(axisY, Qt::AlignLeft);
-            series->attachAxis(axisX);
-            series->attachAxis(axisY);
-
-            for (int i = 0; i < chartData.points.size(); ++i) {
-                if (chartData.points[i].y() > 0) {
-                    QPointF pos = m_chart->mapToPosition(chartData.points[i], series);
-                    QGraphicsEllipseItem *dot = new QGraphicsEllipseItem(m_chart);
-                    dot->setRect(pos.x() - 4, pos.y() - 4, 8, 8);
-                    dot->setBrush(QBrush(Qt::red));
-                    dot->setPen(QPen(Qt::black, 1));
-                    QGraphicsTextItem *label = new QGraphicsTextItem(QString::number(chartData.points[i].y(), 'f', 2), m_chart);
-                    label->setFont(QFont("Arial", 8));
-                    label->setDefaultTextColor(Qt::black);
-                    label->setPos(pos.x() - label->boundingRect().width() / 2,
-                                  pos.y() - label->boundingRect().height() - 5);
-                }
+        QDate latestDate = sortedDates.last();
+        qint64 daysSinceEarliest = earliestDate.daysTo(latestDate);
+        double xEnd = (daysSinceEarliest + 1) * 24.0;
+        axisX->setRange(0, xEnd);
+
+        QValueAxis *axisY = new QValueAxis();
+        axisY->setTitleText(chartData.sensorName);
+        double yRange = maxY * 0.1;
+        double yMin = 0.0;
+        double yMax = maxY + yRange;
+        if (yMax <= 1.0) {
+            yMax = 10.0;
+        }
+        axisY->setRange(yMin, yMax);
+        int tickCount = std::min(10, std::max(5, static_cast<int>(yMax / 5)));
+        axisY->setTickCount(tickCount);
+        axisY->setLabelFormat("%.2f");
+        axisY->setGridLineVisible(true);
+        axisY->setLabelsFont(QFont("Arial", 10, QFont::Bold));
+        axisY->setTitleFont(QFont("Arial", 12, QFont::Bold));
+        axisY->setLinePen(QPen(Qt::black, 2));
+        axisY->setGridLinePen(QPen(Qt::gray, 1, Qt::DashLine));
+
+        m_chart->addSeries(series);
+        m_chart->addAxis(axisX, Qt::AlignBottom);
+        m_chart->addAxis(axisY, Qt::AlignLeft);
+        series->attachAxis(axisX);
+        series->attachAxis(axisY);
+
+        for (int i = 0; i < chartData.points.size(); ++i) {
+            if (chartData.points[i].y() > 0) {
+                QPointF pos = m_chart->mapToPosition(chartData.points[i], series);
+                QGraphicsEllipseItem *dot = new QGraphicsEllipseItem(m_chart);
+                dot->setRect(pos.x() - 4, pos.y() - 4, 8, 8);
+                dot->setBrush(QBrush(Qt::red));
+                dot->setPen(QPen(Qt::black, 1));
+                QGraphicsTextItem *label = new QGraphicsTextItem(QString::number(chartData.points[i].y(), 'f', 2), m_chart);
+                label->setFont(QFont("Arial", 8));
+                label->setDefaultTextColor(Qt::black);
+                label->setPos(pos.x() - label->boundingRect().width() / 2,
+                              pos.y() - label->boundingRect().height() - 5);
             }
         }
+    }
 
-        m_chartView = new QChartView(m_chart);
-        m_chartView->setRenderHint(QPainter::Antialiasing);
-        m_chartView->setMinimumSize(600, 400);
+    m_chartView = new QChartView(m_chart);
+    m_chartView->setRenderHint(QPainter::Antialiasing);
+    m_chartView->setMinimumSize(600, 400);
 
-        QListWidgetItem *item = new QListWidgetItem();
-        item->setSizeHint(QSize(600, 400));
-        ui->listWidget->addItem(item);
-        ui->listWidget->setItemWidget(item, m_chartView);
-    }
+    QListWidgetItem *item = new QListWidgetItem();
+    item->setSizeHint(QSize(600, 400));
+    ui->listWidget->addItem(item);
+    ui->listWidget->setItemWidget(item, m_chartView);
 }
@@ -1,19 +1,23 @@
 #ifndef WINDOW_2_DATA_VIS_H
 #define WINDOW_2_DATA_VIS_H
 #include <QDialog>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
 #include <QCheckBox>
 #include <QVBoxLayout>
 #include <QCalendarWidget>
 #include <QDate>
 #include <QMap>
 #include <QVector>
+#include <QFuture>
+#include <QPromise>
+#include <QSet>
 #include <QtCharts/QChart>
 #include <QtCharts/QChartView>
 #include <QtCharts/QLineSeries>
 #include <QtCore/qjsonobject.h>
 #include "historymanager.h"
+#include "fetchscheduler.h"
+#include "requestbroker.h"
+#include <memory>
 
 namespace Ui {
 class window_2_data_vis;
@@ -46,21 +50,21 @@ public:
 private slots:
     /**
      * @brief Obsługuje odpowiedź sieciową dla żądania sensorów.
-     * @param reply Wskaźnik na odpowiedź sieciową.
+     * @param response Wynik żądania.
      */
-    void onSensorReply(QNetworkReply *reply);
+    void onSensorReply(const RequestBroker::Response &response);
 
     /**
      * @brief Obsługuje odpowiedź sieciową dla żądania pomiarów.
-     * @param reply Wskaźnik na odpowiedź sieciową.
+     * @param response Wynik żądania.
      */
-    void onMeasurementReply(QNetworkReply *reply);
+    void onMeasurementReply(const RequestBroker::Response &response);
 
     /**
      * @brief Obsługuje odpowiedź sieciową dla żądania jakości powietrza.
-     * @param reply Wskaźnik na odpowiedź sieciową.
+     * @param response Wynik żądania.
      */
-    void onAirQualityReply(QNetworkReply *reply);
+    void onAirQualityReply(const RequestBroker::Response &response);
 
     /**
      * @brief Obsługuje kliknięcie daty w kalendarzu.
@@ -90,13 +94,31 @@ private:
         double average;     ///< Średnia wartość pomiarów.
         QString trend;      ///< Trend danych (rosnący, malejący, stabilny).
         QVector<QPointF> points; ///< Punkty danych dla wykresu.
+        QList<QDate> dates; ///< Wybrane daty w kolejności rosnącej.
     };
 
     /**
-     * @brief Sprawdza połączenie z internetem.
-     * @return true, jeśli połączenie istnieje; false w przeciwnym razie.
+     * @struct AggregationResult
+     * @brief Wynik agregacji sensora obliczony poza wątkiem interfejsu.
      */
-    bool checkInternetConnection();
+    struct AggregationResult {
+        QMap<QDate, QMap<QString, QMap<int, double>>> data; ///< Dane zagregowane.
+        QList<SensorChartData> charts;                      ///< Dane wykresów zagregowanych sensorów.
+    };
+
+    /**
+     * @struct AggregationInput
+     * @brief Kopia danych potrzebnych do agregacji poza wątkiem interfejsu.
+     */
+    struct AggregationInput {
+        HistoryManager *historyManager;        ///< Menedżer historii.
+        int stationId;                         ///< Identyfikator stacji.
+        QString sessionId;                     ///< Identyfikator sesji.
+        QSet<int> sensorIds;                   ///< Identyfikatory agregowanych sensorów.
+        QList<QDate> dates;                    ///< Wybrane daty.
+        QMap<int, QString> sensorNames;        ///< Nazwy sensorów według identyfikatora.
+        QMap<int, QJsonArray> measurementData; ///< Pomiary pobrane online.
+    };
 
     /**
      * @brief Pobiera dane sensorów dla stacji.
@@ -110,6 +132,19 @@ private:
      */
     void fetchMeasurementData(int sensorId);
 
+    /**
+     * @brief Zwraca adres pomiarów sensora w API GIOŚ.
+     * @param sensorId Identyfikator sensora.
+     * @return Adres żądania getData.
+     */
+    static QUrl measurementUrl(int sensorId);
+
+    /**
+     * @brief Rozpoczyna pobieranie w tle pomiarów wszystkich sensorów stacji.
+     * @param sensors Tablica JSON z danymi sensorów.
+     */
+    void prefetchMeasurements(const QJsonArray &sensors);
+
     /**
      * @brief Pobiera indeks jakości powietrza dla stacji.
      * @param stationId Identyfikator stacji.
@@ -128,10 +163,41 @@ private:
     void updateSelectedDatesDisplay();
 
     /**
-     * @brief Wyświetla wykresy danych.
-     * @param isLineChart Czy wyświetlić wykres liniowy.
+     * @brief Zwraca przyszły wynik pobierania pomiarów sensora.
+     * @param sensorId Identyfikator sensora.
+     * @return Przyszły wynik zakończony, gdy pomiary są dostępne lokalnie lub żądanie się zakończyło.
      */
-    void displayCharts();//bool isLineChart);
+    QFuture<void> measurementReady(int sensorId);
+
+    /**
+     * @brief Kończy oczekiwanie na pomiary sensora.
+     * @param sensorId Identyfikator sensora.
+     */
+    void finishMeasurement(int sensorId);
+
+    /**
+     * @brief Agreguje w tle dane sensora i wyświetla jego wykres.
+     * @param sensorId Identyfikator sensora.
+     * @param generation Numer wyświetlania, do którego należy sensor.
+     * @param timedOut Czy pomiary online nie dotarły na czas.
+     */
+    void aggregateAndDisplaySensor(int sensorId, int generation, bool timedOut);
+
+    /**
+     * @brief Oblicza statystyki i punkty wykresu jednego sensora.
+     * @param aggregatedData Dane zagregowane.
+     * @param sensorName Nazwa sensora.
+     * @param dates Wybrane daty.
+     * @return Dane wykresu sensora.
+     */
+    static SensorChartData computeChartData(const QMap<QDate, QMap<QString, QMap<int, double>>> &aggregatedData,
+                                            const QString &sensorName, const QList<QDate> &dates);
+
+    /**
+     * @brief Wyświetla statystyki i wykres jednego sensora.
+     * @param chartData Dane wykresu sensora.
+     */
+    void displaySensorChart(const SensorChartData &chartData);
 
     /**
      * @brief Wyświetla informacje o jakości powietrza.
@@ -140,9 +206,10 @@ private:
 
     /**
      * @brief Agreguje dane pomiarowe według dat i sensorów.
+     * @param input Dane wejściowe agregacji.
      * @return Mapa z danymi agregowanymi.
      */
-    QMap<QDate, QMap<QString, QMap<int, double>>> aggregateData();
+    static QMap<QDate, QMap<QString, QMap<int, double>>> aggregateData(const AggregationInput &input);
 
     /**
      * @brief Sprawdza poprawność identyfikatora sesji.
@@ -157,9 +224,59 @@ private:
     Ui::window_2_data_vis *ui;
 
     /**
-     * @brief Manager sieciowy do żądań HTTP.
+     * @brief Kolejka pobierania pomiarów sensorów.
+     */
+    FetchScheduler *m_fetchScheduler;
+
+    /**
+     * @brief Maksymalna liczba równoczesnych pobrań pomiarów.
+     */
+    static const int MAX_CONCURRENT_FETCHES = 3;
+
+    /**
+     * @brief Priorytet pobierania w tle pomiarów wszystkich sensorów.
+     */
+    static const int PREFETCH_PRIORITY = 0;
+
+    /**
+     * @brief Priorytet pomiarów zaznaczonego sensora.
+     */
+    static const int CHECKED_PRIORITY = 1;
+
+    /**
+     * @brief Priorytet pomiarów potrzebnych do wyświetlenia danych.
+     */
+    static const int DISPLAY_PRIORITY = 2;
+
+    /**
+     * @brief Czas oczekiwania na pomiary online po kliknięciu „Wyświetl dane” (ms).
+     */
+    static const int DISPLAY_TIMEOUT_MS = 15000;
+
+    /**
+     * @brief Oczekiwania na pomiary pobierane online, według identyfikatora sensora.
+     */
+    QMap<int, std::shared_ptr<QPromise<void>>> m_measurementPromises;
+
+    /**
+     * @brief Numer bieżącego wyświetlania (zwiększany przy każdym kliknięciu).
+     */
+    int m_displayGeneration;
+
+    /**
+     * @brief Sensory bieżącego wyświetlania, których wykres nie został jeszcze zagregowany.
+     */
+    QSet<int> m_pendingDisplaySensors;
+
+    /**
+     * @brief Liczba sensorów bieżącego wyświetlania, których agregacja jeszcze trwa.
+     */
+    int m_runningAggregations;
+
+    /**
+     * @brief Zadania agregacji w puli wątków (destruktor czeka na ich zakończenie).
      */
-    QNetworkAccessManager *m_networkManager;
+    QList<QFuture<AggregationResult>> m_aggregationTasks;
 
     /**
      * @brief Układ dla listy sensorów.